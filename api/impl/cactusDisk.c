@@ -15,7 +15,8 @@
 #define CACTUS_DISK_NAME_INCREMENT 16384
 #define CACTUS_DISK_BUCKET_NUMBER 65536
 #define CACTUS_DISK_PARAMETER_KEY -100000
-#define CACTUS_DISK_SEQUENCE_CHUNK_SIZE 500
+#define CACTUS_DISK_SEQUENCE_CHUNK_SIZE 65536
+#define CACTUS_DISK_PENDING_UPDATE_SIZE 67108864 //Serialised flowers are compressed once there are this many bytes of them.
 
 /*
  * Functions on meta sequences.
@@ -33,23 +34,32 @@ void cactusDisk_removeMetaSequence(CactusDisk *cactusDisk, MetaSequence *metaSeq
 
 /*
  * Functions on strings stored by the flower disk.
+ *
+ * A string is stored as a series of chunks of CACTUS_DISK_SEQUENCE_CHUNK_SIZE characters, each a packed
+ * string record (see cactusPackedString.c) keyed by the string's name plus the index of the chunk. The
+ * string cache holds the packed chunks, which are decoded as strings are requested.
  */
 
+static int64_t getChunkNumber(int64_t start, int64_t length) {
+    return length == 0 ? 0 : (start + length - 1) / CACTUS_DISK_SEQUENCE_CHUNK_SIZE - start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1;
+}
+
 Name cactusDisk_addString(CactusDisk *cactusDisk, const char *string) {
     /*
      * Adds a string to the database.
      */
     int64_t stringSize = strlen(string);
-    int64_t intervalSize = ceil((double) stringSize / CACTUS_DISK_SEQUENCE_CHUNK_SIZE);
+    int64_t intervalSize = getChunkNumber(0, stringSize);
     Name name = cactusDisk_getUniqueIDInterval(cactusDisk, intervalSize);
     stList *insertRequests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
     for (int64_t i = 0; i * CACTUS_DISK_SEQUENCE_CHUNK_SIZE < stringSize; i++) {
         int64_t j =
             (i + 1) * CACTUS_DISK_SEQUENCE_CHUNK_SIZE < stringSize ?
             CACTUS_DISK_SEQUENCE_CHUNK_SIZE : stringSize - i * CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
-        char *subString = stString_getSubString(string, i * CACTUS_DISK_SEQUENCE_CHUNK_SIZE, j);
-        stList_append(insertRequests, stKVDatabaseBulkRequest_constructInsertRequest(name + i, subString, j + 1));
-        free(subString);
+        int64_t recordSize;
+        void *record = packedString_encode(string + i * CACTUS_DISK_SEQUENCE_CHUNK_SIZE, j, &recordSize);
+        stList_append(insertRequests, stKVDatabaseBulkRequest_constructInsertRequest(name + i, record, recordSize));
+        free(record);
     }
     stTry
     {
@@ -136,24 +146,28 @@ static stList *mergeSubstrings(stList *substrings, int64_t proximityToMerge) {
     return mergedSubstrings;
 }
 
-static void cacheSubstringsFromDB(CactusDisk *cactusDisk, stList *substrings) {
+static void cacheSubstringsFromDB(CactusDisk *cactusDisk, stKVDatabase *database, stList *substrings) {
     if (cactusDisk->stringCache == NULL) {
         // No string cache.
         return;
     }
     /*
-     * Caches the given set of substrings in the cactusDisk cache.
+     * Caches the chunks of the given set of substrings in the cactusDisk cache, skipping those already cached.
      */
     stList *getRequests = stList_construct3(0, free);
+    Name pChunkName = NULL_NAME;
     for (int64_t i = 0; i < stList_length(substrings); i++) {
         Substring *substring = stList_get(substrings, i);
-        int64_t intervalSize = (substring->length + substring->start - 1) / CACTUS_DISK_SEQUENCE_CHUNK_SIZE
-            - substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1;
+        int64_t intervalSize = getChunkNumber(substring->start, substring->length);
         Name shiftedName = substring->name + substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
         for (int64_t j = 0; j < intervalSize; j++) {
-            int64_t *k = st_malloc(sizeof(int64_t));
-            k[0] = shiftedName + j;
-            stList_append(getRequests, k);
+            if (shiftedName + j != pChunkName
+                    && !stShardedCache_containsRecord(cactusDisk->stringCache, shiftedName + j)) {
+                int64_t *k = st_malloc(sizeof(int64_t));
+                k[0] = shiftedName + j;
+                stList_append(getRequests, k);
+            }
+            pChunkName = shiftedName + j; //Substrings are sorted, so repeated chunks are adjacent
         }
     }
     if (stList_length(getRequests) == 0) {
@@ -163,7 +177,7 @@ static void cacheSubstringsFromDB(CactusDisk *cactusDisk, stList *substrings) {
     stList *records = NULL;
     stTry
     {
-        records = stKVDatabase_bulkGetRecords(cactusDisk->database, getRequests);
+        records = stKVDatabase_bulkGetRecords(database, getRequests);
     }
     stCatch(except)
     {
@@ -173,33 +187,17 @@ static void cacheSubstringsFromDB(CactusDisk *cactusDisk, stList *substrings) {
          ;
     assert(records != NULL);
     assert(stList_length(records) == stList_length(getRequests));
-    stList_destruct(getRequests);
-    stListIterator *recordsIt = stList_getIterator(records);
-    for (int64_t i = 0; i < stList_length(substrings); i++) {
-        Substring *substring = stList_get(substrings, i);
-        int64_t intervalSize = (substring->length + substring->start - 1) / CACTUS_DISK_SEQUENCE_CHUNK_SIZE
-            - substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1;
-        stList *strings = stList_construct();
-        while (intervalSize-- > 0) {
-            int64_t recordSize;
-            stKVDatabaseBulkResult *result = stList_getNext(recordsIt);
-            assert(result != NULL);
-            char *string = stKVDatabaseBulkResult_getRecord(result, &recordSize);
-            assert(string != NULL);
-            assert(strlen(string) == recordSize - 1);
-            stList_append(strings, string);
-            assert(recordSize <= CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        int64_t recordSize;
+        void *record = stKVDatabaseBulkResult_getRecord(stList_get(records, i), &recordSize);
+        if (record == NULL) {
+            stThrowNew(CACTUS_DISK_EXCEPTION_ID, "The sequence record %" PRIi64 " is missing from the database",
+                    *(int64_t *) stList_get(getRequests, i));
         }
-        assert(stList_length(strings) > 0);
-        char *joinedString = stString_join2("", strings);
-        stCache_setRecord(cactusDisk->stringCache, substring->name,
-                          (substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE) * CACTUS_DISK_SEQUENCE_CHUNK_SIZE,
-                          strlen(joinedString), joinedString);
-        free(joinedString);
-        stList_destruct(strings);
-    }
-    assert(stList_getNext(recordsIt) == NULL);
-    stList_destructIterator(recordsIt);
+        assert(packedString_getLength(record, recordSize) <= CACTUS_DISK_SEQUENCE_CHUNK_SIZE);
+        stShardedCache_setRecord(cactusDisk->stringCache, *(int64_t *) stList_get(getRequests, i), record, recordSize);
+    }
+    stList_destruct(getRequests);
     stList_destruct(records);
 }
 
@@ -214,7 +212,7 @@ void cactusDisk_preCacheStrings2(CactusDisk *cactusDisk, stList *substrings) {
     //Now do some simple merging to reduce granularity
     stList *mergedSubstrings = mergeSubstrings(substrings, CACTUS_DISK_SEQUENCE_CHUNK_SIZE);
     //Now cache the sequences
-    cacheSubstringsFromDB(cactusDisk, mergedSubstrings);
+    cacheSubstringsFromDB(cactusDisk, cactusDisk->database, mergedSubstrings);
     stList_destruct(mergedSubstrings);
 }
 
@@ -312,29 +310,89 @@ void cactusDisk_preCacheSegmentStrings(CactusDisk *cactusDisk, stList *flowers)
     stList_destruct(substrings);
 }
 
+stList *cactusDisk_getSubstringsForFlowers(stList *flowers) {
+    stList *substrings = getSubstringsForFlowers(flowers);
+    stList *mergedSubstrings = mergeSubstrings(substrings, CACTUS_DISK_SEQUENCE_CHUNK_SIZE);
+    stList_destruct(substrings);
+    return mergedSubstrings;
+}
+
+void cactusDisk_cacheSubstrings(CactusDisk *cactusDisk, stKVDatabase *database, stList *substrings) {
+    cacheSubstringsFromDB(cactusDisk, database, substrings);
+}
+
+static void decodeChunk(const void *record, int64_t recordSize, int64_t chunkIndex, int64_t start, int64_t length, int64_t strand,
+        char *string) {
+    /*
+     * Decodes the part of the chunkIndex-th chunk of the interval [start, start + length) into its place in the string.
+     */
+    int64_t chunkStart = (start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + chunkIndex) * CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
+    int64_t pieceStart = start > chunkStart ? start : chunkStart;
+    int64_t pieceEnd = start + length < chunkStart + CACTUS_DISK_SEQUENCE_CHUNK_SIZE ?
+            start + length : chunkStart + CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
+    packedString_decode(record, recordSize, pieceStart - chunkStart, pieceEnd - pieceStart, strand,
+            string + (strand ? pieceStart - start : start + length - pieceEnd));
+}
+
+static char *getStringFromDB(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand) {
+    /*
+     * Gets a sequence directly from the database, for when it is too long to be held in the cache.
+     */
+    int64_t chunkNumber = getChunkNumber(start, length);
+    char *string = st_malloc(sizeof(char) * (length + 1));
+    for (int64_t i = 0; i < chunkNumber; i++) {
+        int64_t recordSize;
+        void *record = NULL;
+        stTry
+        {
+            record = stKVDatabase_getRecord2(cactusDisk->database, name + start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + i, &recordSize);
+        }
+        stCatch(except)
+        {
+            stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
+                            "An unknown database error occurred when getting a sequence string");
+        }stTryEnd
+             ;
+        if (record == NULL) {
+            stThrowNew(CACTUS_DISK_EXCEPTION_ID, "The sequence record %" PRIi64 " is missing from the database",
+                    name + start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + i);
+        }
+        decodeChunk(record, recordSize, i, start, length, strand, string);
+        free(record);
+    }
+    string[length] = '\0';
+    return string;
+}
+
+typedef struct _decodeArgs {
+    int64_t chunkIndex, start, length, strand;
+    char *string;
+} DecodeArgs;
+
+static void decodeCachedChunk(const void *record, int64_t recordSize, DecodeArgs *args) {
+    decodeChunk(record, recordSize, args->chunkIndex, args->start, args->length, args->strand, args->string);
+}
+
 char *cactusDisk_getStringFromCache(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand) {
     /*
-     * Gets a sequence from the cache.
+     * Gets a sequence from the cache, decoding the cached chunks straight into the returned string.
      */
     if (cactusDisk->stringCache == NULL) {
         // No cache.
         return NULL;
     }
-    char *string = NULL;
-    if (stCache_containsRecord(cactusDisk->stringCache, name, start, sizeof(char) * length)) {
-        int64_t recordSize;
-        string = stCache_getRecord(cactusDisk->stringCache, name, start, sizeof(char) * length, &recordSize);
-        assert(string != NULL);
-        assert(recordSize == length);
-        string = st_realloc(string, sizeof(char) * (length + 1));
-        string[length] = '\0';
-        if (!strand) {
-            char *string2 = stString_reverseComplementString(string);
-            free(string);
-            string = string2;
+    int64_t chunkNumber = getChunkNumber(start, length);
+    Name firstChunkName = name + start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
+    DecodeArgs args = { 0, start, length, strand, st_malloc(sizeof(char) * (length + 1)) };
+    for (; args.chunkIndex < chunkNumber; args.chunkIndex++) {
+        if (!stShardedCache_applyToRecord(cactusDisk->stringCache, firstChunkName + args.chunkIndex,
+                (void (*)(const void *, int64_t, void *)) decodeCachedChunk, &args)) {
+            free(args.string);
+            return NULL;
         }
     }
-    return string;
+    args.string[length] = '\0';
+    return args.string;
 }
 
 char *cactusDisk_getString(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand,
@@ -352,9 +410,12 @@ char *cactusDisk_getString(CactusDisk *cactusDisk, Name name, int64_t start, int
     if (string == NULL) { //If not in the cache, add it to the cache and then get it from the cache.
         stList *list = stList_construct3(0, (void (*)(void *)) substring_destruct);
         stList_append(list, substring_construct(name, start, length));
-        cacheSubstringsFromDB(cactusDisk, list);
+        cacheSubstringsFromDB(cactusDisk, cactusDisk->database, list);
         stList_destruct(list);
         string = cactusDisk_getStringFromCache(cactusDisk, name, start, length, strand);
+        if (string == NULL) { //There is no cache, or the string is bigger than it.
+            string = getStringFromDB(cactusDisk, name, start, length, strand);
+        }
     }
     assert(string != NULL);
     return string;
@@ -396,13 +457,28 @@ static void cactusDisk_loadFromBinaryRepresentation(void **binaryString, CactusD
 }
 
 /*
- * The following two functions compress and decompress the data in the cactus disk..
+ * The following functions compress and decompress the data in the cactus disk..
  */
 
-static void *compress(void *data, int64_t *dataSize) {
+typedef struct _pendingUpdate {
+    /*
+     * A serialised record waiting to be compressed and written.
+     */
+    Name name;
+    void *record;
+    int64_t recordSize;
+    bool insert;
+} PendingUpdate;
+
+static void pendingUpdate_destruct(PendingUpdate *pendingUpdate) {
+    free(pendingUpdate->record);
+    free(pendingUpdate);
+}
+
+static void *compress(CactusDisk *cactusDisk, void *data, int64_t *dataSize) {
     //Compression
     int64_t compressedSize;
-    void *data2 = stCompression_compress(data, *dataSize, &compressedSize, -1);
+    void *data2 = stCompression_compress2(data, *dataSize, &compressedSize, cactusDisk->codec, cactusDisk->compressionLevel);
     free(data);
     *dataSize = compressedSize;
     return data2;
@@ -416,14 +492,54 @@ static void *decompress(void *data, int64_t *dataSize) {
     return data2;
 }
 
-static stList *getRecords(CactusDisk *cactusDisk, stList *objectNames, char *type) {
-    if (stList_length(objectNames) == 0) {
-        return stList_construct3(0, NULL);
+static void decompressBulkResults(stList *results, stList *objectNames, stShardedCache *cache, int64_t threadNumber) {
+    /*
+     * Replaces the bulk results in the list (the entries that are not NULL) with their decompressed records,
+     * decompressing them as a batch, and adds the records to the cache if given.
+     */
+    int64_t recordNumber = stList_length(results), j = 0;
+    void **compressedRecords = st_malloc(sizeof(void *) * recordNumber);
+    void **records = st_malloc(sizeof(void *) * recordNumber);
+    int64_t *compressedSizes = st_malloc(sizeof(int64_t) * recordNumber);
+    int64_t *sizes = st_malloc(sizeof(int64_t) * recordNumber);
+    for (int64_t i = 0; i < recordNumber; i++) {
+        stKVDatabaseBulkResult *result = stList_get(results, i);
+        if (result != NULL) {
+            compressedRecords[j] = stKVDatabaseBulkResult_getRecord(result, &compressedSizes[j]);
+            if (compressedRecords[j] == NULL) {
+                free(compressedRecords);
+                free(records);
+                free(compressedSizes);
+                free(sizes);
+                stThrowNew(CACTUS_DISK_EXCEPTION_ID, "The record %" PRIi64 " is missing from the database",
+                        *(int64_t *) stList_get(objectNames, i));
+            }
+            j++;
+        }
     }
+    stCompression_decompressBulk(compressedRecords, compressedSizes, j, records, sizes, threadNumber);
+    j = 0;
+    for (int64_t i = 0; i < recordNumber; i++) {
+        stKVDatabaseBulkResult *result = stList_get(results, i);
+        if (result != NULL) {
+            if (cache != NULL) {
+                stShardedCache_setRecord(cache, *(int64_t *) stList_get(objectNames, i), records[j], sizes[j]);
+            }
+            stKVDatabaseBulkResult_destruct(result);
+            stList_set(results, i, records[j++]);
+        }
+    }
+    free(compressedRecords);
+    free(records);
+    free(compressedSizes);
+    free(sizes);
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *objectNames, char *type) {
     stList *records = NULL;
     stTry
         {
-            records = stKVDatabase_bulkGetRecords(cactusDisk->database, objectNames);
+            records = stKVDatabase_bulkGetRecords(database, objectNames);
         }
         stCatch(except)
             {
@@ -433,40 +549,53 @@ static stList *getRecords(CactusDisk *cactusDisk, stList *objectNames, char *typ
     ;
     assert(records != NULL);
     assert(stList_length(objectNames) == stList_length(records));
-    stList_setDestructor(records, free);
+    return records;
+}
+
+static stList *getRecords(CactusDisk *cactusDisk, stList *objectNames, char *type) {
+    if (stList_length(objectNames) == 0) {
+        return stList_construct3(0, NULL);
+    }
+    stList *records = bulkGetRecords(cactusDisk->database, objectNames, type);
+    //Records already in the cache are taken from it, the rest are decompressed together
+    stList *cachedRecords = stList_construct();
     for (int64_t i = 0; i < stList_length(objectNames); i++) {
         Name objectName = *((int64_t *) stList_get(objectNames, i));
         int64_t recordSize;
-        void *record;
-        stKVDatabaseBulkResult *result = stList_get(records, i);
-        assert(result != NULL);
-        if (cactusDisk->cache == NULL
-            || !stCache_containsRecord(cactusDisk->cache, objectName, 0, INT64_MAX)) {
-            record = stKVDatabaseBulkResult_getRecord(result, &recordSize);
-            assert(recordSize >= 0);
-            assert(record != NULL);
-            record = decompress(record, &recordSize);
-            if (cactusDisk->cache != NULL) {
-                stCache_setRecord(cactusDisk->cache, objectName, 0, recordSize, record);
-            }
-        } else {
-            record = stCache_getRecord(cactusDisk->cache, objectName, 0, INT64_MAX, &recordSize);
-            assert(recordSize >= 0);
-            assert(record != NULL);
+        void *record = cactusDisk->cache == NULL ? NULL :
+                stShardedCache_getRecord(cactusDisk->cache, objectName, &recordSize);
+        if (record != NULL) {
+            stKVDatabaseBulkResult_destruct(stList_get(records, i));
+            stList_set(records, i, NULL);
         }
-        stKVDatabaseBulkResult_destruct(result);
-        stList_set(records, i, record);
+        stList_append(cachedRecords, record);
+    }
+    decompressBulkResults(records, objectNames, cactusDisk->cache, cactusDisk->compressionThreads);
+    for (int64_t i = 0; i < stList_length(objectNames); i++) {
+        if (stList_get(cachedRecords, i) != NULL) {
+            stList_set(records, i, stList_get(cachedRecords, i));
+        }
+    }
+    stList_destruct(cachedRecords);
+    stList_setDestructor(records, free);
+    return records;
+}
+
+stList *cactusDisk_fetchRecords(CactusDisk *cactusDisk, stKVDatabase *database, stList *objectNames) {
+    if (stList_length(objectNames) == 0) {
+        return stList_construct3(0, free);
     }
+    stList *records = bulkGetRecords(database, objectNames, "prefetched records");
+    decompressBulkResults(records, objectNames, NULL, cactusDisk->compressionThreads);
+    stList_setDestructor(records, free);
     return records;
 }
 
 static void *getRecord(CactusDisk *cactusDisk, Name objectName, char *type, int64_t *size) {
     void *cA = NULL;
     int64_t recordSize = 0;
-    if (cactusDisk->cache != NULL
-        && stCache_containsRecord(cactusDisk->cache, objectName, 0, INT64_MAX)) { //If we already have the record, we won't update it.
-        cA = stCache_getRecord(cactusDisk->cache, objectName, 0, INT64_MAX, &recordSize);
-    } else {
+    if (cactusDisk->cache == NULL
+        || (cA = stShardedCache_getRecord(cactusDisk->cache, objectName, &recordSize)) == NULL) { //If we already have the record, we won't update it.
         stTry
             {
                 cA = stKVDatabase_getRecord2(cactusDisk->database, objectName, &recordSize);
@@ -487,7 +616,7 @@ static void *getRecord(CactusDisk *cactusDisk, Name objectName, char *type, int6
         cA = cA2;
         // Add the uncompressed record to the cache.
         if (cactusDisk->cache != NULL) {
-            stCache_setRecord(cactusDisk->cache, objectName, 0, recordSize, cA);
+            stShardedCache_setRecord(cactusDisk->cache, objectName, cA, recordSize);
         }
     }
     if (size != NULL) {
@@ -498,7 +627,7 @@ static void *getRecord(CactusDisk *cactusDisk, Name objectName, char *type, int6
 
 static bool containsRecord(CactusDisk *cactusDisk, Name objectName) {
     return (cactusDisk->cache != NULL
-            && stCache_containsRecord(cactusDisk->cache, objectName, 0, INT64_MAX))
+            && stShardedCache_containsRecord(cactusDisk->cache, objectName))
         || stKVDatabase_containsRecord(cactusDisk->database, objectName);
 }
 
@@ -511,6 +640,9 @@ static CactusDisk *cactusDisk_constructPrivate(stKVDatabaseConf *conf, bool crea
     cactusDisk->flowerNamesMarkedForDeletion = stSortedSet_construct3((int (*)(const void *, const void *)) strcmp,
             free);
     cactusDisk->updateRequests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    cactusDisk->pendingUpdates = stList_construct3(0, (void (*)(void *)) pendingUpdate_destruct);
+    cactusDisk->pendingUpdateSize = 0;
+    cactusDisk_setCompression(cactusDisk, ST_COMPRESSION_LZ4, -1, 1);
 
     cactusDisk->eventTree = NULL;
 
@@ -518,10 +650,10 @@ static CactusDisk *cactusDisk_constructPrivate(stKVDatabaseConf *conf, bool crea
     cactusDisk->database = stKVDatabase_construct(conf, create);
     if (cache) {
         // 10MB for general DB responses
-        cactusDisk->cache = stCache_construct2(10000000);
+        cactusDisk->cache = stShardedCache_construct(10000000, 0);
     }
     // 100MB for strings
-    cactusDisk->stringCache = stCache_construct2(10000000);
+    cactusDisk->stringCache = stShardedCache_construct(10000000, 0);
 
     //initialise the unique ids.
     int64_t seed = (clock() << 24) | (time(NULL) << 16) | (getpid() & 65535); //Likely to be unique
@@ -570,40 +702,88 @@ void cactusDisk_destruct(CactusDisk *cactusDisk) {
     stKVDatabase_destruct(cactusDisk->database);
 
     if (cactusDisk->cache != NULL) {
-        stCache_destruct(cactusDisk->cache);
+        stShardedCache_destruct(cactusDisk->cache);
     }
     if (cactusDisk->stringCache != NULL) {
-        stCache_destruct(cactusDisk->stringCache);
+        stShardedCache_destruct(cactusDisk->stringCache);
     }
 
     stList_destruct(cactusDisk->updateRequests);
+    stList_destruct(cactusDisk->pendingUpdates);
 
     free(cactusDisk);
 }
 
+void cactusDisk_setCompression(CactusDisk *cactusDisk, stCompressionCodec codec, int64_t level, int64_t threadNumber) {
+    cactusDisk->codec = codec;
+    cactusDisk->compressionLevel = level;
+    cactusDisk->compressionThreads = threadNumber > 0 ? threadNumber : 1;
+}
+
+static void flushPendingUpdates(CactusDisk *cactusDisk) {
+    /*
+     * Compresses the pending records as a batch, adding them to the update requests.
+     */
+    int64_t recordNumber = stList_length(cactusDisk->pendingUpdates);
+    void **records = st_malloc(sizeof(void *) * recordNumber);
+    void **compressedRecords = st_malloc(sizeof(void *) * recordNumber);
+    int64_t *sizes = st_malloc(sizeof(int64_t) * recordNumber);
+    int64_t *compressedSizes = st_malloc(sizeof(int64_t) * recordNumber);
+    for (int64_t i = 0; i < recordNumber; i++) {
+        PendingUpdate *pendingUpdate = stList_get(cactusDisk->pendingUpdates, i);
+        records[i] = pendingUpdate->record;
+        sizes[i] = pendingUpdate->recordSize;
+    }
+    stCompression_compressBulk(records, sizes, recordNumber, compressedRecords, compressedSizes, cactusDisk->codec,
+            cactusDisk->compressionLevel, cactusDisk->compressionThreads);
+    for (int64_t i = 0; i < recordNumber; i++) {
+        PendingUpdate *pendingUpdate = stList_get(cactusDisk->pendingUpdates, i);
+        stList_append(cactusDisk->updateRequests, pendingUpdate->insert ?
+                stKVDatabaseBulkRequest_constructInsertRequest(pendingUpdate->name, compressedRecords[i], compressedSizes[i]) :
+                stKVDatabaseBulkRequest_constructUpdateRequest(pendingUpdate->name, compressedRecords[i], compressedSizes[i]));
+        free(compressedRecords[i]);
+    }
+    free(records);
+    free(compressedRecords);
+    free(sizes);
+    free(compressedSizes);
+    stList_destruct(cactusDisk->pendingUpdates);
+    cactusDisk->pendingUpdates = stList_construct3(0, (void (*)(void *)) pendingUpdate_destruct);
+    cactusDisk->pendingUpdateSize = 0;
+}
+
+static void addPendingUpdate(CactusDisk *cactusDisk, Name name, void *record, int64_t recordSize, bool insert) {
+    PendingUpdate *pendingUpdate = st_malloc(sizeof(PendingUpdate));
+    pendingUpdate->name = name;
+    pendingUpdate->record = record;
+    pendingUpdate->recordSize = recordSize;
+    pendingUpdate->insert = insert;
+    stList_append(cactusDisk->pendingUpdates, pendingUpdate);
+    cactusDisk->pendingUpdateSize += recordSize;
+    if (cactusDisk->pendingUpdateSize >= CACTUS_DISK_PENDING_UPDATE_SIZE) {
+        flushPendingUpdates(cactusDisk);
+    }
+}
+
 void cactusDisk_addUpdateRequest(CactusDisk *cactusDisk, Flower *flower) {
     int64_t recordSize;
     void *vA = binaryRepresentation_makeBinaryRepresentation(flower,
             (void (*)(void *, void (*)(const void * ptr, size_t size, size_t count))) flower_writeBinaryRepresentation,
             &recordSize);
-    //Compression
-    int64_t compressedSize;
-    void *compressed = stCompression_compress(vA, recordSize, &compressedSize, -1);
     if (containsRecord(cactusDisk, flower_getName(flower))) {
         // Check if this is a redundant update.
         int64_t recordSize2;
         void *vA2 = getRecord(cactusDisk, flower_getName(flower), "flower", &recordSize2);
         if (!stCache_recordsIdentical(vA, recordSize, vA2, recordSize2)) { //Only rewrite if we actually did something
-            stList_append(cactusDisk->updateRequests,
-                    stKVDatabaseBulkRequest_constructUpdateRequest(flower_getName(flower), compressed, compressedSize));
+            addPendingUpdate(cactusDisk, flower_getName(flower), vA, recordSize, 0);
+            vA = NULL;
         }
         free(vA2);
     } else {
-        stList_append(cactusDisk->updateRequests,
-                stKVDatabaseBulkRequest_constructInsertRequest(flower_getName(flower), compressed, compressedSize));
+        addPendingUpdate(cactusDisk, flower_getName(flower), vA, recordSize, 1);
+        vA = NULL;
     }
     free(vA);
-    free(compressed);
 }
 
 void cactusDisk_forceParameterUpdate(CactusDisk *cactusDisk, bool keyAlreadyExists) {
@@ -613,7 +793,7 @@ void cactusDisk_forceParameterUpdate(CactusDisk *cactusDisk, bool keyAlreadyExis
                                                       (void (*)(void *, void (*)(const void * ptr, size_t size, size_t count))) cactusDisk_writeBinaryRepresentation,
                                                       &recordSize);
     //Compression
-    cactusDiskParameters = compress(cactusDiskParameters, &recordSize);
+    cactusDiskParameters = compress(cactusDisk, cactusDiskParameters, &recordSize);
     if (keyAlreadyExists) {
         stList_append(cactusDisk->updateRequests,
                       stKVDatabaseBulkRequest_constructUpdateRequest(CACTUS_DISK_PARAMETER_KEY, cactusDiskParameters,
@@ -641,6 +821,8 @@ void cactusDisk_write(CactusDisk *cactusDisk) {
     }
     stSortedSet_destructIterator(it);
 
+    flushPendingUpdates(cactusDisk); //Before the removals, so they are applied after the updates.
+
     st_logDebug("Got the flowers to update\n");
 
     //Remove nets that are marked for deletion..
@@ -665,18 +847,11 @@ void cactusDisk_write(CactusDisk *cactusDisk) {
                 binaryRepresentation_makeBinaryRepresentation(metaSequence,
                         (void (*)(void *, void (*)(const void * ptr, size_t size, size_t count))) metaSequence_writeBinaryRepresentation,
                         &recordSize);
-        //Compression
-        vA = compress(vA, &recordSize);
-        if (!containsRecord(cactusDisk, metaSequence_getName(metaSequence))) {
-            stList_append(cactusDisk->updateRequests,
-                    stKVDatabaseBulkRequest_constructInsertRequest(metaSequence_getName(metaSequence), vA, recordSize));
-        } else {
-            stList_append(cactusDisk->updateRequests,
-                    stKVDatabaseBulkRequest_constructUpdateRequest(metaSequence_getName(metaSequence), vA, recordSize));
-        }
-        free(vA);
+        addPendingUpdate(cactusDisk, metaSequence_getName(metaSequence), vA, recordSize,
+                !containsRecord(cactusDisk, metaSequence_getName(metaSequence)));
     }
     stSortedSet_destructIterator(it);
+    flushPendingUpdates(cactusDisk);
 
     st_logDebug("Got the sequences we are going to add to the database.\n");
 
@@ -726,8 +901,7 @@ void cactusDisk_write(CactusDisk *cactusDisk) {
     st_logDebug("Finished writing to the database\n");
 }
 
-stList *cactusDisk_getFlowers(CactusDisk *cactusDisk, stList *flowerNames) {
-    stList *records = getRecords(cactusDisk, flowerNames, "flowers");
+stList *cactusDisk_getFlowersFromRecords(CactusDisk *cactusDisk, stList *flowerNames, stList *records) {
     assert(stList_length(flowerNames) == stList_length(records));
     stList *flowers = stList_construct();
     for (int64_t i = 0; i < stList_length(flowerNames); i++) {
@@ -744,6 +918,12 @@ stList *cactusDisk_getFlowers(CactusDisk *cactusDisk, stList *flowerNames) {
         }
         stList_append(flowers, flower2);
     }
+    return flowers;
+}
+
+stList *cactusDisk_getFlowers(CactusDisk *cactusDisk, stList *flowerNames) {
+    stList *records = getRecords(cactusDisk, flowerNames, "flowers");
+    stList *flowers = cactusDisk_getFlowersFromRecords(cactusDisk, flowerNames, records);
     stList_destruct(records);
     return flowers;
 }
@@ -778,7 +958,9 @@ MetaSequence *cactusDisk_getMetaSequence(CactusDisk *cactusDisk, Name metaSequen
         return NULL;
     }
     void *cA2 = cA;
+    bool compact = binaryRepresentation_pauseCompactReading(); //We may be loading the sequences of a flower
     metaSequence2 = metaSequence_loadFromBinaryRepresentation(&cA2, cactusDisk);
+    binaryRepresentation_resumeCompactReading(compact);
     free(cA);
     return metaSequence2;
 }
@@ -903,11 +1085,11 @@ int64_t cactusDisk_getUniqueID(CactusDisk *cactusDisk) {
 }
 
 void cactusDisk_clearStringCache(CactusDisk *cactusDisk) {
-    stCache_clear(cactusDisk->stringCache);
+    stShardedCache_clear(cactusDisk->stringCache);
 }
 
 void cactusDisk_clearCache(CactusDisk *cactusDisk) {
-    stCache_clear(cactusDisk->cache);
+    stShardedCache_clear(cactusDisk->cache);
 }
 
 EventTree *cactusDisk_getEventTree(CactusDisk *cactusDisk) {
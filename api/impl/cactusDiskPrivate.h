@@ -15,8 +15,13 @@ struct _cactusDisk {
     stSortedSet *flowers;
     stSortedSet *flowerNamesMarkedForDeletion;
     stList *updateRequests;
-    stCache *cache;
-    stCache *stringCache;
+    stList *pendingUpdates; //Serialised flowers to be compressed as a batch, then added to the update requests.
+    int64_t pendingUpdateSize;
+    stCompressionCodec codec;
+    int64_t compressionLevel;
+    int64_t compressionThreads;
+    stShardedCache *cache;
+    stShardedCache *stringCache;
     EventTree *eventTree;
     Name uniqueNumber;
     Name maxUniqueNumber;
@@ -90,6 +95,36 @@ char *cactusDisk_getString(CactusDisk *cactusDisk, Name name,
  */
 char *cactusDisk_getStringFromCache(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand);
 
+/*
+ * Functions used to prefetch flowers and strings from a thread other than the one using the cactus disk.
+ * They use only the given database connection, which must not be the cactus disk's own, and the
+ * cactus disk's string cache, which is safe to use concurrently.
+ */
+
+/*
+ * Gets the decompressed records with the given names from the given database, which may be a different
+ * connection to the cactus disk's. Only the compression settings of the cactus disk are used.
+ */
+stList *cactusDisk_fetchRecords(CactusDisk *cactusDisk, stKVDatabase *database, stList *objectNames);
+
+/*
+ * Loads the flowers with the given names from records returned by cactusDisk_fetchRecords,
+ * as cactusDisk_getFlowers. Must be called from the thread using the cactus disk.
+ */
+stList *cactusDisk_getFlowersFromRecords(CactusDisk *cactusDisk, stList *flowerNames, stList *records);
+
+/*
+ * Gets the sequence intervals of the given flowers that cactusDisk_preCacheStrings would cache. Must
+ * be called from the thread using the cactus disk, the returned list is freed with stList_destruct.
+ */
+stList *cactusDisk_getSubstringsForFlowers(stList *flowers);
+
+/*
+ * Caches the sequence intervals returned by cactusDisk_getSubstringsForFlowers in the string cache,
+ * reading them from the given database.
+ */
+void cactusDisk_cacheSubstrings(CactusDisk *cactusDisk, stKVDatabase *database, stList *substrings);
+
 /*
  * Set the event tree for this disk. (Hopefully this only happens once.)
  */
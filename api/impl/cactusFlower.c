@@ -905,7 +905,8 @@ void flower_writeBinaryRepresentation(Flower *flower, void(*writeFn)(const void
     Group *group;
     Chain *chain;
 
-    binaryRepresentation_writeElementType(CODE_FLOWER, writeFn);
+    binaryRepresentation_writeElementType(CODE_FLOWER_COMPACT, writeFn);
+    binaryRepresentation_setCompactWriting(1);
     binaryRepresentation_writeName(flower_getName(flower), writeFn);
     binaryRepresentation_writeBool(flower_builtBlocks(flower), writeFn);
     binaryRepresentation_writeBool(flower_builtTrees(flower), writeFn);
@@ -942,14 +943,17 @@ void flower_writeBinaryRepresentation(Flower *flower, void(*writeFn)(const void
     }
     flower_destructChainIterator(chainIterator);
 
-    binaryRepresentation_writeElementType(CODE_FLOWER, writeFn); //this avoids interpretting things wrong.
+    binaryRepresentation_writeElementType(CODE_FLOWER_COMPACT, writeFn); //this avoids interpretting things wrong.
+    binaryRepresentation_setCompactWriting(0);
 }
 
 Flower *flower_loadFromBinaryRepresentation(void **binaryString, CactusDisk *cactusDisk) {
     Flower *flower = NULL;
     bool buildFaces;
-    if (binaryRepresentation_peekNextElementType(*binaryString) == CODE_FLOWER) {
+    char flowerCode = binaryRepresentation_peekNextElementType(*binaryString);
+    if (flowerCode == CODE_FLOWER || flowerCode == CODE_FLOWER_COMPACT) { //Flowers written before the compact format are still read
         binaryRepresentation_popNextElementType(binaryString);
+        binaryRepresentation_setCompactReading(flowerCode == CODE_FLOWER_COMPACT);
         flower = flower_construct3(binaryRepresentation_getName(binaryString), cactusDisk);
         flower_setBuiltBlocks(flower, binaryRepresentation_getBool(binaryString));
         flower_setBuiltTrees(flower, binaryRepresentation_getBool(binaryString));
@@ -966,7 +970,10 @@ Flower *flower_loadFromBinaryRepresentation(void **binaryString, CactusDisk *cac
         while (chain_loadFromBinaryRepresentation(binaryString, flower) != NULL)
             ;
         flower_setBuildFaces(flower, buildFaces);
-        assert(binaryRepresentation_popNextElementType(binaryString) == CODE_FLOWER);
+        char endCode = binaryRepresentation_popNextElementType(binaryString);
+        (void) endCode;
+        assert(endCode == flowerCode);
+        binaryRepresentation_setCompactReading(0);
     }
     return flower;
 }
@@ -1,7 +1,11 @@
+#define _POSIX_C_SOURCE 200809L //For clock_gettime
+#include <pthread.h>
+#include <time.h>
 #include "sonLib.h"
 #include "cactusGlobalsPrivate.h"
 
 #define FLOWER_STREAM_BATCH_SIZE 50
+#define FLOWER_STREAM_PREFETCH_DEPTH 1
 
 struct _flowerWriter {
         stList *flowerNamesAndSizes;
@@ -174,24 +178,233 @@ stList *flowerWriter_parseFlowersFromStdin(CactusDisk *cactusDisk) {
     return flowers;
 }
 
-static FlowerStream *flowerStream_construct(stList *flowerNames, CactusDisk *cactusDisk) {
+/*
+ * Functions for the flower stream's prefetch thread, which fetches the records of the batches of
+ * flowers ahead of the stream, and the sequences of the batches already loaded.
+ */
+
+typedef struct _flowerStreamPrefetcher FlowerStreamPrefetcher;
+
+typedef struct _prefetchedBatch {
+    stList *names;
+    stList *records; //NULL until the batch is fetched.
+    char *error; //The message of the exception thrown fetching the batch, if any.
+} PrefetchedBatch;
+
+struct _flowerStreamPrefetcher {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    stKVDatabase *database; //The prefetch thread's own connection.
+    CactusDisk *cactusDisk; //Only the string cache and compression settings are used by the prefetch thread.
+    int64_t prefetchDepth;
+    PrefetchedBatch *batches;
+    int64_t batchNumber;
+    int64_t fetchedBatches;
+    int64_t consumedBatches;
+    stList *substringJobs; //Lists of substrings to cache, in the order the batches were loaded.
+    bool stop;
+    double consumerWait, fetchTime, prefetcherIdle;
+};
+
+static double getTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1.0e-9;
+}
+
+static void waitOnCondition(FlowerStreamPrefetcher *prefetcher, double *waitTime) {
+    double startTime = getTime();
+    pthread_cond_wait(&prefetcher->cond, &prefetcher->lock);
+    *waitTime += getTime() - startTime;
+}
+
+static void fetchBatch(FlowerStreamPrefetcher *prefetcher, PrefetchedBatch *batch) {
+    stTry {
+        stList *records = cactusDisk_fetchRecords(prefetcher->cactusDisk, prefetcher->database, batch->names);
+        pthread_mutex_lock(&prefetcher->lock);
+        batch->records = records;
+        pthread_mutex_unlock(&prefetcher->lock);
+    } stCatch(except) {
+        pthread_mutex_lock(&prefetcher->lock);
+        batch->error = stString_copy(stExcept_getMsg(except));
+        pthread_mutex_unlock(&prefetcher->lock);
+    } stTryEnd;
+}
+
+static void cacheSubstrings(FlowerStreamPrefetcher *prefetcher, stList *substrings) {
+    stTry {
+        cactusDisk_cacheSubstrings(prefetcher->cactusDisk, prefetcher->database, substrings);
+    } stCatch(except) {
+        //Not fatal, the strings are fetched as they are needed instead
+        st_logInfo("Failed to prefetch the sequences of a batch of flowers: %s\n", stExcept_getMsg(except));
+    } stTryEnd;
+    stList_destruct(substrings);
+}
+
+static void *prefetchBatches(void *arg) {
+    FlowerStreamPrefetcher *prefetcher = arg;
+    pthread_mutex_lock(&prefetcher->lock);
+    while (!prefetcher->stop) {
+        if (stList_length(prefetcher->substringJobs) > 0) {
+            //The sequences of the loaded batches come first, as they are needed sooner
+            stList *substrings = stList_remove(prefetcher->substringJobs, 0);
+            pthread_mutex_unlock(&prefetcher->lock);
+            double startTime = getTime();
+            cacheSubstrings(prefetcher, substrings);
+            pthread_mutex_lock(&prefetcher->lock);
+            prefetcher->fetchTime += getTime() - startTime;
+        } else if (prefetcher->fetchedBatches < prefetcher->batchNumber
+                && prefetcher->fetchedBatches - prefetcher->consumedBatches < prefetcher->prefetchDepth) {
+            PrefetchedBatch *batch = &prefetcher->batches[prefetcher->fetchedBatches];
+            pthread_mutex_unlock(&prefetcher->lock);
+            double startTime = getTime();
+            fetchBatch(prefetcher, batch);
+            pthread_mutex_lock(&prefetcher->lock);
+            prefetcher->fetchTime += getTime() - startTime;
+            prefetcher->fetchedBatches++;
+            pthread_cond_broadcast(&prefetcher->cond);
+        } else {
+            waitOnCondition(prefetcher, &prefetcher->prefetcherIdle);
+        }
+    }
+    pthread_mutex_unlock(&prefetcher->lock);
+    return NULL;
+}
+
+static bool isServerBacked(stKVDatabaseConf *conf) {
+    /*
+     * A second connection to a file-backed database would be a second handle on the same file in
+     * this process, which neither Tokyo Cabinet nor the log file database guard against.
+     */
+    stKVDatabaseType type = stKVDatabaseConf_getType(conf);
+    return type == stKVDatabaseTypeKyotoTycoon || type == stKVDatabaseTypeMySql || type == stKVDatabaseTypeRedis;
+}
+
+static FlowerStreamPrefetcher *prefetcher_construct(CactusDisk *cactusDisk, stList *flowerNames,
+        int64_t prefetchDepth) {
+    if (!isServerBacked(stKVDatabase_getConf(cactusDisk->database))) {
+        st_logInfo("The database is not server-backed, so not prefetching flowers\n");
+        return NULL;
+    }
+    stKVDatabase *database = NULL;
+    stTry {
+        database = stKVDatabase_construct(stKVDatabase_getConf(cactusDisk->database), 0);
+    } stCatch(except) {
+        st_logInfo("Could not open a second connection to the database, so not prefetching flowers: %s\n",
+                stExcept_getMsg(except));
+    } stTryEnd;
+    if (database == NULL) {
+        return NULL;
+    }
+    FlowerStreamPrefetcher *prefetcher = st_calloc(1, sizeof(FlowerStreamPrefetcher));
+    prefetcher->database = database;
+    prefetcher->cactusDisk = cactusDisk;
+    prefetcher->prefetchDepth = prefetchDepth;
+    prefetcher->batchNumber = (stList_length(flowerNames) + FLOWER_STREAM_BATCH_SIZE - 1) / FLOWER_STREAM_BATCH_SIZE;
+    prefetcher->batches = st_calloc(prefetcher->batchNumber, sizeof(PrefetchedBatch));
+    for (int64_t i = 0; i < prefetcher->batchNumber; i++) {
+        int64_t batchEnd = (i + 1) * FLOWER_STREAM_BATCH_SIZE;
+        prefetcher->batches[i].names = stList_construct();
+        for (int64_t j = i * FLOWER_STREAM_BATCH_SIZE; j < batchEnd && j < stList_length(flowerNames); j++) {
+            stList_append(prefetcher->batches[i].names, stList_get(flowerNames, j));
+        }
+    }
+    prefetcher->substringJobs = stList_construct3(0, (void (*)(void *)) stList_destruct);
+    pthread_mutex_init(&prefetcher->lock, NULL);
+    pthread_cond_init(&prefetcher->cond, NULL);
+    if (pthread_create(&prefetcher->thread, NULL, prefetchBatches, prefetcher) != 0) {
+        st_errAbort("Could not create the flower prefetch thread");
+    }
+    return prefetcher;
+}
+
+static void prefetcher_destruct(FlowerStreamPrefetcher *prefetcher) {
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetcher->stop = 1;
+    pthread_cond_broadcast(&prefetcher->cond);
+    pthread_mutex_unlock(&prefetcher->lock);
+    pthread_join(prefetcher->thread, NULL);
+    st_logInfo("Flower stream waited %f seconds for prefetched flowers, the prefetch thread spent %f seconds "
+            "fetching and %f seconds idle\n", prefetcher->consumerWait, prefetcher->fetchTime, prefetcher->prefetcherIdle);
+    for (int64_t i = 0; i < prefetcher->batchNumber; i++) {
+        stList_destruct(prefetcher->batches[i].names);
+        if (prefetcher->batches[i].records != NULL) {
+            stList_destruct(prefetcher->batches[i].records);
+        }
+        free(prefetcher->batches[i].error);
+    }
+    free(prefetcher->batches);
+    stList_destruct(prefetcher->substringJobs);
+    pthread_mutex_destroy(&prefetcher->lock);
+    pthread_cond_destroy(&prefetcher->cond);
+    stKVDatabase_destruct(prefetcher->database);
+    free(prefetcher);
+}
+
+static stList *prefetcher_getBatch(FlowerStreamPrefetcher *prefetcher, int64_t batchIndex) {
+    /*
+     * Waits for the batch to be fetched, then takes its records.
+     */
+    assert(batchIndex == prefetcher->consumedBatches);
+    pthread_mutex_lock(&prefetcher->lock);
+    PrefetchedBatch *batch = &prefetcher->batches[batchIndex];
+    while (batch->records == NULL && batch->error == NULL) {
+        waitOnCondition(prefetcher, &prefetcher->consumerWait);
+    }
+    stList *records = batch->records;
+    batch->records = NULL;
+    prefetcher->consumedBatches++;
+    pthread_cond_broadcast(&prefetcher->cond);
+    pthread_mutex_unlock(&prefetcher->lock);
+    if (records == NULL) {
+        stThrowNew(CACTUS_DISK_EXCEPTION_ID, "Failed to prefetch a batch of flowers: %s", batch->error);
+    }
+    return records;
+}
+
+static void prefetcher_cacheSubstrings(FlowerStreamPrefetcher *prefetcher, stList *substrings) {
+    pthread_mutex_lock(&prefetcher->lock);
+    stList_append(prefetcher->substringJobs, substrings);
+    pthread_cond_broadcast(&prefetcher->cond);
+    pthread_mutex_unlock(&prefetcher->lock);
+}
+
+static FlowerStream *flowerStream_construct(stList *flowerNames, CactusDisk *cactusDisk, int64_t prefetchDepth,
+        bool preCacheStrings) {
     FlowerStream *ret = malloc(sizeof(FlowerStream));
     ret->flowerNames = flowerNames;
     ret->flowerBatch = stList_construct();
     ret->curFlower = NULL;
     ret->nextIdx = 0;
     ret->cactusDisk = cactusDisk;
+    ret->prefetcher = prefetchDepth > 0 && stList_length(flowerNames) > 0 ?
+            prefetcher_construct(cactusDisk, flowerNames, prefetchDepth) : NULL;
+    ret->preCacheStrings = preCacheStrings;
     return ret;
 }
 
-FlowerStream *flowerWriter_getFlowerStream(CactusDisk *cactusDisk, FILE *file) {
+FlowerStream *flowerWriter_getFlowerStream2(CactusDisk *cactusDisk, FILE *file, int64_t prefetchDepth,
+        bool preCacheStrings) {
     stList *flowerNamesList = flowerWriter_parseNames(file);
-    return flowerStream_construct(flowerNamesList, cactusDisk);
+    return flowerStream_construct(flowerNamesList, cactusDisk, prefetchDepth, preCacheStrings);
+}
+
+FlowerStream *flowerWriter_getFlowerStream(CactusDisk *cactusDisk, FILE *file) {
+    return flowerWriter_getFlowerStream2(cactusDisk, file, FLOWER_STREAM_PREFETCH_DEPTH, 0);
+}
+
+static void flowerStream_unloadCurrentFlower(FlowerStream *flowerStream) {
+    //Looked up by name, as the caller may already have unloaded it
+    if (flowerStream->curFlower != NULL && cactusDisk_flowerIsLoaded(flowerStream->cactusDisk, flowerStream->curFlowerName)) {
+        flower_destruct(cactusDisk_getFlower(flowerStream->cactusDisk, flowerStream->curFlowerName), false);
+    }
 }
 
 void flowerStream_destruct(FlowerStream *flowerStream) {
-    if (flowerStream->curFlower != NULL) {
-        flower_destruct(flowerStream->curFlower, false);
+    flowerStream_unloadCurrentFlower(flowerStream);
+    if (flowerStream->prefetcher != NULL) {
+        prefetcher_destruct(flowerStream->prefetcher);
     }
     stList_destruct(flowerStream->flowerBatch);
     stList_destruct(flowerStream->flowerNames);
@@ -199,10 +412,8 @@ void flowerStream_destruct(FlowerStream *flowerStream) {
 }
 
 Flower *flowerStream_getNext(FlowerStream *flowerStream) {
-    if (flowerStream->curFlower != NULL) {
-        // Unload the previously loaded flower.
-        flower_destruct(flowerStream->curFlower, false);
-    }
+    // Unload the previously loaded flower.
+    flowerStream_unloadCurrentFlower(flowerStream);
     if (flowerStream->nextIdx >= stList_length(flowerStream->flowerNames)) {
         flowerStream->curFlower = NULL;
         return NULL;
@@ -219,14 +430,29 @@ Flower *flowerStream_getNext(FlowerStream *flowerStream) {
         for (int64_t i = batchStart; i < batchEnd; i++) {
             stList_set(namesBatch, i - batchStart, stList_get(flowerStream->flowerNames, i));
         }
+        stList_destruct(flowerStream->flowerBatch);
+        if (flowerStream->prefetcher != NULL) {
+            assert(batchStart % FLOWER_STREAM_BATCH_SIZE == 0);
+            stList *records = prefetcher_getBatch(flowerStream->prefetcher, batchStart / FLOWER_STREAM_BATCH_SIZE);
+            flowerStream->flowerBatch = cactusDisk_getFlowersFromRecords(flowerStream->cactusDisk, namesBatch, records);
+            stList_destruct(records);
+            if (flowerStream->preCacheStrings) {
+                prefetcher_cacheSubstrings(flowerStream->prefetcher,
+                        cactusDisk_getSubstringsForFlowers(flowerStream->flowerBatch));
+            }
+        } else {
+            flowerStream->flowerBatch = cactusDisk_getFlowers(flowerStream->cactusDisk, namesBatch);
+            if (flowerStream->preCacheStrings) {
+                cactusDisk_preCacheStrings(flowerStream->cactusDisk, flowerStream->flowerBatch);
+            }
+        }
         // We want to be able to treat the batch like a stack and get
         // the same order, so we reverse it.
-        stList_reverse(namesBatch);
-        stList_destruct(flowerStream->flowerBatch);
-        flowerStream->flowerBatch = cactusDisk_getFlowers(flowerStream->cactusDisk, namesBatch);
+        stList_reverse(flowerStream->flowerBatch);
         stList_destruct(namesBatch);
     }
     flowerStream->curFlower = stList_pop(flowerStream->flowerBatch);
+    flowerStream->curFlowerName = flower_getName(flowerStream->curFlower);
     flowerStream->nextIdx++;
     return flowerStream->curFlower;
 }
@@ -234,3 +460,18 @@ Flower *flowerStream_getNext(FlowerStream *flowerStream) {
 int64_t flowerStream_size(const FlowerStream *flowerStream) {
     return stList_length(flowerStream->flowerNames);
 }
+
+void flowerStream_getWaitTimes(FlowerStream *flowerStream, double *consumerWait, double *fetchTime,
+        double *prefetcherIdle) {
+    *consumerWait = 0.0;
+    *fetchTime = 0.0;
+    *prefetcherIdle = 0.0;
+    FlowerStreamPrefetcher *prefetcher = flowerStream->prefetcher;
+    if (prefetcher != NULL) {
+        pthread_mutex_lock(&prefetcher->lock);
+        *consumerWait = prefetcher->consumerWait;
+        *fetchTime = prefetcher->fetchTime;
+        *prefetcherIdle = prefetcher->prefetcherIdle;
+        pthread_mutex_unlock(&prefetcher->lock);
+    }
+}
@@ -49,6 +49,7 @@
 #include "cactusFlower.h"
 #include "cactusDisk.h"
 #include "cactusDiskPrivate.h"
+#include "cactusPackedStringPrivate.h"
 #include "cactusMisc.h"
 #include "cactusFlowerPrivate.h"
 #include "cactusFace.h"
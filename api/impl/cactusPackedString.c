@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+#include <ctype.h>
+
+/*
+ * A packed record is laid out as:
+ *
+ * header | exception runs | mask runs | exception characters | two bit codes
+ *
+ * The two bit code of a base in an exception run is 0 and is overwritten on decoding by the run's
+ * character. Mask runs are lower cased after the bases and exceptions are decoded.
+ */
+
+#define PACKED_STRING_FORMAT 0x02 //Not a printable character, so can not be the start of an unpacked string.
+
+typedef struct _packedStringHeader {
+    uint8_t format;
+    uint8_t padding[3];
+    int32_t length;
+    int32_t exceptionRunNumber;
+    int32_t maskRunNumber;
+} PackedStringHeader;
+
+typedef struct _packedStringRun {
+    int32_t start;
+    int32_t length;
+} PackedStringRun;
+
+static const char *forwardBases = "ACGT";
+static const char *reverseBases = "TGCA";
+
+static int64_t getCode(char c) {
+    switch (c) {
+        case 'A':
+            return 0;
+        case 'C':
+            return 1;
+        case 'G':
+            return 2;
+        case 'T':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+static int64_t getPackedSize(int64_t length) {
+    return (length + 3) / 4;
+}
+
+static int64_t getExceptionCharactersSize(int64_t exceptionRunNumber) {
+    return (exceptionRunNumber + 3) / 4 * 4; //Keeps the codes 4 byte aligned
+}
+
+static const PackedStringHeader *getHeader(const void *record, int64_t recordSize) {
+    const PackedStringHeader *header = record;
+    if (recordSize < (int64_t) sizeof(PackedStringHeader) || header->format != PACKED_STRING_FORMAT) {
+        stThrowNew(CACTUS_DISK_EXCEPTION_ID,
+                "The sequence record is not a packed string, the database may have been written by an older version of cactus");
+    }
+    assert(recordSize == (int64_t) sizeof(PackedStringHeader)
+            + (header->exceptionRunNumber + header->maskRunNumber) * (int64_t) sizeof(PackedStringRun)
+            + getExceptionCharactersSize(header->exceptionRunNumber) + getPackedSize(header->length));
+    return header;
+}
+
+static void appendRun(stList *runs, int64_t start, int64_t length) {
+    PackedStringRun *run = st_malloc(sizeof(PackedStringRun));
+    run->start = start;
+    run->length = length;
+    stList_append(runs, run);
+}
+
+void *packedString_encode(const char *string, int64_t length, int64_t *recordSize) {
+    assert(length >= 0 && length <= INT32_MAX);
+    //Find the runs
+    stList *exceptionRuns = stList_construct3(0, free);
+    stList *exceptionCharacters = stList_construct();
+    stList *maskRuns = stList_construct3(0, free);
+    for (int64_t i = 0; i < length;) {
+        char c = toupper(string[i]);
+        int64_t j = i + 1;
+        if (getCode(c) == -1) {
+            while (j < length && toupper(string[j]) == c) {
+                j++;
+            }
+            appendRun(exceptionRuns, i, j - i);
+            stList_append(exceptionCharacters, (void *) (size_t) (unsigned char) c);
+        }
+        i = j;
+    }
+    for (int64_t i = 0; i < length;) {
+        int64_t j = i;
+        while (j < length && islower(string[j])) {
+            j++;
+        }
+        if (j > i) {
+            appendRun(maskRuns, i, j - i);
+            i = j;
+        } else {
+            i++;
+        }
+    }
+
+    //Write the record
+    int64_t exceptionRunNumber = stList_length(exceptionRuns), maskRunNumber = stList_length(maskRuns);
+    *recordSize = sizeof(PackedStringHeader) + (exceptionRunNumber + maskRunNumber) * sizeof(PackedStringRun)
+            + getExceptionCharactersSize(exceptionRunNumber) + getPackedSize(length);
+    char *record = st_calloc(*recordSize, sizeof(char));
+    PackedStringHeader *header = (PackedStringHeader *) record;
+    header->format = PACKED_STRING_FORMAT;
+    header->length = length;
+    header->exceptionRunNumber = exceptionRunNumber;
+    header->maskRunNumber = maskRunNumber;
+    PackedStringRun *runs = (PackedStringRun *) (record + sizeof(PackedStringHeader));
+    for (int64_t i = 0; i < exceptionRunNumber; i++) {
+        runs[i] = *(PackedStringRun *) stList_get(exceptionRuns, i);
+    }
+    for (int64_t i = 0; i < maskRunNumber; i++) {
+        runs[exceptionRunNumber + i] = *(PackedStringRun *) stList_get(maskRuns, i);
+    }
+    char *characters = (char *) (runs + exceptionRunNumber + maskRunNumber);
+    for (int64_t i = 0; i < exceptionRunNumber; i++) {
+        characters[i] = (char) (size_t) stList_get(exceptionCharacters, i);
+    }
+    uint8_t *codes = (uint8_t *) (characters + getExceptionCharactersSize(exceptionRunNumber));
+    for (int64_t i = 0; i < length; i++) {
+        int64_t code = getCode(toupper(string[i]));
+        if (code > 0) {
+            codes[i >> 2] |= code << ((i & 3) * 2);
+        }
+    }
+    stList_destruct(exceptionRuns);
+    stList_destruct(exceptionCharacters);
+    stList_destruct(maskRuns);
+    return record;
+}
+
+int64_t packedString_getLength(const void *record, int64_t recordSize) {
+    return getHeader(record, recordSize)->length;
+}
+
+/*
+ * Returns the index of the first run that ends after the given position.
+ */
+static int64_t getFirstRun(const PackedStringRun *runs, int64_t runNumber, int64_t position) {
+    int64_t i = 0, j = runNumber;
+    while (i < j) {
+        int64_t k = i + (j - i) / 2;
+        if (runs[k].start + runs[k].length <= position) {
+            i = k + 1;
+        } else {
+            j = k;
+        }
+    }
+    return i;
+}
+
+void packedString_decode(const void *record, int64_t recordSize, int64_t start, int64_t length, bool strand, char *buffer) {
+    const PackedStringHeader *header = getHeader(record, recordSize);
+    assert(start >= 0 && length >= 0 && start + length <= header->length);
+    const PackedStringRun *exceptionRuns = (const PackedStringRun *) ((const char *) record + sizeof(PackedStringHeader));
+    const PackedStringRun *maskRuns = exceptionRuns + header->exceptionRunNumber;
+    const char *characters = (const char *) (maskRuns + header->maskRunNumber);
+    const uint8_t *codes = (const uint8_t *) (characters + getExceptionCharactersSize(header->exceptionRunNumber));
+    int64_t end = start + length;
+
+    //The bases, in the output position for the strand
+    const char *bases = strand ? forwardBases : reverseBases;
+    for (int64_t i = start; i < end; i++) {
+        buffer[strand ? i - start : end - 1 - i] = bases[(codes[i >> 2] >> ((i & 3) * 2)) & 3];
+    }
+
+    //Exceptions
+    for (int64_t j = getFirstRun(exceptionRuns, header->exceptionRunNumber, start);
+            j < header->exceptionRunNumber && exceptionRuns[j].start < end; j++) {
+        char c = strand ? characters[j] : stString_reverseComplementChar(characters[j]);
+        int64_t runEnd = exceptionRuns[j].start + exceptionRuns[j].length;
+        for (int64_t i = exceptionRuns[j].start > start ? exceptionRuns[j].start : start; i < end && i < runEnd; i++) {
+            buffer[strand ? i - start : end - 1 - i] = c;
+        }
+    }
+
+    //Soft masking
+    for (int64_t j = getFirstRun(maskRuns, header->maskRunNumber, start); j < header->maskRunNumber && maskRuns[j].start < end;
+            j++) {
+        int64_t runEnd = maskRuns[j].start + maskRuns[j].length;
+        for (int64_t i = maskRuns[j].start > start ? maskRuns[j].start : start; i < end && i < runEnd; i++) {
+            char *c = &buffer[strand ? i - start : end - 1 - i];
+            *c = tolower(*c);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_PACKED_STRING_PRIVATE_H_
+#define CACTUS_PACKED_STRING_PRIVATE_H_
+
+#include "cactusGlobals.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Packed strings, the format in which the cactus disk stores sequence.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * Encodes the given string as a packed record, returned with its size in bytes. The bases A, C, G
+ * and T are stored in two bits each, runs of any other character (N, IUPAC codes) are kept in an
+ * exception list and runs of lower case (soft masked) characters in a mask list, so the encoding
+ * is lossless for any string.
+ */
+void *packedString_encode(const char *string, int64_t length, int64_t *recordSize);
+
+/*
+ * Returns the number of characters encoded in the record.
+ */
+int64_t packedString_getLength(const void *record, int64_t recordSize);
+
+/*
+ * Decodes length characters of the record, starting from start, into the given buffer. If strand
+ * is false the reverse complement of the substring is written. No terminating zero is written.
+ */
+void packedString_decode(const void *record, int64_t recordSize, int64_t start, int64_t length, bool strand, char *buffer);
+
+#endif
@@ -14,18 +14,107 @@
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
 
+/*
+ * State of the compact format, in which integers and names are delta coded against the previous value in
+ * the same position of the same type of element, then written as zig-zag varints. As the writer and reader
+ * process the elements in the same order they see the same previous values.
+ */
+
+#define COMPACT_FIELD_NUMBER 8 //Fields after this share the last previous value.
+
+typedef struct _compactState {
+    bool compact;
+    int64_t elementCode;
+    int64_t field;
+    uint64_t previousValues[CODE_NUMBER][COMPACT_FIELD_NUMBER];
+} CompactState;
+
+static __thread CompactState compactWriteState, compactReadState; //Per thread, as flowers may be parsed off the main thread
+
+static void compactState_reset(CompactState *state, bool compact) {
+	memset(state, 0, sizeof(CompactState));
+	state->compact = compact;
+}
+
+static void compactState_startElement(CompactState *state, char elementCode) {
+	state->elementCode = elementCode >= 0 && elementCode < CODE_NUMBER ? elementCode : 0;
+	state->field = 0;
+}
+
+static uint64_t *compactState_getPreviousValue(CompactState *state) {
+	uint64_t *previousValue = &state->previousValues[state->elementCode][state->field];
+	if (state->field < COMPACT_FIELD_NUMBER - 1) {
+		state->field++;
+	}
+	return previousValue;
+}
+
+void binaryRepresentation_setCompactWriting(bool compact) {
+	compactState_reset(&compactWriteState, compact);
+}
+
+void binaryRepresentation_setCompactReading(bool compact) {
+	compactState_reset(&compactReadState, compact);
+}
+
+bool binaryRepresentation_pauseCompactReading(void) {
+	bool compact = compactReadState.compact;
+	compactReadState.compact = 0;
+	return compact;
+}
+
+void binaryRepresentation_resumeCompactReading(bool compact) {
+	compactReadState.compact = compact;
+}
+
+static void writeCompactInteger(int64_t i, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
+	uint64_t *previousValue = compactState_getPreviousValue(&compactWriteState);
+	int64_t delta = (int64_t) ((uint64_t) i - *previousValue); //Wraps, so any two values have a delta
+	*previousValue = i;
+	uint64_t zigZag = ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+	uint8_t bytes[10];
+	int64_t j = 0;
+	while (zigZag >= 0x80) {
+		bytes[j++] = (uint8_t) (zigZag | 0x80);
+		zigZag >>= 7;
+	}
+	bytes[j++] = (uint8_t) zigZag;
+	writeFn(bytes, sizeof(uint8_t), j);
+}
+
+static int64_t getCompactInteger(void **binaryString) {
+	uint8_t *bytes = *binaryString;
+	uint64_t zigZag = 0;
+	int64_t shift = 0;
+	do {
+		zigZag |= (uint64_t) (*bytes & 0x7F) << shift;
+		shift += 7;
+	} while (*bytes++ & 0x80);
+	*binaryString = bytes;
+	uint64_t *previousValue = compactState_getPreviousValue(&compactReadState);
+	*previousValue += (zigZag >> 1) ^ -(zigZag & 1);
+	return (int64_t) *previousValue;
+}
+
 void binaryRepresentation_writeElementType(char elementCode, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
+	if (compactWriteState.compact) {
+		compactState_startElement(&compactWriteState, elementCode);
+	}
 	writeFn(&elementCode, sizeof(char), 1);
 }
 
 void binaryRepresentation_writeString(const char *name, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
 	int64_t i = strlen(name);
-	writeFn(&i, sizeof(int64_t), 1);
+	binaryRepresentation_writeInteger(i, writeFn);
 	writeFn(name, sizeof(char), i);
 }
 
 void binaryRepresentation_writeInteger(int64_t i, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
-	writeFn(&i, sizeof(int64_t), 1);
+	if (compactWriteState.compact) {
+		writeCompactInteger(i, writeFn);
+	} else {
+		writeFn(&i, sizeof(int64_t), 1);
+	}
 }
 
 void binaryRepresentation_writeName(Name name, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
@@ -48,6 +137,9 @@ char binaryRepresentation_popNextElementType(void **binaryString) {
 	char *c;
 	c = *binaryString;
 	*binaryString = c + 1;
+	if (compactReadState.compact) {
+		compactState_startElement(&compactReadState, *c);
+	}
 	return *c;
 }
 
@@ -72,6 +164,9 @@ const char *binaryRepresentation_getStringStatic(void **binaryString) {
 }
 
 int64_t binaryRepresentation_getInteger(void **binaryString) {
+	if (compactReadState.compact) {
+		return getCompactInteger(binaryString);
+	}
 	int64_t *i;
 	i = *binaryString;
 	*binaryString = i + 1;
@@ -46,6 +46,29 @@
 #define CODE_PSEUDO_CHROMOSOME 23
 #define CODE_PSEUDO_ADJACENCY 24
 #define CODE_CACTUS_DISK 25
+#define CODE_FLOWER_COMPACT 26
+#define CODE_NUMBER 27
+
+/*
+ * Sets if the integers and names written after are in the compact format, in which each is written as a
+ * zig-zag varint of its difference from the integer or name in the same position of the previous element
+ * of the same type. The compact format is used for flower records, so its state is reset by each call.
+ */
+void binaryRepresentation_setCompactWriting(bool compact);
+
+/*
+ * As binaryRepresentation_setCompactWriting, but for the integers and names parsed after.
+ */
+void binaryRepresentation_setCompactReading(bool compact);
+
+/*
+ * Stops parsing in the compact format, without losing the previous values, so a record in the raw format
+ * can be parsed while in the middle of a compact one (e.g. a meta sequence loaded while loading a flower).
+ * Returns the setting to pass to binaryRepresentation_resumeCompactReading once it is parsed.
+ */
+bool binaryRepresentation_pauseCompactReading(void);
+
+void binaryRepresentation_resumeCompactReading(bool compact);
 
 /*
  * Writes a code for the element type.
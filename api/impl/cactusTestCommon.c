@@ -14,10 +14,17 @@
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
 
+stKVDatabaseConf *testCommon_constructKVDatabaseConf(const char *databaseDir) {
+#ifdef HAVE_TOKYO_CABINET
+    return stKVDatabaseConf_constructTokyoCabinet(databaseDir);
+#else
+    return stKVDatabaseConf_constructLogFile(databaseDir);
+#endif
+}
+
 stKVDatabaseConf *testCommon_getTemporaryKVDatabaseConf() {
     testCommon_deleteTemporaryKVDatabase();
-    stKVDatabaseConf *conf = stKVDatabaseConf_constructTokyoCabinet(
-            "temporaryCactusDisk");
+    stKVDatabaseConf *conf = testCommon_constructKVDatabaseConf("temporaryCactusDisk");
     return conf;
 }
 
@@ -28,8 +35,7 @@ void testCommon_deleteTemporaryKVDatabase(void) {
 
 CactusDisk *testCommon_getTemporaryCactusDisk2(void) {
     testCommon_deleteTemporaryKVDatabase();
-    stKVDatabaseConf *conf = stKVDatabaseConf_constructTokyoCabinet(
-            "temporaryCactusDisk");
+    stKVDatabaseConf *conf = testCommon_constructKVDatabaseConf("temporaryCactusDisk");
     CactusDisk *cactusDisk;
     cactusDisk = cactusDisk_construct(conf, true, true);
     stKVDatabaseConf_destruct(conf);
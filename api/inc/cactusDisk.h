@@ -54,9 +54,17 @@ void cactusDisk_write(CactusDisk *cactusDisk);
 
 /*
  * This is used to serialise a flower before a call to a cactusDisk_write, it is exposed for use in the cactus_caf code.
+ * Flowers are compressed in batches, when enough are pending and by cactusDisk_write.
  */
 void cactusDisk_addUpdateRequest(CactusDisk *cactusDisk, Flower *flower);
 
+/*
+ * Sets the codec and level used to compress the records written by the cactus disk, and the number of threads
+ * used to compress and decompress batches of records. By default records are compressed with lz4 in the calling
+ * thread; more threads must be asked for explicitly. Records are readable whatever codec they were written with.
+ */
+void cactusDisk_setCompression(CactusDisk *cactusDisk, stCompressionCodec codec, int64_t level, int64_t threadNumber);
+
 /*
  * Gets a flower the cactusDisk contains. If the flower is not in memory it will be loaded. If not in memory or on disk, returns NULL.
  */
@@ -35,7 +35,10 @@ typedef struct {
     stList *flowerBatch;
     CactusDisk *cactusDisk;
     Flower *curFlower;
+    Name curFlowerName;
     size_t nextIdx;
+    struct _flowerStreamPrefetcher *prefetcher; //NULL if the flowers are loaded synchronously.
+    bool preCacheStrings;
 } FlowerStream;
 
 /*
@@ -45,10 +48,26 @@ typedef struct {
  * in memory at a time.)
  *
  * Flower loading/unloading is managed for you, so keeping a reference
- * to one of the flowers around will cause problems.
+ * to one of the flowers around will cause problems. The caller may unload
+ * the current flower itself, for example after writing it, in which case
+ * the stream does not unload it again.
  */
 FlowerStream *flowerWriter_getFlowerStream(CactusDisk *cactusDisk, FILE *file);
 
+/*
+ * As flowerWriter_getFlowerStream, but a background thread, with its own connection to the
+ * database, fetches and decompresses the records of the next prefetchDepth batches of flowers
+ * while the current flowers are processed. If preCacheStrings is non-zero the thread also caches
+ * the sequences of each batch of flowers, as cactusDisk_preCacheStrings, once the batch is loaded.
+ * If prefetchDepth is zero, or the database is not server-backed (Kyoto Tycoon, MySQL or Redis),
+ * or does not allow a second connection, the flowers are loaded synchronously. flowerWriter_getFlowerStream prefetches one batch, without strings.
+ *
+ * The flowers are read from the database as they are prefetched, so flowers still to be returned
+ * by the stream must not be written to the database while it is in use.
+ */
+FlowerStream *flowerWriter_getFlowerStream2(CactusDisk *cactusDisk, FILE *file, int64_t prefetchDepth,
+        bool preCacheStrings);
+
 /*
  * Free a flowerStream.
  */
@@ -66,4 +85,13 @@ Flower *flowerStream_getNext(FlowerStream *flowerStream);
  */
 int64_t flowerStream_size(const FlowerStream *flowerStream);
 
+/*
+ * Gets the time in seconds the stream has spent waiting for the background thread to deliver
+ * a batch of flowers, that the background thread has spent fetching flowers and strings from
+ * the database, and that it has spent idle because it was prefetchDepth batches ahead. All are zero
+ * if the stream does not prefetch. They are also logged when the stream is destructed.
+ */
+void flowerStream_getWaitTimes(FlowerStream *flowerStream, double *consumerWait, double *fetchTime,
+        double *prefetcherIdle);
+
 #endif
@@ -17,6 +17,12 @@
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
 
+/*
+ * Gets a conf for a file based KV database in the given directory. This is Tokyo Cabinet if sonLib
+ * was built with it, otherwise the embedded log file database, so the tests need no server or library.
+ */
+stKVDatabaseConf *testCommon_constructKVDatabaseConf(const char *databaseDir);
+
 /*
  * Gets a temporary KV database conf file suitable for building a database in.
  */
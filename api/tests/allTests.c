@@ -24,6 +24,7 @@ CuSuite *cactusFaceEndTestSuite();
 CuSuite *cactusSequenceTestSuite();
 CuSuite *cactusSerialisationTestSuite();
 CuSuite *cactusFlowerWriterTestSuite();
+CuSuite *cactusPackedStringTestSuite();
 
 
 int cactusAPIRunAllTests(void) {
@@ -47,6 +48,7 @@ int cactusAPIRunAllTests(void) {
 	CuSuiteAddSuite(suite, cactusSequenceTestSuite());
 	CuSuiteAddSuite(suite, cactusSerialisationTestSuite());
 	CuSuiteAddSuite(suite, cactusFlowerWriterTestSuite());
+	CuSuiteAddSuite(suite, cactusPackedStringTestSuite());
 	CuSuiteRun(suite);
 	CuSuiteSummary(suite, output);
 	CuSuiteDetails(suite, output);
@@ -58,6 +58,39 @@ void testCactusDisk_getFlower(CuTest* testCase) {
     cactusDiskTestTeardown();
 }
 
+void testCactusDisk_compression(CuTest* testCase) {
+    /*
+     * Flowers written with each codec are read back in bulk, including by a cactus disk using another codec.
+     */
+    stCompressionCodec codecs[] = { ST_COMPRESSION_LZ4, ST_COMPRESSION_LZ4HC, ST_COMPRESSION_ZLIB };
+    for (int64_t i = 0; i < 3; i++) {
+        cactusDiskTestSetup();
+        cactusDisk_setCompression(cactusDisk, codecs[i], -1, 3);
+        stList *names = stList_construct3(0, free);
+        for (int64_t j = 0; j < 100; j++) {
+            Flower *flower = flower_construct(cactusDisk);
+            end_construct(1, flower);
+            int64_t *name = st_malloc(sizeof(int64_t));
+            *name = flower_getName(flower);
+            stList_append(names, name);
+        }
+        cactusDisk_write(cactusDisk);
+        cactusDisk_destruct(cactusDisk);
+        cactusDisk = cactusDisk_construct(conf, false, true);
+        cactusDisk_setCompression(cactusDisk, codecs[(i + 1) % 3], -1, 2);
+        stList *flowers = cactusDisk_getFlowers(cactusDisk, names);
+        CuAssertIntEquals(testCase, 100, stList_length(flowers));
+        for (int64_t j = 0; j < stList_length(flowers); j++) {
+            Flower *flower = stList_get(flowers, j);
+            CuAssertTrue(testCase, flower_getName(flower) == *(int64_t *) stList_get(names, j));
+            CuAssertIntEquals(testCase, 1, flower_getEndNumber(flower));
+        }
+        stList_destruct(flowers);
+        stList_destruct(names);
+        cactusDiskTestTeardown();
+    }
+}
+
 void testCactusDisk_getMetaSequence(CuTest* testCase) {
     cactusDiskTestSetup();
     MetaSequence *metaSequence = metaSequence_construct(1, 10, "ACTGACTGAG",
@@ -138,6 +171,7 @@ CuSuite* cactusDiskTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testCactusDisk_write);
     SUITE_ADD_TEST(suite, testCactusDisk_getFlower);
+    SUITE_ADD_TEST(suite, testCactusDisk_compression);
     SUITE_ADD_TEST(suite, testCactusDisk_getMetaSequence);
     SUITE_ADD_TEST(suite, testCactusDisk_getUniqueID);
     SUITE_ADD_TEST(suite, testCactusDisk_getUniqueID_Unique);
@@ -523,6 +523,60 @@ void testFlower_removeIfRedundant(CuTest *testCase) {
     cactusFlowerTestTeardown();
 }
 
+static Name oldFormatFlowerName;
+
+static void writeOldFormatFlower(void *object, void(*writeFn)(const void * ptr, size_t size, size_t count)) {
+    /*
+     * A flower with a sequence, as written before the compact format.
+     */
+    int64_t name = oldFormatFlowerName, parentName = NULL_NAME, sequenceName = sequence_getName(object);
+    char code = CODE_FLOWER, sequenceCode = CODE_SEQUENCE;
+    bool built[] = { 1, 0, 0 };
+    writeFn(&code, sizeof(char), 1);
+    writeFn(&name, sizeof(int64_t), 1);
+    writeFn(built, sizeof(bool), 3);
+    writeFn(&parentName, sizeof(int64_t), 1);
+    writeFn(&sequenceCode, sizeof(char), 1);
+    writeFn(&sequenceName, sizeof(int64_t), 1);
+    writeFn(&code, sizeof(char), 1);
+}
+
+void testFlower_serialisation(CuTest *testCase) {
+    cactusFlowerTestSetup();
+    sequenceSetup();
+    endsSetup();
+    Name name = flower_getName(flower), endName = end_getName(end);
+    int64_t i;
+    void *vA = binaryRepresentation_makeBinaryRepresentation(flower,
+            (void(*)(void *, void(*)(const void *, size_t, size_t))) flower_writeBinaryRepresentation, &i);
+    CuAssertTrue(testCase, binaryRepresentation_peekNextElementType(vA) == CODE_FLOWER_COMPACT);
+    flower_destruct(flower, 0);
+    void *vA2 = vA;
+    flower = flower_loadFromBinaryRepresentation(&vA2, cactusDisk);
+    CuAssertTrue(testCase, (char *) vA2 - (char *) vA == i);
+    free(vA);
+    CuAssertTrue(testCase, flower_getName(flower) == name);
+    CuAssertTrue(testCase, cactusDisk_getFlower(cactusDisk, name) == flower);
+    CuAssertIntEquals(testCase, 2, flower_getSequenceNumber(flower));
+    CuAssertIntEquals(testCase, 2, flower_getEndNumber(flower));
+    CuAssertTrue(testCase, flower_getEnd(flower, endName) != NULL);
+
+    //Flowers in the old format can still be loaded
+    sequence = flower_getFirstSequence(flower);
+    oldFormatFlowerName = cactusDisk_getUniqueID(cactusDisk);
+    vA = binaryRepresentation_makeBinaryRepresentation(sequence, writeOldFormatFlower, &i);
+    vA2 = vA;
+    Flower *flower2 = flower_loadFromBinaryRepresentation(&vA2, cactusDisk);
+    CuAssertTrue(testCase, (char *) vA2 - (char *) vA == i);
+    free(vA);
+    CuAssertTrue(testCase, flower_getName(flower2) == oldFormatFlowerName);
+    CuAssertTrue(testCase, flower_builtBlocks(flower2));
+    CuAssertTrue(testCase, !flower_builtTrees(flower2));
+    CuAssertIntEquals(testCase, 1, flower_getSequenceNumber(flower2));
+    CuAssertTrue(testCase, sequence_getMetaSequence(flower_getFirstSequence(flower2)) == sequence_getMetaSequence(sequence));
+    cactusFlowerTestTeardown();
+}
+
 CuSuite* cactusFlowerTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testFlower_getName);
@@ -545,6 +599,7 @@ CuSuite* cactusFlowerTestSuite(void) {
     SUITE_ADD_TEST(suite, testFlower_isLeaf);
     SUITE_ADD_TEST(suite, testFlower_isTerminal);
     SUITE_ADD_TEST(suite, testFlower_removeIfRedundant);
+    SUITE_ADD_TEST(suite, testFlower_serialisation);
     SUITE_ADD_TEST(suite, testFlower_constructAndDestruct);
     return suite;
 }
@@ -53,6 +53,89 @@ static void testFlowerStream(CuTest *testCase) {
     testCommon_deleteTemporaryCactusDisk(cactusDisk);
 }
 
+static char *getThreadString(Flower *flower) {
+    Sequence *sequence = flower_getFirstSequence(flower);
+    return sequence == NULL ? NULL : sequence_getString(sequence, sequence_getStart(sequence),
+            sequence_getLength(sequence), 1);
+}
+
+static void testFlowerStreamP(CuTest *testCase, int64_t prefetchDepth, bool preCacheStrings) {
+    /*
+     * Streams enough flowers for several batches, some with a sequence.
+     */
+    CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+    eventTree_construct2(cactusDisk);
+    char *tempPath = getTempFile();
+    FILE *f = fopen(tempPath, "w");
+    int64_t flowerNumber = 137;
+    Name *flowerNames = st_malloc(sizeof(Name) * flowerNumber);
+    stList *strings = stList_construct3(0, free);
+    stList *flowers = stList_construct();
+    fprintf(f, "%" PRIi64, flowerNumber);
+    for (int64_t i = 0; i < flowerNumber; i++) {
+        Flower *flower = flower_construct(cactusDisk);
+        flowerNames[i] = flower_getName(flower);
+        fprintf(f, " %" PRIi64, i == 0 ? flowerNames[i] : flowerNames[i] - flowerNames[i - 1]);
+        if (i % 3 == 0) {
+            testCommon_addThreadToFlower(flower, "header", st_randomInt(1, 300));
+        }
+        stList_append(strings, getThreadString(flower));
+        stList_append(flowers, flower);
+    }
+    fclose(f);
+    cactusDisk_write(cactusDisk);
+    for (int64_t i = 0; i < flowerNumber; i++) {
+        flower_destruct(stList_get(flowers, i), false);
+    }
+    stList_destruct(flowers);
+
+    f = fopen(tempPath, "r");
+    FlowerStream *flowerStream = flowerWriter_getFlowerStream2(cactusDisk, f, prefetchDepth, preCacheStrings);
+    CuAssertIntEquals(testCase, flowerNumber, flowerStream_size(flowerStream));
+    int64_t i = 0;
+    Flower *flower;
+    while ((flower = flowerStream_getNext(flowerStream)) != NULL) {
+        CuAssertTrue(testCase, i < flowerNumber);
+        CuAssertIntEquals(testCase, flowerNames[i], flower_getName(flower));
+        char *string = getThreadString(flower);
+        if (stList_get(strings, i) == NULL) {
+            CuAssertTrue(testCase, string == NULL);
+        } else {
+            CuAssertStrEquals(testCase, stList_get(strings, i), string);
+        }
+        free(string);
+        i++;
+    }
+    CuAssertIntEquals(testCase, flowerNumber, i);
+    CuAssertIntEquals(testCase, 0, stSortedSet_size(cactusDisk->flowers));
+
+    double consumerWait, fetchTime, prefetcherIdle;
+    flowerStream_getWaitTimes(flowerStream, &consumerWait, &fetchTime, &prefetcherIdle);
+    CuAssertTrue(testCase, consumerWait >= 0.0 && fetchTime >= 0.0 && prefetcherIdle >= 0.0);
+    //Flowers are only prefetched from server-backed databases, which the temporary database is not
+    stKVDatabaseType type = stKVDatabaseConf_getType(stKVDatabase_getConf(cactusDisk->database));
+    if (prefetchDepth == 0 || type == stKVDatabaseTypeTokyoCabinet || type == stKVDatabaseTypeLogFile) {
+        CuAssertTrue(testCase, consumerWait == 0.0 && fetchTime == 0.0 && prefetcherIdle == 0.0);
+    }
+    flowerStream_destruct(flowerStream);
+    fclose(f);
+    removeTempFile(tempPath);
+    free(flowerNames);
+    stList_destruct(strings);
+    testCommon_deleteTemporaryCactusDisk(cactusDisk);
+}
+
+static void testFlowerStream_synchronous(CuTest *testCase) {
+    testFlowerStreamP(testCase, 0, 0);
+    testFlowerStreamP(testCase, 0, 1);
+}
+
+static void testFlowerStream_prefetch(CuTest *testCase) {
+    testFlowerStreamP(testCase, 1, 0);
+    testFlowerStreamP(testCase, 2, 1);
+    testFlowerStreamP(testCase, 10, 1);
+}
+
 static void testFlowerWriter(CuTest *testCase) {
     char *tempFile = "./flowerWriterTest.txt";
     FILE *fileHandle = fopen(tempFile, "w");
@@ -101,6 +184,8 @@ static void testFlowerWriter(CuTest *testCase) {
 CuSuite* cactusFlowerWriterTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testFlowerStream);
+    SUITE_ADD_TEST(suite, testFlowerStream_synchronous);
+    SUITE_ADD_TEST(suite, testFlowerStream_prefetch);
     SUITE_ADD_TEST(suite, testFlowerWriter);
     return suite;
 }
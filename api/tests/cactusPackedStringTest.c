@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+#include <ctype.h>
+
+static char *getRandomString(int64_t length) {
+    /*
+     * Mostly bases, with runs of Ns, IUPAC codes and other characters, and soft masked runs.
+     */
+    const char *others = "NRYKMSWBDHV-.*";
+    char *string = st_malloc(sizeof(char) * (length + 1));
+    for (int64_t i = 0; i < length;) {
+        int64_t runLength = st_randomInt(1, 50);
+        char c = st_random() > 0.1 ? 0 : others[st_randomInt(0, strlen(others))];
+        bool masked = st_random() > 0.7;
+        for (int64_t j = 0; j < runLength && i < length; j++, i++) {
+            string[i] = c != 0 ? c : "ACGT"[st_randomInt(0, 4)];
+            if (masked) {
+                string[i] = tolower(string[i]);
+            }
+        }
+    }
+    string[length] = '\0';
+    return string;
+}
+
+static void testPackedString_encodeAndDecode(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        int64_t length = st_randomInt(0, 5000);
+        char *string = getRandomString(length);
+        int64_t recordSize;
+        void *record = packedString_encode(string, length, &recordSize);
+        CuAssertIntEquals(testCase, length, packedString_getLength(record, recordSize));
+
+        //The whole string, on both strands
+        char *buffer = st_malloc(sizeof(char) * (length + 1));
+        buffer[length] = '\0';
+        packedString_decode(record, recordSize, 0, length, 1, buffer);
+        CuAssertStrEquals(testCase, string, buffer);
+        char *reverseString = stString_reverseComplementString(string);
+        packedString_decode(record, recordSize, 0, length, 0, buffer);
+        CuAssertStrEquals(testCase, reverseString, buffer);
+        free(reverseString);
+        free(buffer);
+
+        //Random substrings
+        for (int64_t i = 0; i < 100 && length > 0; i++) {
+            int64_t start = st_randomInt(0, length);
+            int64_t subLength = st_randomInt(0, length - start + 1);
+            bool strand = st_random() > 0.5;
+            char *subString = stString_getSubString(string, start, subLength);
+            if (!strand) {
+                char *subString2 = stString_reverseComplementString(subString);
+                free(subString);
+                subString = subString2;
+            }
+            buffer = st_malloc(sizeof(char) * (subLength + 1));
+            buffer[subLength] = '\0';
+            packedString_decode(record, recordSize, start, subLength, strand, buffer);
+            CuAssertStrEquals(testCase, subString, buffer);
+            free(buffer);
+            free(subString);
+        }
+        free(record);
+        free(string);
+    }
+}
+
+static void testPackedString_size(CuTest *testCase) {
+    /*
+     * Unmasked bases take two bits each.
+     */
+    int64_t length = 100000;
+    char *string = st_malloc(sizeof(char) * (length + 1));
+    for (int64_t i = 0; i < length; i++) {
+        string[i] = "ACGT"[st_randomInt(0, 4)];
+    }
+    string[length] = '\0';
+    int64_t recordSize;
+    void *record = packedString_encode(string, length, &recordSize);
+    CuAssertTrue(testCase, recordSize <= length / 4 + 32);
+    free(record);
+    free(string);
+}
+
+static void testPackedString_notPacked(CuTest *testCase) {
+    /*
+     * A record in the old, plain text format is refused.
+     */
+    const char *string = "ACGTACGTACGTACGTACGT";
+    char buffer[5];
+    stTry {
+        packedString_decode(string, strlen(string) + 1, 0, 4, 1, buffer);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == CACTUS_DISK_EXCEPTION_ID);
+    } stTryEnd;
+}
+
+CuSuite* cactusPackedStringTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testPackedString_encodeAndDecode);
+    SUITE_ADD_TEST(suite, testPackedString_size);
+    SUITE_ADD_TEST(suite, testPackedString_notPacked);
+    return suite;
+}
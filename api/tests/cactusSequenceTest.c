@@ -128,8 +128,7 @@ void testSequence_addAndGetBigStringsP(CuTest* testCase,
         if(reopenCactusDisk) {
             cactusDisk_write(cactusDisk);
             cactusDisk_destruct(cactusDisk);
-            stKVDatabaseConf *conf = stKVDatabaseConf_constructTokyoCabinet(
-                        "temporaryCactusDisk");
+            stKVDatabaseConf *conf = testCommon_constructKVDatabaseConf("temporaryCactusDisk");
             cactusDisk = cactusDisk_construct(conf, false, true);
             flower = cactusDisk_getFlower(cactusDisk, flowerName);
             stKVDatabaseConf_destruct(conf);
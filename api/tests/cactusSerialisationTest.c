@@ -117,6 +117,76 @@ void testBinaryRepresentation_makeBinaryRepresentation(CuTest* testCase) {
     cactusSerialisationTestTeardown();
 }
 
+static void writeCompactElements(void) {
+    /*
+     * Two elements of the same type, then one of another, mixing the delta coded fields with raw ones.
+     */
+    binaryRepresentation_writeElementType(CODE_SEGMENT, writeFn);
+    binaryRepresentation_writeName(1000, writeFn);
+    binaryRepresentation_writeInteger(INT64_MAX, writeFn);
+    binaryRepresentation_writeBool(1, writeFn);
+    binaryRepresentation_writeElementType(CODE_SEGMENT, writeFn);
+    binaryRepresentation_writeName(1001, writeFn);
+    binaryRepresentation_writeInteger(INT64_MIN, writeFn);
+    binaryRepresentation_writeBool(0, writeFn);
+    binaryRepresentation_writeElementType(CODE_CAP, writeFn);
+    binaryRepresentation_writeName(-5, writeFn);
+    binaryRepresentation_writeString("HELLO", writeFn);
+    binaryRepresentation_writeFloat(0.5, writeFn);
+}
+
+void testBinaryRepresentation_compact(CuTest* testCase) {
+    cactusSerialisationTestSetup();
+    void *vA2 = vA;
+    binaryRepresentation_setCompactWriting(1);
+    writeCompactElements();
+    binaryRepresentation_setCompactWriting(0);
+    binaryRepresentation_writeInteger(1000, writeFn); //Back to the raw format
+    CuAssertIntEquals(testCase, 30 + sizeof(int64_t), vA3 - (char *) vA2);
+
+    binaryRepresentation_setCompactReading(1);
+    CuAssertTrue(testCase, binaryRepresentation_popNextElementType(&vA2) == CODE_SEGMENT);
+    CuAssertTrue(testCase, binaryRepresentation_getName(&vA2) == 1000);
+    CuAssertTrue(testCase, binaryRepresentation_getInteger(&vA2) == INT64_MAX);
+    CuAssertTrue(testCase, binaryRepresentation_getBool(&vA2));
+    CuAssertTrue(testCase, binaryRepresentation_popNextElementType(&vA2) == CODE_SEGMENT);
+    CuAssertTrue(testCase, binaryRepresentation_getName(&vA2) == 1001);
+    CuAssertTrue(testCase, binaryRepresentation_getInteger(&vA2) == INT64_MIN);
+    CuAssertTrue(testCase, !binaryRepresentation_getBool(&vA2));
+    CuAssertTrue(testCase, binaryRepresentation_popNextElementType(&vA2) == CODE_CAP);
+    CuAssertTrue(testCase, binaryRepresentation_getName(&vA2) == -5);
+    CuAssertStrEquals(testCase, "HELLO", binaryRepresentation_getStringStatic(&vA2));
+    CuAssertTrue(testCase, binaryRepresentation_getFloat(&vA2) == 0.5);
+    binaryRepresentation_setCompactReading(0);
+    CuAssertIntEquals(testCase, 1000, binaryRepresentation_getInteger(&vA2));
+    CuAssertTrue(testCase, (char *) vA2 == vA3);
+    cactusSerialisationTestTeardown();
+}
+
+void testBinaryRepresentation_compactSize(CuTest* testCase) {
+    /*
+     * Names close to the name in the same position of the previous element take a byte each.
+     */
+    cactusSerialisationTestSetup();
+    binaryRepresentation_setCompactWriting(1);
+    for (int64_t i = 0; i < 100; i++) {
+        binaryRepresentation_writeElementType(CODE_END_WITHOUT_PHYLOGENY, writeFn);
+        binaryRepresentation_writeName(543829676894821452 + 2 * i, writeFn);
+        binaryRepresentation_writeName(123456789876543234 - 2 * i, writeFn);
+    }
+    binaryRepresentation_setCompactWriting(0);
+    CuAssertTrue(testCase, vA3 - vA <= 100 * 3 + 2 * 9);
+    void *vA2 = vA;
+    binaryRepresentation_setCompactReading(1);
+    for (int64_t i = 0; i < 100; i++) {
+        CuAssertTrue(testCase, binaryRepresentation_popNextElementType(&vA2) == CODE_END_WITHOUT_PHYLOGENY);
+        CuAssertTrue(testCase, binaryRepresentation_getName(&vA2) == 543829676894821452 + 2 * i);
+        CuAssertTrue(testCase, binaryRepresentation_getName(&vA2) == 123456789876543234 - 2 * i);
+    }
+    binaryRepresentation_setCompactReading(0);
+    cactusSerialisationTestTeardown();
+}
+
 static void testBinaryRepresentation_resizeObjectAsPowerOf2(CuTest* testCase) {
     for(int64_t i=0; i<100000; i++) {
         int64_t recordSize = i;
@@ -138,6 +208,8 @@ CuSuite* cactusSerialisationTestSuite(void) {
     SUITE_ADD_TEST(suite, testBinaryRepresentation_float);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_bool);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_makeBinaryRepresentation);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_compact);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_compactSize);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_resizeObjectAsPowerOf2);
     return suite;
 }
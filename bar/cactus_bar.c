@@ -49,13 +49,21 @@ void usage() {
 
     fprintf(stderr, "-y --pruneOutStubAlignments : Prune out alignments of sequences that terminates in free stubs stubs\n");
 
+    fprintf(stderr, "-z --useLastzForAnchors : Find the anchors for the pairwise alignments with lastz instead of the in process seed and chain anchorer, only with one thread\n");
+
+    fprintf(stderr, "-P --dpMemoryLimit : (int >= 0) Bytes of forward DP matrix above which only checkpoint diagonals are kept and the others recomputed, 0 for no limit\n");
+
+    fprintf(stderr, "-T --threads : (int >= 1) Number of threads with which to compute the end alignments of a flower, or the pairwise alignments of an end if there is only one end to align\n");
+
     fprintf(stderr, "-A --minimumIngroupDegree : Number of ingroup sequences required in a block.\n");
 
     fprintf(stderr, "-B --minimumOutgroupDegree : Number of outgroup sequences required in a block.\n");
 
-    fprintf(stderr, "-D --precomputedAlignments : Precomputed end alignments.\n");
+    fprintf(stderr, "-C --compressPrecomputedAlignments : LZ4 compress the end alignments written to the endAlignmentsToPrecomputeOutputFile.\n");
 
-    fprintf(stderr, "-E --endAlignmentsToPrecomputeOutputFile [fileName] : If this output file is provided then bar will read stdin first to parse the flower, then to parse the names of the end alignments to precompute. The results will be placed in this file.\n");
+    fprintf(stderr, "-D --precomputedAlignments : Precomputed end alignments, in the text or binary format.\n");
+
+    fprintf(stderr, "-E --endAlignmentsToPrecomputeOutputFile [fileName] : If this output file is provided then bar will read stdin first to parse the flower, then to parse the names of the end alignments to precompute. The results will be placed in this file, in the binary end alignment format.\n");
 
     fprintf(stderr,
             "-F --useProgressiveMerging : Use progressive merging instead of poset merging for constructing multiple sequence alignments.\n");
@@ -70,6 +78,10 @@ void usage() {
 
     fprintf(stderr, "-M --minimumCoverageToRescue : Unaligned segments must have at least this proportion of their bases covered by an outgroup to be rescued.\n");
 
+    fprintf(stderr, "--compressionCodec : Codec with which flowers are written, either 'lz4', 'lz4hc' or 'zlib', default lz4.\n");
+
+    fprintf(stderr, "--compressionThreads : Number of threads with which to compress the flowers written, default 1.\n");
+
     fprintf(stderr, "-h --help : Print this help screen\n");
 }
 
@@ -95,7 +107,7 @@ int main(int argc, char *argv[]) {
 
     char * logLevelString = NULL;
     char * cactusDiskDatabaseString = NULL;
-    int64_t i, j;
+    int64_t i;
     int64_t spanningTrees = 10;
     int64_t maximumLength = 1500;
     bool useProgressiveMerging = 0;
@@ -104,6 +116,7 @@ int main(int argc, char *argv[]) {
     int64_t k;
     stList *listOfEndAlignmentFiles = NULL;
     char *endAlignmentsToPrecomputeOutputFile = NULL;
+    bool compressPrecomputedAlignments = 0;
     bool calculateWhichEndsToComputeSeparately = 0;
     int64_t largeEndSize = 1000000;
     int64_t chainLengthForBigFlower = 1000000;
@@ -111,6 +124,8 @@ int main(int argc, char *argv[]) {
     char *ingroupCoverageFilePath = NULL;
     int64_t minimumSizeToRescue = 1;
     double minimumCoverageToRescue = 0.0;
+    stCompressionCodec compressionCodec = ST_COMPRESSION_LZ4;
+    int64_t compressionThreads = 1;
 
     PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters = pairwiseAlignmentBandingParameters_construct();
 
@@ -130,8 +145,10 @@ int main(int argc, char *argv[]) {
                         required_argument, 0, 'p' }, { "repeatMaskMatrixBiggerThanThis", required_argument, 0, 'q' }, {
                         "diagonalExpansion", required_argument, 0, 'r' }, { "constraintDiagonalTrim", required_argument, 0, 't' }, {
                         "minimumDegree", required_argument, 0, 'u' }, { "alignAmbiguityCharacters", no_argument, 0, 'w' }, {
-                        "pruneOutStubAlignments", no_argument, 0, 'y' }, {
+                        "pruneOutStubAlignments", no_argument, 0, 'y' }, { "useLastzForAnchors", no_argument, 0, 'z' }, {
+                        "threads", required_argument, 0, 'T' }, { "dpMemoryLimit", required_argument, 0, 'P' }, {
                         "minimumIngroupDegree", required_argument, 0, 'A' }, { "minimumOutgroupDegree", required_argument, 0, 'B' },
+                { "compressPrecomputedAlignments", no_argument, 0, 'C' },
                 { "precomputedAlignments", required_argument, 0, 'D' }, {
                         "endAlignmentsToPrecomputeOutputFile", required_argument, 0, 'E' }, { "useProgressiveMerging",
                         no_argument, 0, 'F' }, { "calculateWhichEndsToComputeSeparately", no_argument, 0, 'G' }, { "largeEndSize",
@@ -140,11 +157,13 @@ int main(int argc, char *argv[]) {
                         {"minimumSizeToRescue", required_argument, 0, 'K'},
                         {"minimumCoverageToRescue", required_argument, 0, 'M'},
                         { "minimumNumberOfSpecies", required_argument, 0, 'N' },
+                        { "compressionCodec", required_argument, 0, '1' },
+                        { "compressionThreads", required_argument, 0, '2' },
                         { 0, 0, 0, 0 } };
 
         int option_index = 0;
 
-        int key = getopt_long(argc, argv, "a:b:hi:j:kl:o:p:q:r:t:u:wy:A:B:D:E:FGI:J:K:L:M:N:", long_options, &option_index);
+        int key = getopt_long(argc, argv, "a:b:hi:j:kl:o:p:q:r:t:u:wy:zA:B:CD:E:FGI:J:K:L:M:N:P:T:", long_options, &option_index);
 
         if (key == -1) {
             break;
@@ -224,6 +243,20 @@ int main(int argc, char *argv[]) {
             case 'y':
                 pruneOutStubAlignments = 1;
                 break;
+            case 'z':
+                pairwiseAlignmentBandingParameters->useLastzForAnchors = 1;
+                break;
+            case 'P':
+                i = sscanf(optarg, "%" PRIi64 "", &pairwiseAlignmentBandingParameters->dpMemoryLimit);
+                assert(i == 1);
+                break;
+            case 'T':
+                i = sscanf(optarg, "%" PRIi64 "", &pairwiseAlignmentBandingParameters->numThreads);
+                assert(i == 1);
+                if (pairwiseAlignmentBandingParameters->numThreads < 1) {
+                    st_errAbort("The number of threads must be at least one: %" PRIi64 "\n", pairwiseAlignmentBandingParameters->numThreads);
+                }
+                break;
             case 'A':
                 i = sscanf(optarg, "%" PRIi64 "", &minimumIngroupDegree);
                 assert(i == 1);
@@ -232,6 +265,9 @@ int main(int argc, char *argv[]) {
                 i = sscanf(optarg, "%" PRIi64 "", &minimumOutgroupDegree);
                 assert(i == 1);
                 break;
+            case 'C':
+                compressPrecomputedAlignments = 1;
+                break;
             case 'D':
                 listOfEndAlignmentFiles = stString_split(optarg);
                 break;
@@ -265,12 +301,29 @@ int main(int argc, char *argv[]) {
                     st_errAbort("Error parsing minimumNumberOfSpecies parameter");
                 }
                 break;
+            case '1':
+                compressionCodec = stCompression_parseCodec(optarg);
+                if (compressionCodec == ST_COMPRESSION_UNTAGGED) {
+                    st_errAbort("Error parsing compressionCodec parameter");
+                }
+                break;
+            case '2':
+                i = sscanf(optarg, "%" PRIi64, &compressionThreads);
+                if (i != 1 || compressionThreads < 1) {
+                    st_errAbort("Error parsing compressionThreads parameter");
+                }
+                break;
             default:
                 usage();
                 return 1;
         }
     }
 
+    if (pairwiseAlignmentBandingParameters->useLastzForAnchors && pairwiseAlignmentBandingParameters->numThreads > 1) {
+        //getBlastPairs runs lastz through temporary files, which is not thread safe
+        st_errAbort("--useLastzForAnchors can not be used with more than one thread\n");
+    }
+
     st_setLogLevelFromString(logLevelString);
 
     /*
@@ -278,6 +331,7 @@ int main(int argc, char *argv[]) {
      */
     stKVDatabaseConf *kvDatabaseConf = stKVDatabaseConf_constructFromString(cactusDiskDatabaseString);
     CactusDisk *cactusDisk = cactusDisk_construct(kvDatabaseConf, false, true); //We precache the sequences
+    cactusDisk_setCompression(cactusDisk, compressionCodec, -1, compressionThreads);
     st_logInfo("Set up the flower disk\n");
 
     /*
@@ -309,7 +363,7 @@ int main(int argc, char *argv[]) {
          */
         stList *names = flowerWriter_parseNames(stdin);
         Flower *flower = cactusDisk_getFlower(cactusDisk, *((Name *)stList_get(names, 0)));
-        FILE *fileHandle = fopen(endAlignmentsToPrecomputeOutputFile, "w");
+        FILE *fileHandle = fopen(endAlignmentsToPrecomputeOutputFile, "wb");
         if (fileHandle == NULL) {
             st_errnoAbort("Opening end alignment file %s failed", endAlignmentsToPrecomputeOutputFile);
         }
@@ -320,7 +374,7 @@ int main(int argc, char *argv[]) {
             }
             stSortedSet *endAlignment = makeEndAlignment(sM, end, spanningTrees, maximumLength, useProgressiveMerging,
                             matchGamma, pairwiseAlignmentBandingParameters);
-            writeEndAlignmentToDisk(end, endAlignment, fileHandle);
+            writeEndAlignmentToDiskBinary(end, endAlignment, compressPrecomputedAlignments, fileHandle);
             stSortedSet_destruct(endAlignment);
         }
         fclose(fileHandle);
@@ -362,13 +416,12 @@ int main(int argc, char *argv[]) {
             fclose(coverageFile);
         }
 
-        stList *flowers = flowerWriter_parseFlowersFromStdin(cactusDisk);
-        if (listOfEndAlignmentFiles != NULL && stList_length(flowers) != 1) {
-            st_errAbort("We have precomputed alignments but %" PRIi64 " flowers to align.\n", stList_length(flowers));
+        //The next batch of flowers, and their strings, are fetched while the current flowers are aligned.
+        FlowerStream *flowerStream = flowerWriter_getFlowerStream2(cactusDisk, stdin, 1, 1);
+        if (listOfEndAlignmentFiles != NULL && flowerStream_size(flowerStream) != 1) {
+            st_errAbort("We have precomputed alignments but %" PRIi64 " flowers to align.\n", flowerStream_size(flowerStream));
         }
-        cactusDisk_preCacheStrings(cactusDisk, flowers);
-        for (j = 0; j < stList_length(flowers); j++) {
-            flower = stList_get(flowers, j);
+        while ((flower = flowerStream_getNext(flowerStream)) != NULL) {
             st_logInfo("Processing a flower\n");
 
             stSortedSet *alignedPairs = makeFlowerAlignment3(sM, flower, listOfEndAlignmentFiles, spanningTrees, maximumLength,
@@ -420,7 +473,7 @@ int main(int argc, char *argv[]) {
 
             st_logInfo("Finished filling in the alignments for the flower\n");
         }
-        stList_destruct(flowers);
+        flowerStream_destruct(flowerStream);
         //st_errAbort("Done\n");
         /*
          * Write and close the cactusdisk.
@@ -4,6 +4,14 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
 #include "endAligner.h"
 #include "multipleAligner.h"
 #include "adjacencySequences.h"
@@ -52,10 +60,17 @@ int alignedPair_cmpFn(const AlignedPair *alignedPair1, const AlignedPair *aligne
     return i;
 }
 
-stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
+EndAlignmentJob *endAlignmentJob_construct(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
         bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
-    //Make an alignment of the sequences in the ends
+    EndAlignmentJob *job = st_malloc(sizeof(EndAlignmentJob));
+    job->sM = sM;
+    job->end = end;
+    job->spanningTrees = spanningTrees;
+    job->useProgressiveMerging = useProgressiveMerging;
+    job->gapGamma = gapGamma;
+    job->pairwiseAlignmentBandingParameters = pairwiseAlignmentBandingParameters;
+    job->endAlignment = NULL;
 
     //Get the adjacency sequences to be aligned.
     Cap *cap;
@@ -82,9 +97,26 @@ stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees,
         (*c)++;
     }
     end_destructInstanceIterator(it);
+    job->sequences = sequences;
+    job->seqFrags = seqFrags;
+    job->endInstanceNumbers = endInstanceNumbers;
+    return job;
+}
+
+void endAlignmentJob_run(EndAlignmentJob *job) {
+    //Each end alignment gets its own stream of random numbers, so that the alignment does not depend
+    //on the number of threads or on their scheduling.
+    st_randomSeedThread(end_getName(job->end));
+
+    //Make an alignment of the sequences in the ends
+    End *end = job->end;
+    stList *sequences = job->sequences;
+    stList *seqFrags = job->seqFrags;
+    stHash *endInstanceNumbers = job->endInstanceNumbers;
 
     //Get the alignment.
-    MultipleAlignment *mA = makeAlignment(sM, seqFrags, spanningTrees, 100000000, useProgressiveMerging, gapGamma, pairwiseAlignmentBandingParameters);
+    MultipleAlignment *mA = makeAlignment(job->sM, seqFrags, job->spanningTrees, 100000000, job->useProgressiveMerging, job->gapGamma,
+            job->pairwiseAlignmentBandingParameters);
 
     //Build an array of weights to reweight pairs in the alignment.
     int64_t *pairwiseAlignmentsPerSequenceNonCommonEnds = st_calloc(stList_length(seqFrags), sizeof(int64_t));
@@ -177,16 +209,38 @@ stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees,
     }
 
     //Cleanup
-    stList_destruct(seqFrags);
-    stList_destruct(sequences);
     free(pairwiseAlignmentsPerSequenceNonCommonEnds);
     free(pairwiseAlignmentsPerSequenceCommonEnds);
     free(scoreAdjustmentsNonCommonEnds);
     free(scoreAdjustmentsCommonEnds);
     multipleAlignment_destruct(mA);
-    stHash_destruct(endInstanceNumbers);
 
-    return sortedAlignment;
+    //Hand the thread back to the shared generator, so a caller running the job on its own thread keeps its stream.
+    st_randomUnseedThread();
+
+    job->endAlignment = sortedAlignment;
+}
+
+void endAlignmentJob_destruct(EndAlignmentJob *job) {
+    stList_destruct(job->seqFrags);
+    stList_destruct(job->sequences);
+    stHash_destruct(job->endInstanceNumbers);
+    if (job->endAlignment != NULL) {
+        stSortedSet_destruct(job->endAlignment);
+    }
+    free(job);
+}
+
+stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
+        bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
+    EndAlignmentJob *job = endAlignmentJob_construct(sM, end, spanningTrees, maxSequenceLength, useProgressiveMerging, gapGamma,
+            pairwiseAlignmentBandingParameters);
+    endAlignmentJob_run(job);
+    stSortedSet *endAlignment = job->endAlignment;
+    job->endAlignment = NULL;
+    endAlignmentJob_destruct(job);
+    return endAlignment;
 }
 
 void writeEndAlignmentToDisk(End *end, stSortedSet *endAlignment, FILE *fileHandle) {
@@ -201,7 +255,7 @@ void writeEndAlignmentToDisk(End *end, stSortedSet *endAlignment, FILE *fileHand
     stSortedSet_destructIterator(it);
 }
 
-stSortedSet *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **end) {
+static stSortedSet *loadEndAlignmentFromDiskText(Flower *flower, FILE *fileHandle, End **end) {
     stSortedSet *endAlignment =
                 stSortedSet_construct3((int (*)(const void *, const void *))alignedPair_cmpFn,
                 (void (*)(void *))alignedPair_destruct);
@@ -239,3 +293,256 @@ stSortedSet *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **en
     return endAlignment;
 }
 
+
+/*
+ * Binary end alignment format. Each end alignment is a fixed size header followed by a payload holding every
+ * pair of the alignment (both orientations) as an array of fixed width records in alignedPair_cmpFn order. Each
+ * record gives the index of its reverse, so an alignment is rebuilt without searching or sorting. The payload is
+ * optionally LZ4 compressed, is covered by a CRC32 checksum and is padded to a multiple of eight bytes so the
+ * next header stays aligned. Integers are in host byte order.
+ */
+
+#define END_ALIGNMENT_MAGIC "cBarEA01"
+#define END_ALIGNMENT_MAGIC_LENGTH 8
+#define END_ALIGNMENT_COMPRESSED 1
+
+typedef struct _endAlignmentHeader {
+    char magic[END_ALIGNMENT_MAGIC_LENGTH];
+    int64_t endName;
+    int64_t recordNumber;
+    int64_t payloadSize; //Stored bytes, excluding the padding
+    uint32_t flags;
+    uint32_t checksum;
+} EndAlignmentHeader;
+
+typedef struct _endAlignmentRecord {
+    int64_t subsequenceIdentifier;
+    int64_t position;
+    int64_t score;
+    int64_t reverse; //Index of the reverse record shifted up one bit, the low bit is the strand
+} EndAlignmentRecord;
+
+static int64_t getPaddedSize(int64_t payloadSize) {
+    return (payloadSize + 7) & ~((int64_t)7);
+}
+
+static uint32_t getChecksum(const void *payload, int64_t payloadSize) {
+    //crc32 takes a 32 bit length, so large payloads are checksummed in chunks.
+    uLong checksum = crc32(0L, Z_NULL, 0);
+    for (int64_t i = 0; i < payloadSize; i += 1 << 30) {
+        checksum = crc32(checksum, (const Bytef *)payload + i, payloadSize - i < (1 << 30) ? payloadSize - i : (1 << 30));
+    }
+    return checksum;
+}
+
+static int alignedPair_cmpFnP2(const void *alignedPair1, const void *alignedPair2) {
+    return alignedPair_cmpFn(*(AlignedPair **)alignedPair1, *(AlignedPair **)alignedPair2);
+}
+
+void writeEndAlignmentToDiskBinary(End *end, stSortedSet *endAlignment, bool compress, FILE *fileHandle) {
+    int64_t recordNumber = stSortedSet_size(endAlignment);
+    AlignedPair **alignedPairs = st_malloc(sizeof(AlignedPair *) * (recordNumber > 0 ? recordNumber : 1));
+    EndAlignmentRecord *records = st_malloc(sizeof(EndAlignmentRecord) * (recordNumber > 0 ? recordNumber : 1));
+    stSortedSetIterator *it = stSortedSet_getIterator(endAlignment);
+    for (int64_t i = 0; i < recordNumber; i++) {
+        alignedPairs[i] = stSortedSet_getNext(it);
+    }
+    stSortedSet_destructIterator(it);
+    for (int64_t i = 0; i < recordNumber; i++) {
+        AlignedPair *aP = alignedPairs[i];
+        //The reverse may be an equal copy rather than the object in the set, so search by value
+        AlignedPair **reverse = bsearch(&aP->reverse, alignedPairs, recordNumber, sizeof(AlignedPair *), alignedPair_cmpFnP2);
+        if (reverse == NULL) {
+            st_errAbort("The reverse of an aligned pair is missing from the end alignment of end %s\n",
+                    cactusMisc_nameToStringStatic(end_getName(end)));
+        }
+        records[i].subsequenceIdentifier = aP->subsequenceIdentifier;
+        records[i].position = aP->position;
+        records[i].score = aP->score;
+        records[i].reverse = ((int64_t)(reverse - alignedPairs) << 1) | (aP->strand ? 1 : 0);
+    }
+    free(alignedPairs);
+
+    EndAlignmentHeader header;
+    memset(&header, 0, sizeof(EndAlignmentHeader));
+    memcpy(header.magic, END_ALIGNMENT_MAGIC, END_ALIGNMENT_MAGIC_LENGTH);
+    header.endName = end_getName(end);
+    header.recordNumber = recordNumber;
+    void *payload = records;
+    header.payloadSize = sizeof(EndAlignmentRecord) * recordNumber;
+    if (compress && recordNumber > 0) {
+        payload = stCompression_compress(records, header.payloadSize, &header.payloadSize, -1);
+        free(records);
+        header.flags |= END_ALIGNMENT_COMPRESSED;
+    }
+    header.checksum = getChecksum(payload, header.payloadSize);
+
+    static const char padding[8] = { 0 };
+    if (fwrite(&header, sizeof(EndAlignmentHeader), 1, fileHandle) != 1 ||
+            fwrite(payload, 1, header.payloadSize, fileHandle) != header.payloadSize ||
+            fwrite(padding, 1, getPaddedSize(header.payloadSize) - header.payloadSize, fileHandle) !=
+                    getPaddedSize(header.payloadSize) - header.payloadSize) {
+        st_errnoAbort("Failed to write the end alignment of end %s", cactusMisc_nameToStringStatic(end_getName(end)));
+    }
+    free(payload);
+}
+
+static stSortedSet *decodeEndAlignment(Flower *flower, EndAlignmentHeader *header, const void *payload, End **end) {
+    /*
+     * Checks the header and payload of a binary end alignment and rebuilds the alignment from its records.
+     */
+    if (memcmp(header->magic, END_ALIGNMENT_MAGIC, END_ALIGNMENT_MAGIC_LENGTH) != 0 || header->recordNumber < 0
+            || header->payloadSize < 0) {
+        st_errAbort("We encountered a mis-specified header in loading a binary end alignment from the disk\n");
+    }
+    *end = flower_getEnd(flower, header->endName);
+    if (*end == NULL) {
+        st_errAbort("We encountered an end name that is not in the database: %" PRIi64 "\n", header->endName);
+    }
+    if (getChecksum(payload, header->payloadSize) != header->checksum) {
+        st_errAbort("The checksum of the binary end alignment of end %" PRIi64 " does not match its contents\n",
+                header->endName);
+    }
+    const EndAlignmentRecord *records = payload;
+    void *decompressed = NULL;
+    int64_t size = header->payloadSize;
+    if (header->flags & END_ALIGNMENT_COMPRESSED) {
+        decompressed = stCompression_decompress((void *)payload, header->payloadSize, &size);
+        records = decompressed;
+    }
+    if (size != header->recordNumber * (int64_t)sizeof(EndAlignmentRecord)) {
+        st_errAbort("The binary end alignment of end %" PRIi64 " has %" PRIi64 " bytes of records, expected %" PRIi64 "\n",
+                header->endName, size, header->recordNumber * (int64_t)sizeof(EndAlignmentRecord));
+    }
+
+    int64_t recordNumber = header->recordNumber;
+    stList *alignedPairs = stList_construct3(recordNumber, NULL);
+    for (int64_t i = 0; i < recordNumber; i++) {
+        stList_set(alignedPairs, i, st_malloc(sizeof(AlignedPair)));
+    }
+    for (int64_t i = 0; i < recordNumber; i++) {
+        const EndAlignmentRecord *record = &records[i];
+        int64_t j = record->reverse >> 1;
+        if (j < 0 || j >= recordNumber || j == i || (records[j].reverse >> 1) != i) {
+            st_errAbort("The binary end alignment of end %" PRIi64 " has an invalid reverse index\n", header->endName);
+        }
+        AlignedPair *aP = stList_get(alignedPairs, i);
+        aP->subsequenceIdentifier = record->subsequenceIdentifier;
+        aP->position = record->position;
+        aP->strand = record->reverse & 1;
+        aP->score = record->score;
+        aP->reverse = stList_get(alignedPairs, j);
+    }
+    free(decompressed);
+
+    //The records are already in order, so the set is built in linear time.
+    stSortedSet *endAlignment = NULL;
+    stTry
+    {
+        endAlignment = stSortedSet_constructFromSortedList(alignedPairs,
+                (int (*)(const void *, const void *))alignedPair_cmpFn, (void (*)(void *))alignedPair_destruct);
+    }
+    stCatch(except)
+    {
+        //The records were out of order, so the set does not own the pairs
+        stList_setDestructor(alignedPairs, (void (*)(void *))alignedPair_destruct);
+        stList_destruct(alignedPairs);
+        stThrow(except);
+    }stTryEnd
+         ;
+    stList_destruct(alignedPairs);
+    return endAlignment;
+}
+
+static stSortedSet *loadEndAlignmentFromDiskBinary(Flower *flower, FILE *fileHandle, End **end) {
+    EndAlignmentHeader header;
+    if (fread(&header, sizeof(EndAlignmentHeader), 1, fileHandle) != 1) {
+        st_errAbort("Got a truncated header when parsing a binary end alignment\n");
+    }
+    if (header.payloadSize < 0) {
+        st_errAbort("We encountered a mis-specified header in loading a binary end alignment from the disk\n");
+    }
+    int64_t paddedSize = getPaddedSize(header.payloadSize);
+    char *payload = st_malloc(paddedSize > 0 ? paddedSize : 1);
+    if (fread(payload, 1, paddedSize, fileHandle) != paddedSize) {
+        st_errAbort("Got a truncated payload when parsing a binary end alignment\n");
+    }
+    stSortedSet *endAlignment = decodeEndAlignment(flower, &header, payload, end);
+    free(payload);
+    return endAlignment;
+}
+
+stSortedSet *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **end) {
+    int c = getc(fileHandle);
+    if (c == EOF) {
+        *end = NULL;
+        return NULL;
+    }
+    ungetc(c, fileHandle);
+    //A text end alignment starts with a digit, so the first byte tells the formats apart.
+    if (c == END_ALIGNMENT_MAGIC[0]) {
+        return loadEndAlignmentFromDiskBinary(flower, fileHandle, end);
+    }
+    return loadEndAlignmentFromDiskText(flower, fileHandle, end);
+}
+
+static void insertEndAlignment(stHash *endAlignments, End *end, stSortedSet *endAlignment) {
+    if (stHash_search(endAlignments, end) != NULL) {
+        st_errAbort("The end %s has more than one precomputed alignment\n", cactusMisc_nameToStringStatic(end_getName(end)));
+    }
+    stHash_insert(endAlignments, end, endAlignment);
+}
+
+void loadEndAlignmentsFromFile(Flower *flower, const char *fileName, stHash *endAlignments) {
+    int fd = open(fileName, O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0) {
+        st_errnoAbort("Opening end alignment file %s failed", fileName);
+    }
+    int64_t fileSize = fileStat.st_size;
+    char *map = NULL;
+    if (fileSize >= END_ALIGNMENT_MAGIC_LENGTH) {
+        map = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            st_errnoAbort("Failure mapping end alignment file %s", fileName);
+        }
+        if (memcmp(map, END_ALIGNMENT_MAGIC, END_ALIGNMENT_MAGIC_LENGTH) != 0) {
+            munmap(map, fileSize);
+            map = NULL;
+        }
+    }
+    if (map == NULL) {
+        //An empty or text file, which is parsed line by line.
+        close(fd);
+        FILE *fileHandle = fopen(fileName, "r");
+        if (fileHandle == NULL) {
+            st_errnoAbort("Opening end alignment file %s failed", fileName);
+        }
+        End *end;
+        stSortedSet *endAlignment;
+        while ((endAlignment = loadEndAlignmentFromDisk(flower, fileHandle, &end)) != NULL) {
+            insertEndAlignment(endAlignments, end, endAlignment);
+        }
+        fclose(fileHandle);
+        return;
+    }
+    //Decode the records straight out of the mapping; uncompressed payloads are never copied.
+    posix_madvise(map, fileSize, POSIX_MADV_SEQUENTIAL);
+    for (int64_t offset = 0; offset < fileSize;) {
+        if (offset + (int64_t)sizeof(EndAlignmentHeader) > fileSize) {
+            st_errAbort("Got a truncated header when parsing binary end alignment file %s\n", fileName);
+        }
+        EndAlignmentHeader header;
+        memcpy(&header, map + offset, sizeof(EndAlignmentHeader));
+        offset += sizeof(EndAlignmentHeader);
+        if (header.payloadSize < 0 || offset + getPaddedSize(header.payloadSize) > fileSize) {
+            st_errAbort("Got a truncated payload when parsing binary end alignment file %s\n", fileName);
+        }
+        End *end;
+        stSortedSet *endAlignment = decodeEndAlignment(flower, &header, map + offset, &end);
+        insertEndAlignment(endAlignments, end, endAlignment);
+        offset += getPaddedSize(header.payloadSize);
+    }
+    munmap(map, fileSize);
+    close(fd);
+}
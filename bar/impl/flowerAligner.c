@@ -9,6 +9,7 @@
 #include "sonLib.h"
 #include "adjacencySequences.h"
 #include "pairwiseAligner.h"
+#include "multipleAligner.h"
 
 stList *getInducedAlignment(stSortedSet *endAlignment, AdjacencySequence *adjacencySequence) {
     /*
@@ -521,6 +522,61 @@ static stSortedSet *getEndsToAlign(Flower *flower, int64_t maxSequenceLength) {
  * then call the makeFlowerAlignment2 consistency generating function.
  */
 
+static void *runEndAlignmentJob(EndAlignmentJob *job) {
+    endAlignmentJob_run(job);
+    return job;
+}
+
+static int64_t getEndAlignmentJobSize(EndAlignmentJob *job) {
+    int64_t size = 0;
+    for (int64_t i = 0; i < stList_length(job->seqFrags); i++) {
+        size += ((SeqFrag *) stList_get(job->seqFrags, i))->length;
+    }
+    return size;
+}
+
+static int cmpEndAlignmentJobsBySize(const void *a, const void *b) {
+    int64_t i = getEndAlignmentJobSize((EndAlignmentJob *) a), j = getEndAlignmentJobSize((EndAlignmentJob *) b);
+    return i < j ? -1 : (i > j ? 1 : cactusMisc_nameCompare(end_getName(((EndAlignmentJob *) a)->end),
+            end_getName(((EndAlignmentJob *) b)->end)));
+}
+
+static void computeEndAlignmentsConcurrently(StateMachine *sM, stList *ends, stHash *endAlignments, int64_t spanningTrees,
+        int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
+    /*
+     * Aligns the given ends using pairwiseAlignmentBandingParameters->numThreads threads, one end per thread at a time.
+     * The sequences are fetched serially, as the cactus disk is not thread safe. The alignments are added to the
+     * endAlignments hash in the order of the given list of ends.
+     */
+    PairwiseAlignmentParameters threadParameters = *pairwiseAlignmentBandingParameters;
+    threadParameters.numThreads = 1; //The threads are used for the ends, not for the pairs within an end
+    stList *jobs = stList_construct();
+    for (int64_t i = 0; i < stList_length(ends); i++) {
+        stList_append(jobs, endAlignmentJob_construct(sM, stList_get(ends, i), spanningTrees, maxSequenceLength,
+                useProgressiveMerging, gapGamma, &threadParameters));
+    }
+    //The work is taken from a stack, so sorting by increasing size starts the largest alignments first
+    stList *jobsBySize = stList_copy(jobs, NULL);
+    stList_sort(jobsBySize, cmpEndAlignmentJobsBySize);
+    int64_t numThreads = pairwiseAlignmentBandingParameters->numThreads;
+    stThreadPool *threadPool = stThreadPool_construct(numThreads < stList_length(jobs) ? numThreads : stList_length(jobs),
+            (void *(*)(void *)) runEndAlignmentJob, NULL);
+    for (int64_t i = 0; i < stList_length(jobsBySize); i++) {
+        stThreadPool_push(threadPool, stList_get(jobsBySize, i));
+    }
+    stThreadPool_wait(threadPool);
+    stThreadPool_destruct(threadPool);
+    stList_destruct(jobsBySize);
+    for (int64_t i = 0; i < stList_length(jobs); i++) {
+        EndAlignmentJob *job = stList_get(jobs, i);
+        stHash_insert(endAlignments, job->end, job->endAlignment);
+        job->endAlignment = NULL;
+        endAlignmentJob_destruct(job);
+    }
+    stList_destruct(jobs);
+}
+
 static void computeMissingEndAlignments(StateMachine *sM, Flower *flower, stHash *endAlignments, int64_t spanningTrees,
         int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
@@ -528,10 +584,27 @@ static void computeMissingEndAlignments(StateMachine *sM, Flower *flower, stHash
      * Creates end alignments for the ends that
      * do not have an alignment in the "endAlignments" hash, only creating
      * non-trivial end alignments for those specified by "getEndsToAlign".
+     * If more than one thread is allowed by the parameters and there are several ends to align
+     * they are aligned concurrently, otherwise the threads are used for the pairwise alignments of each end.
      */
     //Make the end alignments, representing each as an adjacency alignment.
     stSortedSet *endsToAlign = getEndsToAlign(flower, maxSequenceLength);
     End *end;
+    if (pairwiseAlignmentBandingParameters->numThreads > 1) {
+        stList *ends = stList_construct();
+        Flower_EndIterator *endIterator = flower_getEndIterator(flower);
+        while ((end = flower_getNextEnd(endIterator)) != NULL) {
+            if (stHash_search(endAlignments, end) == NULL && stSortedSet_search(endsToAlign, end) != NULL) {
+                stList_append(ends, end);
+            }
+        }
+        flower_destructEndIterator(endIterator);
+        if (stList_length(ends) > 1) {
+            computeEndAlignmentsConcurrently(sM, ends, endAlignments, spanningTrees, maxSequenceLength,
+                    useProgressiveMerging, gapGamma, pairwiseAlignmentBandingParameters);
+        }
+        stList_destruct(ends);
+    }
     Flower_EndIterator *endIterator = flower_getEndIterator(flower);
     while ((end = flower_getNextEnd(endIterator)) != NULL) {
         if (stHash_search(endAlignments, end) == NULL) {
@@ -565,14 +638,7 @@ static void loadEndAlignments(Flower *flower, stHash *endAlignments, stList *lis
      * Load alignments from given list of files and add them to the "endAlignments" hash.
      */
     for (int64_t i = 0; i < stList_length(listOfEndAlignments); i++) {
-        End *end;
-        FILE *fileHandle = fopen(stList_get(listOfEndAlignments, i), "r");
-        stSortedSet *alignment;
-        while((alignment = loadEndAlignmentFromDisk(flower, fileHandle, &end)) != NULL) {
-            assert(stHash_search(endAlignments, end) == NULL);
-            stHash_insert(endAlignments, end, alignment);
-        }
-        fclose(fileHandle);
+        loadEndAlignmentsFromFile(flower, stList_get(listOfEndAlignments, i), endAlignments);
     }
 }
 
@@ -51,15 +51,60 @@ stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees,
         bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters);
 
+/*
+ * The alignment of an end split into steps, so that the alignments of different ends can be computed
+ * concurrently. endAlignmentJob_construct gets the sequences of the end from the cactus disk, so must
+ * be called serially, while endAlignmentJob_run, which computes the alignment and places it in
+ * endAlignment, only reads the flower and so can be called from any thread. endAlignmentJob_run
+ * seeds the random numbers of the calling thread with the name of the end, so the alignment is
+ * the same whichever thread computes it.
+ */
+typedef struct _endAlignmentJob {
+    StateMachine *sM;
+    End *end;
+    int64_t spanningTrees;
+    bool useProgressiveMerging;
+    float gapGamma;
+    PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters;
+    stList *sequences;
+    stList *seqFrags;
+    stHash *endInstanceNumbers;
+    stSortedSet *endAlignment;
+} EndAlignmentJob;
+
+EndAlignmentJob *endAlignmentJob_construct(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
+        bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters);
+
+void endAlignmentJob_run(EndAlignmentJob *job);
+
+/*
+ * Destructs the job, including its end alignment if not NULL.
+ */
+void endAlignmentJob_destruct(EndAlignmentJob *job);
+
 /*
  * Writes an end alignment to the given file.
  */
 void writeEndAlignmentToDisk(End *end, stSortedSet *endAlignment, FILE *fileHandle);
 
 /*
- * Loads an end alignment from the given file.
+ * Writes an end alignment to the given file in the binary format, which is smaller and much faster to load
+ * than the text format. If compress is true the records are LZ4 compressed.
+ */
+void writeEndAlignmentToDiskBinary(End *end, stSortedSet *endAlignment, bool compress, FILE *fileHandle);
+
+/*
+ * Loads an end alignment, in either the text or the binary format, from the given file. Returns NULL and sets
+ * end to NULL when the end of the file is reached.
  */
 stSortedSet *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **end);
 
+/*
+ * Loads all the end alignments in the given file into endAlignments, keyed by end. Binary files are memory
+ * mapped and the alignments built directly from the mapped records.
+ */
+void loadEndAlignmentsFromFile(Flower *flower, const char *fileName, stHash *endAlignments);
+
 
 #endif /* ENDALIGNER_H_ */
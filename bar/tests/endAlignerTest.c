@@ -149,10 +149,70 @@ static void testReadAndWriteEndAlignments(CuTest *testCase) {
     teardown();
 }
 
+static void checkAlignedPairScoresAndReverses(CuTest *testCase, stSortedSet *endAlignment1, stSortedSet *endAlignment2) {
+    stSortedSetIterator *it = stSortedSet_getIterator(endAlignment2);
+    AlignedPair *alignedPair;
+    while ((alignedPair = stSortedSet_getNext(it)) != NULL) {
+        AlignedPair *alignedPair2 = stSortedSet_search(endAlignment1, alignedPair);
+        CuAssertTrue(testCase, alignedPair2 != NULL);
+        CuAssertIntEquals(testCase, alignedPair2->score, alignedPair->score);
+        CuAssertIntEquals(testCase, alignedPair2->reverse->score, alignedPair->reverse->score);
+        CuAssertPtrEquals(testCase, alignedPair->reverse, stSortedSet_search(endAlignment2, alignedPair->reverse));
+        CuAssertPtrEquals(testCase, alignedPair, alignedPair->reverse->reverse);
+    }
+    stSortedSet_destructIterator(it);
+}
+
+static void testReadAndWriteEndAlignmentsBinary(CuTest *testCase) {
+    setup();
+    End *ends[3] = { end1, end2, end3 };
+    int64_t maxLength = 4;
+    char *temporaryEndAlignmentFile = "temporaryEndAlignmentFile.end";
+    stSortedSet *endAlignments[3];
+    FILE *fileHandle = fopen(temporaryEndAlignmentFile, "wb");
+    for (int64_t endIndex = 0; endIndex < 3; endIndex++) {
+        End *end = ends[endIndex];
+        endAlignments[endIndex] = makeEndAlignment(stateMachine, end, 5, maxLength, end_getInstanceNumber(end) > 50, 0.5, pairwiseParameters);
+        writeEndAlignmentToDiskBinary(end, endAlignments[endIndex], endIndex % 2, fileHandle); //Mix compressed and uncompressed
+    }
+    fclose(fileHandle);
+
+    //Load through the file stream
+    fileHandle = fopen(temporaryEndAlignmentFile, "rb");
+    for (int64_t endIndex = 0; endIndex < 3; endIndex++) {
+        End *end;
+        stSortedSet *endAlignment = loadEndAlignmentFromDisk(flower, fileHandle, &end);
+        CuAssertPtrEquals(testCase, ends[endIndex], end);
+        CuAssertTrue(testCase, stSortedSet_equals(endAlignments[endIndex], endAlignment));
+        checkAlignedPairScoresAndReverses(testCase, endAlignments[endIndex], endAlignment);
+        stSortedSet_destruct(endAlignment);
+    }
+    End *end;
+    CuAssertTrue(testCase, loadEndAlignmentFromDisk(flower, fileHandle, &end) == NULL);
+    CuAssertTrue(testCase, end == NULL);
+    fclose(fileHandle);
+
+    //Load through the memory mapping
+    stHash *loadedEndAlignments = stHash_construct2(NULL, (void (*)(void *))stSortedSet_destruct);
+    loadEndAlignmentsFromFile(flower, temporaryEndAlignmentFile, loadedEndAlignments);
+    CuAssertIntEquals(testCase, 3, stHash_size(loadedEndAlignments));
+    for (int64_t endIndex = 0; endIndex < 3; endIndex++) {
+        stSortedSet *endAlignment = stHash_search(loadedEndAlignments, ends[endIndex]);
+        CuAssertTrue(testCase, endAlignment != NULL);
+        CuAssertTrue(testCase, stSortedSet_equals(endAlignments[endIndex], endAlignment));
+        checkAlignedPairScoresAndReverses(testCase, endAlignments[endIndex], endAlignment);
+        stSortedSet_destruct(endAlignments[endIndex]);
+    }
+    stHash_destruct(loadedEndAlignments);
+    stFile_rmrf(temporaryEndAlignmentFile);
+    teardown();
+}
+
 CuSuite* endAlignerTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testMakeEndAlignments);
     SUITE_ADD_TEST(suite, testReadAndWriteEndAlignments);
     SUITE_ADD_TEST(suite, test_alignedPair_cmpFn);
+    SUITE_ADD_TEST(suite, testReadAndWriteEndAlignmentsBinary);
     return suite;
 }
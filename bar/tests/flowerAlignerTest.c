@@ -126,9 +126,47 @@ void test_flowerAlignerRandom(CuTest *testCase) {
     teardown();
 }
 
+static void checkFlowerAlignmentsEqual(CuTest *testCase, stSortedSet *flowerAlignment, stSortedSet *flowerAlignment2) {
+    CuAssertIntEquals(testCase, stSortedSet_size(flowerAlignment), stSortedSet_size(flowerAlignment2));
+    stSortedSetIterator *iterator = stSortedSet_getIterator(flowerAlignment);
+    stSortedSetIterator *iterator2 = stSortedSet_getIterator(flowerAlignment2);
+    AlignedPair *alignedPair, *alignedPair2;
+    while((alignedPair = stSortedSet_getNext(iterator)) != NULL) {
+        alignedPair2 = stSortedSet_getNext(iterator2);
+        CuAssertTrue(testCase, alignedPair2 != NULL);
+        CuAssertIntEquals(testCase, 0, alignedPair_cmpFn(alignedPair, alignedPair2));
+        CuAssertIntEquals(testCase, alignedPair->score, alignedPair2->score);
+        CuAssertIntEquals(testCase, 0, alignedPair_cmpFn(alignedPair->reverse, alignedPair2->reverse));
+    }
+    stSortedSet_destructIterator(iterator);
+    stSortedSet_destructIterator(iterator2);
+}
+
+/*
+ * Checks the flower alignment does not depend on the number of threads, including when computed
+ * without threads.
+ */
+void test_flowerAlignerThreaded(CuTest *testCase) {
+    setup();
+    StateMachine *sM = stateMachine5_construct(fiveState);
+    pairwiseParameters->numThreads = 1;
+    stSortedSet *flowerAlignment = makeFlowerAlignment(sM, flower, 5, 5, 1, 0.5, pairwiseParameters, 0);
+    for (int64_t numThreads = 2; numThreads <= 4; numThreads += 2) {
+        pairwiseParameters->numThreads = numThreads;
+        stSortedSet *flowerAlignment2 = makeFlowerAlignment(sM, flower, 5, 5, 1, 0.5, pairwiseParameters, 0);
+        checkFlowerAlignmentsEqual(testCase, flowerAlignment, flowerAlignment2);
+        stSortedSet_destruct(flowerAlignment2);
+    }
+    stateMachine_destruct(sM);
+    stSortedSet_destruct(flowerAlignment);
+
+    teardown();
+}
+
 CuSuite* flowerAlignerTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_getInducedAlignment);
     SUITE_ADD_TEST(suite, test_flowerAlignerRandom);
+    SUITE_ADD_TEST(suite, test_flowerAlignerThreaded);
     return suite;
 }
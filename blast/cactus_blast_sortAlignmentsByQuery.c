@@ -4,15 +4,78 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <getopt.h>
 #include "sonLib.h"
 #include "stLastzAlignments.h"
 
+static void usage() {
+	fprintf(stderr, "cactus_blast_sortAlignmentsByQuery [--threads N] [--memory bytes] [--tempDir dir] [--unique] "
+			"[--bySecondSequence] logLevel inputFile outputFile\n");
+	fprintf(stderr, "Sorts a file of alignments, text cigars or binary records, in ascending order of first sequence and start coordinate.\n");
+	fprintf(stderr, "--threads N : Sort on N threads (default 1)\n");
+	fprintf(stderr, "--memory bytes : The memory to hold alignments in before spilling sorted runs to disk "
+			"(default 1000000000)\n");
+	fprintf(stderr, "--tempDir dir : Where to spill sorted runs (default $TMPDIR or /tmp)\n");
+	fprintf(stderr, "--unique : Drop repeats of an alignment, as piping through uniq would\n");
+	fprintf(stderr, "--bySecondSequence : Sort by the second sequence and start coordinate on it instead\n");
+}
+
 int main(int argc, char *argv[]) {
 	/*
-	 * Sort cigar file in descending order of query start coordinate.
+	 * Sort cigar file in ascending order of first sequence and start coordinate.
 	 */
-	assert(argc == 4);
+	struct option opts[] = { {"threads", required_argument, NULL, 't'},
+	                         {"memory", required_argument, NULL, 'm'},
+	                         {"tempDir", required_argument, NULL, 'd'},
+	                         {"unique", no_argument, NULL, 'u'},
+	                         {"bySecondSequence", no_argument, NULL, 's'},
+	                         {0, 0, 0, 0} };
+	int64_t threadNumber = 1, memoryBudget = 1000000000;
+	char *tempDir = NULL;
+	bool unique = 0, bySecondSequence = 0;
+	int flag;
+	while((flag = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+		switch(flag) {
+		case 't':
+			if(sscanf(optarg, "%" PRIi64 "", &threadNumber) != 1 || threadNumber < 1) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'm':
+			if(sscanf(optarg, "%" PRIi64 "", &memoryBudget) != 1 || memoryBudget < 1) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'd':
+			tempDir = optarg;
+			break;
+		case 'u':
+			unique = 1;
+			break;
+		case 's':
+			bySecondSequence = 1;
+			break;
+		case '?':
+		default:
+			usage();
+			return 1;
+		}
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
+	if(argc != 4) {
+		usage();
+		return 1;
+	}
 	st_setLogLevelFromString(argv[1]);
-	stCaf_sortCigarsFileByFirstSequenceStartCoordinateInAscendingOrder(argv[2], argv[3]);
+	if(bySecondSequence) {
+		stCaf_sortCigarsFileBySecondSequenceStartCoordinateInAscendingOrder(argv[2], argv[3], memoryBudget, threadNumber,
+				tempDir, unique);
+	} else {
+		stCaf_sortCigarsFileByFirstSequenceStartCoordinateInAscendingOrder(argv[2], argv[3], memoryBudget, threadNumber,
+				tempDir, unique);
+	}
 	return 0;
 }
@@ -4,10 +4,14 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <getopt.h>
 #include "sonLib.h"
 #include "pairwiseAlignment.h"
 #include "math.h"
 
+// The number of alignments read before the sites holding them are scored on the thread pool.
+#define ALIGNMENTS_PER_BATCH 10000
+
 uint64_t getStartCoordinate(struct PairwiseAlignment *pairwiseAlignment) {
 	assert(pairwiseAlignment->strand1); // This code assumes that the alignment is reported with respect
 	// to the positive strand of the first sequence
@@ -21,35 +25,57 @@ int cmpAlignmentsFn(const void *a, const void *b) {
 }
 
 void updateScoresToReflectMappingQualities(stList *alignments, float alpha, uint64_t numAlignmentsToScore) {
+	/*
+	 * The alignments must be sorted by ascending score. The mapping quality of alignment i is -10 log10(1 - 1/z_i), where
+	 * z_i = sum_j 10^(alpha (s_j - s_i)). Writing t_j = 10^(alpha (s_j - s_max)), which is at most one, this is
+	 * z_i - 1 = 10^(alpha (s_max - s_i)) sum_{j != i} t_j, so prefix and suffix sums of the t_j give every z_i in
+	 * linear time, without the cancellation of subtracting one from z_i.
+	 */
+	uint64_t alignmentNumber = stList_length(alignments);
+	if(alignmentNumber == 0) {
+		return;
+	}
 	// Create an array of the scores
-	float *alignmentScores = st_calloc(stList_length(alignments), sizeof(float));
-	for(uint64_t i=0; i<stList_length(alignments); i++) {
+	float *alignmentScores = st_calloc(alignmentNumber, sizeof(float));
+	for(uint64_t i=0; i<alignmentNumber; i++) {
 		alignmentScores[i] = ((struct PairwiseAlignment *)stList_get(alignments, i))->score;
 	}
+	float maxScore = alignmentScores[alignmentNumber-1];
+
+	// The t_j, and their sums before and after each alignment, summing the small terms first
+	double *terms = st_malloc(sizeof(double) * alignmentNumber);
+	double *prefixSums = st_malloc(sizeof(double) * (alignmentNumber + 1));
+	double *suffixSums = st_malloc(sizeof(double) * (alignmentNumber + 1));
+	prefixSums[0] = 0.0;
+	for(uint64_t i=0; i<alignmentNumber; i++) {
+		terms[i] = pow(10, alpha * (alignmentScores[i] - maxScore));
+		prefixSums[i+1] = prefixSums[i] + terms[i];
+	}
+	suffixSums[alignmentNumber] = 0.0;
+	for(uint64_t i=alignmentNumber; i>0; i--) {
+		suffixSums[i-1] = suffixSums[i] + terms[i-1];
+	}
 
 	// Calculate mapQs for the best N alignments (N = numAlignmentsToScore).
-        uint64_t start = stList_length(alignments) > numAlignmentsToScore ? stList_length(alignments) - numAlignmentsToScore : 0;
-	for(uint64_t i=start; i<stList_length(alignments); i++) {
+	uint64_t start = alignmentNumber > numAlignmentsToScore ? alignmentNumber - numAlignmentsToScore : 0;
+	for(uint64_t i=start; i<alignmentNumber; i++) {
 		struct PairwiseAlignment *pA = stList_get(alignments, i);
 
 		// Cut off the calculation if clearly going to be zero
-		if(alpha * (alignmentScores[i] - alignmentScores[stList_length(alignments)-1]) < -10) {
+		if(alpha * (alignmentScores[i] - maxScore) < -10) {
 			pA->score = 0.0;
 		}
 
 		else {
-			// Calculate the denominator
-			double z = 0.0;
-			for(uint64_t j=0; j<stList_length(alignments); j++) {
-				z += pow(10, alpha * (alignmentScores[j] - alignmentScores[i]));
-			}
-			assert(z >= 1.0);
+			// Calculate z - 1
+			double otherZ = pow(10, alpha * (maxScore - alignmentScores[i])) * (prefixSums[i] + suffixSums[i+1]);
+			assert(otherZ >= 0.0);
 
-			if(z <= 1.000001) { // Round scores to max of 60
+			if(otherZ <= 0.000001) { // Round scores to max of 60
 				pA->score = 60.0;
 			}
-			else {
-				pA->score = -10.0 * log10(1.0 - 1.0/z);
+			else { // -10 log10(1 - 1/z) = 10 (log10(z) - log10(z - 1))
+				pA->score = 10.0 * (log1p(otherZ) / log(10.0) - log10(otherZ));
 				assert(pA->score >= 0.0);
 			}
 		}
@@ -57,22 +83,46 @@ void updateScoresToReflectMappingQualities(stList *alignments, float alpha, uint
 
 	// Cleanup
 	free(alignmentScores);
+	free(terms);
+	free(prefixSums);
+	free(suffixSums);
 }
 
-void reportAlignments(stList *alignments, int64_t maxAlignmentsPerSite,
-		float minimumMapQValue, float alpha, FILE **fileHandleOuts) {
-	// Sort by ascending score
-	stList_sort(alignments, cmpAlignmentsFn);
+typedef struct _mappingQualityParameters {
+	int64_t maxAlignmentsPerSite;
+	float alpha;
+} MappingQualityParameters;
 
-	// Calculate the mapping qualities
-	updateScoresToReflectMappingQualities(alignments, alpha, maxAlignmentsPerSite);
+typedef struct _site {
+	stList *alignments;
+	MappingQualityParameters *parameters;
+} Site;
 
-	// Report the alignments
+static void *scoreSite(void *arg) {
+	/*
+	 * Sorts the alignments of a site by ascending score and replaces the scores with mapping qualities. Sites are
+	 * independent, so this can be run on a thread pool.
+	 */
+	Site *site = arg;
+	stList_sort(site->alignments, cmpAlignmentsFn);
+	updateScoresToReflectMappingQualities(site->alignments, site->parameters->alpha,
+			site->parameters->maxAlignmentsPerSite);
+	return NULL;
+}
+
+void reportAlignments(stList *alignments, int64_t maxAlignmentsPerSite,
+		float minimumMapQValue, FILE **fileHandleOuts, stPairwiseAlignmentWriter **writers) {
+	// Report the alignments, which have been scored, from the highest scoring
 	for(int64_t i=0; stList_length(alignments) > 0;) {
 		struct PairwiseAlignment *pairwiseAlignment = stList_pop(alignments);
 		if(i < maxAlignmentsPerSite && pairwiseAlignment->score >= minimumMapQValue) {
 			// Write out modified cigar
-			cigarWrite(fileHandleOuts[i++], pairwiseAlignment, 0);
+			if(writers != NULL) {
+				stPairwiseAlignmentWriter_write(writers[i++], pairwiseAlignment);
+			}
+			else {
+				cigarWrite(fileHandleOuts[i++], pairwiseAlignment, 0);
+			}
 		}
 
 		// Cleanup
@@ -80,11 +130,78 @@ void reportAlignments(stList *alignments, int64_t maxAlignmentsPerSite,
 	}
 }
 
+static void reportSites(stList *sites, stThreadPool *threadPool, float minimumMapQValue, FILE **fileHandleOuts,
+		stPairwiseAlignmentWriter **writers) {
+	/*
+	 * Scores a batch of sites, on the thread pool if there is one, then reports them in the order they were read.
+	 */
+	for(int64_t i=0; i<stList_length(sites); i++) {
+		if(threadPool != NULL) {
+			stThreadPool_push(threadPool, stList_get(sites, i));
+		}
+		else {
+			scoreSite(stList_get(sites, i));
+		}
+	}
+	if(threadPool != NULL) {
+		stThreadPool_wait(threadPool);
+	}
+	for(int64_t i=0; i<stList_length(sites); i++) {
+		Site *site = stList_get(sites, i);
+		reportAlignments(site->alignments, site->parameters->maxAlignmentsPerSite, minimumMapQValue, fileHandleOuts,
+				writers);
+		stList_destruct(site->alignments);
+		free(site);
+	}
+	while(stList_length(sites) > 0) {
+		stList_pop(sites);
+	}
+}
+
+static void usage() {
+	fprintf(stderr, "cactus_calculateMappingQualities [--threads N] [--binary] logLevel maxAlignmentsPerSite minimumMapQValue alpha "
+			"outputFile1 .. outputFileN [inputFile]\n");
+	fprintf(stderr, "Reads alignments sorted by start coordinate, replaces their scores with mapping qualities and "
+			"writes the i-th best alignment of each site to the i-th output file.\n");
+	fprintf(stderr, "--threads N : Score independent sites on N threads (default 1)\n");
+	fprintf(stderr, "--binary : Write binary records, rather than text cigars\n");
+}
+
 int main(int argc, char *argv[]) {
 	/*
-	 * For each alignment in the input file copy the alignment to the output file and additionally
-	 * write out the alignment with the query and target sequences reversed.
+	 * For each site, the set of alignments sharing the same start coordinate, replace the scores of the alignments
+	 * with their mapping qualities and report them.
 	 */
+	struct option opts[] = { {"threads", required_argument, NULL, 't'},
+	                         {"binary", no_argument, NULL, 'b'},
+	                         {0, 0, 0, 0} };
+	int64_t threadNumber = 1;
+	bool binary = 0;
+	int flag;
+	while((flag = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+		switch(flag) {
+		case 't':
+			if(sscanf(optarg, "%" PRIi64 "", &threadNumber) != 1 || threadNumber < 1) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'b':
+			binary = 1;
+			break;
+		case '?':
+		default:
+			usage();
+			return 1;
+		}
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
+	if(argc < 6) {
+		usage();
+		return 1;
+	}
+
 	st_setLogLevelFromString(argv[1]);
 
 	int64_t maxAlignmentsPerSite;
@@ -99,10 +216,21 @@ int main(int argc, char *argv[]) {
 	i = sscanf(argv[4], "%f", &alpha);
 	assert(i == 1);
 
+	MappingQualityParameters parameters;
+	parameters.maxAlignmentsPerSite = maxAlignmentsPerSite;
+	parameters.alpha = alpha;
+
 	FILE **fileHandleOuts = st_malloc(sizeof(FILE *) * maxAlignmentsPerSite);
 	for(i=0; i<maxAlignmentsPerSite; i++) {
 		fileHandleOuts[i] = fopen(argv[i+5], "w");
 	}
+	stPairwiseAlignmentWriter **writers = NULL;
+	if(binary) {
+		writers = st_malloc(sizeof(stPairwiseAlignmentWriter *) * maxAlignmentsPerSite);
+		for(i=0; i<maxAlignmentsPerSite; i++) {
+			writers[i] = stPairwiseAlignmentWriter_construct(fileHandleOuts[i], 0);
+		}
+	}
 
 	FILE *fileHandleIn = stdin;
 	if(argc == maxAlignmentsPerSite+6) {
@@ -111,34 +239,71 @@ int main(int argc, char *argv[]) {
 	else {
 		assert(argc == maxAlignmentsPerSite+5);
 	}
-    
+
+    stThreadPool *threadPool = threadNumber > 1 ? stThreadPool_construct(threadNumber, scoreSite, NULL) : NULL;
+
+    // Sites read but not yet reported, and the number of alignments they hold
+    stList *sites = stList_construct();
+    int64_t batchAlignmentNumber = 0;
+
     // List of totally overlapping alignments
     stList *alignments = stList_construct();
-    
+
+    stPairwiseAlignmentReader *reader = stPairwiseAlignmentReader_construct(fileHandleIn);
     struct PairwiseAlignment *pairwiseAlignment = NULL;
-    while ((pairwiseAlignment = cigarRead(fileHandleIn)) != NULL) {
+    while ((pairwiseAlignment = stPairwiseAlignmentReader_read(reader)) != NULL) {
 
     	// If the pairwiseAlignment does not share the same interval
-    	// as the previous pairwise alignments report the previous alignments
-		if(stList_length(alignments) == 0 ||
-			strcmp(((struct PairwiseAlignment *)stList_peek(alignments))->contig1, pairwiseAlignment->contig1) != 0 ||
-		   	getStartCoordinate(stList_peek(alignments)) != getStartCoordinate(pairwiseAlignment)) {
-		   
-			reportAlignments(alignments, maxAlignmentsPerSite, minimumMapQValue, alpha, fileHandleOuts);
+    	// as the previous pairwise alignments the previous alignments are a complete site
+		if(stList_length(alignments) > 0 &&
+		   (strcmp(((struct PairwiseAlignment *)stList_peek(alignments))->contig1, pairwiseAlignment->contig1) != 0 ||
+		   	getStartCoordinate(stList_peek(alignments)) != getStartCoordinate(pairwiseAlignment))) {
+
+			Site *site = st_malloc(sizeof(Site));
+			site->alignments = alignments;
+			site->parameters = &parameters;
+			stList_append(sites, site);
+			batchAlignmentNumber += stList_length(alignments);
+			alignments = stList_construct();
+
+			if(batchAlignmentNumber >= ALIGNMENTS_PER_BATCH) {
+				reportSites(sites, threadPool, minimumMapQValue, fileHandleOuts, writers);
+				batchAlignmentNumber = 0;
+			}
 		}
 
 		// Adding the pairwise alignment to the set to consider
 		stList_append(alignments, pairwiseAlignment);
     }
-    
-    reportAlignments(alignments, maxAlignmentsPerSite, minimumMapQValue, alpha, fileHandleOuts);
 
-    assert(stList_length(alignments) == 0);
+    if(stList_length(alignments) > 0) {
+    	Site *site = st_malloc(sizeof(Site));
+    	site->alignments = alignments;
+    	site->parameters = &parameters;
+    	stList_append(sites, site);
+    }
+    else {
+    	stList_destruct(alignments);
+    }
+    reportSites(sites, threadPool, minimumMapQValue, fileHandleOuts, writers);
+
+    assert(stList_length(sites) == 0);
     // Cleanup
-    stList_destruct(alignments);
+    stList_destruct(sites);
+    stPairwiseAlignmentReader_destruct(reader);
+    if(writers != NULL) {
+    	for(i=0; i<maxAlignmentsPerSite; i++) {
+    		stPairwiseAlignmentWriter_destruct(writers[i]);
+    	}
+    	free(writers);
+    }
+    if(threadPool != NULL) {
+    	stThreadPool_destruct(threadPool);
+    }
     for(i=0; i<maxAlignmentsPerSite; i++) {
     	fclose(fileHandleOuts[i]);
     }
+    free(fileHandleOuts);
     if(argc == maxAlignmentsPerSite+6) {
     	fclose(fileHandleIn);
     }
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2009-2018 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <getopt.h>
+#include "sonLib.h"
+#include "pairwiseAlignment.h"
+
+static void usage() {
+    fprintf(stderr, "cactus_convertAlignmentFormat [--binary] [--withProbs] [inputFile [outputFile]]\n");
+    fprintf(stderr, "Converts alignments, as text cigars, binary records or a mix of both, to text cigars, "
+            "or to binary records with --binary. Reads from stdin and writes to stdout by default.\n");
+    fprintf(stderr, "--binary : Write binary records\n");
+    fprintf(stderr, "--withProbs : Keep the scores of the alignment operations\n");
+}
+
+int main(int argc, char *argv[]) {
+    struct option opts[] = { {"binary", no_argument, NULL, 'b'},
+                             {"withProbs", no_argument, NULL, 'p'},
+                             {"help", no_argument, NULL, 'h'},
+                             {0, 0, 0, 0} };
+    bool binary = 0, withProbs = 0;
+    int flag;
+    while((flag = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch(flag) {
+        case 'b':
+            binary = 1;
+            break;
+        case 'p':
+            withProbs = 1;
+            break;
+        case 'h':
+            usage();
+            return 0;
+        case '?':
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if(argc - optind > 2) {
+        usage();
+        return 1;
+    }
+
+    FILE *fileHandleIn = argc - optind >= 1 ? fopen(argv[optind], "r") : stdin;
+    if(fileHandleIn == NULL) {
+        st_errnoAbort("Could not open input file %s", argv[optind]);
+    }
+    FILE *fileHandleOut = argc - optind == 2 ? fopen(argv[optind + 1], "w") : stdout;
+    if(fileHandleOut == NULL) {
+        st_errnoAbort("Could not open output file %s", argv[optind + 1]);
+    }
+
+    stPairwiseAlignmentReader *reader = stPairwiseAlignmentReader_construct(fileHandleIn);
+    stPairwiseAlignmentWriter *writer = binary ? stPairwiseAlignmentWriter_construct(fileHandleOut, withProbs) : NULL;
+    struct PairwiseAlignment *pairwiseAlignment;
+    while((pairwiseAlignment = stPairwiseAlignmentReader_read(reader)) != NULL) {
+        if(binary) {
+            stPairwiseAlignmentWriter_write(writer, pairwiseAlignment);
+        }
+        else {
+            cigarWrite(fileHandleOut, pairwiseAlignment, withProbs);
+        }
+        destructPairwiseAlignment(pairwiseAlignment);
+    }
+
+    if(binary) {
+        stPairwiseAlignmentWriter_destruct(writer);
+    }
+    stPairwiseAlignmentReader_destruct(reader);
+    if(fileHandleIn != stdin) {
+        fclose(fileHandleIn);
+    }
+    if(fileHandleOut != stdout) {
+        fclose(fileHandleOut);
+    }
+    return 0;
+}
@@ -15,6 +15,8 @@ static void usage(void)
     fprintf(stderr, "cactus_convertAlignmentsToInternalNames --cactusDisk cactusDisk inputFile outputFile\n");
     fprintf(stderr, "Options: --bed input file is a bed file, not a cigar. "
             "Output will be a sorted binary coverage file.\n");
+    fprintf(stderr, "--binary write the converted alignments as binary records, "
+            "rather than text cigars.\n");
 }
 
 static void convertHeadersToNames(struct PairwiseAlignment *pA, stHash *headerToName)
@@ -53,8 +55,10 @@ int main(int argc, char *argv[])
     FILE *inputFile;
     FILE *outputFile;
     bool isBedFile = false; // true if bed, false if cigar
+    bool binary = false; // true to write binary alignment records
     struct option longopts[] = { {"cactusDisk", required_argument, NULL, 'a' },
                                  {"bed", no_argument, NULL, 'c'},
+                                 {"binary", no_argument, NULL, 'b'},
 
                                  {0, 0, 0, 0} };
     int flag;
@@ -66,6 +70,9 @@ int main(int argc, char *argv[])
 	case 'c':
             isBedFile = true;
             break;
+        case 'b':
+            binary = true;
+            break;
         case '?':
         default:
             usage();
@@ -208,16 +215,26 @@ int main(int argc, char *argv[])
         // Input is a cigar file.
         // Scan over the given alignment file and convert the headers to
         // cactus Names.
+        stPairwiseAlignmentReader *reader = stPairwiseAlignmentReader_construct(inputFile);
+        stPairwiseAlignmentWriter *writer = binary ? stPairwiseAlignmentWriter_construct(outputFile, TRUE) : NULL;
         for (;;) {
-            struct PairwiseAlignment *pA = cigarRead(inputFile);
+            struct PairwiseAlignment *pA = stPairwiseAlignmentReader_read(reader);
             if (pA == NULL) {
                 // Signals end of cigar file.
                 break;
             }
             convertHeadersToNames(pA, headerToName);
             checkPairwiseAlignment(pA);
-            cigarWrite(outputFile, pA, TRUE);
+            if (binary) {
+                stPairwiseAlignmentWriter_write(writer, pA);
+            } else {
+                cigarWrite(outputFile, pA, TRUE);
+            }
+        }
+        if (binary) {
+            stPairwiseAlignmentWriter_destruct(writer);
         }
+        stPairwiseAlignmentReader_destruct(reader);
     }
 
     // Cleanup.
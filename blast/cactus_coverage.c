@@ -19,7 +19,7 @@ static stHash *sequenceCoverage = NULL;
 // (although there is no relation to the query contig in the cigar):
 // i.e. the genome specified in --from, if any
 static stSet *otherGenomeSequences = NULL;
-// For splitting sequence coverage arrays by ID, if we're using the
+// For splitting sequence coverage by ID, if we're using the
 // --depthByID option.
 static stHash *IDToSequenceCoverage;
 
@@ -54,10 +54,14 @@ static void addOtherGenomeSequence(const char *name, const char *seq,
     stSet_insert(otherGenomeSequences, identifier);
 }
 
+// The greatest depth reported, as coverage was historically kept in
+// 16-bit counters, unless --uncapped is given.
+#define MAX_COVERAGE_DEPTH 65535
+
 static void usage(void)
 {
-    fprintf(stderr, "cactus_coverage fastaFile alignmentsFile\n");
-    fprintf(stderr, "Prints a bed file representing coverage from a CIGAR file "
+    fprintf(stderr, "cactus_coverage fastaFile [alignmentsFile ...]\n");
+    fprintf(stderr, "Prints a bed file representing coverage from CIGAR files "
             "on the sequences provided in the fasta file.\n");
     fprintf(stderr, "Format: seq\tregionStart\tregionStop\tcoverageDepth");
     fprintf(stderr, "Options:\n");
@@ -68,44 +72,150 @@ static void usage(void)
     fprintf(stderr, "--depthById: Assume that headers have an 'id=N|' prefix, "
             "where N is an integer. Score coverage depth by the number of "
             "different prefixes that align to a region, rather than the total "
-            "number of alignments. Uses much more memory than the standard mode."
+            "number of alignments. Uses more memory than the standard mode."
             "\n");
     fprintf(stderr, "--from <fromFastaFile>: Only consider alignments for which one sequence is in fastaFile and the other is in fromFastaFile.\n");
+    fprintf(stderr, "--merge <bedFile>: Add the coverage in a bed file printed by a previous run, "
+            "for example over a shard of the alignments. May be given more than once. With --depthById "
+            "the shards must not share IDs. Depths are capped at %d unless the shard was printed with "
+            "--uncapped, so sums over deeper regions undercount otherwise.\n", MAX_COVERAGE_DEPTH);
+    fprintf(stderr, "--uncapped: Print depths above %d rather than capping them, as for a shard to be "
+            "given to --merge.\n", MAX_COVERAGE_DEPTH);
 }
 
-static void printCoverage(char *name, uint16_t *array, int64_t length) {
-    int64_t i, regionStart = 0;
-    uint16_t prevCoverage = 0;
-    for(i = 0; i < length; i++) {
-        if(array[i] != prevCoverage) {
-            if(prevCoverage != 0) {
-                printf("%s\t%" PRIi64 "\t%" PRIi64 "\t\t%u\n", name,
-                       regionStart, i, prevCoverage);
+// A change in coverage depth at a position of a sequence.
+typedef struct _coverageEvent {
+    int64_t position;
+    int64_t change;
+} CoverageEvent;
+
+// The coverage of a sequence, as a list of changes in depth. The list
+// is kept in the order the alignments are read until it has grown to
+// twice its length after it was last compacted, then it is sorted and
+// the changes at each position combined, so its size is bounded by the
+// number of positions at which the coverage changes rather than by the
+// number of alignments or the length of the sequence.
+typedef struct _coverage {
+    CoverageEvent *events;
+    int64_t length;
+    int64_t maxLength;
+    int64_t compactedLength;
+    // If true only whether a position is covered matters, as when
+    // counting the IDs that cover a position in --depthById mode, so
+    // compaction reduces the events to the union of the intervals.
+    bool isUnion;
+} Coverage;
+
+// The least number of events a coverage list holds before it is compacted.
+#define MIN_EVENTS_BEFORE_COMPACTION 65536
+
+static Coverage *coverage_construct(bool isUnion) {
+    Coverage *coverage = st_calloc(1, sizeof(Coverage));
+    coverage->isUnion = isUnion;
+    return coverage;
+}
+
+static void coverage_destruct(Coverage *coverage) {
+    free(coverage->events);
+    free(coverage);
+}
+
+static int cmpCoverageEvents(const void *a, const void *b) {
+    const CoverageEvent *e1 = a, *e2 = b;
+    return e1->position < e2->position ? -1 : (e1->position > e2->position ? 1 : 0);
+}
+
+// Sort the events and combine those at the same position, or, for a
+// union, replace them with the boundaries of the covered intervals.
+static void coverage_compact(Coverage *coverage) {
+    qsort(coverage->events, coverage->length, sizeof(CoverageEvent),
+          cmpCoverageEvents);
+    int64_t j = 0, depth = 0;
+    for (int64_t i = 0; i < coverage->length;) {
+        int64_t position = coverage->events[i].position, change = 0;
+        for (; i < coverage->length && coverage->events[i].position == position; i++) {
+            change += coverage->events[i].change;
+        }
+        if (coverage->isUnion) {
+            if ((depth > 0) != (depth + change > 0)) {
+                coverage->events[j].position = position;
+                coverage->events[j++].change = depth > 0 ? -1 : 1;
             }
-            regionStart = i;
+        } else if (change != 0) {
+            coverage->events[j].position = position;
+            coverage->events[j++].change = change;
         }
-        prevCoverage = array[i];
+        depth += change;
     }
-    if(prevCoverage != 0) {
-        printf("%s\t%" PRIi64 "\t%" PRIi64 "\t\t%u\n", name,
-               regionStart, i, prevCoverage);
+    assert(depth == 0);
+    coverage->length = j;
+    coverage->compactedLength = j;
+}
+
+// Add depth to the interval [start, end).
+static void coverage_addInterval(Coverage *coverage, int64_t start, int64_t end,
+                                 int64_t depth) {
+    assert(start < end);
+    if (coverage->length + 2 > coverage->maxLength) {
+        if (coverage->length >= MIN_EVENTS_BEFORE_COMPACTION
+            && coverage->length >= 2 * coverage->compactedLength) {
+            coverage_compact(coverage);
+        }
+        if (coverage->length + 2 > coverage->maxLength / 2) {
+            coverage->maxLength = coverage->maxLength == 0 ? 16 : coverage->maxLength * 2;
+            coverage->events = st_realloc(coverage->events,
+                                          coverage->maxLength * sizeof(CoverageEvent));
+        }
     }
+    coverage->events[coverage->length].position = start;
+    coverage->events[coverage->length++].change = depth;
+    coverage->events[coverage->length].position = end;
+    coverage->events[coverage->length++].change = -depth;
 }
 
-// Fill in the part of a coverage array that is covered by a
-// particular pairwise alignment. contigNum is which contig this
-// coverage array corresponds to in the CIGAR.
+static void printCoverage(char *name, Coverage *coverage, int64_t maxDepth) {
+    coverage_compact(coverage);
+    int64_t i, regionStart = 0, depth = 0;
+    int64_t prevCoverage = 0;
+    bool hitCap = FALSE;
+    for(i = 0; i < coverage->length; i++) {
+        int64_t position = coverage->events[i].position;
+        depth += coverage->events[i].change;
+        int64_t cappedDepth = depth;
+        if(depth > maxDepth) {
+            cappedDepth = maxDepth;
+            if(!hitCap) {
+                fprintf(stderr, "WARNING: Coverage hit cap (%" PRIi64 ") on contig: "
+                        "%s pos: %" PRIi64 "\n", maxDepth, name, position);
+                hitCap = TRUE;
+            }
+        }
+        if(cappedDepth != prevCoverage) {
+            if(prevCoverage != 0) {
+                printf("%s\t%" PRIi64 "\t%" PRIi64 "\t\t%" PRIi64 "\n", name,
+                       regionStart, position, prevCoverage);
+            }
+            regionStart = position;
+        }
+        prevCoverage = cappedDepth;
+    }
+    assert(prevCoverage == 0);
+}
+
+// Add the part of a sequence that is covered by a particular pairwise
+// alignment. contigNum is which contig the coverage corresponds to in
+// the CIGAR.
 static void fillCoverage(struct PairwiseAlignment *pA, int contigNum,
-                         uint16_t *coverageArray)
+                         Coverage *coverage)
 {
     int strand = contigNum == 1 ? pA->strand1 : pA->strand2;
     int64_t startPos = contigNum == 1 ? pA->start1 : pA->start2;
     int64_t endPos = contigNum == 1 ? pA->end1 : pA->end2;
-    int64_t i, j;
+    int64_t i;
     int64_t *lenPtr = stHash_search(sequenceLengths, contigNum == 1 ? pA->contig1 : pA->contig2);
     assert(lenPtr != NULL);
     int64_t len = *lenPtr;
-    if(endPos > len) {
+    if((strand ? endPos : startPos) > len) {
         fprintf(stderr, "Error: alignment on %s:%" PRIi64 "-%" PRIi64 " is past chr end\n", contigNum == 1 ? pA->contig1 : pA->contig2, startPos, endPos);
         exit(1);
     }
@@ -132,28 +242,15 @@ static void fillCoverage(struct PairwiseAlignment *pA, int contigNum,
             }
             break;
         case PAIRWISE_MATCH:
+            if(op->length <= 0) {
+                break;
+            }
             if(strand) {
-                for(j=curAlignmentPos; j < curAlignmentPos + op->length; j++) {
-                    if(coverageArray[j] == 65535) {
-                        fprintf(stderr, "WARNING: Coverage hit cap (65535) on contig: "
-                                "%s pos: %" PRIi64 "\n",
-                                contigNum == 1 ? pA->contig1 : pA->contig2, j);
-                    } else {
-                        coverageArray[j]++;
-                    }
-                }
+                coverage_addInterval(coverage, curAlignmentPos, curAlignmentPos + op->length, 1);
                 curAlignmentPos += op->length;
                 assert(curAlignmentPos <= endPos);
             } else {
-                for(j=curAlignmentPos-1; j >= curAlignmentPos - op->length; j--) {
-                    if(coverageArray[j] == 65535) {
-                        fprintf(stderr, "WARNING: Coverage hit cap (65535) on contig: "
-                                "%s pos: %" PRIi64 "\n",
-                                contigNum == 1 ? pA->contig1 : pA->contig2, j);
-                    } else {
-                        coverageArray[j]++;
-                    }
-                }
+                coverage_addInterval(coverage, curAlignmentPos - op->length, curAlignmentPos, 1);
                 curAlignmentPos -= op->length;
                 assert(curAlignmentPos >= endPos);
             }
@@ -161,15 +258,15 @@ static void fillCoverage(struct PairwiseAlignment *pA, int contigNum,
     }
 }
 
-// Get the proper coverage array to fill in, given the "on" header
-// (i.e. a header in the fasta provided in the arguments to this
-// program), and the "from" header (the other header in the CIGAR file,
-// which may or may not be in that fasta). Initialize the array if necessary.
-static uint16_t *getCoverageArray(char *onHeader, char *fromHeader,
-                                  int depthById) {
+// Get the proper coverage to fill in, given the "on" header (i.e. a
+// header in the fasta provided in the arguments to this program), and
+// the "from" header (the other header in the CIGAR file, which may or
+// may not be in that fasta). Initialize the coverage if necessary.
+static Coverage *getCoverage(char *onHeader, char *fromHeader,
+                             int depthById) {
     stHash *coverageHash;
     if (depthById) {
-        // We're splitting arrays by "id=N|" of the "from" header.
+        // We're splitting coverage by "id=N|" of the "from" header.
         stList *attributes = fastaDecodeHeader(fromHeader);
         char *id = stList_get(attributes, 0);
         if (strncmp(id, "id=", 3)) {
@@ -181,26 +278,54 @@ static uint16_t *getCoverageArray(char *onHeader, char *fromHeader,
             // Initialize coverage sub-hash.
             sequenceSubCoverage = stHash_construct3(stHash_stringKey,
                                                     stHash_stringEqualKey, free,
-                                                    free);
-            stHash_insert(IDToSequenceCoverage, id, sequenceSubCoverage);
+                                                    (void (*)(void *)) coverage_destruct);
+            stHash_insert(IDToSequenceCoverage, stString_copy(id), sequenceSubCoverage);
         }
+        stList_destruct(attributes);
         coverageHash = sequenceSubCoverage;
     } else {
         coverageHash = sequenceCoverage;
     }
-    int64_t *lengthPtr = stHash_search(sequenceLengths, onHeader);
-    assert(lengthPtr != NULL);
-    uint16_t *array;
-    if((array = stHash_search(coverageHash, onHeader)) == NULL) {
-        // Coverage array for this seq doesn't exist yet, so
-        // create it
-        int64_t length = *lengthPtr;
-        array = st_malloc(length * sizeof(uint16_t));
-        memset(array, 0, length * sizeof(uint16_t));
-        stHash_insert(coverageHash, stString_copy(onHeader),
-                      array);
+    assert(stHash_search(sequenceLengths, onHeader) != NULL);
+    Coverage *coverage;
+    if((coverage = stHash_search(coverageHash, onHeader)) == NULL) {
+        // Coverage for this seq doesn't exist yet, so create it
+        coverage = coverage_construct(depthById);
+        stHash_insert(coverageHash, stString_copy(onHeader), coverage);
+    }
+    return coverage;
+}
+
+// Add the coverage in a BED file written by a previous run, such as one
+// over a shard of the alignments.
+static void mergeCoverage(const char *bedPath) {
+    FILE *bedHandle = fopen(bedPath, "r");
+    if (bedHandle == NULL) {
+        st_errnoAbort("Could not open coverage file %s", bedPath);
+    }
+    char *line;
+    while ((line = stFile_getLineFromFile(bedHandle)) != NULL) {
+        stList *tokens = stString_split(line);
+        int64_t start, end, depth;
+        if (stList_length(tokens) != 4
+            || sscanf(stList_get(tokens, 1), "%" PRIi64, &start) != 1
+            || sscanf(stList_get(tokens, 2), "%" PRIi64, &end) != 1
+            || sscanf(stList_get(tokens, 3), "%" PRIi64, &depth) != 1) {
+            st_errAbort("Malformed line in coverage file %s: %s", bedPath, line);
+        }
+        char *name = stList_get(tokens, 0);
+        int64_t *lengthPtr = stHash_search(sequenceLengths, name);
+        if (lengthPtr == NULL || start < 0 || end > *lengthPtr) {
+            st_errAbort("Coverage file %s has an interval %s:%" PRIi64 "-%" PRIi64
+                        " that is not in the fasta file", bedPath, name, start, end);
+        }
+        if (start < end && depth > 0) {
+            coverage_addInterval(getCoverage(name, NULL, FALSE), start, end, depth);
+        }
+        stList_destruct(tokens);
+        free(line);
     }
-    return array;
+    fclose(bedHandle);
 }
 
 int main(int argc, char *argv[])
@@ -211,8 +336,11 @@ int main(int argc, char *argv[])
                              {"onlyContig2", no_argument, NULL, '2'},
                              {"depthById", no_argument, NULL, 'i'},
                              {"from", required_argument, NULL, 'f'},
+                             {"merge", required_argument, NULL, 'm'},
+                             {"uncapped", no_argument, NULL, 'u'},
                              {0, 0, 0, 0} };
-    int outputOnContig1 = TRUE, outputOnContig2 = TRUE, depthById = FALSE;
+    stList *mergePaths = stList_construct3(0, free);
+    int outputOnContig1 = TRUE, outputOnContig2 = TRUE, depthById = FALSE, uncapped = FALSE;
     int64_t flag, i;
     while((flag = getopt_long(argc, argv, "", opts, NULL)) != -1) {
         switch(flag) {
@@ -228,6 +356,12 @@ int main(int argc, char *argv[])
         case 'f':
             otherGenomeFastaPath = stString_copy(optarg);
             break;
+        case 'm':
+            stList_append(mergePaths, stString_copy(optarg));
+            break;
+        case 'u':
+            uncapped = TRUE;
+            break;
         case '?':
         default:
             usage();
@@ -256,14 +390,15 @@ int main(int argc, char *argv[])
     sequenceLengths = stHash_construct3(stHash_stringKey,
                                         stHash_stringEqualKey, free, free);
     sequenceCoverage = stHash_construct3(stHash_stringKey,
-                                         stHash_stringEqualKey, free, free);
+                                         stHash_stringEqualKey, free,
+                                         (void (*)(void *)) coverage_destruct);
     sequenceNames = stList_construct3(0, free);
     IDToSequenceCoverage = stHash_construct3(stHash_stringKey,
                                              stHash_stringEqualKey,
                                              free,
                                              (void (*)(void *)) stHash_destruct);
 
-    if (optind >= argc - 1) {
+    if (optind >= argc - (stList_length(mergePaths) > 0 ? 0 : 1)) {
         fprintf(stderr, "fasta file for sequence and alignments file (in "
                 "cigar format) must be provided\n");
         return 1;
@@ -277,36 +412,38 @@ int main(int argc, char *argv[])
     fastaReadToFunction(fastaHandle, addSequenceLength);
     fclose(fastaHandle);
 
-    // Fill coverage arrays with the alignments
-    FILE *alignmentsHandle = fopen(argv[optind + 1], "r");
-    for(;;) {
-        int64_t *lengthPtr;
-        struct PairwiseAlignment *pA = cigarRead(alignmentsHandle);
-        if(pA == NULL) {
-            // Reached end of alignment file
-            break;
-        }
-        if((outputOnContig1 && (lengthPtr = stHash_search(sequenceLengths, pA->contig1))) && ((otherGenomeSequences == NULL) || stSet_search(otherGenomeSequences, pA->contig2))) {
-            // contig 1 is present in the fasta and contig 2 is in the
-            // "from" genome if it exists
-            uint16_t *array = getCoverageArray(pA->contig1, pA->contig2,
-                                               depthById);
-            fillCoverage(pA, 1, array);
+    // Fill coverage with the alignments, as they are read
+    for (int64_t j = optind + 1; j < argc; j++) {
+        FILE *alignmentsHandle = fopen(argv[j], "r");
+        if (alignmentsHandle == NULL) {
+            st_errnoAbort("Could not open alignments file %s", argv[j]);
         }
-        if((outputOnContig2 && (lengthPtr = stHash_search(sequenceLengths, pA->contig2))) && ((otherGenomeSequences == NULL) || stSet_search(otherGenomeSequences, pA->contig1))) {
-            // contig 2 is present in the fasta and contig 1 is in the
-            // "from" genome if it exists
-            uint16_t *array = getCoverageArray(pA->contig2, pA->contig1,
-                                               depthById);
-            fillCoverage(pA, 2, array);
+        for(;;) {
+            int64_t *lengthPtr;
+            struct PairwiseAlignment *pA = cigarRead(alignmentsHandle);
+            if(pA == NULL) {
+                // Reached end of alignment file
+                break;
+            }
+            if((outputOnContig1 && (lengthPtr = stHash_search(sequenceLengths, pA->contig1))) && ((otherGenomeSequences == NULL) || stSet_search(otherGenomeSequences, pA->contig2))) {
+                // contig 1 is present in the fasta and contig 2 is in the
+                // "from" genome if it exists
+                fillCoverage(pA, 1, getCoverage(pA->contig1, pA->contig2, depthById));
+            }
+            if((outputOnContig2 && (lengthPtr = stHash_search(sequenceLengths, pA->contig2))) && ((otherGenomeSequences == NULL) || stSet_search(otherGenomeSequences, pA->contig1))) {
+                // contig 2 is present in the fasta and contig 1 is in the
+                // "from" genome if it exists
+                fillCoverage(pA, 2, getCoverage(pA->contig2, pA->contig1, depthById));
+            }
+            destructPairwiseAlignment(pA);
         }
-        destructPairwiseAlignment(pA);
+        fclose(alignmentsHandle);
     }
-    fclose(alignmentsHandle);
 
     if (depthById) {
-        // Have to merge all coverage arrays that are divided by
-        // source ID into the main sequenceCoverage hash.
+        // Have to merge all coverage that is divided by source ID into
+        // the main sequenceCoverage hash, each ID adding one to the
+        // depth of the intervals it covers.
         stHashIterator *idIt = stHash_getIterator(IDToSequenceCoverage);
         char *id;
         while ((id = stHash_getNext(idIt)) != NULL) {
@@ -315,34 +452,39 @@ int main(int argc, char *argv[])
             stHashIterator *sequenceIt = stHash_getIterator(subHash);
             char *sequence;
             while ((sequence = stHash_getNext(sequenceIt)) != NULL) {
-                uint16_t *srcArray = stHash_search(subHash, sequence);
-                assert(srcArray != NULL);
-                uint16_t *destArray = getCoverageArray(sequence, NULL, FALSE);
-                int64_t *length = stHash_search(sequenceLengths, sequence);
-                assert(length != NULL && *length >= 0);
-                for (int64_t i = 0; i < *length; i++) {
-                    if (srcArray[i] > 0) {
-                        destArray[i]++;
-                    }
+                Coverage *srcCoverage = stHash_search(subHash, sequence);
+                assert(srcCoverage != NULL);
+                coverage_compact(srcCoverage);
+                Coverage *destCoverage = getCoverage(sequence, NULL, FALSE);
+                for (int64_t k = 0; k < srcCoverage->length; k += 2) {
+                    assert(srcCoverage->events[k].change == 1);
+                    assert(srcCoverage->events[k + 1].change == -1);
+                    coverage_addInterval(destCoverage, srcCoverage->events[k].position,
+                                         srcCoverage->events[k + 1].position, 1);
                 }
             }
+            stHash_destructIterator(sequenceIt);
         }
-        stHash_destruct(IDToSequenceCoverage);
+        stHash_destructIterator(idIt);
+    }
+    stHash_destruct(IDToSequenceCoverage);
+
+    // Add the coverage of previous runs
+    for (i = 0; i < stList_length(mergePaths); i++) {
+        mergeCoverage(stList_get(mergePaths, i));
     }
 
     // Print results as BED
     for(i = 0; i < stList_length(sequenceNames); i++) {
-        uint16_t *array;
+        Coverage *coverage;
         char *name = stList_get(sequenceNames, i);
-        int64_t *lengthPtr = stHash_search(sequenceLengths, name);
-        assert(lengthPtr != NULL);
-        int64_t length = *lengthPtr;
-        if((array = stHash_search(sequenceCoverage, name))) {
-            printCoverage(name, array, length);
+        if((coverage = stHash_search(sequenceCoverage, name))) {
+            printCoverage(name, coverage, uncapped ? INT64_MAX : MAX_COVERAGE_DEPTH);
         }
     }
 
     // Cleanup
+    stList_destruct(mergePaths);
     stList_destruct(sequenceNames);
     stHash_destruct(sequenceCoverage);
     stHash_destruct(sequenceLengths);
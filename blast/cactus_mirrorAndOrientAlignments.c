@@ -4,6 +4,7 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <getopt.h>
 #include "sonLib.h"
 #include "pairwiseAlignment.h"
 
@@ -73,12 +74,50 @@ void cigarReverse(struct PairwiseAlignment *pairwiseAlignment) {
 	}
 }
 
+static void usage() {
+	fprintf(stderr, "cactus_mirrorAndOrientAlignments [--binary] logLevel [inputFile outputFile]\n");
+	fprintf(stderr, "Writes each alignment, and its mirror, with respect to the positive strand of the first sequence. "
+			"Reads from stdin and writes to stdout by default.\n");
+	fprintf(stderr, "--binary : Write binary records, rather than text cigars\n");
+}
+
+static void writeAlignment(FILE *fileHandleOut, stPairwiseAlignmentWriter *writer, struct PairwiseAlignment *pairwiseAlignment) {
+	if(writer != NULL) {
+		stPairwiseAlignmentWriter_write(writer, pairwiseAlignment);
+	}
+	else {
+		cigarWrite(fileHandleOut, pairwiseAlignment, 0);
+	}
+}
+
 int main(int argc, char *argv[]) {
 	/*
 	 * For each alignment in the input file copy the alignment to the output file and additionally
 	 * write out the alignment with the first and second sequences reversed. For each alignment written out
 	 * we ensure the alignment is reported with respect to the positive strand of the first reported sequence.
 	 */
+	struct option opts[] = { {"binary", no_argument, NULL, 'b'},
+	                         {0, 0, 0, 0} };
+	bool binary = 0;
+	int flag;
+	while((flag = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+		switch(flag) {
+		case 'b':
+			binary = 1;
+			break;
+		case '?':
+		default:
+			usage();
+			return 1;
+		}
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
+	if(argc != 2 && argc != 4) {
+		usage();
+		return 1;
+	}
+
 	st_setLogLevelFromString(argv[1]);
 
     FILE *fileHandleIn = stdin;
@@ -88,20 +127,19 @@ int main(int argc, char *argv[]) {
 		fileHandleIn = fopen(argv[2], "r");
 		fileHandleOut = fopen(argv[3], "w");
 	}
-	else {
-		assert(argc == 2);
-	}
 
+    stPairwiseAlignmentReader *reader = stPairwiseAlignmentReader_construct(fileHandleIn);
+    stPairwiseAlignmentWriter *writer = binary ? stPairwiseAlignmentWriter_construct(fileHandleOut, 0) : NULL;
     struct PairwiseAlignment *pairwiseAlignment;
 
-    while ((pairwiseAlignment = cigarRead(fileHandleIn)) != NULL) {
+    while ((pairwiseAlignment = stPairwiseAlignmentReader_read(reader)) != NULL) {
 
         // Write out original cigar
     	if(!pairwiseAlignment->strand1) {
     		invertStrands(pairwiseAlignment);
     	}
     	checkPairwiseAlignment(pairwiseAlignment);
-        cigarWrite(fileHandleOut, pairwiseAlignment, 0);
+        writeAlignment(fileHandleOut, writer, pairwiseAlignment);
 
         // Write out mirror cigar (with query and target reversed)
         cigarReverse(pairwiseAlignment);
@@ -109,11 +147,15 @@ int main(int argc, char *argv[]) {
         	invertStrands(pairwiseAlignment);
         }
         checkPairwiseAlignment(pairwiseAlignment);
-        cigarWrite(fileHandleOut, pairwiseAlignment, 0);
+        writeAlignment(fileHandleOut, writer, pairwiseAlignment);
 
         // Cleanup
         destructPairwiseAlignment(pairwiseAlignment);
     }
+    if(writer != NULL) {
+    	stPairwiseAlignmentWriter_destruct(writer);
+    }
+    stPairwiseAlignmentReader_destruct(reader);
     fclose(fileHandleIn);
     fclose(fileHandleOut);
 
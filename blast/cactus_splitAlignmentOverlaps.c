@@ -4,9 +4,18 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <getopt.h>
 #include "sonLib.h"
 #include "pairwiseAlignment.h"
 
+// The default number of alignments read before a batch is ended, at the next point on the first sequence that no
+// alignment of the batch spans, so that batches can be split independently on the thread pool.
+#define ALIGNMENTS_PER_BATCH 10000
+
+// A batch grown to this many times the batch size without such a point, because an alignment spans the rest of
+// it, is split as it is read on the main thread instead, so that the alignments held stay bounded.
+#define MAX_BATCH_GROWTH 4
+
 uint64_t getStartCoordinate(struct PairwiseAlignment *pairwiseAlignment) {
 	assert(pairwiseAlignment->strand1); // This code assumes that the alignment is reported with respect
 	// to the positive strand of the first sequence
@@ -19,152 +28,300 @@ uint64_t getEndCoordinate(struct PairwiseAlignment *pairwiseAlignment) {
 	return pairwiseAlignment->end1;
 }
 
-struct PairwiseAlignment *removeAlignmentPrefix(struct PairwiseAlignment *pairwiseAlignment, int64_t prefixEnd) {
-	// Store the original start coordinates
-	//checkPairwiseAlignment(pairwiseAlignment);
-	int64_t start1 = pairwiseAlignment->start1, start2 = pairwiseAlignment->start2;
-	assert(pairwiseAlignment->end1 > prefixEnd);
-	assert(pairwiseAlignment->start1 < prefixEnd);
-	assert(pairwiseAlignment->strand1);
+typedef struct _activeAlignment {
+	struct PairwiseAlignment *pairwiseAlignment;
+	int64_t order; // The position of the alignment in the input, to break ties between equal ends
+	int64_t opIndex; // The first operation not yet emitted
+	int64_t opOffset; // The length of that operation already emitted
+	int64_t start1, start2; // The start of the part of the alignment not yet emitted
+} ActiveAlignment;
+
+typedef struct _sweep {
+	/*
+	 * The alignments being progressively split, all starting at 'from', in a binary heap ordered by ascending
+	 * end coordinate. The alignments are never modified, the part already emitted is skipped by the op index
+	 * and offset of each.
+	 */
+	ActiveAlignment *heap;
+	int64_t heapLength;
+	int64_t heapMaxLength;
+	int64_t from;
+	int64_t order;
+
+	// The prefix alignment being emitted, whose operations are those of the alignment it is cut from, except
+	// for its first and last, which may be partial and are held in partialOps.
+	struct PairwiseAlignment prefix;
+	struct List prefixOps;
+	struct AlignmentOperation partialOps[2];
+
+	FILE *fileHandleOut;
+	stPairwiseAlignmentWriter *writer; // Non-null if the output is binary
+} Sweep;
+
+static Sweep *sweep_construct(FILE *fileHandleOut, bool binary) {
+	Sweep *sweep = st_calloc(1, sizeof(Sweep));
+	sweep->heapMaxLength = 16;
+	sweep->heap = st_malloc(sizeof(ActiveAlignment) * sweep->heapMaxLength);
+	sweep->prefixOps.maxLength = 16;
+	sweep->prefixOps.list = st_malloc(sizeof(void *) * sweep->prefixOps.maxLength);
+	sweep->prefix.operationList = &sweep->prefixOps;
+	sweep->fileHandleOut = fileHandleOut;
+	sweep->writer = binary ? stPairwiseAlignmentWriter_construct(fileHandleOut, 0) : NULL;
+	return sweep;
+}
+
+static void sweep_destruct(Sweep *sweep) {
+	assert(sweep->heapLength == 0);
+	if(sweep->writer != NULL) {
+		stPairwiseAlignmentWriter_destruct(sweep->writer);
+	}
+	free(sweep->heap);
+	free(sweep->prefixOps.list);
+	free(sweep);
+}
+
+static inline bool heapLessThan(ActiveAlignment *a1, ActiveAlignment *a2) {
+	int64_t end1 = a1->pairwiseAlignment->end1, end2 = a2->pairwiseAlignment->end1;
+	return end1 < end2 || (end1 == end2 && a1->order < a2->order);
+}
 
-	// Split the ops in the cigar string between the prefix and suffix alignments
-	struct List *prefixOps = constructEmptyList(0, (void (*)(void *))destructAlignmentOperation);
+static void heapPush(Sweep *sweep, struct PairwiseAlignment *pairwiseAlignment) {
+	if(sweep->heapLength == sweep->heapMaxLength) {
+		sweep->heapMaxLength *= 2;
+		sweep->heap = st_realloc(sweep->heap, sizeof(ActiveAlignment) * sweep->heapMaxLength);
+	}
+	ActiveAlignment a;
+	a.pairwiseAlignment = pairwiseAlignment;
+	a.order = sweep->order++;
+	a.opIndex = 0;
+	a.opOffset = 0;
+	a.start1 = pairwiseAlignment->start1;
+	a.start2 = pairwiseAlignment->start2;
+
+	// Sift up
+	int64_t i = sweep->heapLength++;
+	while(i > 0 && heapLessThan(&a, &sweep->heap[(i-1)/2])) {
+		sweep->heap[i] = sweep->heap[(i-1)/2];
+		i = (i-1)/2;
+	}
+	sweep->heap[i] = a;
+}
+
+static struct PairwiseAlignment *heapPop(Sweep *sweep) {
+	assert(sweep->heapLength > 0);
+	struct PairwiseAlignment *pairwiseAlignment = sweep->heap[0].pairwiseAlignment;
+	ActiveAlignment a = sweep->heap[--sweep->heapLength];
+
+	// Sift down the last element from the root
 	int64_t i = 0;
+	while(2*i+1 < sweep->heapLength) {
+		int64_t j = 2*i+1;
+		if(j+1 < sweep->heapLength && heapLessThan(&sweep->heap[j+1], &sweep->heap[j])) {
+			j++;
+		}
+		if(!heapLessThan(&sweep->heap[j], &a)) {
+			break;
+		}
+		sweep->heap[i] = sweep->heap[j];
+		i = j;
+	}
+	if(sweep->heapLength > 0) {
+		sweep->heap[i] = a;
+	}
+	return pairwiseAlignment;
+}
+
+static void appendPrefixOp(Sweep *sweep, struct AlignmentOperation *op, int64_t length) {
+	// Adds the given length of the op to the prefix alignment, copying the op only if it is partial
+	if(length != op->length) {
+		struct AlignmentOperation *partialOp = &sweep->partialOps[sweep->prefixOps.length == 0 ? 0 : 1];
+		partialOp->opType = op->opType;
+		partialOp->length = length;
+		partialOp->score = op->score;
+		op = partialOp;
+	}
+	sweep->prefixOps.list[sweep->prefixOps.length++] = op;
+}
+
+static void emitPrefix(Sweep *sweep, ActiveAlignment *a, int64_t prefixEnd) {
+	/*
+	 * Emits the part of the alignment from its current start, inclusive, to prefixEnd, exclusive, and moves its start
+	 * to prefixEnd. Inserts in the second sequence at prefixEnd are left to the suffix, unless the alignment ends at
+	 * prefixEnd, in which case the remainder of the alignment is emitted.
+	 */
+	struct PairwiseAlignment *pairwiseAlignment = a->pairwiseAlignment;
+	struct List *ops = pairwiseAlignment->operationList;
+	assert(a->start1 == sweep->from);
+	assert(a->start1 < prefixEnd);
+	assert(pairwiseAlignment->end1 >= prefixEnd);
+
+	if(sweep->prefixOps.maxLength < ops->length - a->opIndex) {
+		sweep->prefixOps.maxLength = ops->length - a->opIndex;
+		sweep->prefixOps.list = st_realloc(sweep->prefixOps.list, sizeof(void *) * sweep->prefixOps.maxLength);
+	}
+	sweep->prefixOps.length = 0;
+
+	int64_t start1 = a->start1, start2 = a->start2;
+	bool isSuffix = pairwiseAlignment->end1 == prefixEnd;
 	do {
-		assert(i < pairwiseAlignment->operationList->length);
-		struct AlignmentOperation *op = pairwiseAlignment->operationList->list[i];
-		assert(op->length > 0);
-
-		if(op->opType == PAIRWISE_INDEL_Y) { // Insert in second sequence
-			listAppend(prefixOps, op);
-			i++;
-			pairwiseAlignment->start2 += pairwiseAlignment->strand2 ? op->length : -op->length;
-		}
-		else { // Not an insert in second sequence
-			// Op is in the prefix alignment
-			int64_t j;
-			if(pairwiseAlignment->start1 + op->length <= prefixEnd) {
-				listAppend(prefixOps, op);
-				i++;
-				j = op->length;
-			}
-			// Op spans the prefix and suffix alignments, so split it
-			else {
-				j = prefixEnd-pairwiseAlignment->start1;
-				assert(j > 0);
-				listAppend(prefixOps, constructAlignmentOperation(op->opType, j, op->score));
-				op->length -= j;
-				assert(op->length > 0);
-				assert(pairwiseAlignment->start1+j == prefixEnd);
-			}
+		assert(a->opIndex < ops->length);
+		struct AlignmentOperation *op = ops->list[a->opIndex];
+		int64_t length = op->length - a->opOffset;
+		assert(length > 0);
 
-			// Update start coordinates of suffix alignments
-			pairwiseAlignment->start1 += j;
-			if(op->opType != PAIRWISE_INDEL_X) {
-				pairwiseAlignment->start2 += pairwiseAlignment->strand2 ? j : -j;
-			}
+		// Op spans the prefix and suffix alignments, so split it
+		if(op->opType != PAIRWISE_INDEL_Y && start1 + length > prefixEnd) {
+			length = prefixEnd - start1;
+			a->opOffset += length;
+		}
+		else {
+			a->opIndex++;
+			a->opOffset = 0;
 		}
-	} while(pairwiseAlignment->start1 < prefixEnd);
+		appendPrefixOp(sweep, op, length);
 
-	assert(pairwiseAlignment->start1 == prefixEnd);
+		if(op->opType != PAIRWISE_INDEL_Y) {
+			start1 += length;
+		}
+		if(op->opType != PAIRWISE_INDEL_X) { // Not an insert in the first sequence
+			start2 += pairwiseAlignment->strand2 ? length : -length;
+		}
+	} while(start1 < prefixEnd || (isSuffix && a->opIndex < ops->length));
+	assert(start1 == prefixEnd);
 
-	// Remove prefix ops from pairwise alignment
-	uint64_t j=0;
-	while(i<pairwiseAlignment->operationList->length) {
-		pairwiseAlignment->operationList->list[j++] = pairwiseAlignment->operationList->list[i++];
-	}
-	pairwiseAlignment->operationList->length = j;
-	assert(pairwiseAlignment->operationList->length > 0);
+	struct PairwiseAlignment *prefix = &sweep->prefix;
+	prefix->contig1 = pairwiseAlignment->contig1;
+	prefix->start1 = a->start1;
+	prefix->end1 = start1;
+	prefix->strand1 = 1;
+	prefix->contig2 = pairwiseAlignment->contig2;
+	prefix->start2 = a->start2;
+	prefix->end2 = start2;
+	prefix->strand2 = pairwiseAlignment->strand2;
+	prefix->score = pairwiseAlignment->score;
+	assert(!isSuffix || start2 == pairwiseAlignment->end2);
 
-	// Create prefix pairwiseAlignment
-	struct PairwiseAlignment *prefixAlignment = constructPairwiseAlignment(pairwiseAlignment->contig1,
-			start1, pairwiseAlignment->start1, 1,
-			pairwiseAlignment->contig2, start2, pairwiseAlignment->start2, pairwiseAlignment->strand2,
-			pairwiseAlignment->score, prefixOps);
-	//checkPairwiseAlignment(pairwiseAlignment);
-	//checkPairwiseAlignment(prefixAlignment);
+	if(sweep->writer != NULL) {
+		stPairwiseAlignmentWriter_write(sweep->writer, prefix);
+	}
+	else {
+		cigarWrite(sweep->fileHandleOut, prefix, 0);
+	}
 
-	return prefixAlignment;
+	a->start1 = start1;
+	a->start2 = start2;
 }
 
-void emitBlock(stSortedSet *activeAlignments, uint64_t from, uint64_t to, FILE *fileHandleOut) {
+static void splitAlignmentOverlaps(Sweep *sweep, int64_t splitUpto) {
 	/*
-	 * Emits block of alignments that are all start, inclusive, at 'fromt' and end, exclusive, at 'to'.
+	 * Emits the blocks of the active alignments up to splitUpto, each block ending at the least end of the active
+	 * alignments, or at splitUpto.
 	 */
-	// Now split the remaining alignments, which must all end after prefixEnd
-	struct PairwiseAlignment *pairwiseAlignment;
-	while(stSortedSet_size(activeAlignments) > 0 &&
-		  getStartCoordinate(pairwiseAlignment = stSortedSet_getFirst(activeAlignments)) < to) {
-		assert(getStartCoordinate(pairwiseAlignment) == from);
-		//assert(getEndCoordinate(pairwiseAlignment) >= to);
-		
-		// Remove from active alignments
-		assert(stSortedSet_search(activeAlignments, pairwiseAlignment) == pairwiseAlignment);
-		stSortedSet_remove(activeAlignments, pairwiseAlignment);
-		assert(stSortedSet_search(activeAlignments, pairwiseAlignment) == NULL);
-		
-		// If the alignment needs to be split
-		if(getEndCoordinate(pairwiseAlignment) > to) {
-			// Cleave off the prefix of the alignment
-			struct PairwiseAlignment *prefixPairwiseAlignment = removeAlignmentPrefix(pairwiseAlignment, to);
-			assert(getStartCoordinate(prefixPairwiseAlignment) == from);
-			assert(getEndCoordinate(prefixPairwiseAlignment) == to);
-			assert(getStartCoordinate(pairwiseAlignment) == to);
-
-			// Add back the suffix alignment to the set
-			stSortedSet_insert(activeAlignments, pairwiseAlignment);
-
-			// Set the prefix alignment to be written out and then cleaned up
-			pairwiseAlignment = prefixPairwiseAlignment;
-		}
-		
-		// Write out the prefix alignment up until end
-		cigarWrite(fileHandleOut, pairwiseAlignment, 0);
-		// Delete the pairwise alignment
-		assert(stSortedSet_search(activeAlignments, pairwiseAlignment) == NULL);
-		destructPairwiseAlignment(pairwiseAlignment);
-	}
-}
-
-void splitAlignmentOverlaps(stSortedSet *activeAlignments, uint64_t splitUpto, FILE *fileHandleOut) {
-	if(stSortedSet_size(activeAlignments) == 0) {
-		return; // Nothing to do
-	}
-
-	// Process overlaps between alignments that precede splitUpto
-	uint64_t from = getStartCoordinate(stSortedSet_getFirst(activeAlignments));
-	uint64_t to;
-	// while (minEndCoordinate = Min end coordinate in S) < splitUpto:
-	while(stSortedSet_size(activeAlignments) > 0 &&
-		  (to = getEndCoordinate(stSortedSet_getFirst(activeAlignments))) < splitUpto) {
-		assert(from < to);
-		emitBlock(activeAlignments, from, to, fileHandleOut);
-		from = to;
-	}
-
-	// Now split at the splitUpto point
-	if(stSortedSet_size(activeAlignments) > 0) {
-		assert(from < to);
-		emitBlock(activeAlignments, from, splitUpto, fileHandleOut);
-	}
-}
-
-int comparePairwiseAlignments(const void *a, const void *b) {
-	struct PairwiseAlignment *pA1 = (struct PairwiseAlignment *)a;
-	struct PairwiseAlignment *pA2 = (struct PairwiseAlignment *)b;
-
-	int i = strcmp(pA1->contig1, pA2->contig1);
-	if(i == 0) {
-		i = pA1->start1 > pA2->start1 ? 1 : pA1->start1 < pA2->start1 ? -1 : 0;
-		if(i == 0) {
-			i = pA1->end1 > pA2->end1 ? 1 : pA1->end1 < pA2->end1 ? -1 : 0;
-			if(i == 0) {
-				i = pA1 > pA2 ? 1 : pA1 < pA2 ? -1 : 0;
-			}
+	while(sweep->heapLength > 0) {
+		int64_t to = sweep->heap[0].pairwiseAlignment->end1;
+		if(to > splitUpto) {
+			to = splitUpto;
+		}
+		if(to <= sweep->from) {
+			break;
+		}
+		for(int64_t i=0; i<sweep->heapLength; i++) {
+			emitPrefix(sweep, &sweep->heap[i], to);
+		}
+		// Remove the alignments that are now completely emitted
+		while(sweep->heapLength > 0 && sweep->heap[0].pairwiseAlignment->end1 == to) {
+			destructPairwiseAlignment(heapPop(sweep));
 		}
+		sweep->from = to;
 	}
+}
+
+static void sweep_add(Sweep *sweep, struct PairwiseAlignment *pairwiseAlignment) {
+	// Remove overlaps in alignments up to but excluding the start of pairwiseAlignment
+	splitAlignmentOverlaps(sweep, getStartCoordinate(pairwiseAlignment));
+	heapPush(sweep, pairwiseAlignment);
+	sweep->from = getStartCoordinate(pairwiseAlignment);
+}
+
+static void sweep_finish(Sweep *sweep) {
+	// Remove remaining overlaps in alignments
+	splitAlignmentOverlaps(sweep, INT64_MAX);
+}
+
+typedef struct _batch {
+	stList *alignments; // On one contig, sorted by start coordinate, overlapping no alignment of another batch
+	bool binary;
+	FILE *fileHandleOut; // A temporary file holding the output, to be copied out in order
+} Batch;
+
+static Batch *batch_construct(bool binary) {
+	Batch *batch = st_calloc(1, sizeof(Batch));
+	batch->alignments = stList_construct();
+	batch->binary = binary;
+	return batch;
+}
+
+static void batch_destruct(Batch *batch) {
+	stList_destruct(batch->alignments);
+	free(batch);
+}
+
+static void *splitBatch(void *arg) {
+	Batch *batch = arg;
+	// The output goes to disk rather than memory, as it can be many times the size of the input
+	batch->fileHandleOut = tmpfile();
+	if(batch->fileHandleOut == NULL) {
+		st_errnoAbort("Could not open a temporary file for split alignments");
+	}
+	Sweep *sweep = sweep_construct(batch->fileHandleOut, batch->binary);
+	for(int64_t i=0; i<stList_length(batch->alignments); i++) {
+		sweep_add(sweep, stList_get(batch->alignments, i));
+	}
+	sweep_finish(sweep);
+	sweep_destruct(sweep);
+	return NULL;
+}
+
+static void copyBatchOutput(Batch *batch, FILE *fileHandleOut) {
+	char buffer[65536];
+	size_t length;
+	rewind(batch->fileHandleOut);
+	while((length = fread(buffer, 1, sizeof(buffer), batch->fileHandleOut)) > 0) {
+		if(fwrite(buffer, 1, length, fileHandleOut) != length) {
+			st_errnoAbort("Could not write split alignments");
+		}
+	}
+	if(ferror(batch->fileHandleOut)) {
+		st_errnoAbort("Could not read back split alignments");
+	}
+	fclose(batch->fileHandleOut);
+}
+
+static void reportBatches(stList *batches, stThreadPool *threadPool, FILE *fileHandleOut) {
+	/*
+	 * Splits a set of batches on the thread pool, then writes their output in the order they were read.
+	 */
+	for(int64_t i=0; i<stList_length(batches); i++) {
+		stThreadPool_push(threadPool, stList_get(batches, i));
+	}
+	stThreadPool_wait(threadPool);
+	for(int64_t i=0; i<stList_length(batches); i++) {
+		Batch *batch = stList_get(batches, i);
+		copyBatchOutput(batch, fileHandleOut);
+		batch_destruct(batch);
+	}
+	while(stList_length(batches) > 0) {
+		stList_pop(batches);
+	}
+}
 
-	return i;
+static void usage() {
+	fprintf(stderr, "cactus_splitAlignmentOverlaps [--threads N] [--batchSize N] logLevel [inputFile outputFile]\n");
+	fprintf(stderr, "Reads alignments sorted by start coordinate and splits them so that no two partially overlap on "
+			"the first sequence. Binary input gives binary output.\n");
+	fprintf(stderr, "--threads N : Split independent runs of alignments on N threads (default 1)\n");
+	fprintf(stderr, "--batchSize N : The alignments in each run split on a thread, at least (default %d)\n",
+			ALIGNMENTS_PER_BATCH);
 }
 
 int main(int argc, char *argv[]) {
@@ -175,6 +332,38 @@ int main(int argc, char *argv[]) {
 	 * This program breaks up alignments in the input file so that there are no partial overlaps between
 	 * alignments, outputting the non-partially-overlapping alignments to the output file.
 	 */
+	struct option opts[] = { {"threads", required_argument, NULL, 't'},
+	                         {"batchSize", required_argument, NULL, 'b'},
+	                         {0, 0, 0, 0} };
+	int64_t threadNumber = 1, batchSize = ALIGNMENTS_PER_BATCH;
+	int flag;
+	while((flag = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+		switch(flag) {
+		case 't':
+			if(sscanf(optarg, "%" PRIi64 "", &threadNumber) != 1 || threadNumber < 1) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'b':
+			if(sscanf(optarg, "%" PRIi64 "", &batchSize) != 1 || batchSize < 1) {
+				usage();
+				return 1;
+			}
+			break;
+		case '?':
+		default:
+			usage();
+			return 1;
+		}
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
+	if(argc != 2 && argc != 4) {
+		usage();
+		return 1;
+	}
+
 	st_setLogLevelFromString(argv[1]);
 
 	FILE *fileHandleIn;
@@ -185,47 +374,116 @@ int main(int argc, char *argv[]) {
 		fileHandleOut = stdout;
 	}
 	else {
-		assert(argc == 4);
 		fileHandleIn = fopen(argv[2], "r");
 		fileHandleOut = fopen(argv[3], "w");
 	}
 
-    // Set of alignments being progressively processed, ordered by ascending query end coordinate
-    stSortedSet *activeAlignments = stSortedSet_construct3(comparePairwiseAlignments, NULL);
+	bool binary = stPairwiseAlignment_isBinary(fileHandleIn);
+	stPairwiseAlignmentReader *reader = stPairwiseAlignmentReader_construct(fileHandleIn);
+	stThreadPool *threadPool = threadNumber > 1 ? stThreadPool_construct(threadNumber, splitBatch, NULL) : NULL;
 
-    struct PairwiseAlignment *pairwiseAlignment;
-    while ((pairwiseAlignment = cigarRead(fileHandleIn)) != NULL) {
+	// Batches read but not yet split
+	stList *batches = stList_construct();
+	Batch *batch = NULL;
+	// Splits the alignments as they are read: with one thread always, else while a batch cannot be ended
+	Sweep *sweep = NULL;
+	int64_t end = 0; // The greatest end coordinate of the alignments of the batch or sweep
+	char *previousContig = NULL;
+	int64_t previousStart = 0;
 
-    	// There are existing alignments
-    	if(stSortedSet_size(activeAlignments) > 0) {
-    		// If the new alignment is on the same sequence as the previous sequence
-			if(strcmp(((struct PairwiseAlignment *)stSortedSet_getFirst(activeAlignments))->contig1,
-					pairwiseAlignment->contig1) == 0) {
-				// Remove overlaps in alignments up to but excluding the start of pairwiseAlignment
-				splitAlignmentOverlaps(activeAlignments, getStartCoordinate(pairwiseAlignment), fileHandleOut);
+	struct PairwiseAlignment *pairwiseAlignment;
+	while((pairwiseAlignment = stPairwiseAlignmentReader_read(reader)) != NULL) {
+		if(pairwiseAlignment->end1 <= pairwiseAlignment->start1) {
+			st_errAbort("Alignment is empty on the first sequence: %s %" PRIi64 " %" PRIi64 "",
+					pairwiseAlignment->contig1, pairwiseAlignment->start1, pairwiseAlignment->end1);
+		}
+		// The previous alignment may already be split and freed, so its contig and start are kept
+		bool sameContig = previousContig != NULL && strcmp(previousContig, pairwiseAlignment->contig1) == 0;
+		if(sameContig && pairwiseAlignment->start1 < previousStart) {
+			st_errAbort("Alignments are not sorted by start coordinate: %s %" PRIi64 " follows %" PRIi64 "",
+					pairwiseAlignment->contig1, pairwiseAlignment->start1, previousStart);
+		}
+		if(!sameContig) {
+			free(previousContig);
+			previousContig = stString_copy(pairwiseAlignment->contig1);
+		}
+		previousStart = pairwiseAlignment->start1;
+
+		if(sweep != NULL) {
+			// If pairwiseAlignment is on a new sequence the sweep is finished, and with threads, if no alignment
+			// of the sweep spans the start of pairwiseAlignment, batches can be used again
+			if(!sameContig || (threadPool != NULL && pairwiseAlignment->start1 >= end)) {
+				sweep_finish(sweep);
+				end = 0;
+				if(threadPool != NULL) {
+					sweep_destruct(sweep);
+					sweep = NULL;
+				}
+			}
+		}
+		else if(batch != NULL) {
+			// If pairwiseAlignment is on a new sequence, or the batch is full and no alignment of it spans
+			// the start of pairwiseAlignment, the batch is complete
+			if(!sameContig || (stList_length(batch->alignments) >= batchSize && pairwiseAlignment->start1 >= end)) {
+				stList_append(batches, batch);
+				if(stList_length(batches) >= threadNumber) {
+					reportBatches(batches, threadPool, fileHandleOut);
+				}
+				batch = NULL;
+			}
+			else if(stList_length(batch->alignments) >= MAX_BATCH_GROWTH * batchSize) {
+				// An alignment spans the rest of the batch, so continue by splitting as the alignments are read
+				reportBatches(batches, threadPool, fileHandleOut);
+				sweep = sweep_construct(fileHandleOut, binary);
+				for(int64_t i=0; i<stList_length(batch->alignments); i++) {
+					sweep_add(sweep, stList_get(batch->alignments, i));
+				}
+				batch_destruct(batch);
+				batch = NULL;
+			}
+		}
+		if(sweep == NULL && batch == NULL) {
+			if(threadPool != NULL) {
+				batch = batch_construct(binary);
 			}
 			else {
-				// If pairwiseAlignment is on a new sequence
-				splitAlignmentOverlaps(activeAlignments, UINT64_MAX, fileHandleOut);
-				assert(stSortedSet_size(activeAlignments) == 0);
+				sweep = sweep_construct(fileHandleOut, binary);
 			}
-    	}
+			end = 0;
+		}
 
-    	// Add pairwiseAlignment to the set of activeAlignemnts
-    	stSortedSet_insert(activeAlignments, pairwiseAlignment);
-    }
-    // Remove remaining overlaps in alignments
-    splitAlignmentOverlaps(activeAlignments, UINT64_MAX, fileHandleOut);
-    assert(stSortedSet_size(activeAlignments) == 0);
+		if(sweep != NULL) {
+			sweep_add(sweep, pairwiseAlignment);
+		}
+		else {
+			stList_append(batch->alignments, pairwiseAlignment);
+		}
+		if(pairwiseAlignment->end1 > end) {
+			end = pairwiseAlignment->end1;
+		}
+	}
+	if(sweep != NULL) {
+		sweep_finish(sweep);
+		sweep_destruct(sweep);
+	}
+	if(batch != NULL) {
+		stList_append(batches, batch);
+	}
+	if(threadPool != NULL) {
+		reportBatches(batches, threadPool, fileHandleOut);
+		stThreadPool_destruct(threadPool);
+	}
 
-    // Cleanup
-    stSortedSet_destruct(activeAlignments);
-    if(argc == 4) {
-    	fclose(fileHandleIn);
-    	fclose(fileHandleOut);
-    }
+	// Cleanup
+	free(previousContig);
+	stList_destruct(batches);
+	stPairwiseAlignmentReader_destruct(reader);
+	if(argc == 4) {
+		fclose(fileHandleIn);
+		fclose(fileHandleOut);
+	}
 
-    //while(1);
+	//while(1);
 
-    return 0;
+	return 0;
 }
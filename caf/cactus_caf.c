@@ -93,6 +93,9 @@ static void usage() {
     fprintf(stderr, "-T --minimumBlockHomologySupport: Minimum fraction of possible homologies required not to be considered a transitively collapsed megablock.\n");
     fprintf(stderr, "-U --phylogenyNucleotideScalingFactor: Weighting for the nucleotide information in the distance matrix used to build each tree.\n");
     fprintf(stderr, "-V --minimumBlockDegreeToCheckSupport: Minimum degree required to be checked for being a megablock.\n");
+    fprintf(stderr, "--annealingThreads : Number of threads with which to anneal alignments that are not filtered, default 1.\n");
+    fprintf(stderr, "--compressionCodec : Codec with which flowers are written, either 'lz4', 'lz4hc' or 'zlib', default lz4.\n");
+    fprintf(stderr, "--compressionThreads : Number of threads with which to compress the flowers written, default 1.\n");
 }
 
 static int64_t *getInts(const char *string, int64_t *arrayLength) {
@@ -322,6 +325,9 @@ int main(int argc, char *argv[]) {
     bool (*recoverableChainsFilter)(stCactusEdgeEnd *, Flower *) = NULL;
     int64_t maxRecoverableChainsIterations = 1;
     int64_t maxRecoverableChainLength = INT64_MAX;
+    int64_t annealingThreads = 1;
+    stCompressionCodec compressionCodec = ST_COMPRESSION_LZ4;
+    int64_t compressionThreads = 1;
 
     //Parameters for removing ancient homologies
     bool doPhylogeny = false;
@@ -404,6 +410,9 @@ int main(int argc, char *argv[]) {
 				{ "maxRecoverableChainsIterations", required_argument, 0, '1' },
 				{ "maxRecoverableChainLength", required_argument, 0, '2' },
 				{ "secondaryAlignments", required_argument, 0, '3' },
+				{ "annealingThreads", required_argument, 0, '4' },
+				{ "compressionCodec", required_argument, 0, '5' },
+				{ "compressionThreads", required_argument, 0, '6' },
 				{ 0, 0, 0, 0 } };
 
         int option_index = 0;
@@ -697,6 +706,24 @@ int main(int argc, char *argv[]) {
             case '3':
                 secondaryAlignmentsFile = stString_copy(optarg);
                 break;
+            case '4':
+                k = sscanf(optarg, "%" PRIi64, &annealingThreads);
+                if (k != 1 || annealingThreads < 1) {
+                    st_errAbort("Error parsing the annealingThreads argument");
+                }
+                break;
+            case '5':
+                compressionCodec = stCompression_parseCodec(optarg);
+                if (compressionCodec == ST_COMPRESSION_UNTAGGED) {
+                    st_errAbort("Error parsing the compressionCodec argument");
+                }
+                break;
+            case '6':
+                k = sscanf(optarg, "%" PRIi64, &compressionThreads);
+                if (k != 1 || compressionThreads < 1) {
+                    st_errAbort("Error parsing the compressionThreads argument");
+                }
+                break;
             default:
                 usage();
                 return 1;
@@ -745,6 +772,7 @@ int main(int argc, char *argv[]) {
 
     kvDatabaseConf = stKVDatabaseConf_constructFromString(cactusDiskDatabaseString);
     cactusDisk = cactusDisk_construct(kvDatabaseConf, false, true);
+    cactusDisk_setCompression(cactusDisk, compressionCodec, -1, compressionThreads);
     st_logInfo("Set up the flower disk\n");
 
     ///////////////////////////////////////////////////////////////////////////
@@ -753,7 +781,7 @@ int main(int argc, char *argv[]) {
 
     stPinchIterator *pinchIteratorForConstraints = NULL;
     if (constraintsFile != NULL) {
-        pinchIteratorForConstraints = stPinchIterator_constructFromFile(constraintsFile);
+        pinchIteratorForConstraints = stPinchIterator_constructFromFileInMemory(constraintsFile, 0);
         st_logInfo("Created an iterator for the alignment constaints from file: %s\n", constraintsFile);
     }
 
@@ -763,13 +791,11 @@ int main(int argc, char *argv[]) {
 
     startTime = time(NULL);
 
-    stList *flowers = flowerWriter_parseFlowersFromStdin(cactusDisk);
-    if (alignmentsFile == NULL) {
-        cactusDisk_preCacheStrings(cactusDisk, flowers);
-    }
+    //The next batch of flowers, and their strings if the alignments are computed from them, are fetched
+    //while the current flowers are processed.
+    FlowerStream *flowerStream = flowerWriter_getFlowerStream2(cactusDisk, stdin, 1, alignmentsFile == NULL);
     char *tempFile1 = NULL;
-    for (int64_t i = 0; i < stList_length(flowers); i++) {
-        flower = stList_get(flowers, i);
+    for (int64_t i = 0; (flower = flowerStream_getNext(flowerStream)) != NULL; i++) {
         if (!flower_builtBlocks(flower)) { // Do nothing if the flower already has defined blocks
             st_logDebug("Processing flower: %lli\n", flower_getName(flower));
 
@@ -791,18 +817,13 @@ int main(int argc, char *argv[]) {
             stList *alignmentsList = NULL;
             if (alignmentsFile != NULL) {
                 assert(i == 0);
-                assert(stList_length(flowers) == 1);
+                assert(flowerStream_size(flowerStream) == 1);
 
-                if (sortAlignments) {
-                    tempFile1 = getTempFile();
-                    stCaf_sortCigarsFileByScoreInDescendingOrder(alignmentsFile, tempFile1);
-                    pinchIterator = stPinchIterator_constructFromFile(tempFile1);
-                } else {
-                    pinchIterator = stPinchIterator_constructFromFile(alignmentsFile);
-                }
+                //The alignments are parsed, and sorted if needed, once, then replayed from memory in each round.
+                pinchIterator = stPinchIterator_constructFromFileInMemory(alignmentsFile, sortAlignments);
 
                 if(secondaryAlignmentsFile != NULL) {
-                	secondaryPinchIterator = stPinchIterator_constructFromFile(secondaryAlignmentsFile);
+                	secondaryPinchIterator = stPinchIterator_constructFromFileInMemory(secondaryAlignmentsFile, 0);
                 }
 
             } else {
@@ -832,12 +853,16 @@ int main(int argc, char *argv[]) {
 
                 //Add back in the constraints
                 if (pinchIteratorForConstraints != NULL) {
-                    stCaf_anneal(threadSet, pinchIteratorForConstraints, NULL);
+                    stCaf_annealInParallel(threadSet, pinchIteratorForConstraints, NULL, annealingThreads);
                 }
 
-                //Do the annealing
+                //Do the annealing, the filters are not thread safe so filtered annealing is serial
                 if (annealingRound == 0) {
-                    stCaf_anneal(threadSet, pinchIterator, filterFn);
+                    if (filterFn == NULL) {
+                        stCaf_annealInParallel(threadSet, pinchIterator, NULL, annealingThreads);
+                    } else {
+                        stCaf_anneal(threadSet, pinchIterator, filterFn);
+                    }
                 } else {
                     stCaf_annealBetweenAdjacencyComponents(threadSet, pinchIterator, filterFn);
                 }
@@ -882,15 +907,13 @@ int main(int argc, char *argv[]) {
                     }
                 }
 
-                //Do the melting rounds
-                for (int64_t meltingRound = 0; meltingRound < meltingRoundsLength; meltingRound++) {
-                    int64_t minimumChainLengthForMeltingRound = meltingRounds[meltingRound];
-                    st_logDebug("Starting melting round with a minimum chain length of %" PRIi64 " \n", minimumChainLengthForMeltingRound);
-                    if (minimumChainLengthForMeltingRound >= minimumChainLength) {
-                        break;
-                    }
-                    stCaf_melt(flower, threadSet, NULL, 0, minimumChainLengthForMeltingRound, 0, INT64_MAX);
-                } st_logDebug("Last melting round of cycle with a minimum chain length of %" PRIi64 " \n", minimumChainLength);
+                //Do the melting rounds, rebuilding the cactus graph between rounds only where blocks were destroyed
+                int64_t meltingRoundNumber = 0;
+                while (meltingRoundNumber < meltingRoundsLength && meltingRounds[meltingRoundNumber] < minimumChainLength) {
+                    meltingRoundNumber++;
+                }
+                stCaf_meltRounds(flower, threadSet, meltingRounds, meltingRoundNumber);
+                st_logDebug("Last melting round of cycle with a minimum chain length of %" PRIi64 " \n", minimumChainLength);
                 stCaf_melt(flower, threadSet, NULL, 0, minimumChainLength, breakChainsAtReverseTandems, maximumMedianSequenceLengthBetweenLinkedEnds);
                 //This does the filtering of blocks that do not have the required species/tree-coverage/degree.
                 stCaf_melt(flower, threadSet, blockFilterFn, blockTrim, 0, 0, INT64_MAX);
@@ -973,7 +996,7 @@ int main(int argc, char *argv[]) {
             stPinchThreadSet_destruct(threadSet);
             stPinchIterator_destruct(pinchIterator);
             if(secondaryPinchIterator != NULL) {
-            	free(secondaryPinchIterator);
+            	stPinchIterator_destruct(secondaryPinchIterator);
             }
             stSet_destruct(outgroupThreads);
 
@@ -985,7 +1008,7 @@ int main(int argc, char *argv[]) {
             st_logInfo("We've already built blocks / alignments for this flower\n");
         }
     }
-    stList_destruct(flowers);
+    flowerStream_destruct(flowerStream);
     if (tempFile1 != NULL) {
         st_system("rm %s", tempFile1);
     }
@@ -10,6 +10,12 @@
 // respecting end blocks.
 ///////////////////////////////////////////////////////////////////////////
 
+static void stCaf_ensureThreadEndsAreDistinct(stPinchThread *thread) {
+    stPinchThread_split(thread, stPinchThread_getStart(thread));
+    assert(stPinchThread_getLength(thread) > 1);
+    stPinchThread_split(thread, stPinchThread_getStart(thread) + stPinchThread_getLength(thread) - 2);
+}
+
 static void stCaf_ensureEndsAreDistinct(stPinchThreadSet *threadSet) {
     /*
      * Ensures the blocks at the ends of threads are distinct.
@@ -17,9 +23,7 @@ static void stCaf_ensureEndsAreDistinct(stPinchThreadSet *threadSet) {
     stPinchThread *thread;
     stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet);
     while ((thread = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
-        stPinchThread_split(thread, stPinchThread_getStart(thread));
-        assert(stPinchThread_getLength(thread) > 1);
-        stPinchThread_split(thread, stPinchThread_getStart(thread) + stPinchThread_getLength(thread) - 2);
+        stCaf_ensureThreadEndsAreDistinct(thread);
     }
 }
 
@@ -28,6 +32,31 @@ void stCaf_joinTrivialBoundaries(stPinchThreadSet *threadSet) {
     stCaf_ensureEndsAreDistinct(threadSet);
 }
 
+void stCaf_joinTrivialBoundariesOfThreads(stList *threads) {
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stPinchThread_joinTrivialBoundaries(stList_get(threads, i));
+    }
+    //Joining a boundary keeps the block of the segment being walked, so the walk can carry on from it
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stPinchSegment *segment = stPinchThread_getFirst(stList_get(threads, i));
+        while (segment != NULL) {
+            stPinchBlock *block = stPinchSegment_getBlock(segment);
+            if (block != NULL) {
+                for (int64_t orientation = 0; orientation < 2; orientation++) {
+                    stPinchEnd end = stPinchEnd_constructStatic(block, orientation);
+                    if (stPinchEnd_boundaryIsTrivial(end)) {
+                        stPinchEnd_joinTrivialBoundary(end);
+                    }
+                }
+            }
+            segment = stPinchSegment_get3Prime(segment);
+        }
+    }
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stCaf_ensureThreadEndsAreDistinct(stList_get(threads, i));
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Basic annealing function
 ///////////////////////////////////////////////////////////////////////////
@@ -63,6 +92,145 @@ void stCaf_anneal(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, b
     stCaf_joinTrivialBoundaries(threadSet);
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Parallel annealing. The pinches are partitioned into sets whose threads
+// are not connected, by a pinch or an existing block, to the threads of any
+// other set. Each set only touches its own threads, segments and blocks, so
+// the sets are annealed concurrently, each in the order of the iterator.
+///////////////////////////////////////////////////////////////////////////
+
+typedef struct _annealingJob {
+    stPinchThreadSet *threadSet;
+    stPinch *pinches;
+    int64_t pinchNumber;
+    bool (*filterFn)(stPinchSegment *, stPinchSegment *);
+} AnnealingJob;
+
+static void *annealingJob_run(AnnealingJob *job) {
+    for (int64_t i = 0; i < job->pinchNumber; i++) {
+        stPinch *pinch = &job->pinches[i];
+        stPinchThread *thread1 = stPinchThreadSet_getThread(job->threadSet, pinch->name1);
+        stPinchThread *thread2 = stPinchThreadSet_getThread(job->threadSet, pinch->name2);
+        assert(thread1 != NULL && thread2 != NULL);
+        if (job->filterFn != NULL) {
+            stPinchThread_filterPinch(thread1, thread2, pinch->start1, pinch->start2, pinch->length, pinch->strand, job->filterFn);
+        } else {
+            stPinchThread_pinch(thread1, thread2, pinch->start1, pinch->start2, pinch->length, pinch->strand);
+        }
+    }
+    return NULL;
+}
+
+static int cmpAnnealingJobsBySize(const void *a, const void *b) {
+    const AnnealingJob *job1 = a, *job2 = b;
+    return job1->pinchNumber > job2->pinchNumber ? -1 : (job1->pinchNumber < job2->pinchNumber ? 1 : 0);
+}
+
+static stUnionFind *getConnectedThreads(stPinchThreadSet *threadSet, stPinch *pinches, int64_t pinchNumber) {
+    /*
+     * Partitions the threads into sets connected by the given pinches or by the existing blocks.
+     */
+    stUnionFind *connectedThreads = stUnionFind_construct();
+    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet);
+    stPinchThread *thread;
+    while ((thread = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
+        stUnionFind_add(connectedThreads, thread);
+    }
+    stPinchThreadSetBlockIt blockIt = stPinchThreadSet_getBlockIt(threadSet);
+    stPinchBlock *block;
+    while ((block = stPinchThreadSetBlockIt_getNext(&blockIt)) != NULL) {
+        stPinchThread *firstThread = stPinchSegment_getThread(stPinchBlock_getFirst(block));
+        stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(block);
+        stPinchSegment *segment;
+        while ((segment = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+            stUnionFind_union(connectedThreads, firstThread, stPinchSegment_getThread(segment));
+        }
+    }
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        stUnionFind_union(connectedThreads, stPinchThreadSet_getThread(threadSet, pinches[i].name1),
+                stPinchThreadSet_getThread(threadSet, pinches[i].name2));
+    }
+    return connectedThreads;
+}
+
+void stCaf_annealInParallel2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *), void *extraArg,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads) {
+    //Gather the pinches
+    int64_t pinchNumber = 0, maxPinchNumber = 16;
+    stPinch *pinches = st_malloc(sizeof(stPinch) * maxPinchNumber);
+    stPinch *pinch;
+    while ((pinch = pinchIterator(extraArg)) != NULL) {
+        if (pinchNumber == maxPinchNumber) {
+            maxPinchNumber *= 2;
+            pinches = st_realloc(pinches, sizeof(stPinch) * maxPinchNumber);
+        }
+        pinches[pinchNumber++] = *pinch;
+    }
+
+    //Group the pinches of each set of connected threads together, keeping their order
+    stUnionFind *connectedThreads = getConnectedThreads(threadSet, pinches, pinchNumber);
+    stHash *rootsToJobs = stHash_construct();
+    stList *jobs = stList_construct3(0, free); //In order of first appearance, so the grouping is deterministic
+    AnnealingJob **pinchJobs = st_malloc(sizeof(AnnealingJob *) * (pinchNumber > 0 ? pinchNumber : 1));
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        void *root = stUnionFind_find(connectedThreads, stPinchThreadSet_getThread(threadSet, pinches[i].name1));
+        AnnealingJob *job = stHash_search(rootsToJobs, root);
+        if (job == NULL) {
+            job = st_calloc(1, sizeof(AnnealingJob));
+            job->threadSet = threadSet;
+            job->filterFn = filterFn;
+            stHash_insert(rootsToJobs, root, job);
+            stList_append(jobs, job);
+        }
+        job->pinchNumber++;
+        pinchJobs[i] = job;
+    }
+    stPinch *groupedPinches = st_malloc(sizeof(stPinch) * (pinchNumber > 0 ? pinchNumber : 1));
+    for (int64_t i = 0, j = 0; i < stList_length(jobs); i++) {
+        AnnealingJob *job = stList_get(jobs, i);
+        job->pinches = groupedPinches + j;
+        j += job->pinchNumber;
+        job->pinchNumber = 0;
+    }
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        pinchJobs[i]->pinches[pinchJobs[i]->pinchNumber++] = pinches[i];
+    }
+    free(pinchJobs);
+    free(pinches);
+    stHash_destruct(rootsToJobs);
+    stUnionFind_destruct(connectedThreads);
+
+    //Anneal the sets, the largest first so the work is balanced across the threads
+    int64_t jobNumber = stList_length(jobs);
+    if (numThreads > 1 && jobNumber > 1) {
+        stList_sort(jobs, cmpAnnealingJobsBySize);
+        stThreadPool *threadPool = stThreadPool_construct(numThreads < jobNumber ? numThreads : jobNumber,
+                (void *(*)(void *)) annealingJob_run, NULL);
+        for (int64_t i = jobNumber - 1; i >= 0; i--) { //The work is taken from a stack, so push in reverse
+            stThreadPool_push(threadPool, stList_get(jobs, i));
+        }
+        stThreadPool_wait(threadPool);
+        stThreadPool_destruct(threadPool);
+    } else {
+        for (int64_t i = 0; i < jobNumber; i++) {
+            annealingJob_run(stList_get(jobs, i));
+        }
+    }
+    stList_destruct(jobs);
+    free(groupedPinches);
+}
+
+void stCaf_annealInParallel(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads) {
+    if (numThreads <= 1) {
+        stCaf_anneal(threadSet, pinchIterator, filterFn);
+        return;
+    }
+    stPinchIterator_reset(pinchIterator);
+    stCaf_annealInParallel2(threadSet, (stPinch *(*)(void *)) stPinchIterator_getNext, pinchIterator, filterFn, numThreads);
+    stCaf_joinTrivialBoundaries(threadSet);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Annealing function that ignores homologies between bases not in the same adjacency component.
 ///////////////////////////////////////////////////////////////////////////
@@ -190,6 +190,23 @@ void stCaf_breakupComponentsGreedily(stPinchThreadSet *threadSet, float maximumA
     if (maximumAdjacencyComponentSize < 10) {
         maximumAdjacencyComponentSize = 10;
     }
+    //Check if any adjacency component is too big using the cheap CSR graph, the size of a component being its number
+    //of block ends, before building the adjacency components themselves
+    stPinchBlock **blocks;
+    int64_t blockNumber, *endNodes, *edgeOffsets, *edgeTargets;
+    int64_t nodeNumber = stPinchThreadSet_getAdjacencyComponentGraph(threadSet, &blocks, &blockNumber, &endNodes, &edgeOffsets,
+            &edgeTargets);
+    bool hasGiantComponent = 0;
+    for (int64_t i = 0; i < nodeNumber && !hasGiantComponent; i++) {
+        hasGiantComponent = edgeOffsets[i + 1] - edgeOffsets[i] > maximumAdjacencyComponentSize;
+    }
+    free(blocks);
+    free(endNodes);
+    free(edgeOffsets);
+    free(edgeTargets);
+    if (!hasGiantComponent) {
+        return;
+    }
     //Get adjacency components
     stList *adjacencyComponents = stPinchThreadSet_getAdjacencyComponents(threadSet);
     for (int64_t i = 0; i < stList_length(adjacencyComponents); i++) {
@@ -7,6 +7,8 @@
 
 #define _XOPEN_SOURCE 500
 
+#include <sys/stat.h>
+
 #include "bioioC.h"
 #include "cactus.h"
 #include "sonLib.h"
@@ -80,23 +82,44 @@ void stCaf_sortCigarsByScoreInDescendingOrder(stList *cigars) {
 #endif
 }
 
-void stCaf_sortCigarsFileByScoreInDescendingOrder(char *cigarsFile, char *sortedFile) {
-    int64_t i = st_system("sort -k10,10nr -k2,2 %s > %s", cigarsFile, sortedFile);
-    if(i != 0) {
-        st_errAbort("Encountered unix sort error when sorting cigar alignments in file: %s\n", cigarsFile);
-    }
-    i = st_system("chmod 777 %s", sortedFile);
-    if(i != 0) {
-        st_errAbort("Encountered error when changing file permissions: %s\n", cigarsFile);
+static void sortCigarsFile(char *cigarsFile, char *sortedFile,
+        int (*cmpFn)(const struct PairwiseAlignment *, const struct PairwiseAlignment *),
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir, bool unique) {
+    stPairwiseAlignment_sortFile(cigarsFile, sortedFile, cmpFn, memoryBudget, threadNumber, tempDir, unique);
+    if(chmod(sortedFile, 0777) != 0) {
+        st_errAbort("Encountered error when changing file permissions: %s\n", sortedFile);
     }
 #ifndef NDEBUG
-    double score = INT64_MAX;
     FILE *fileHandle = fopen(sortedFile, "r");
-    struct PairwiseAlignment *pA;
+    struct PairwiseAlignment *pA, *pA2 = NULL;
     while ((pA = cigarRead(fileHandle)) != NULL) {
-        assert(pA->score <= score);
-        score = pA->score;
+        if(pA2 != NULL) {
+            assert(cmpFn(pA2, pA) <= 0);
+            destructPairwiseAlignment(pA2);
+        }
+        pA2 = pA;
+    }
+    if(pA2 != NULL) {
+        destructPairwiseAlignment(pA2);
     }
     fclose(fileHandle);
 #endif
 }
+
+void stCaf_sortCigarsFileByScoreInDescendingOrder(char *cigarsFile, char *sortedFile,
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir) {
+    sortCigarsFile(cigarsFile, sortedFile, stPairwiseAlignment_cmpByDescendingScore,
+            memoryBudget, threadNumber, tempDir, 0);
+}
+
+void stCaf_sortCigarsFileByFirstSequenceStartCoordinateInAscendingOrder(char *cigarsFile, char *sortedFile,
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir, bool unique) {
+    sortCigarsFile(cigarsFile, sortedFile, stPairwiseAlignment_cmpByFirstSequenceStart,
+            memoryBudget, threadNumber, tempDir, unique);
+}
+
+void stCaf_sortCigarsFileBySecondSequenceStartCoordinateInAscendingOrder(char *cigarsFile, char *sortedFile,
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir, bool unique) {
+    sortCigarsFile(cigarsFile, sortedFile, stPairwiseAlignment_cmpBySecondSequenceStart,
+            memoryBudget, threadNumber, tempDir, unique);
+}
@@ -108,6 +108,14 @@ static void filterAlignments(stPinchThreadSet *threadSet, bool(*blockFilterFn)(s
     }
 }
 
+static void printMeltingRound(stList *blocksToDelete, int64_t minimumChainLength) {
+    printf("A melting round is destroying %" PRIi64 " blocks with an average degree "
+           "of %lf from chains with length less than %" PRIi64 ". Total aligned bases"
+           " lost: %" PRIu64 "\n",
+           stList_length(blocksToDelete), stCaf_averageBlockDegree(blocksToDelete),
+           minimumChainLength, stCaf_totalAlignedBases(blocksToDelete));
+}
+
 void stCaf_melt(Flower *flower, stPinchThreadSet *threadSet, bool blockFilterfn(stPinchBlock *), int64_t blockEndTrim,
         int64_t minimumChainLength, bool breakChainsAtReverseTandems, int64_t maximumMedianSpacingBetweenLinkedEnds) {
     //First trim
@@ -128,11 +136,7 @@ void stCaf_melt(Flower *flower, stPinchThreadSet *threadSet, bool blockFilterfn(
                 0.0, breakChainsAtReverseTandems, maximumMedianSpacingBetweenLinkedEnds);
         stList *blocksToDelete = stCaf_getBlocksInChainsLessThanGivenLength(cactusGraph, minimumChainLength);
 
-        printf("A melting round is destroying %" PRIi64 " blocks with an average degree "
-               "of %lf from chains with length less than %" PRIi64 ". Total aligned bases"
-               " lost: %" PRIu64 "\n",
-               stList_length(blocksToDelete), stCaf_averageBlockDegree(blocksToDelete),
-               minimumChainLength, stCaf_totalAlignedBases(blocksToDelete));
+        printMeltingRound(blocksToDelete, minimumChainLength);
 
         //Cleanup cactus
         stCactusGraph_destruct(cactusGraph);
@@ -142,6 +146,143 @@ void stCaf_melt(Flower *flower, stPinchThreadSet *threadSet, bool blockFilterfn(
     stCaf_joinTrivialBoundaries(threadSet);
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Incremental melting. Thread components only share the dead end component,
+// so the chains of the cactus graph of the whole thread set are the union of
+// the chains of each thread component's cactus graph. Destroying blocks only
+// changes the thread components containing them, so after the first round
+// only those components' cactus graphs need to be rebuilt.
+///////////////////////////////////////////////////////////////////////////
+
+typedef struct _meltingChain {
+    int64_t length;
+    stList *blocks; //The blocks of the chain that can be destroyed, i.e. those that are not thread ends
+} MeltingChain;
+
+typedef struct _meltingComponent {
+    stList *threads;
+    stList *chains;
+} MeltingComponent;
+
+static void meltingChain_destruct(MeltingChain *chain) {
+    stList_destruct(chain->blocks);
+    free(chain);
+}
+
+static void meltingComponent_destruct(MeltingComponent *component) {
+    stList_destruct(component->threads);
+    stList_destruct(component->chains);
+    free(component);
+}
+
+static void addMeltingComponents(Flower *flower, stList *threads, stList *components) {
+    /*
+     * Builds the cactus graph of the threads and adds their thread components, with their chains, to the list of components.
+     */
+    stCactusNode *startCactusNode;
+    stList *deadEndComponent;
+    stCactusGraph *cactusGraph = stCaf_getCactusGraphForThreads(flower, threads, &startCactusNode, &deadEndComponent, 0, INT64_MAX,
+            0.0, 0, INT64_MAX);
+
+    stHash *threadsToComponents = stHash_construct();
+    stSortedSet *threadComponents = stPinchThreadSet_getThreadComponentsForThreads(threads);
+    stSortedSetIterator *it = stSortedSet_getIterator(threadComponents);
+    stList *threadComponent;
+    while ((threadComponent = stSortedSet_getNext(it)) != NULL) {
+        MeltingComponent *component = st_malloc(sizeof(MeltingComponent));
+        component->threads = stList_copy(threadComponent, NULL);
+        component->chains = stList_construct3(0, (void(*)(void *)) meltingChain_destruct);
+        stList_append(components, component);
+        for (int64_t i = 0; i < stList_length(threadComponent); i++) {
+            stHash_insert(threadsToComponents, stList_get(threadComponent, i), component);
+        }
+    }
+    stSortedSet_destructIterator(it);
+    stSortedSet_destruct(threadComponents);
+
+    stCactusGraphNodeIt *nodeIt = stCactusGraphNodeIterator_construct(cactusGraph);
+    stCactusNode *cactusNode;
+    while ((cactusNode = stCactusGraphNodeIterator_getNext(nodeIt)) != NULL) {
+        stCactusNodeEdgeEndIt cactusEdgeEndIt = stCactusNode_getEdgeEndIt(cactusNode);
+        stCactusEdgeEnd *cactusEdgeEnd;
+        while ((cactusEdgeEnd = stCactusNodeEdgeEndIt_getNext(&cactusEdgeEndIt)) != NULL) {
+            if (stCactusEdgeEnd_isChainEnd(cactusEdgeEnd) && stCactusEdgeEnd_getLinkOrientation(cactusEdgeEnd)) {
+                MeltingChain *chain = st_malloc(sizeof(MeltingChain));
+                chain->length = getChainLength(cactusEdgeEnd);
+                chain->blocks = stList_construct();
+                addChainBlocksToBlocksToDelete(cactusEdgeEnd, chain->blocks);
+                stPinchBlock *block = stPinchEnd_getBlock(stCactusEdgeEnd_getObject(cactusEdgeEnd));
+                MeltingComponent *component = stHash_search(threadsToComponents,
+                        stPinchSegment_getThread(stPinchBlock_getFirst(block)));
+                assert(component != NULL);
+                stList_append(component->chains, chain);
+            }
+        }
+    }
+    stCactusGraphNodeIterator_destruct(nodeIt);
+    stHash_destruct(threadsToComponents);
+    stCactusGraph_destruct(cactusGraph);
+}
+
+void stCaf_meltRounds(Flower *flower, stPinchThreadSet *threadSet, int64_t *minimumChainLengths, int64_t roundNumber) {
+    if (roundNumber <= 0) {
+        return;
+    }
+    //Joining trivial boundaries destroys blocks, so do it everywhere before the chains are found, as the first
+    //stCaf_melt round would after melting. This does not change the chains' lengths, so the same bases are melted.
+    stCaf_joinTrivialBoundaries(threadSet);
+    stList *threads = stList_construct();
+    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet);
+    stPinchThread *pinchThread;
+    while ((pinchThread = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
+        stList_append(threads, pinchThread);
+    }
+    stList *components = stList_construct3(0, (void(*)(void *)) meltingComponent_destruct);
+    addMeltingComponents(flower, threads, components);
+    stList_destruct(threads);
+
+    for (int64_t round = 0; round < roundNumber; round++) {
+        int64_t minimumChainLength = minimumChainLengths[round];
+        st_logDebug("Starting melting round with a minimum chain length of %" PRIi64 " \n", minimumChainLength);
+
+        //Gather the blocks of the short chains, splitting the components into those that lose blocks and those that do not
+        stList *blocksToDelete = stList_construct3(0, (void(*)(void *)) stPinchBlock_destruct);
+        stList *changedThreads = stList_construct();
+        stList *unchangedComponents = stList_construct3(0, (void(*)(void *)) meltingComponent_destruct);
+        while (stList_length(components) > 0) {
+            MeltingComponent *component = stList_pop(components);
+            int64_t blockNumber = stList_length(blocksToDelete);
+            for (int64_t i = 0; i < stList_length(component->chains); i++) {
+                MeltingChain *chain = stList_get(component->chains, i);
+                if (chain->length < minimumChainLength) {
+                    stList_appendAll(blocksToDelete, chain->blocks);
+                }
+            }
+            if (stList_length(blocksToDelete) > blockNumber) {
+                stList_appendAll(changedThreads, component->threads);
+                meltingComponent_destruct(component);
+            } else {
+                stList_append(unchangedComponents, component);
+            }
+        }
+        stList_destruct(components);
+        components = unchangedComponents;
+
+        printMeltingRound(blocksToDelete, minimumChainLength);
+        stList_destruct(blocksToDelete); //This will destroy the blocks
+
+        //Heal up the trivial boundaries where blocks were destroyed
+        stCaf_joinTrivialBoundariesOfThreads(changedThreads);
+
+        //Rebuild the chains of the changed components, unless this was the last round
+        if (stList_length(changedThreads) > 0 && round + 1 < roundNumber) {
+            addMeltingComponents(flower, changedThreads, components);
+        }
+        stList_destruct(changedThreads);
+    }
+    stList_destruct(components);
+}
+
 static bool isTelomere(stPinchEnd *end, stSet *deadEndComponent) {
     stPinchSegment *segment = stPinchBlock_getFirst(end->block);
     bool atEndOfThread = stPinchThread_getFirst(stPinchSegment_getThread(segment)) == segment || stPinchThread_getLast(stPinchSegment_getThread(segment)) == segment;
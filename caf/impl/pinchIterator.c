@@ -6,6 +6,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "sonLib.h"
 #include "stPinchGraphs.h"
 #include "stPinchIterator.h"
@@ -161,6 +162,132 @@ stPinchIterator *stPinchIterator_constructFromList(stList *alignmentsList) {
     return pinchIterator;
 }
 
+/*
+ * An in memory pinch stream: the pinches of a set of alignments, parsed once and held in a flat array that is
+ * replayed on each reset.
+ */
+
+typedef struct _pinchArray {
+    stPinch *pinches;
+    int64_t length;
+    int64_t maxLength;
+    int64_t index;
+    stPinch pinch; //Copy handed out by getNext, so trimming does not modify the array
+} PinchArray;
+
+typedef struct _alignmentRange {
+    float score;
+    int64_t firstPinch;
+    int64_t pinchNumber;
+} AlignmentRange;
+
+typedef struct _pinchArrayReader {
+    FILE *fileHandle;
+    PinchArray *pinchArray;
+    AlignmentRange *alignments;
+    int64_t length;
+    int64_t maxLength;
+} PinchArrayReader;
+
+static struct PairwiseAlignment *pinchArrayReader_getNext(PinchArrayReader *reader) {
+    /*
+     * Reads the next alignment, noting its score and the index of its first pinch.
+     */
+    struct PairwiseAlignment *pairwiseAlignment = cigarRead(reader->fileHandle);
+    if (pairwiseAlignment != NULL) {
+        if (reader->length == reader->maxLength) {
+            reader->maxLength = reader->maxLength * 2 + 16;
+            reader->alignments = st_realloc(reader->alignments, sizeof(AlignmentRange) * reader->maxLength);
+        }
+        AlignmentRange *alignment = &reader->alignments[reader->length++];
+        alignment->score = pairwiseAlignment->score;
+        alignment->firstPinch = reader->pinchArray->length;
+    }
+    return pairwiseAlignment;
+}
+
+static int alignmentRange_cmpByDescendingScore(const void *a, const void *b) {
+    //Ties are broken by position in the file, so the sort is stable.
+    const AlignmentRange *alignment1 = a, *alignment2 = b;
+    if (alignment1->score != alignment2->score) {
+        return alignment1->score > alignment2->score ? -1 : 1;
+    }
+    return alignment1->firstPinch < alignment2->firstPinch ? -1 : (alignment1->firstPinch > alignment2->firstPinch ? 1 : 0);
+}
+
+static void pinchArray_sortByDescendingScore(PinchArray *pinchArray, AlignmentRange *alignments, int64_t alignmentNumber) {
+    qsort(alignments, alignmentNumber, sizeof(AlignmentRange), alignmentRange_cmpByDescendingScore);
+    stPinch *pinches = st_malloc(sizeof(stPinch) * (pinchArray->length > 0 ? pinchArray->length : 1));
+    int64_t j = 0;
+    for (int64_t i = 0; i < alignmentNumber; i++) {
+        memcpy(pinches + j, pinchArray->pinches + alignments[i].firstPinch, sizeof(stPinch) * alignments[i].pinchNumber);
+        j += alignments[i].pinchNumber;
+    }
+    assert(j == pinchArray->length);
+    free(pinchArray->pinches);
+    pinchArray->pinches = pinches;
+    pinchArray->maxLength = pinchArray->length;
+}
+
+static PinchArray *pinchArray_constructFromFile(const char *alignmentFile, bool sortByScore) {
+    PinchArray *pinchArray = st_calloc(1, sizeof(PinchArray));
+    PinchArrayReader reader;
+    memset(&reader, 0, sizeof(PinchArrayReader));
+    reader.pinchArray = pinchArray;
+    reader.fileHandle = fopen(alignmentFile, "r");
+    if (reader.fileHandle == NULL) {
+        st_errnoAbort("Opening alignment file %s failed", alignmentFile);
+    }
+    PairwiseAlignmentToPinch *pA = pairwiseAlignmentToPinch_construct(&reader,
+            (struct PairwiseAlignment *(*)(void *)) pinchArrayReader_getNext, 1);
+    stPinch *pinch;
+    while ((pinch = pairwiseAlignmentToPinch_getNext(pA)) != NULL) {
+        if (pinchArray->length == pinchArray->maxLength) {
+            pinchArray->maxLength = pinchArray->maxLength * 2 + 16;
+            pinchArray->pinches = st_realloc(pinchArray->pinches, sizeof(stPinch) * pinchArray->maxLength);
+        }
+        pinchArray->pinches[pinchArray->length++] = *pinch;
+    }
+    free(pA);
+    fclose(reader.fileHandle);
+    for (int64_t i = 0; i < reader.length; i++) {
+        reader.alignments[i].pinchNumber = (i + 1 < reader.length ? reader.alignments[i + 1].firstPinch : pinchArray->length)
+                - reader.alignments[i].firstPinch;
+    }
+    if (sortByScore) {
+        pinchArray_sortByDescendingScore(pinchArray, reader.alignments, reader.length);
+    }
+    free(reader.alignments);
+    return pinchArray;
+}
+
+static stPinch *pinchArray_getNext(PinchArray *pinchArray) {
+    if (pinchArray->index >= pinchArray->length) {
+        return NULL;
+    }
+    pinchArray->pinch = pinchArray->pinches[pinchArray->index++];
+    return &pinchArray->pinch;
+}
+
+static PinchArray *pinchArray_reset(PinchArray *pinchArray) {
+    pinchArray->index = 0;
+    return pinchArray;
+}
+
+static void pinchArray_destruct(PinchArray *pinchArray) {
+    free(pinchArray->pinches);
+    free(pinchArray);
+}
+
+stPinchIterator *stPinchIterator_constructFromFileInMemory(const char *alignmentFile, bool sortByScore) {
+    stPinchIterator *pinchIterator = st_calloc(1, sizeof(stPinchIterator));
+    pinchIterator->alignmentArg = pinchArray_constructFromFile(alignmentFile, sortByScore);
+    pinchIterator->getNextAlignment = (stPinch *(*)(void *)) pinchArray_getNext;
+    pinchIterator->destructAlignmentArg = (void(*)(void *)) pinchArray_destruct;
+    pinchIterator->startAlignmentStack = (void *(*)(void *)) pinchArray_reset;
+    return pinchIterator;
+}
+
 stSortedSetIterator *startAlignmentStackForAlignedPairs(stSortedSetIterator *it) {
     while (stSortedSet_getPrevious(it) != NULL) {
         ;
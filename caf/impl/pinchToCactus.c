@@ -24,16 +24,15 @@ static void attachPinchBlockEndToAnotherComponent(stPinchBlock *pinchBlock, bool
     stHash_insert(pinchEndsToAdjacencyComponents, pinchEnd, anotherComponent);
 }
 
-static stList *stCaf_constructDeadEndComponent(Flower *flower, stPinchThreadSet *threadSet, stHash *pinchEndsToAdjacencyComponents) {
+static stList *stCaf_constructDeadEndComponent(Flower *flower, stList *threads, stHash *pinchEndsToAdjacencyComponents) {
     /*
      * Locates the ends of all the attached ends and merges together their 'dead end' components to create a single
      * 'dead end' component, as described in the JCB cactus paper.
      */
     //For each block end at the end of a thread, attach to dead end component if associated end is attached
     stList *deadEndAdjacencyComponent = stList_construct3(0, (void(*)(void *)) stPinchEnd_destruct);
-    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet);
-    stPinchThread *pinchThread;
-    while ((pinchThread = stPinchThreadSetIt_getNext(&threadIt))) {
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stPinchThread *pinchThread = stList_get(threads, i);
         Cap *cap = flower_getCap(flower, stPinchThread_getName(pinchThread));
         assert(cap != NULL);
         End *end1 = cap_getEnd(cap), *end2 = cap_getEnd(cap_getAdjacency(cap));
@@ -196,17 +195,13 @@ static void attachThreadComponentToDeadEndComponent(stList *threadComponent, stL
     stHash_destruct(basesAligned);
 }
 
-static void stCaf_attachUnattachedThreadComponents(Flower *flower, stPinchThreadSet *threadSet, stList *deadEndComponent,
+static void stCaf_attachUnattachedThreadComponents(Flower *flower, stSortedSet *threadComponents, stList *deadEndComponent,
         stHash *pinchEndsToAdjacencyComponents, bool markEndsAttached, int64_t minLengthForChromosome,
         double proportionOfUnalignedBasesForNewChromosome) {
     /*
      * Locates threads components which have no dead ends part of the dead end component, and then
      * connects them, picking the longest thread to attach them.
      */
-    if (flower_getName(flower) != 0) {
-        return; //We don't need to attach ends if flower is not at top level, as everything is anchored to attached components in lower level flowers.
-    }
-    stSortedSet *threadComponents = stPinchThreadSet_getThreadComponents(threadSet);
     assert(stSortedSet_size(threadComponents) > 0);
     stSortedSetIterator *threadIt = stSortedSet_getIterator(threadComponents);
     stList *threadComponent;
@@ -215,7 +210,6 @@ static void stCaf_attachUnattachedThreadComponents(Flower *flower, stPinchThread
                 minLengthForChromosome, proportionOfUnalignedBasesForNewChromosome, flower);
     }
     stSortedSet_destructIterator(threadIt);
-    stSortedSet_destruct(threadComponents);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -352,6 +346,33 @@ static stCactusGraph *stCaf_constructCactusGraph(stList *deadEndComponent, stHas
 // Function that draws together above functions to generate a cactus graph from a pinch graph.
 ///////////////////////////////////////////////////////////////////////////
 
+static stCactusGraph *stCaf_getCactusGraph(Flower *flower, stList *threads, stHash *pinchEndsToAdjacencyComponents,
+        stSortedSet *threadComponents, stCactusNode **startCactusNode, stList **deadEndComponent, bool attachEndsInFlower,
+        int64_t minLengthForChromosome, double proportionOfUnalignedBasesForNewChromosome,
+        bool breakChainsAtReverseTandems, int64_t maximumMedianSpacingBetweenLinkedEnds) {
+    //Merge together dead end component
+    *deadEndComponent = stCaf_constructDeadEndComponent(flower, threads, pinchEndsToAdjacencyComponents);
+
+    //Join unattached components of graph by dead ends to dead end component, and make other ends 'attached' if necessary.
+    //We don't need to attach ends if flower is not at top level, as everything is anchored to attached components in lower level flowers.
+    if (threadComponents != NULL) {
+        stCaf_attachUnattachedThreadComponents(flower, threadComponents, *deadEndComponent, pinchEndsToAdjacencyComponents,
+                attachEndsInFlower, minLengthForChromosome, proportionOfUnalignedBasesForNewChromosome);
+    }
+
+    //Create cactus
+    stCactusGraph *cactusGraph = stCaf_constructCactusGraph(*deadEndComponent, pinchEndsToAdjacencyComponents, startCactusNode,
+            breakChainsAtReverseTandems, maximumMedianSpacingBetweenLinkedEnds);
+
+    //Cleanup (the memory is owned by the cactus graph, so this does not break anything)
+    stHash_destruct(pinchEndsToAdjacencyComponents);
+    if (threadComponents != NULL) {
+        stSortedSet_destruct(threadComponents);
+    }
+
+    return cactusGraph;
+}
+
 stCactusGraph *stCaf_getCactusGraphForThreadSet(Flower *flower, stPinchThreadSet *threadSet, stCactusNode **startCactusNode,
         stList **deadEndComponent, bool attachEndsInFlower, int64_t minLengthForChromosome,
         double proportionOfUnalignedBasesForNewChromosome,
@@ -362,19 +383,33 @@ stCactusGraph *stCaf_getCactusGraphForThreadSet(Flower *flower, stPinchThreadSet
     stList_setDestructor(adjacencyComponents, NULL);
     stList_destruct(adjacencyComponents);
 
-    //Merge together dead end component
-    *deadEndComponent = stCaf_constructDeadEndComponent(flower, threadSet, pinchEndsToAdjacencyComponents);
+    stList *threads = stList_construct();
+    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet);
+    stPinchThread *pinchThread;
+    while ((pinchThread = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
+        stList_append(threads, pinchThread);
+    }
+    stSortedSet *threadComponents = flower_getName(flower) == 0 ? stPinchThreadSet_getThreadComponents(threadSet) : NULL;
 
-    //Join unattached components of graph by dead ends to dead end component, and make other ends 'attached' if necessary
-    stCaf_attachUnattachedThreadComponents(flower, threadSet, *deadEndComponent, pinchEndsToAdjacencyComponents, attachEndsInFlower,
-            minLengthForChromosome, proportionOfUnalignedBasesForNewChromosome);
+    stCactusGraph *cactusGraph = stCaf_getCactusGraph(flower, threads, pinchEndsToAdjacencyComponents, threadComponents,
+            startCactusNode, deadEndComponent, attachEndsInFlower, minLengthForChromosome,
+            proportionOfUnalignedBasesForNewChromosome, breakChainsAtReverseTandems, maximumMedianSpacingBetweenLinkedEnds);
+    stList_destruct(threads);
+    return cactusGraph;
+}
 
-    //Create cactus
-    stCactusGraph *cactusGraph = stCaf_constructCactusGraph(*deadEndComponent, pinchEndsToAdjacencyComponents, startCactusNode,
-            breakChainsAtReverseTandems, maximumMedianSpacingBetweenLinkedEnds);
+stCactusGraph *stCaf_getCactusGraphForThreads(Flower *flower, stList *threads, stCactusNode **startCactusNode,
+        stList **deadEndComponent, bool attachEndsInFlower, int64_t minLengthForChromosome,
+        double proportionOfUnalignedBasesForNewChromosome,
+        bool breakChainsAtReverseTandems, int64_t maximumMedianSpacingBetweenLinkedEnds) {
+    stHash *pinchEndsToAdjacencyComponents;
+    stList *adjacencyComponents = stPinchThreadSet_getAdjacencyComponentsForThreads(threads, &pinchEndsToAdjacencyComponents);
+    stList_setDestructor(adjacencyComponents, NULL);
+    stList_destruct(adjacencyComponents);
 
-    //Cleanup (the memory is owned by the cactus graph, so this does not break anything)
-    stHash_destruct(pinchEndsToAdjacencyComponents);
+    stSortedSet *threadComponents = flower_getName(flower) == 0 ? stPinchThreadSet_getThreadComponentsForThreads(threads) : NULL;
 
-    return cactusGraph;
+    return stCaf_getCactusGraph(flower, threads, pinchEndsToAdjacencyComponents, threadComponents,
+            startCactusNode, deadEndComponent, attachEndsInFlower, minLengthForChromosome,
+            proportionOfUnalignedBasesForNewChromosome, breakChainsAtReverseTandems, maximumMedianSpacingBetweenLinkedEnds);
 }
@@ -38,6 +38,15 @@ stPinchThreadSet *stCaf_setup(Flower *flower);
  */
 void stCaf_anneal(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, bool (*filterFn)(stPinchSegment *, stPinchSegment *));
 
+/*
+ * As stCaf_anneal, but the pinches are partitioned into sets whose threads are connected, by the pinches or by
+ * existing blocks, and the sets are annealed concurrently using numThreads threads. Gives the same graph as
+ * stCaf_anneal. The filterFn, if not NULL, is called concurrently, so must be thread safe and only depend on
+ * the segments it is given.
+ */
+void stCaf_annealInParallel(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads);
+
 /*
  * Add the set of alignments, represented as pinches, to the graph, allowing alignments only between segments in the same component.
  */
@@ -48,6 +57,11 @@ void stCaf_annealBetweenAdjacencyComponents(stPinchThreadSet *threadSet, stPinch
  */
 void stCaf_joinTrivialBoundaries(stPinchThreadSet *threadSet);
 
+/*
+ * As stCaf_joinTrivialBoundaries, but only for the given threads, which must be a union of thread components.
+ */
+void stCaf_joinTrivialBoundariesOfThreads(stList *threads);
+
 ///////////////////////////////////////////////////////////////////////////
 // Melting fuctions -- removing alignments from the pinch graph
 ///////////////////////////////////////////////////////////////////////////
@@ -58,6 +72,13 @@ void stCaf_joinTrivialBoundaries(stPinchThreadSet *threadSet);
 void stCaf_melt(Flower *flower, stPinchThreadSet *threadSet, bool blockFilterfn(stPinchBlock *), int64_t blockEndTrim,
         int64_t minimumChainLength, bool breakChainsAtReverseTandems, int64_t maximumMedianSpacingBetweenLinkedEnds);
 
+/*
+ * Does a series of melting rounds, equivalent to calling stCaf_melt(flower, threadSet, NULL, 0, minimumChainLengths[i], 0, INT64_MAX)
+ * for each of the roundNumber chain lengths in turn. The cactus graph is built once, then after each round only the cactus
+ * graphs of the thread components that lost blocks are rebuilt.
+ */
+void stCaf_meltRounds(Flower *flower, stPinchThreadSet *threadSet, int64_t *minimumChainLengths, int64_t roundNumber);
+
 /*
  * Removes any recoverable chains (those expected to be picked up by
  * bar phase) from the graph. Only chains that are recoverable *and*
@@ -91,6 +112,16 @@ stCactusGraph *stCaf_getCactusGraphForThreadSet(Flower *flower, stPinchThreadSet
         stList **deadEndComponent, bool attachEndsInFlower, int64_t minLengthForChromosome, double proportionOfUnalignedBasesForNewChromosome,
         bool breakChainsAtReverseTandems, int64_t maximumMedianSpacingBetweenLinkedEnds);
 
+/*
+ * As stCaf_getCactusGraphForThreadSet, but the cactus graph only covers the given threads, which must be a union of
+ * thread components. As thread components only share the dead end component, the chains of the graph are exactly
+ * the chains of the whole thread set's graph that are made of the threads' blocks.
+ */
+stCactusGraph *stCaf_getCactusGraphForThreads(Flower *flower, stList *threads, stCactusNode **startCactusNode,
+        stList **deadEndComponent, bool attachEndsInFlower, int64_t minLengthForChromosome,
+        double proportionOfUnalignedBasesForNewChromosome,
+        bool breakChainsAtReverseTandems, int64_t maximumMedianSpacingBetweenLinkedEnds);
+
 ///////////////////////////////////////////////////////////////////////////
 // Finishing: Converting a pinch graph into the flower hierarchy
 ///////////////////////////////////////////////////////////////////////////
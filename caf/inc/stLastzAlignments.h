@@ -17,6 +17,24 @@ stList *stCaf_selfAlignFlower(Flower *flower, int64_t minimumSequenceLength, con
 
 void stCaf_sortCigarsByScoreInDescendingOrder(stList *cigars);
 
-void stCaf_sortCigarsFileByScoreInDescendingOrder(char *cigarsFile, char *sortedFile);
+/*
+ * Sorts a file of alignments, text cigars or binary records, with stPairwiseAlignment_sortFile, using at most
+ * threadNumber threads and around memoryBudget bytes, and spilling to tempDir (NULL for $TMPDIR or /tmp).
+ */
+void stCaf_sortCigarsFileByScoreInDescendingOrder(char *cigarsFile, char *sortedFile,
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir);
+
+/*
+ * As above, but sorts by the first contig, then the start coordinate on it. If unique is non-zero, repeats of an
+ * alignment are dropped, as with uniq.
+ */
+void stCaf_sortCigarsFileByFirstSequenceStartCoordinateInAscendingOrder(char *cigarsFile, char *sortedFile,
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir, bool unique);
+
+/*
+ * As above, but sorts by the second contig, then the start coordinate on it.
+ */
+void stCaf_sortCigarsFileBySecondSequenceStartCoordinateInAscendingOrder(char *cigarsFile, char *sortedFile,
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir, bool unique);
 
 #endif /* ST_LASTZALIGNMENT_H_ */
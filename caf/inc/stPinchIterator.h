@@ -37,6 +37,14 @@ void stPinchIterator_destruct(
 stPinchIterator *stPinchIterator_constructFromFile(
         const char *alignmentFile);
 
+/*
+ * Get a pairwise alignment iterator from a file, parsing the file once and holding its pinches in a flat
+ * array in memory, so that resetting the iterator does not reread the file. If sortByScore is true the
+ * alignments are ordered by descending score, ties keeping the order of the file.
+ */
+stPinchIterator *stPinchIterator_constructFromFileInMemory(
+        const char *alignmentFile, bool sortByScore);
+
 /*
  * Get a pairwise alignment iterator from a list of alignments.
  * Does not cleanup the list or modify the list.
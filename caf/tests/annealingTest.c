@@ -11,6 +11,9 @@
 
 void stCaf_anneal2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *), void *extraArg);
 
+void stCaf_annealInParallel2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *), void *extraArg,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads);
+
 void stCaf_annealBetweenAdjacencyComponents2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *),
         void *extraArg, bool (*filterFn)(stPinchSegment *, stPinchSegment *));
 
@@ -41,9 +44,106 @@ static void testAnnealingBetweenAdjacencyComponents(CuTest *testCase) {
     }
 }
 
+static stList *getRandomPinchesWithinGroups(stPinchThreadSet *threadSet, int64_t threadNumber, int64_t groupNumber,
+        int64_t pinchNumber) {
+    /*
+     * Pinches between threads whose names are equal modulo groupNumber, with the odd pinch between groups.
+     */
+    stList *pinches = stList_construct3(0, free);
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        int64_t name1 = st_randomInt(0, threadNumber);
+        int64_t name2 = st_random() < 0.02 ? st_randomInt(0, threadNumber) : name1 % groupNumber;
+        while (name2 + groupNumber < threadNumber && st_random() > 0.5) {
+            name2 += groupNumber;
+        }
+        stPinchThread *thread1 = stPinchThreadSet_getThread(threadSet, name1);
+        stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet, name2);
+        int64_t maxLength = stPinchThread_getLength(thread1) < stPinchThread_getLength(thread2) ?
+                stPinchThread_getLength(thread1) : stPinchThread_getLength(thread2);
+        int64_t length = st_randomInt(1, maxLength + 1);
+        stPinch *pinch = st_malloc(sizeof(stPinch));
+        stPinch_fillOut(pinch, name1, name2,
+                stPinchThread_getStart(thread1) + st_randomInt(0, stPinchThread_getLength(thread1) - length + 1),
+                stPinchThread_getStart(thread2) + st_randomInt(0, stPinchThread_getLength(thread2) - length + 1),
+                length, st_random() > 0.5);
+        stList_append(pinches, pinch);
+    }
+    return pinches;
+}
+
+static void checkGraphsAreEqual(CuTest *testCase, stPinchThreadSet *threadSet1, stPinchThreadSet *threadSet2, int64_t threadNumber) {
+    for (int64_t name = 0; name < threadNumber; name++) {
+        stPinchSegment *segment1 = stPinchThread_getFirst(stPinchThreadSet_getThread(threadSet1, name));
+        stPinchSegment *segment2 = stPinchThread_getFirst(stPinchThreadSet_getThread(threadSet2, name));
+        while (segment1 != NULL) {
+            CuAssertTrue(testCase, segment2 != NULL);
+            CuAssertIntEquals(testCase, stPinchSegment_getStart(segment1), stPinchSegment_getStart(segment2));
+            CuAssertIntEquals(testCase, stPinchSegment_getLength(segment1), stPinchSegment_getLength(segment2));
+            stPinchBlock *block1 = stPinchSegment_getBlock(segment1);
+            stPinchBlock *block2 = stPinchSegment_getBlock(segment2);
+            CuAssertTrue(testCase, (block1 == NULL) == (block2 == NULL));
+            if (block1 != NULL) {
+                CuAssertIntEquals(testCase, stPinchBlock_getDegree(block1), stPinchBlock_getDegree(block2));
+                CuAssertIntEquals(testCase, stPinchBlock_getNumSupportingHomologies(block1),
+                        stPinchBlock_getNumSupportingHomologies(block2));
+                CuAssertIntEquals(testCase, stPinchSegment_getBlockOrientation(segment1),
+                        stPinchSegment_getBlockOrientation(segment2));
+                CuAssertIntEquals(testCase, stPinchSegment_getName(stPinchBlock_getFirst(block1)),
+                        stPinchSegment_getName(stPinchBlock_getFirst(block2)));
+                CuAssertIntEquals(testCase, stPinchSegment_getStart(stPinchBlock_getFirst(block1)),
+                        stPinchSegment_getStart(stPinchBlock_getFirst(block2)));
+            }
+            segment1 = stPinchSegment_get3Prime(segment1);
+            segment2 = stPinchSegment_get3Prime(segment2);
+        }
+        CuAssertTrue(testCase, segment2 == NULL);
+    }
+}
+
+static void testAnnealingInParallel(CuTest *testCase) {
+    /*
+     * Checks parallel annealing gives exactly the graph serial annealing does, starting from a graph with blocks.
+     */
+    for (int64_t test = 0; test < 100; test++) {
+        st_logInfo("Starting parallel annealing random test %" PRIi64 "\n", test);
+        int64_t threadNumber = st_randomInt(1, 50);
+        int64_t groupNumber = st_randomInt(1, 10);
+        stPinchThreadSet *threadSet1 = stPinchThreadSet_construct();
+        stPinchThreadSet *threadSet2 = stPinchThreadSet_construct();
+        for (int64_t name = 0; name < threadNumber; name++) {
+            int64_t start = st_randomInt(0, 100), length = st_randomInt(1, 200);
+            stPinchThreadSet_addThread(threadSet1, name, start, length);
+            stPinchThreadSet_addThread(threadSet2, name, start, length);
+        }
+        stList *initialPinches = getRandomPinchesWithinGroups(threadSet1, threadNumber, groupNumber, st_randomInt(0, 20));
+        stListIterator *it = stList_getIterator(initialPinches);
+        stCaf_anneal2(threadSet1, (stPinch *(*)(void *)) stList_getNext, it);
+        stList_destructIterator(it);
+        it = stList_getIterator(initialPinches);
+        stCaf_anneal2(threadSet2, (stPinch *(*)(void *)) stList_getNext, it);
+        stList_destructIterator(it);
+
+        stList *pinches = getRandomPinchesWithinGroups(threadSet1, threadNumber, groupNumber, st_randomInt(0, 200));
+        it = stList_getIterator(pinches);
+        stCaf_anneal2(threadSet1, (stPinch *(*)(void *)) stList_getNext, it);
+        stList_destructIterator(it);
+        it = stList_getIterator(pinches);
+        stCaf_annealInParallel2(threadSet2, (stPinch *(*)(void *)) stList_getNext, it, NULL, st_randomInt(1, 5));
+        stList_destructIterator(it);
+
+        checkGraphsAreEqual(testCase, threadSet1, threadSet2, threadNumber);
+
+        stList_destruct(initialPinches);
+        stList_destruct(pinches);
+        stPinchThreadSet_destruct(threadSet1);
+        stPinchThreadSet_destruct(threadSet2);
+    }
+}
+
 CuSuite* annealingTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testAnnealing);
     SUITE_ADD_TEST(suite, testAnnealingBetweenAdjacencyComponents);
+    SUITE_ADD_TEST(suite, testAnnealingInParallel);
     return suite;
 }
@@ -0,0 +1,133 @@
+#include "CuTest.h"
+#include "sonLib.h"
+#include "stCaf.h"
+#include "stPinchGraphs.h"
+
+static void pinchRandomly(stList *threads1, stList *threads2, int64_t componentNumber) {
+    /*
+     * Makes the same random pinches in two copies of the same threads. Pinches are only made between threads
+     * in the same group, so there are several thread components, and avoid the ends of the threads.
+     */
+    int64_t pinchNumber = st_randomInt(0, 200);
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        int64_t group = st_randomInt(0, componentNumber);
+        int64_t j = group + componentNumber * st_randomInt(0, stList_length(threads1) / componentNumber);
+        int64_t k = group + componentNumber * st_randomInt(0, stList_length(threads1) / componentNumber);
+        stPinchThread *thread1 = stList_get(threads1, j), *thread2 = stList_get(threads1, k);
+        int64_t length = st_randomInt(1, 20);
+        if (stPinchThread_getLength(thread1) < length + 4 || stPinchThread_getLength(thread2) < length + 4) {
+            continue;
+        }
+        int64_t start1 = stPinchThread_getStart(thread1) + st_randomInt(2, stPinchThread_getLength(thread1) - length - 1);
+        int64_t start2 = stPinchThread_getStart(thread2) + st_randomInt(2, stPinchThread_getLength(thread2) - length - 1);
+        bool strand = st_random() > 0.5;
+        stPinchThread_pinch(thread1, thread2, start1, start2, length, strand);
+        stPinchThread_pinch(stList_get(threads2, j), stList_get(threads2, k), start1, start2, length, strand);
+    }
+}
+
+static char *getAlignment(stList *threads) {
+    /*
+     * Gets a string describing the aligned bases of the threads, that does not depend on how the columns are split into blocks.
+     * Each base is labelled with the first base, by thread and coordinate, of its column.
+     */
+    stList *strings = stList_construct3(0, free);
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stPinchThread *thread = stList_get(threads, i);
+        stPinchSegment *segment = stPinchThread_getFirst(thread);
+        while (segment != NULL) {
+            stPinchBlock *block = stPinchSegment_getBlock(segment);
+            for (int64_t j = 0; j < stPinchSegment_getLength(segment); j++) {
+                int64_t column = stPinchSegment_getBlockOrientation(segment) ? j : stPinchSegment_getLength(segment) - 1 - j;
+                int64_t name = stPinchSegment_getName(segment), coordinate = stPinchSegment_getStart(segment) + j;
+                if (block != NULL) {
+                    stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(block);
+                    stPinchSegment *segment2;
+                    while ((segment2 = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+                        int64_t coordinate2 = stPinchSegment_getStart(segment2)
+                                + (stPinchSegment_getBlockOrientation(segment2) ? column : stPinchSegment_getLength(segment2) - 1 - column);
+                        if (stPinchSegment_getName(segment2) < name
+                                || (stPinchSegment_getName(segment2) == name && coordinate2 < coordinate)) {
+                            name = stPinchSegment_getName(segment2);
+                            coordinate = coordinate2;
+                        }
+                    }
+                }
+                stList_append(strings, stString_print("%" PRIi64 ":%" PRIi64, name, coordinate));
+            }
+            segment = stPinchSegment_get3Prime(segment);
+        }
+    }
+    char *string = stString_join2(" ", strings);
+    stList_destruct(strings);
+    return string;
+}
+
+static int64_t getAlignedBases(stPinchThreadSet *threadSet) {
+    int64_t alignedBases = 0;
+    stPinchThreadSetBlockIt blockIt = stPinchThreadSet_getBlockIt(threadSet);
+    stPinchBlock *block;
+    while ((block = stPinchThreadSetBlockIt_getNext(&blockIt)) != NULL) {
+        alignedBases += stPinchBlock_getLength(block) * stPinchBlock_getDegree(block);
+    }
+    return alignedBases;
+}
+
+static stList *getThreads(stPinchThreadSet *threadSet, stList *threadNames) {
+    stList *threads = stList_construct();
+    for (int64_t i = 0; i < stList_length(threadNames); i++) {
+        stList_append(threads, stPinchThreadSet_getThread(threadSet, stIntTuple_get(stList_get(threadNames, i), 0)));
+    }
+    return threads;
+}
+
+// The incremental melting rounds destroy the same alignments as a series of calls to stCaf_melt.
+static void testMeltRounds_random(CuTest *testCase) {
+    int64_t minimumChainLengths[] = { 2, 4, 8, 16, 32 };
+    int64_t alignedBasesLost = 0;
+    for (int64_t test = 0; test < 50; test++) {
+        CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+        eventTree_construct2(cactusDisk);
+        Flower *flower = flower_construct2(0, cactusDisk);
+        group_construct2(flower);
+
+        //Threads of distinct lengths, so that the threads chosen to attach components do not depend on the order of ties
+        int64_t componentNumber = st_randomInt(1, 5);
+        int64_t threadNumber = componentNumber * st_randomInt(1, 5);
+        stList *threadNames = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+        for (int64_t i = 0; i < threadNumber; i++) {
+            stList_append(threadNames, stIntTuple_construct1(testCommon_addThreadToFlower(flower, "thread", 100 + 13 * i)));
+        }
+        stPinchThreadSet *threadSet1 = stCaf_setup(flower);
+        stPinchThreadSet *threadSet2 = stCaf_constructEmptyPinchGraph(flower);
+        stList *threads1 = getThreads(threadSet1, threadNames), *threads2 = getThreads(threadSet2, threadNames);
+        pinchRandomly(threads1, threads2, componentNumber);
+        int64_t alignedBases = getAlignedBases(threadSet1);
+
+        stCaf_meltRounds(flower, threadSet1, minimumChainLengths, 5);
+        for (int64_t i = 0; i < 5; i++) {
+            stCaf_melt(flower, threadSet2, NULL, 0, minimumChainLengths[i], 0, INT64_MAX);
+        }
+
+        char *alignment1 = getAlignment(threads1), *alignment2 = getAlignment(threads2);
+        CuAssertTrue(testCase, strcmp(alignment1, alignment2) == 0); //Not CuAssertStrEquals, the strings are too long for its message
+        CuAssertIntEquals(testCase, getAlignedBases(threadSet2), getAlignedBases(threadSet1));
+        alignedBasesLost += alignedBases - getAlignedBases(threadSet1);
+
+        free(alignment1);
+        free(alignment2);
+        stList_destruct(threads1);
+        stList_destruct(threads2);
+        stList_destruct(threadNames);
+        stPinchThreadSet_destruct(threadSet1);
+        stPinchThreadSet_destruct(threadSet2);
+        testCommon_deleteTemporaryCactusDisk(cactusDisk);
+    }
+    CuAssertTrue(testCase, alignedBasesLost > 0); //Check the tests do some melting
+}
+
+CuSuite *meltingTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testMeltRounds_random);
+    return suite;
+}
@@ -120,9 +120,51 @@ static void testPinchIteratorFromList(CuTest *testCase) {
     }
 }
 
+static void testPinchIteratorFromFileInMemory(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        stList *pairwiseAlignments = getRandomPairwiseAlignments();
+        bool sortByScore = test % 2;
+        for (int64_t i = 0; i < stList_length(pairwiseAlignments); i++) {
+            ((struct PairwiseAlignment *)stList_get(pairwiseAlignments, i))->score = st_randomInt(0, 5); //Repeated scores
+        }
+        st_logInfo("Doing a random in memory pinch iterator test %" PRIi64 " with %" PRIi64 " alignments\n", test, stList_length(pairwiseAlignments));
+        //Put alignments in a file
+        char *tempFile = "tempFileForPinchIteratorTest.cig";
+        FILE *fileHandle = fopen(tempFile, "w");
+        for (int64_t i = 0; i < stList_length(pairwiseAlignments); i++) {
+            cigarWrite(fileHandle, stList_get(pairwiseAlignments, i), 0);
+        }
+        fclose(fileHandle);
+        //Get the expected order, a stable sort by descending score if sorting
+        stList *expectedAlignments = stList_construct();
+        stList *remainingAlignments = stList_copy(pairwiseAlignments, NULL);
+        while (stList_length(remainingAlignments) > 0) {
+            int64_t k = 0;
+            for (int64_t i = 1; sortByScore && i < stList_length(remainingAlignments); i++) {
+                if (((struct PairwiseAlignment *)stList_get(remainingAlignments, i))->score >
+                        ((struct PairwiseAlignment *)stList_get(remainingAlignments, k))->score) {
+                    k = i;
+                }
+            }
+            stList_append(expectedAlignments, stList_remove(remainingAlignments, k));
+        }
+        //Get an iterator, the file is no longer needed once it is built
+        stPinchIterator *pinchIterator = stPinchIterator_constructFromFileInMemory(tempFile, sortByScore);
+        stFile_rmrf(tempFile);
+        //Now test it
+        testIterator(testCase, pinchIterator, expectedAlignments);
+        //Cleanup
+        stPinchIterator_destruct(pinchIterator);
+        stList_destruct(expectedAlignments);
+        stList_destruct(remainingAlignments);
+        stList_destruct(pairwiseAlignments);
+    }
+}
+
 CuSuite* pinchIteratorTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testPinchIteratorFromFile);
     SUITE_ADD_TEST(suite, testPinchIteratorFromList);
+    SUITE_ADD_TEST(suite, testPinchIteratorFromFileInMemory);
     return suite;
 }
@@ -28,6 +28,7 @@ void usage() {
     fprintf(
             stderr,
             "-l --showOnlySubstitutionsWithRespectToReference : Put stars in place of characters that are identical to the reference.\n");
+    fprintf(stderr, "-b --binary : Write the output file in the binary c2h format.\n");
     fprintf(stderr, "-h --help : Print this help screen\n");
 }
 
@@ -45,6 +46,7 @@ int main(int argc, char *argv[]) {
     char *referenceEventString =
             (char *) cactusMisc_getDefaultReferenceEventHeader();
     char *outputFile = NULL;
+    bool binary = 0;
 
     ///////////////////////////////////////////////////////////////////////////
     // (0) Parse the inputs handed by genomeCactus.py / setup stuff.
@@ -59,11 +61,12 @@ int main(int argc, char *argv[]) {
                         required_argument, 0, 'k' }, {
                         "showOnlySubstitutionsWithRespectToReference",
                         no_argument, 0, 'l' },
+                { "binary", no_argument, 0, 'b' },
                 { 0, 0, 0, 0 } };
 
         int option_index = 0;
 
-        int key = getopt_long(argc, argv, "a:c:d:e:g:hk:l", long_options,
+        int key = getopt_long(argc, argv, "a:bc:d:e:g:hk:l", long_options,
                 &option_index);
 
         if (key == -1) {
@@ -74,6 +77,9 @@ int main(int argc, char *argv[]) {
             case 'a':
                 logLevelString = stString_copy(optarg);
                 break;
+            case 'b':
+                binary = 1;
+                break;
             case 'c':
                 cactusDiskDatabaseString = stString_copy(optarg);
                 break;
@@ -150,7 +156,7 @@ int main(int argc, char *argv[]) {
         if(outputFile != NULL) {
             fileHandle = fopen(outputFile, "w");
         }
-        makeHalFormat(flower, sequenceDatabase, referenceEventName, fileHandle);
+        makeHalFormat(flower, sequenceDatabase, referenceEventName, fileHandle, binary);
         if(fileHandle != NULL) {
             fclose(fileHandle);
         }
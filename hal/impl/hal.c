@@ -75,8 +75,38 @@ static Name globalReferenceEventName;
  * alignmentOrientation :
  *      0
  *      1
+ *
+ * The binary .c2h format has the same sequences and segments, but gives the dimensions of every sequence in a header,
+ * so that a reader can size the genomes without reading the segments. All integers are 64 bit, in the byte order of
+ * the machine that wrote the file.
+ *
+ * binaryFile :
+ *      "C2HB" version sequenceNumber sequenceHeaders sequenceSegments
+ *
+ * version :
+ *      1
+ *
+ * #One for each sequence, in the order of the text format
+ * sequenceHeader :
+ *      eventHeaderLength eventHeader sequenceHeaderLength sequenceHeader isBottom segmentNumber sequenceLength
+ *
+ * #The segments of each sequence in turn, segmentNumber of them for each, in the order of the text format
+ * sequenceSegments :
+ *      binarySegment
+ *      binarySegment sequenceSegments
+ *
+ * #Each segment is four integers
+ * binarySegment :
+ *      segmentName start length 0
+ *      start length parentSegment alignmentOrientation
+ *      #If it was an insertion, where NULL_NAME is the largest 64 bit integer
+ *      start length NULL_NAME 0
  */
 
+static const char binaryMagic[4] = { 'C', '2', 'H', 'B' };
+static const int64_t binaryVersion = 1;
+static const int64_t binarySegmentSize = 4;
+
 static void writeSequenceHeader(FILE *fileHandle, Sequence *sequence) {
     //s eventName sequenceName isBottom
     Event *event = sequence_getEvent(sequence);
@@ -120,6 +150,57 @@ static char *writeSegment(Segment *segment) {
     return stString_print("a\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\n", segment_getName(segment), segment_getStart(segment) - sequence_getStart(sequence), segment_getLength(segment));
 }
 
+static void *writeBinaryTerminalAdjacency(Cap *cap, int64_t *recordSize) {
+    //The binary equivalent of writeTerminalAdjacency, an empty record if the adjacency has no bases
+    Cap *adjacentCap = cap_getAdjacency(cap);
+    assert(adjacentCap != NULL);
+    int64_t adjacencyLength = cap_getCoordinate(adjacentCap) - cap_getCoordinate(cap) - 1;
+    assert(adjacencyLength >= 0);
+    int64_t *record = st_malloc(sizeof(int64_t) * binarySegmentSize);
+    *recordSize = 0;
+    if (adjacencyLength > 0) {
+        Sequence *sequence = cap_getSequence(cap);
+        assert(sequence != NULL);
+        assert(cap_getEvent(cap) != NULL);
+        if (event_getName(cap_getEvent(cap)) == globalReferenceEventName) {
+            record[0] = cap_getName(cap);
+            record[1] = cap_getCoordinate(cap) + 1 - sequence_getStart(sequence);
+            record[2] = adjacencyLength;
+            record[3] = 0;
+        } else {
+            record[0] = cap_getCoordinate(cap) + 1 - sequence_getStart(sequence);
+            record[1] = adjacencyLength;
+            record[2] = NULL_NAME;
+            record[3] = 0;
+        }
+        *recordSize = sizeof(int64_t) * binarySegmentSize;
+    }
+    return record;
+}
+
+static void *writeBinarySegment(Segment *segment, int64_t *recordSize) {
+    //The binary equivalent of writeSegment
+    Block *block = segment_getBlock(segment);
+    Segment *referenceSegment = block_getSegmentForEvent(block, globalReferenceEventName);
+    assert(referenceSegment != NULL);
+    Sequence *sequence = segment_getSequence(segment);
+    assert(sequence != NULL);
+    int64_t *record = st_malloc(sizeof(int64_t) * binarySegmentSize);
+    if (referenceSegment != segment) { //Is a top segment
+        record[0] = segment_getStart(segment) - sequence_getStart(sequence);
+        record[1] = segment_getLength(segment);
+        record[2] = segment_getName(referenceSegment);
+        record[3] = segment_getStrand(referenceSegment);
+    } else { //Is a bottom segment
+        record[0] = segment_getName(segment);
+        record[1] = segment_getStart(segment) - sequence_getStart(sequence);
+        record[2] = segment_getLength(segment);
+        record[3] = 0;
+    }
+    *recordSize = sizeof(int64_t) * binarySegmentSize;
+    return record;
+}
+
 static int compareCaps(Cap *cap, Cap *cap2) {
     Event *event = cap_getEvent(cap);
     Event *event2 = cap_getEvent(cap2);
@@ -161,10 +242,79 @@ static stList *getCaps(Flower *flower) {
     return caps;
 }
 
-void makeHalFormat(Flower *flower, stKVDatabase *database, Name referenceEventName, FILE *fileHandle) {
+static void writeBinary(FILE *fileHandle, const void *data, size_t size) {
+    if (size > 0 && fwrite(data, size, 1, fileHandle) != 1) {
+        st_errAbort("Error writing the binary c2h file");
+    }
+}
+
+static void writeBinaryInt(FILE *fileHandle, int64_t i) {
+    writeBinary(fileHandle, &i, sizeof(int64_t));
+}
+
+static void writeBinaryString(FILE *fileHandle, const char *string) {
+    writeBinaryInt(fileHandle, strlen(string));
+    writeBinary(fileHandle, string, strlen(string));
+}
+
+static void writeBinaryHalFormat(FILE *fileHandle, stList *caps, stList *threads, int64_t *threadSizes) {
+    /*
+     * Writes the threads, whose records are already binary segments, in the binary format, preceded by the header,
+     * which needs the dimensions of all the sequences.
+     */
+    int64_t sequenceNumber = 0;
+    for (int64_t i = 0; i < stList_length(caps); i++) {
+        sequenceNumber += !metaSequence_isTrivialSequence(sequence_getMetaSequence(cap_getSequence(stList_get(caps, i))));
+    }
+    writeBinary(fileHandle, binaryMagic, sizeof(binaryMagic));
+    writeBinaryInt(fileHandle, binaryVersion);
+    writeBinaryInt(fileHandle, sequenceNumber);
+    for (int64_t i = 0; i < stList_length(caps); i++) {
+        Sequence *sequence = cap_getSequence(stList_get(caps, i));
+        if (!metaSequence_isTrivialSequence(sequence_getMetaSequence(sequence))) {
+            Event *event = sequence_getEvent(sequence);
+            assert(event != NULL);
+            assert(event_getHeader(event) != NULL);
+            assert(sequence_getHeader(sequence) != NULL);
+            bool isBottom = event_getName(event) == globalReferenceEventName;
+            //The length of the sequence is the sum of the lengths of its segments
+            assert(threadSizes[i] % (sizeof(int64_t) * binarySegmentSize) == 0);
+            int64_t segmentNumber = threadSizes[i] / (sizeof(int64_t) * binarySegmentSize);
+            int64_t *segments = stList_get(threads, i);
+            int64_t length = 0;
+            for (int64_t j = 0; j < segmentNumber; j++) {
+                length += segments[j * binarySegmentSize + (isBottom ? 2 : 1)];
+            }
+            writeBinaryString(fileHandle, event_getHeader(event));
+            writeBinaryString(fileHandle, sequence_getHeader(sequence));
+            writeBinaryInt(fileHandle, isBottom);
+            writeBinaryInt(fileHandle, segmentNumber);
+            writeBinaryInt(fileHandle, length);
+        }
+    }
+    for (int64_t i = 0; i < stList_length(caps); i++) {
+        if (!metaSequence_isTrivialSequence(sequence_getMetaSequence(cap_getSequence(stList_get(caps, i))))) {
+            writeBinary(fileHandle, stList_get(threads, i), threadSizes[i]);
+        }
+    }
+}
+
+void makeHalFormat(Flower *flower, stKVDatabase *database, Name referenceEventName, FILE *fileHandle, bool binary) {
     globalReferenceEventName = referenceEventName;
     stList *caps = getCaps(flower);
-    if (fileHandle == NULL) {
+    if (binary) {
+        if (fileHandle == NULL) {
+            buildRecursiveThreads2(database, caps, writeBinarySegment, writeBinaryTerminalAdjacency);
+        } else {
+            int64_t *threadSizes;
+            stList *threads = buildRecursiveThreadsInList2(database, caps, writeBinarySegment,
+                    writeBinaryTerminalAdjacency, &threadSizes);
+            assert(stList_length(threads) == stList_length(caps));
+            writeBinaryHalFormat(fileHandle, caps, threads, threadSizes);
+            stList_destruct(threads);
+            free(threadSizes);
+        }
+    } else if (fileHandle == NULL) {
         buildRecursiveThreads(database, caps, writeSegment, writeTerminalAdjacency);
     } else {
         stList *threadStrings = buildRecursiveThreadsInList(database, caps, writeSegment, writeTerminalAdjacency);
@@ -177,6 +327,7 @@ void makeHalFormat(Flower *flower, stKVDatabase *database, Name referenceEventNa
                 fprintf(fileHandle, "%s\n", threadString);
             }
         }
+        stList_destruct(threadStrings);
     }
     stList_destruct(caps);
 }
@@ -11,8 +11,13 @@
 #include "sonLib.h"
 #include "cactus.h"
 
+/*
+ * Writes the c2h file for the flower to fileHandle, in the binary format if binary is true, or else in the
+ * text format (see hal.c). If fileHandle is NULL the threads are stored in the database, to be built on by the
+ * flower's parent, so binary must be the same for every flower of the hierarchy.
+ */
 void makeHalFormat(Flower *flower, stKVDatabase *database, Name referenceEventName,
-                   FILE *fileHandle);
+                   FILE *fileHandle, bool binary);
 
 void printFastaSequences(Flower *flower, FILE *fileHandle, Name referenceEventName);
 
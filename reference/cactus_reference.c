@@ -48,6 +48,10 @@ void usage() {
     fprintf(
     stderr, "-q --makeScaffolds : Scaffold across regions of adjacency uncertainty.\n");
 
+    fprintf(stderr, "--compressionCodec : Codec with which flowers are written, either 'lz4', 'lz4hc' or 'zlib', default lz4.\n");
+
+    fprintf(stderr, "--compressionThreads : Number of threads with which to compress the flowers written, default 1.\n");
+
     fprintf(stderr, "-h --help : Print this help screen\n");
 }
 
@@ -75,6 +79,8 @@ int main(int argc, char *argv[]) {
     int64_t numberOfNsForScaffoldGap = 10;
     int64_t minNumberOfSequencesToSupportAdjacency = 1;
     bool makeScaffolds = 0;
+    stCompressionCodec compressionCodec = ST_COMPRESSION_LZ4;
+    int64_t compressionThreads = 1;
 
     ///////////////////////////////////////////////////////////////////////////
     // (0) Parse the inputs handed by genomeCactus.py / setup stuff.
@@ -89,7 +95,8 @@ int main(int argc, char *argv[]) {
         required_argument, 0, 's' }, { "maxWalkForCalculatingZ", required_argument, 0, 'l' }, { "ignoreUnalignedGaps",
         no_argument, 0, 'm' }, { "wiggle", required_argument, 0, 'n' }, { "numberOfNs", required_argument, 0, 'o' }, {
                 "minNumberOfSequencesToSupportAdjacency", required_argument, 0, 'p' }, { "makeScaffolds", no_argument,
-                0, 'q' }, { "help", no_argument, 0, 'h' }, { 0, 0, 0, 0 } };
+                0, 'q' }, { "compressionCodec", required_argument, 0, '1' }, { "compressionThreads", required_argument,
+                0, '2' }, { "help", no_argument, 0, 'h' }, { 0, 0, 0, 0 } };
 
         int option_index = 0;
 
@@ -188,6 +195,18 @@ int main(int argc, char *argv[]) {
         case 'q':
             makeScaffolds = 1;
             break;
+        case '1':
+            compressionCodec = stCompression_parseCodec(optarg);
+            if (compressionCodec == ST_COMPRESSION_UNTAGGED) {
+                stThrowNew(REFERENCE_BUILDING_EXCEPTION, "Input error: unrecognized compression codec: %s", optarg);
+            }
+            break;
+        case '2':
+            j = sscanf(optarg, "%" PRIi64 "", &compressionThreads);
+            if (j != 1 || compressionThreads < 1) {
+                stThrowNew(REFERENCE_BUILDING_EXCEPTION, "Compression threads is not valid %s", optarg);
+            }
+            break;
         default:
             usage();
             return 1;
@@ -224,6 +243,7 @@ int main(int argc, char *argv[]) {
 
     stKVDatabaseConf *kvDatabaseConf = stKVDatabaseConf_constructFromString(cactusDiskDatabaseString);
     CactusDisk *cactusDisk = cactusDisk_construct(kvDatabaseConf, false, true);
+    cactusDisk_setCompression(cactusDisk, compressionCodec, -1, compressionThreads);
     st_logInfo("Set up the flower disk\n");
 
     ///////////////////////////////////////////////////////////////////////////
@@ -8,50 +8,51 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include "cactus.h"
 #include "sonLib.h"
 
-static void *compress(char *string, int64_t *dataSize) {
-    void *data = stCompression_compress(string, strlen(string) + 1, dataSize, 1); //going with least, fastest compression-1);
-    free(string);
+static void *compress(void *record, int64_t recordSize, int64_t *dataSize) {
+    void *data = stCompression_compress(record, recordSize, dataSize, 1); //going with least, fastest compression-1);
+    free(record);
     return data;
 }
 
-static char *decompress(void *data, int64_t dataSize) {
-    int64_t uncompressedSize;
-    char *string = stCompression_decompress(data, dataSize, &uncompressedSize);
-    assert(strlen(string)+1 == uncompressedSize);
+static void *decompress(void *data, int64_t dataSize, int64_t *recordSize) {
+    void *record = stCompression_decompress(data, dataSize, recordSize);
     free(data);
-    return string;
+    return record;
 }
 
-static void cacheNonNestedRecords(stCache *cache, stList *caps, char *(*segmentWriteFn)(Segment *),
-        char *(*terminalAdjacencyWriteFn)(Cap *)) {
+static void cacheNonNestedRecords(stShardedCache *cache, stList *caps, void *(*segmentWriteFn)(Segment *, int64_t *),
+        void *(*terminalAdjacencyWriteFn)(Cap *, int64_t *)) {
     /*
      * Caches the set of terminal adjacency and segment records present in the threads.
      */
     for (int64_t i = 0; i < stList_length(caps); i++) {
         Cap *cap = stList_get(caps, i);
-        int64_t recordSize;
+        int64_t recordSize, dataSize;
         while (1) {
             Cap *adjacentCap = cap_getAdjacency(cap);
             assert(adjacentCap != NULL);
             Group *group = end_getGroup(cap_getEnd(cap));
             assert(group != NULL);
             if (group_isLeaf(group)) { //Record must not be in the database already
-                void *data = compress(terminalAdjacencyWriteFn(cap), &recordSize);
-                assert(!stCache_containsRecord(cache, cap_getName(cap), 0, INT64_MAX));
-                stCache_setRecord(cache, cap_getName(cap), 0, recordSize, data);
+                void *record = terminalAdjacencyWriteFn(cap, &recordSize);
+                void *data = compress(record, recordSize, &dataSize);
+                assert(!stShardedCache_containsRecord(cache, cap_getName(cap)));
+                stShardedCache_setRecord(cache, cap_getName(cap), data, dataSize);
                 free(data);
             }
             if ((cap = cap_getOtherSegmentCap(adjacentCap)) == NULL) {
                 break;
             }
             Segment *segment = cap_getSegment(adjacentCap);
-            assert(!stCache_containsRecord(cache, segment_getName(segment), 0, INT64_MAX));
-            void *data = compress(segmentWriteFn(segment), &recordSize);
-            stCache_setRecord(cache, segment_getName(segment), 0, recordSize, data);
+            assert(!stShardedCache_containsRecord(cache, segment_getName(segment)));
+            void *record = segmentWriteFn(segment, &recordSize);
+            void *data = compress(record, recordSize, &dataSize);
+            stShardedCache_setRecord(cache, segment_getName(segment), data, dataSize);
             free(data);
         }
     }
@@ -82,7 +83,7 @@ static stList *getNestedRecordNames(stList *caps) {
     return getRequests;
 }
 
-static void cacheNestedRecords(stKVDatabase *database, stCache *cache, stList *caps) {
+static void cacheNestedRecords(stKVDatabase *database, stShardedCache *cache, stList *caps) {
     /*
      * Caches all the non-terminal adjacencies by retrieving them from the database.
      */
@@ -108,8 +109,8 @@ static void cacheNestedRecords(stKVDatabase *database, stCache *cache, stList *c
         int64_t recordSize;
         void *record = stKVDatabaseBulkResult_getRecord(result, &recordSize);
         assert(record != NULL);
-        assert(!stCache_containsRecord(cache, *recordName, 0, INT64_MAX));
-        stCache_setRecord(cache, *recordName, 0, recordSize, record);
+        assert(!stShardedCache_containsRecord(cache, *recordName));
+        stShardedCache_setRecord(cache, *recordName, record, recordSize);
         stKVDatabaseBulkResult_destruct(result); //Cleanup the memory as we go.
         free(recordName);
     }
@@ -118,12 +119,12 @@ static void cacheNestedRecords(stKVDatabase *database, stCache *cache, stList *c
     stList_destruct(records);
 }
 
-static stCache *cacheRecords(stKVDatabase *database, stList *caps, char *(*segmentWriteFn)(Segment *),
-        char *(*terminalAdjacencyWriteFn)(Cap *)) {
+static stShardedCache *cacheRecords(stKVDatabase *database, stList *caps, void *(*segmentWriteFn)(Segment *, int64_t *),
+        void *(*terminalAdjacencyWriteFn)(Cap *, int64_t *)) {
     /*
      * Cache all the elements needed to construct the set of threads.
      */
-    stCache *cache = stCache_construct();
+    stShardedCache *cache = stShardedCache_construct2();
     cacheNestedRecords(database, cache, caps);
     cacheNonNestedRecords(cache, caps, segmentWriteFn, terminalAdjacencyWriteFn);
     return cache;
@@ -151,45 +152,58 @@ static void deleteNestedRecords(stKVDatabase *database, stList *caps) {
     stList_destruct(deleteRequests);
 }
 
-static char *getThread(stCache *cache, Cap *startCap) {
+static void appendRecord(char **thread, int64_t *threadSize, int64_t *threadCapacity, stShardedCache *cache, Name name) {
+    /*
+     * Appends the decompressed record of the given name to the thread, leaving room for a terminating zero.
+     */
+    int64_t dataSize, recordSize;
+    assert(stShardedCache_containsRecord(cache, name));
+    void *data = stShardedCache_getRecord(cache, name, &dataSize);
+    void *record = decompress(data, dataSize, &recordSize);
+    if (*threadSize + recordSize + 1 > *threadCapacity) {
+        *threadCapacity = 2 * (*threadSize + recordSize + 1);
+        *thread = st_realloc(*thread, *threadCapacity);
+    }
+    memcpy(*thread + *threadSize, record, recordSize);
+    *threadSize += recordSize;
+    free(record);
+}
+
+static char *getThread(stShardedCache *cache, Cap *startCap, int64_t *threadSize) {
     /*
-     * Iterate through, first calculating the length of the final record, then concatenating the results.
+     * Iterate through, concatenating the records of the thread. The thread is followed by a zero, which is not
+     * counted in its size, so that threads of strings can be used as strings.
      */
     Cap *cap = startCap;
-    stList *strings = stList_construct3(0, free);
-    while (1) { //Calculate the size of the entries in the DB that represent the thread.
+    int64_t threadCapacity = 1;
+    char *thread = st_malloc(threadCapacity);
+    *threadSize = 0;
+    while (1) {
         Cap *adjacentCap = cap_getAdjacency(cap);
         assert(adjacentCap != NULL);
-        int64_t recordSize;
-        assert(stCache_containsRecord(cache, cap_getName(cap), 0, INT64_MAX));
-        void *data = stCache_getRecord(cache, cap_getName(cap), 0, INT64_MAX, &recordSize);
-        stList_append(strings, decompress(data, recordSize));
+        appendRecord(&thread, threadSize, &threadCapacity, cache, cap_getName(cap));
         if ((cap = cap_getOtherSegmentCap(adjacentCap)) == NULL) {
             break;
         }
-        assert(stCache_containsRecord(cache, segment_getName(cap_getSegment(adjacentCap)), 0, INT64_MAX));
-        data = stCache_getRecord(cache, segment_getName(cap_getSegment(adjacentCap)), 0, INT64_MAX, &recordSize);
-        stList_append(strings, decompress(data, recordSize));
+        appendRecord(&thread, threadSize, &threadCapacity, cache, segment_getName(cap_getSegment(adjacentCap)));
     }
-    char *string = stString_join2("", strings);
-    stList_destruct(strings);
-    return string;
+    thread[*threadSize] = '\0';
+    return thread;
 }
 
-void buildRecursiveThreads(stKVDatabase *database, stList *caps, char *(*segmentWriteFn)(Segment *),
-        char *(*terminalAdjacencyWriteFn)(Cap *)) {
+void buildRecursiveThreads2(stKVDatabase *database, stList *caps, void *(*segmentWriteFn)(Segment *, int64_t *),
+        void *(*terminalAdjacencyWriteFn)(Cap *, int64_t *)) {
     //Cache records
-    stCache *cache = cacheRecords(database, caps, segmentWriteFn, terminalAdjacencyWriteFn);
+    stShardedCache *cache = cacheRecords(database, caps, segmentWriteFn, terminalAdjacencyWriteFn);
 
     //Build new threads
     stList *records = stList_construct3(0, (void(*)(void *)) stKVDatabaseBulkRequest_destruct);
     for (int64_t i = 0; i < stList_length(caps); i++) {
         Cap *cap = stList_get(caps, i);
-        char *string = getThread(cache, cap);
-        assert(string != NULL);
-        int64_t recordSize;
-        void *data = compress(string, &recordSize);
-        stList_append(records, stKVDatabaseBulkRequest_constructInsertRequest(cap_getName(cap), data, recordSize));
+        int64_t threadSize, dataSize;
+        char *thread = getThread(cache, cap, &threadSize);
+        void *data = compress(thread, threadSize, &dataSize);
+        stList_append(records, stKVDatabaseBulkRequest_constructInsertRequest(cap_getName(cap), data, dataSize));
         free(data);
     }
 
@@ -204,25 +218,62 @@ void buildRecursiveThreads(stKVDatabase *database, stList *caps, char *(*segment
             }stTryEnd;
 
     //Cleanup
-    stCache_destruct(cache);
+    stShardedCache_destruct(cache);
     stList_destruct(records);
 }
 
-stList *buildRecursiveThreadsInList(stKVDatabase *database, stList *caps, char *(*segmentWriteFn)(Segment *),
-        char *(*terminalAdjacencyWriteFn)(Cap *)) {
-    stList *threadStrings = stList_construct3(0, free);
+stList *buildRecursiveThreadsInList2(stKVDatabase *database, stList *caps, void *(*segmentWriteFn)(Segment *, int64_t *),
+        void *(*terminalAdjacencyWriteFn)(Cap *, int64_t *), int64_t **threadSizes) {
+    stList *threads = stList_construct3(0, free);
+    *threadSizes = st_malloc(sizeof(int64_t) * (stList_length(caps) > 0 ? stList_length(caps) : 1));
 
     //Cache records
-    stCache *cache = cacheRecords(database, caps, segmentWriteFn, terminalAdjacencyWriteFn);
+    stShardedCache *cache = cacheRecords(database, caps, segmentWriteFn, terminalAdjacencyWriteFn);
 
     //Build new threads
     for (int64_t i = 0; i < stList_length(caps); i++) {
         Cap *cap = stList_get(caps, i);
-        stList_append(threadStrings, getThread(cache, cap));
+        stList_append(threads, getThread(cache, cap, &(*threadSizes)[i]));
     }
 
-    stCache_destruct(cache);
+    stShardedCache_destruct(cache);
 
-    return threadStrings;
+    return threads;
 }
 
+/*
+ * The string writers are adapted to the record writers, each string being stored without its terminating zero.
+ */
+
+static char *(*stringSegmentWriteFn)(Segment *);
+static char *(*stringTerminalAdjacencyWriteFn)(Cap *);
+
+static void *writeStringSegment(Segment *segment, int64_t *recordSize) {
+    char *string = stringSegmentWriteFn(segment);
+    *recordSize = strlen(string);
+    return string;
+}
+
+static void *writeStringTerminalAdjacency(Cap *cap, int64_t *recordSize) {
+    char *string = stringTerminalAdjacencyWriteFn(cap);
+    *recordSize = strlen(string);
+    return string;
+}
+
+void buildRecursiveThreads(stKVDatabase *database, stList *caps, char *(*segmentWriteFn)(Segment *),
+        char *(*terminalAdjacencyWriteFn)(Cap *)) {
+    stringSegmentWriteFn = segmentWriteFn;
+    stringTerminalAdjacencyWriteFn = terminalAdjacencyWriteFn;
+    buildRecursiveThreads2(database, caps, writeStringSegment, writeStringTerminalAdjacency);
+}
+
+stList *buildRecursiveThreadsInList(stKVDatabase *database, stList *caps, char *(*segmentWriteFn)(Segment *),
+        char *(*terminalAdjacencyWriteFn)(Cap *)) {
+    stringSegmentWriteFn = segmentWriteFn;
+    stringTerminalAdjacencyWriteFn = terminalAdjacencyWriteFn;
+    int64_t *threadSizes;
+    stList *threadStrings = buildRecursiveThreadsInList2(database, caps, writeStringSegment, writeStringTerminalAdjacency,
+            &threadSizes);
+    free(threadSizes);
+    return threadStrings;
+}
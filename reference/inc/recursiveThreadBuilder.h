@@ -16,4 +16,18 @@ stList *buildRecursiveThreadsInList(stKVDatabase *database, stList *caps,
         char *(*segmentWriteFn)(Segment *),
         char *(*terminalAdjacencyWriteFn)(Cap *));
 
+/*
+ * As buildRecursiveThreads and buildRecursiveThreadsInList, but the records written for segments and terminal
+ * adjacencies are arbitrary bytes, their sizes being returned through the second argument of the write functions.
+ * The threads are the concatenations of their records. Each thread in the list is followed by a zero, which is not
+ * counted in its size; the array of thread sizes is to be freed by the caller.
+ */
+void buildRecursiveThreads2(stKVDatabase *database, stList *caps,
+        void *(*segmentWriteFn)(Segment *, int64_t *),
+        void *(*terminalAdjacencyWriteFn)(Cap *, int64_t *));
+
+stList *buildRecursiveThreadsInList2(stKVDatabase *database, stList *caps,
+        void *(*segmentWriteFn)(Segment *, int64_t *),
+        void *(*terminalAdjacencyWriteFn)(Cap *, int64_t *), int64_t **threadSizes);
+
 #endif /* RECURSIVETHREADBUILDER_H_ */
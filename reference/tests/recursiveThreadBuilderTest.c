@@ -25,7 +25,23 @@ static char *writeTerminalAdjacency(Cap *cap) {
     return stString_print("%" PRIi64 " %s ", cap_getCoordinate(cap), sequence_getString(sequence, cap_getCoordinate(cap)+1, cap_getCoordinate(cap_getAdjacency(cap)) - cap_getCoordinate(cap) - 1, 1));
 }
 
-static void recursiveFileBuilder_test(CuTest *testCase) {
+static void *writeBinarySegment(Segment *segment, int64_t *recordSize) {
+    int64_t *record = st_malloc(2 * sizeof(int64_t));
+    record[0] = segment_getStart(segment);
+    record[1] = segment_getLength(segment);
+    *recordSize = 2 * sizeof(int64_t);
+    return record;
+}
+
+static void *writeBinaryTerminalAdjacency(Cap *cap, int64_t *recordSize) {
+    int64_t *record = st_malloc(2 * sizeof(int64_t));
+    record[0] = cap_getCoordinate(cap);
+    record[1] = cap_getCoordinate(cap_getAdjacency(cap)) - cap_getCoordinate(cap) - 1;
+    *recordSize = record[1] == 0 ? 0 : 2 * sizeof(int64_t);
+    return record;
+}
+
+static void recursiveFileBuilder_test2(CuTest *testCase, bool binary) {
     //Make flower with two ends and 2 blocks, and one child, one empty adjacency and two containing additional blocks.
 
     const char *tempDir = "recursiveFileBuilderTestTempDir";
@@ -33,7 +49,7 @@ static void recursiveFileBuilder_test(CuTest *testCase) {
         stFile_rmrf(tempDir);
     }
     stFile_mkdir(tempDir);
-    stKVDatabaseConf *conf = stKVDatabaseConf_constructTokyoCabinet(
+    stKVDatabaseConf *conf = testCommon_constructKVDatabaseConf(
                 stFile_pathJoin(tempDir, "temporaryCactusDisk"));
     CactusDisk *cactusDisk = cactusDisk_construct(conf, true, true);
     eventTree_construct2(cactusDisk);
@@ -77,30 +93,62 @@ static void recursiveFileBuilder_test(CuTest *testCase) {
     flower_destructEndIterator(endIt);
 
     //Create the sequence database
-    stKVDatabaseConf *secondaryConf = stKVDatabaseConf_constructTokyoCabinet(
+    stKVDatabaseConf *secondaryConf = testCommon_constructKVDatabaseConf(
                     stFile_pathJoin(tempDir, "temporaryCactusDisk2"));
     stKVDatabase *secondaryDatabase = stKVDatabase_construct(secondaryConf, 1);
     stList *caps = stList_construct();
     stList_append(caps, flower_getCap(nestedFlower, cap_getName(cap1)));
-    buildRecursiveThreads(secondaryDatabase, caps, writeSegment, writeTerminalAdjacency);
+    if (binary) {
+        buildRecursiveThreads2(secondaryDatabase, caps, writeBinarySegment, writeBinaryTerminalAdjacency);
+    } else {
+        buildRecursiveThreads(secondaryDatabase, caps, writeSegment, writeTerminalAdjacency);
+    }
     stKVDatabase_destruct(secondaryDatabase);
 
     //Now complete the alignment
     secondaryDatabase = stKVDatabase_construct(secondaryConf, 0);
     stList_pop(caps);
     stList_append(caps, cap1);
-    stList *threadStrings = buildRecursiveThreadsInList(secondaryDatabase, caps, writeSegment, writeTerminalAdjacency);
-    stKVDatabase_deleteFromDisk(secondaryDatabase);
-
-    CuAssertIntEquals(testCase, 1, stList_length(threadStrings));
-    CuAssertStrEquals(testCase, "1 ACG 3 TA ", stList_get(threadStrings, 0));
+    if (binary) {
+        //The records of the segment and the terminal adjacency after it, the adjacency before it being empty
+        int64_t *threadSizes;
+        stList *threads = buildRecursiveThreadsInList2(secondaryDatabase, caps, writeBinarySegment,
+                writeBinaryTerminalAdjacency, &threadSizes);
+        stKVDatabase_deleteFromDisk(secondaryDatabase);
+
+        CuAssertIntEquals(testCase, 1, stList_length(threads));
+        CuAssertIntEquals(testCase, 4 * sizeof(int64_t), threadSizes[0]);
+        int64_t *thread = stList_get(threads, 0);
+        CuAssertIntEquals(testCase, 1, thread[0]);
+        CuAssertIntEquals(testCase, 3, thread[1]);
+        CuAssertIntEquals(testCase, 3, thread[2]);
+        CuAssertIntEquals(testCase, 2, thread[3]);
+        stList_destruct(threads);
+        free(threadSizes);
+    } else {
+        stList *threadStrings = buildRecursiveThreadsInList(secondaryDatabase, caps, writeSegment, writeTerminalAdjacency);
+        stKVDatabase_deleteFromDisk(secondaryDatabase);
+
+        CuAssertIntEquals(testCase, 1, stList_length(threadStrings));
+        CuAssertStrEquals(testCase, "1 ACG 3 TA ", stList_get(threadStrings, 0));
+        stList_destruct(threadStrings);
+    }
 
     cactusDisk_destruct(cactusDisk);
     stFile_rmrf(tempDir);
 }
 
+static void recursiveFileBuilder_test(CuTest *testCase) {
+    recursiveFileBuilder_test2(testCase, 0);
+}
+
+static void recursiveFileBuilder_testBinary(CuTest *testCase) {
+    recursiveFileBuilder_test2(testCase, 1);
+}
+
 CuSuite* recursiveThreadBuilderTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, recursiveFileBuilder_test);
+    SUITE_ADD_TEST(suite, recursiveFileBuilder_testBinary);
     return suite;
 }
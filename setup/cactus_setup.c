@@ -31,6 +31,8 @@ void usage() {
     fprintf(stderr, "-f --speciesTree : The species tree, which will form the skeleton of the event tree\n");
     fprintf(stderr, "-g --outgroupEvents : Leaf events in the species tree identified as outgroups\n");
     fprintf(stderr, "-i --makeEventHeadersAlphaNumeric : Remove non alpha-numeric characters from event header names\n");
+    fprintf(stderr, "--compressionCodec : Codec with which flowers are written, either 'lz4', 'lz4hc' or 'zlib', default lz4\n");
+    fprintf(stderr, "--compressionThreads : Number of threads with which to compress the flowers written, default 1\n");
     fprintf(stderr, "-h --help : Print this help screen\n");
     fprintf(stderr, "-d --debug : Run some extra debug checks at the end\n");
 }
@@ -204,6 +206,8 @@ int main(int argc, char *argv[]) {
     char * logLevelString = NULL;
     char * speciesTree = NULL;
     char * outgroupEvents = NULL;
+    stCompressionCodec compressionCodec = ST_COMPRESSION_LZ4;
+    int64_t compressionThreads = 1;
 
     ///////////////////////////////////////////////////////////////////////////
     // (0) Parse the inputs handed by genomeCactus.py / setup stuff.
@@ -212,7 +216,8 @@ int main(int argc, char *argv[]) {
     while (1) {
         static struct option long_options[] = { { "logLevel", required_argument, 0, 'a' }, { "cactusDisk", required_argument, 0, 'b' }, {
                 "speciesTree", required_argument, 0, 'g' }, { "outgroupEvents", required_argument, 0, 'h' },
-                { "help", no_argument, 0, 'i' }, { "makeEventHeadersAlphaNumeric", no_argument, 0, 'j' }, { 0, 0, 0, 0 } };
+                { "help", no_argument, 0, 'i' }, { "makeEventHeadersAlphaNumeric", no_argument, 0, 'j' },
+                { "compressionCodec", required_argument, 0, '1' }, { "compressionThreads", required_argument, 0, '2' }, { 0, 0, 0, 0 } };
 
         int option_index = 0;
 
@@ -241,6 +246,17 @@ int main(int argc, char *argv[]) {
             case 'j':
                 makeEventHeadersAlphaNumeric = 1;
                 break;
+            case '1':
+                compressionCodec = stCompression_parseCodec(optarg);
+                if (compressionCodec == ST_COMPRESSION_UNTAGGED) {
+                    st_errAbort("Error parsing the compressionCodec argument");
+                }
+                break;
+            case '2':
+                if (sscanf(optarg, "%" PRIi64, &compressionThreads) != 1 || compressionThreads < 1) {
+                    st_errAbort("Error parsing the compressionThreads argument");
+                }
+                break;
             default:
                 usage();
                 return 1;
@@ -277,12 +293,13 @@ int main(int argc, char *argv[]) {
 
     stKVDatabaseConf *kvDatabaseConf = kvDatabaseConf = stKVDatabaseConf_constructFromString(cactusDiskDatabaseString);
     if (stKVDatabaseConf_getType(kvDatabaseConf) == stKVDatabaseTypeTokyoCabinet || stKVDatabaseConf_getType(kvDatabaseConf)
-            == stKVDatabaseTypeKyotoTycoon) {
+            == stKVDatabaseTypeKyotoTycoon || stKVDatabaseConf_getType(kvDatabaseConf) == stKVDatabaseTypeLogFile) {
         assert(stKVDatabaseConf_getDir(kvDatabaseConf) != NULL);
         cactusDisk = cactusDisk_construct(kvDatabaseConf, true, true);
     } else {
         cactusDisk = cactusDisk_construct(kvDatabaseConf, true, true);
     }
+    cactusDisk_setCompression(cactusDisk, compressionCodec, -1, compressionThreads);
     st_logInfo("Set up the flower disk\n");
 
     //////////////////////////////////////////////
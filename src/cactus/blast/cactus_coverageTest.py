@@ -165,7 +165,53 @@ class TestCase(unittest.TestCase):
         self.assertEqual(bed, dedent('''\
         id=0|simpleSeqA1\t9\t10\t\t65535
         '''))
+        # Shards printed with --uncapped merge to the true depth
+        deepBedPath = getTempFile()
+        cactus_call(parameters=["cactus_coverage", "--uncapped", self.simpleFastaPathA, deepCigarPath],
+                    outfile=deepBedPath)
+        self.assertEqual(open(deepBedPath).read(), dedent('''\
+        id=0|simpleSeqA1\t9\t10\t\t65537
+        '''))
+        bed = cactus_call(parameters=["cactus_coverage", "--uncapped", self.simpleFastaPathA,
+                                      "--merge", deepBedPath, "--merge", deepBedPath], check_output=True)
+        self.assertEqual(bed, dedent('''\
+        id=0|simpleSeqA1\t9\t10\t\t131074
+        '''))
+        os.remove(deepBedPath)
         os.remove(deepCigarPath)
 
+    @silentOnSuccess
+    def testMerge(self):
+        """Test that merging the coverage of shards of the alignments gives the coverage of all of them."""
+        cigars = open(self.simpleCigarPath).readlines()
+        shardPaths = [getTempFile() for i in xrange(3)]
+        bedPaths = [getTempFile() for i in xrange(3)]
+        for i, (shardPath, bedPath) in enumerate(zip(shardPaths, bedPaths)):
+            open(shardPath, 'w').write("".join(cigars[i::3]))
+            cactus_call(parameters=["cactus_coverage", self.simpleFastaPathA, shardPath], outfile=bedPath)
+        bed = cactus_call(parameters=["cactus_coverage", self.simpleFastaPathA, self.simpleCigarPath],
+                          check_output=True)
+        mergeArgs = sum([["--merge", bedPath] for bedPath in bedPaths], [])
+        self.assertEqual(cactus_call(parameters=["cactus_coverage", self.simpleFastaPathA] + mergeArgs,
+                                     check_output=True), bed)
+        # Shards of alignments and coverage can be mixed
+        self.assertEqual(cactus_call(parameters=["cactus_coverage", self.simpleFastaPathA, shardPaths[0], shardPaths[1],
+                                                 "--merge", bedPaths[2]], check_output=True), bed)
+        for path in shardPaths + bedPaths:
+            os.remove(path)
+
+    @silentOnSuccess
+    def testBinaryAlignments(self):
+        """Test that alignments converted to binary records convert back unchanged, and give the same coverage."""
+        binaryCigarPath = getTempFile()
+        cactus_call(parameters=["cactus_convertAlignmentFormat", "--binary", self.simpleCigarPath, binaryCigarPath])
+        self.assertEqual(open(binaryCigarPath).read(1), '\0')
+        self.assertEqual(cactus_call(parameters=["cactus_convertAlignmentFormat", binaryCigarPath], check_output=True),
+                         cactus_call(parameters=["cactus_convertAlignmentFormat", self.simpleCigarPath], check_output=True))
+        for fastaPath in [self.simpleFastaPathA, self.simpleFastaPathB]:
+            self.assertEqual(cactus_call(parameters=["cactus_coverage", fastaPath, binaryCigarPath], check_output=True),
+                             cactus_call(parameters=["cactus_coverage", fastaPath, self.simpleCigarPath], check_output=True))
+        os.remove(binaryCigarPath)
+
 if __name__ == '__main__':
     unittest.main()
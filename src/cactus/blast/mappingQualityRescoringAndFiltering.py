@@ -15,7 +15,7 @@ filtering the alignments to remove lower probability alignments.
         - Add mirror alignments to T  and ensure alignments are reported with repsect to positive strand of first sequence 
         (this ensures that each alignment is considered on both sequences 
         to which it aligns): C subscript: cactus_mirrorAndOrientAlignments.c
-        - Sort alignments in T by coordinates on S: Unix sort
+        - Sort alignments in T by coordinates on S, dropping duplicates: C subscript: cactus_blast_sortAlignmentsByQuery
         - Split alignments in T so that they don't partially overlap on S: C subscript: cactus_splitAlignmentOverlaps
             - Each alignment defines an interval on a sequence in S
             - Split alignments into sub-alignments so for any two alignments in the set 
@@ -24,6 +24,7 @@ filtering the alignments to remove lower probability alignments.
         for example to only keep the primary alignment: C subscript: cactus_calculateMappingQualities
 
 """
+import os
 from cactus.shared.common import cactus_call
 
 def countLines(inputFile):
@@ -45,11 +46,20 @@ def mappingQualityRescoring(job, inputAlignmentFileID,
     assert maxAlignmentsPerSite >= 1
     tempAlignmentFiles = [job.fileStore.getLocalTempFile() for i in xrange(maxAlignmentsPerSite)]
     
-    # Mirror and orient alignments, sort, split overlaps and calculate mapping qualities
-    cactus_call(parameters=[["cat", inputAlignmentFile],
-                            ["cactus_mirrorAndOrientAlignments", logLevel],
-                            ["sort", "-k6,6", "-k7,7n", "-k8,8n"], # This sorts by coordinate
-                            ["uniq"], # This eliminates any annoying duplicates if lastz reports the alignment in both orientations
+    # Mirror and orient alignments
+    mirroredAlignmentFile = job.fileStore.getLocalTempFile()
+    cactus_call(parameters=["cactus_mirrorAndOrientAlignments", logLevel,
+                            inputAlignmentFile, mirroredAlignmentFile])
+
+    # Sort by coordinate, with --unique eliminating any annoying duplicates if lastz reports the alignment in both orientations
+    sortedAlignmentFile = job.fileStore.getLocalTempFile()
+    cactus_call(parameters=["cactus_blast_sortAlignmentsByQuery", "--unique",
+                            "--tempDir", job.fileStore.getLocalTempDir(), logLevel,
+                            mirroredAlignmentFile, sortedAlignmentFile])
+    os.remove(mirroredAlignmentFile)
+
+    # Split overlaps and calculate mapping qualities
+    cactus_call(parameters=[["cat", sortedAlignmentFile],
                             ["cactus_splitAlignmentOverlaps", logLevel],
                             ["cactus_calculateMappingQualities", logLevel, str(maxAlignmentsPerSite),
                              str(minimumMapQValue), str(alpha)] + tempAlignmentFiles])
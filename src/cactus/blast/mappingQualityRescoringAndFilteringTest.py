@@ -1,4 +1,4 @@
-import unittest, os, random, time
+import unittest, os, random, time, math
 
 from toil.job import Job
 from toil.common import Toil
@@ -210,9 +210,12 @@ class TestCase(unittest.TestCase):
         with open(self.simpleOutputCigarPath, 'r') as fh:
             outputCigars = [ cigar[:-1] for cigar in fh.readlines() ] # Remove new lines
         
+        self.checkSplitAlignmentOverlaps(self.inputCigars, outputCigars)
+    
+    def checkSplitAlignmentOverlaps(self, inputCigars, outputCigars):
         # Get start and end coordinates of cigars
         ends = set()
-        for inputCigar in self.inputCigars:
+        for inputCigar in inputCigars:
             name1, start1, end1, strand1 = inputCigar.split()[5:9]
             ends.add((name1, int(start1)))
             ends.add((name1, int(end1)))
@@ -250,7 +253,7 @@ class TestCase(unittest.TestCase):
             return pOps, sOps     
         
         # For each cigar:
-        for inputCigar in self.inputCigars:
+        for inputCigar in inputCigars:
             name1, start1, end1, strand1 = inputCigar.split()[5:9]
             start1, end1 = int(start1), int(end1)
             assert strand1 == "+"
@@ -295,6 +298,75 @@ class TestCase(unittest.TestCase):
         # Check we have the expected number of cigars  
         self.assertEquals(totalExpectedCigars, len(outputCigars))
     
+    @staticmethod
+    def makeOverlappingCigars(alignmentNumber, contigLength, maxOpLength):
+        # Random alignments to the positive strand of a few contigs, sorted by start coordinate, most of which
+        # partially overlap many others. Like those of lastz, they start and end with a match.
+        cigars = []
+        for contig in xrange(3):
+            for i in xrange(alignmentNumber / 3):
+                start1 = random.randint(0, contigLength)
+                ops = []
+                length1, length2 = 0, 0
+                opNumber = random.choice([ 1, 3, 5, 7 ])
+                for j in xrange(opNumber):
+                    op = random.choice("MID") if j % 2 == 1 else "M"
+                    length = random.randint(1, maxOpLength)
+                    ops += [ op, length ]
+                    length1 += length if op != "I" else 0
+                    length2 += length if op != "D" else 0
+                strand2 = random.choice("+-")
+                start2 = random.randint(length2, 10 * contigLength)
+                end2 = start2 + length2 if strand2 == "+" else start2 - length2
+                cigars.append((contig, start1, TestCase.makeCigar(("contig%s" % contig, start1, start1 + length1, "+"),
+                                                                  ("other", start2, end2, strand2),
+                                                                  random.randint(1, 100), ops)))
+        return [ cigar for contig, start1, cigar in sorted(cigars) ]
+
+    @silentOnSuccess
+    def testSplitAlignmentOverlaps_random(self):
+        """
+        Splits random, heavily overlapping, alignments with one and several threads.
+        """
+        for test in xrange(5):
+            inputCigars = self.makeOverlappingCigars(random.choice([ 10, 100, 300 ]), 200, 30)
+            with open(self.simpleInputCigarPath, 'w') as fH:
+                fH.write("\n".join(inputCigars) + "\n")
+            outputs = []
+            for threads in [ "1", "4" ]:
+                cactus_call(parameters=[ "cactus_splitAlignmentOverlaps", "--threads", threads, self.logLevelString,
+                                         self.simpleInputCigarPath, self.simpleOutputCigarPath ])
+                with open(self.simpleOutputCigarPath, 'r') as fh:
+                    outputs.append([ cigar[:-1] for cigar in fh.readlines() ])
+            self.assertEqual(outputs[0], outputs[1])
+            self.checkSplitAlignmentOverlaps(inputCigars, outputs[0])
+
+    @silentOnSuccess
+    def testSplitAlignmentOverlaps_batchBoundaries(self):
+        """
+        Splits sparser alignments in small batches, so that batches end mid-contig, with a long alignment spanning
+        many batches' worth of others in some tests, and checks the output does not depend on the batches.
+        """
+        for test in xrange(5):
+            inputCigars = self.makeOverlappingCigars(300, 3000, 5)
+            if test % 2 == 0:
+                start1 = random.randint(0, 1000)
+                inputCigars.append(self.makeCigar(("contig1", start1, start1 + 2000, "+"),
+                                                  ("other", 0, 2000, "+"), 50, [ "M", 2000 ]))
+                inputCigars.sort(key=lambda cigar : (cigar.split()[5], int(cigar.split()[6])))
+            with open(self.simpleInputCigarPath, 'w') as fH:
+                fH.write("\n".join(inputCigars) + "\n")
+            outputs = []
+            for options in [ [ "--threads", "1" ], [ "--threads", "4", "--batchSize", "5" ],
+                             [ "--threads", "2", "--batchSize", "1" ] ]:
+                cactus_call(parameters=[ "cactus_splitAlignmentOverlaps" ] + options + [ self.logLevelString,
+                                         self.simpleInputCigarPath, self.simpleOutputCigarPath ])
+                with open(self.simpleOutputCigarPath, 'r') as fh:
+                    outputs.append([ cigar[:-1] for cigar in fh.readlines() ])
+            self.assertEqual(outputs[0], outputs[1])
+            self.assertEqual(outputs[0], outputs[2])
+            self.checkSplitAlignmentOverlaps(inputCigars, outputs[0])
+
     @silentOnSuccess
     def testCalculateMappingQualities(self):
         with open(self.simpleInputCigarPath, 'w') as fH:
@@ -311,6 +383,107 @@ class TestCase(unittest.TestCase):
         
         self.assertEqual(self.filteredSortedNonOverlappingInputCigars, outputCigars)
         
+    @silentOnSuccess
+    def testBinaryOutput(self):
+        """Test that the tools give the same alignments as binary records as they do as text cigars."""
+        def readAsText(path):
+            return cactus_call(parameters=["cactus_convertAlignmentFormat", path], check_output=True)
+
+        cactus_call(parameters=["cactus_mirrorAndOrientAlignments", self.logLevelString,
+                                self.simpleInputCigarPath, self.simpleOutputCigarPath])
+        cactus_call(parameters=["cactus_mirrorAndOrientAlignments", "--binary", self.logLevelString,
+                                self.simpleInputCigarPath, self.simpleOutputCigarPath2])
+        self.assertEqual(open(self.simpleOutputCigarPath2).read(1), '\0')
+        self.assertEqual(readAsText(self.simpleOutputCigarPath), readAsText(self.simpleOutputCigarPath2))
+
+        # Binary input read from a pipe
+        binaryOutput = cactus_call(parameters=["cactus_mirrorAndOrientAlignments", self.logLevelString],
+                                   stdin_string=open(self.simpleOutputCigarPath2).read(), check_output=True)
+        with open(self.simpleOutputCigarPath2, 'w') as fH:
+            fH.write(binaryOutput)
+        cactus_call(parameters=["cactus_mirrorAndOrientAlignments", self.logLevelString,
+                                self.simpleOutputCigarPath, self.simpleOutputCigarPath + ".mirrored"])
+        self.assertEqual(readAsText(self.simpleOutputCigarPath + ".mirrored"), readAsText(self.simpleOutputCigarPath2))
+        os.remove(self.simpleOutputCigarPath + ".mirrored")
+
+        with open(self.simpleInputCigarPath, 'w') as fH:
+            fH.write("\n".join(self.sortedNonOverlappingInputCigars) + "\n")
+        for binary in [ [], [ "--binary" ] ]:
+            cactus_call(parameters=[ "cactus_calculateMappingQualities" ] + binary + [ self.logLevelString,
+                                     '1', '0', "1.0", self.simpleOutputCigarPath2, self.simpleInputCigarPath ])
+            self.assertEqual(self.filteredSortedNonOverlappingInputCigars,
+                             readAsText(self.simpleOutputCigarPath2).split("\n")[:-1])
+
+    @silentOnSuccess
+    def testSortAlignmentsByQueryUnique(self):
+        """Test that sorting with --unique gives the alignments of sort and uniq, with the duplicates not adjacent."""
+        cactus_call(parameters=["cactus_mirrorAndOrientAlignments", self.logLevelString,
+                                self.simpleInputCigarPath, self.simpleOutputCigarPath])
+        with open(self.simpleOutputCigarPath, 'r') as fh:
+            mirroredCigars = [ cigar[:-1] for cigar in fh.readlines() ]
+        with open(self.simpleOutputCigarPath, 'w') as fH:
+            fH.write("\n".join(mirroredCigars + list(reversed(mirroredCigars))) + "\n")
+        cactus_call(parameters=["cactus_blast_sortAlignmentsByQuery", "--unique", self.logLevelString,
+                                self.simpleOutputCigarPath, self.simpleOutputCigarPath2])
+        with open(self.simpleOutputCigarPath2, 'r') as fh:
+            outputCigars = [ cigar[:-1] for cigar in fh.readlines() ]
+
+        self.assertEqual(sorted(set(mirroredCigars)), sorted(outputCigars))
+        keys = [ (cigar.split()[5], int(cigar.split()[6]), int(cigar.split()[7])) for cigar in outputCigars ]
+        self.assertEqual(sorted(keys), keys)
+
+    @staticmethod
+    def calculateMappingQuality(scores, i, alpha):
+        # The mapping quality of the i-th of the ascending scores, computed directly from the definition
+        if alpha * (scores[i] - scores[-1]) < -10:
+            return 0.0
+        z = sum([ math.pow(10, alpha * (score - scores[i])) for score in scores ])
+        if z <= 1.000001:
+            return 60.0
+        return -10.0 * math.log10(1.0 - 1.0/z)
+
+    @silentOnSuccess
+    def testCalculateMappingQualities_random(self):
+        """
+        Compares the mapping qualities of random sites, some with many alignments, to those computed
+        directly from their definition, with one and several threads.
+        """
+        maxAlignmentsPerSite = 3
+        for test in xrange(5):
+            alpha = random.choice([ 0.01, 0.3, 1.0 ])
+            sites = []
+            with open(self.simpleInputCigarPath, 'w') as fH:
+                for site in xrange(random.randint(1, 50)):
+                    alignmentNumber = random.choice([ 1, 2, 3, 10, 100, 5000 ])
+                    scores = [ 0.25 * score for score in random.sample(xrange(10 * alignmentNumber), alignmentNumber) ]
+                    for score in scores:
+                        fH.write(self.makeCigar(("simpleSeqA1", 10 * site, 10 * site + 10, "+"),
+                                                ("simpleSeqB1", 0, 10, "+"), score, [ "M", 10 ]) + "\n")
+                    sites.append(sorted(scores))
+
+            outputs = []
+            for threads in [ "1", "4" ]:
+                outputCigarPaths = [ getTempFile() for i in xrange(maxAlignmentsPerSite) ]
+                cactus_call(parameters=[ "cactus_calculateMappingQualities", "--threads", threads,
+                                         self.logLevelString, str(maxAlignmentsPerSite), '0', str(alpha) ] +
+                                        outputCigarPaths + [ self.simpleInputCigarPath ])
+                output = []
+                for outputCigarPath in outputCigarPaths:
+                    with open(outputCigarPath, 'r') as fh:
+                        output.append([ cigar.split() for cigar in fh.readlines() ])
+                    os.remove(outputCigarPath)
+                outputs.append(output)
+            self.assertEqual(outputs[0], outputs[1])
+
+            # The i-th output file has the i-th best alignment of each site
+            for i in xrange(maxAlignmentsPerSite):
+                expectedMapQs = [ (j, self.calculateMappingQuality(site, len(site) - 1 - i, alpha))
+                                  for j, site in enumerate(sites) if len(site) > i ]
+                self.assertEqual(len(expectedMapQs), len(outputs[0][i]))
+                for (j, mapQ), cigar in zip(expectedMapQs, outputs[0][i]):
+                    self.assertEqual(cigar[5:9], [ "simpleSeqA1", str(10 * j), str(10 * j + 10), "+" ])
+                    self.assertAlmostEqual(mapQ, float(cigar[9]), places=3)
+
     def runToilPipeline(self, alignmentsFile, alpha=0.001):
         # Tests the toil pipeline        
         options = Job.Runner.getDefaultOptions(os.path.join(self.tempDir, "toil"))
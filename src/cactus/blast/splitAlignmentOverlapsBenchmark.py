@@ -0,0 +1,36 @@
+"""Times cactus_splitAlignmentOverlaps on random, heavily overlapping alignments, as text and as binary records,
+with one and several threads. Kept out of the unit tests as it is slow and only reports timings.
+"""
+
+import os, time
+from argparse import ArgumentParser
+
+from sonLib.bioio import getTempFile
+from cactus.shared.common import cactus_call
+from cactus.blast.mappingQualityRescoringAndFilteringTest import TestCase
+
+def main():
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("--alignments", type=int, default=30000, help="Number of alignments to split")
+    parser.add_argument("--contigLength", type=int, default=20000, help="Length of the contigs aligned to")
+    parser.add_argument("--maxOpLength", type=int, default=100, help="Maximum length of each cigar operation")
+    parser.add_argument("--threads", default="1,4", help="Comma separated numbers of threads to time")
+    options = parser.parse_args()
+
+    inputCigars = TestCase.makeOverlappingCigars(options.alignments, options.contigLength, options.maxOpLength)
+    textInputPath, binaryInputPath, outputPath = getTempFile(), getTempFile(), getTempFile()
+    with open(textInputPath, 'w') as fH:
+        fH.write("\n".join(inputCigars) + "\n")
+    cactus_call(parameters=[ "cactus_convertAlignmentFormat", "--binary", textInputPath, binaryInputPath ])
+    for inputPath, format in [ (textInputPath, "text"), (binaryInputPath, "binary") ]:
+        for threads in options.threads.split(","):
+            startTime = time.time()
+            cactus_call(parameters=[ "cactus_splitAlignmentOverlaps", "--threads", threads, "CRITICAL",
+                                     inputPath, outputPath ])
+            print "It took %s seconds to split %s %s alignments with %s threads" % (time.time() - startTime,
+                                                                                  len(inputCigars), format, threads)
+    for path in [ textInputPath, binaryInputPath, outputPath ]:
+        os.remove(path)
+
+if __name__ == '__main__':
+    main()
@@ -3,7 +3,8 @@ from argparse import ArgumentParser
 from collections import defaultdict
 import sys
 import os
-from sonLib.bioio import cigarRead, cigarWrite, getTempFile, system
+from sonLib.bioio import cigarRead, cigarWrite, getTempFile
+from cactus.shared.common import cactus_call
 
 def getSequenceRanges(fa):
     """Get dict of (untrimmed header) -> [(start, non-inclusive end)] mappings
@@ -54,10 +55,12 @@ def validateRanges(seqRanges):
                 assert start < range2[0]
 
 def sortCigarByContigAndPos(cigarPath, contigNum):
-    contigNameKey = 2 if contigNum == 1 else 6
-    startPosKey = 3 if contigNum == 1 else 7
+    # contig1 and contig2 are reversed in python api, so contigNum 1 is
+    # the second sequence of the C sort
     tempFile = getTempFile()
-    system("sort -k %d,%d -k %d,%dn %s > %s" % (contigNameKey, contigNameKey, startPosKey, startPosKey, cigarPath, tempFile))
+    cactus_call(parameters=["cactus_blast_sortAlignmentsByQuery"] +
+                (["--bySecondSequence"] if contigNum == 1 else []) +
+                ["CRITICAL", cigarPath, tempFile])
     return tempFile
 
 def upconvertCoords(cigarPath, fastaPath, contigNum, outputFile):
@@ -638,7 +638,9 @@ class CactusSetupPhase(CactusPhasesJob):
                        sequences=sequences,
                        newickTreeString=self.cactusWorkflowArguments.speciesTree, 
                        outgroupEvents=self.cactusWorkflowArguments.outgroupEventNames,
-                       makeEventHeadersAlphaNumeric=self.getOptionalPhaseAttrib("makeEventHeadersAlphaNumeric", bool, False))
+                       makeEventHeadersAlphaNumeric=self.getOptionalPhaseAttrib("makeEventHeadersAlphaNumeric", bool, False),
+                       compressionCodec=self.getOptionalPhaseAttrib("compressionCodec"),
+                       compressionThreads=self.getOptionalPhaseAttrib("compressionThreads", int))
         for message in messages:
             logger.info(message)
         return self.makeFollowOnPhaseJob(CactusCafPhase, "caf")
@@ -781,7 +783,10 @@ class CactusCafWrapper(CactusRecursionJob):
                           phylogenyHomologyUnitType=self.getOptionalPhaseAttrib("phylogenyHomologyUnitType"),
                           phylogenyDistanceCorrectionMethod=self.getOptionalPhaseAttrib("phylogenyDistanceCorrectionMethod"),
                           maxRecoverableChainsIterations=self.getOptionalPhaseAttrib("maxRecoverableChainsIterations", int),
-                          maxRecoverableChainLength=self.getOptionalPhaseAttrib("maxRecoverableChainLength", int))
+                          maxRecoverableChainLength=self.getOptionalPhaseAttrib("maxRecoverableChainLength", int),
+                          annealingThreads=self.getOptionalPhaseAttrib("annealingThreads", int),
+                          compressionCodec=self.getOptionalPhaseAttrib("compressionCodec"),
+                          compressionThreads=self.getOptionalPhaseAttrib("compressionThreads", int))
         for message in messages:
             logger.info(message)
 
@@ -851,6 +856,9 @@ def runBarForJob(self, fileStore=None, features=None, calculateWhichEndsToComput
                  minimumIngroupDegree=self.getOptionalPhaseAttrib("minimumIngroupDegree", int),
                  minimumOutgroupDegree=self.getOptionalPhaseAttrib("minimumOutgroupDegree", int),
                  alignAmbiguityCharacters=self.getOptionalPhaseAttrib("alignAmbiguityCharacters", bool),
+                 useLastzForAnchors=self.getOptionalPhaseAttrib("useLastzForAnchors", bool),
+                 threads=self.getOptionalPhaseAttrib("threads", int),
+                 dpMemoryLimit=self.getOptionalPhaseAttrib("dpMemoryLimit", int),
                  pruneOutStubAlignments=self.getOptionalPhaseAttrib("pruneOutStubAlignments", bool),
                  useProgressiveMerging=self.getOptionalPhaseAttrib("useProgressiveMerging", bool),
                  calculateWhichEndsToComputeSeparately=calculateWhichEndsToComputeSeparately,
@@ -860,7 +868,9 @@ def runBarForJob(self, fileStore=None, features=None, calculateWhichEndsToComput
                  ingroupCoverageFile=self.cactusWorkflowArguments.ingroupCoverageID if self.getOptionalPhaseAttrib("rescue", bool) else None,
                  minimumSizeToRescue=self.getOptionalPhaseAttrib("minimumSizeToRescue"),
                  minimumCoverageToRescue=self.getOptionalPhaseAttrib("minimumCoverageToRescue"),
-                 minimumNumberOfSpecies=self.getOptionalPhaseAttrib("minimumNumberOfSpecies", int))
+                 minimumNumberOfSpecies=self.getOptionalPhaseAttrib("minimumNumberOfSpecies", int),
+                 compressionCodec=self.getOptionalPhaseAttrib("compressionCodec"),
+                 compressionThreads=self.getOptionalPhaseAttrib("compressionThreads", int))
 
 class CactusBarWrapper(CactusRecursionJob):
     """Runs the BAR algorithm implementation.
@@ -1111,7 +1121,9 @@ class CactusReferenceWrapper(CactusRecursionJob):
                        wiggle=self.getOptionalPhaseAttrib("wiggle", float),
                        numberOfNs=self.getOptionalPhaseAttrib("numberOfNs", int),
                        minNumberOfSequencesToSupportAdjacency=self.getOptionalPhaseAttrib("minNumberOfSequencesToSupportAdjacency", int),
-                       makeScaffolds=self.getOptionalPhaseAttrib("makeScaffolds", bool))
+                       makeScaffolds=self.getOptionalPhaseAttrib("makeScaffolds", bool),
+                       compressionCodec=self.getOptionalPhaseAttrib("compressionCodec"),
+                       compressionThreads=self.getOptionalPhaseAttrib("compressionThreads", int))
 
 class CactusReferenceRecursion2(CactusRecursionJob):
     memoryPoly = [2e+09]
@@ -1321,7 +1333,8 @@ class CactusHalGeneratorUpWrapper(CactusRecursionJob):
                               referenceEventString=self.getOptionalPhaseAttrib("reference"),
                               outputFile=tmpHal,
                               showOnlySubstitutionsWithRespectToReference=\
-                              self.getOptionalPhaseAttrib("showOnlySubstitutionsWithRespectToReference", bool))
+                              self.getOptionalPhaseAttrib("showOnlySubstitutionsWithRespectToReference", bool),
+                              binary=self.getOptionalPhaseAttrib("binaryC2h", bool))
         if tmpHal:
             # At top level--have the final .c2h file
             intermediateResultsUrl = getattr(self.cactusWorkflowArguments, 'intermediateResultsUrl', None)
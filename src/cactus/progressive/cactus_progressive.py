@@ -424,7 +424,8 @@ def main():
 
     #Progressive Cactus Options
     parser.add_argument("--database", dest="database",
-                      help="Database type: tokyo_cabinet or kyoto_tycoon"
+                      help="Database type: tokyo_cabinet, log_file (an embedded single file database"
+                      " needing no server) or kyoto_tycoon"
                       " [default: %(default)s]",
                       default="kyoto_tycoon")
     parser.add_argument("--configFile", dest="configFile",
@@ -206,9 +206,19 @@ def runCactusSplitFlowersBySecondaryGrouping(flowerNames):
 #############################################
 #############################################  
 
+def compressionArgs(compressionCodec, compressionThreads):
+    """The arguments choosing how the cactus disk compresses the flowers it writes."""
+    args = []
+    if compressionCodec is not None:
+        args += ["--compressionCodec", compressionCodec]
+    if compressionThreads is not None:
+        args += ["--compressionThreads", str(compressionThreads)]
+    return args
+
 def runCactusSetup(cactusDiskDatabaseString, sequences, 
                    newickTreeString, logLevel=None, outgroupEvents=None,
-                   makeEventHeadersAlphaNumeric=False):
+                   makeEventHeadersAlphaNumeric=False,
+                   compressionCodec=None, compressionThreads=None):
     logLevel = getLogLevelString2(logLevel)
     args = ["--speciesTree", newickTreeString, "--cactusDisk", cactusDiskDatabaseString,
             "--logLevel", logLevel]
@@ -216,6 +226,7 @@ def runCactusSetup(cactusDiskDatabaseString, sequences,
         args += ["--makeEventHeadersAlphaNumeric"]
     if outgroupEvents is not None:
         args += ["--outgroupEvents", outgroupEvents]
+    args += compressionArgs(compressionCodec, compressionThreads)
     masterMessages = cactus_call(check_output=True,
                                  parameters=["cactus_setup"] + args + sequences)
 
@@ -281,6 +292,9 @@ def runCactusCaf(cactusDiskDatabaseString,
                  minimumNumberOfSpecies=None,
                  maxRecoverableChainsIterations=None,
                  maxRecoverableChainLength=None,
+                 annealingThreads=None,
+                 compressionCodec=None,
+                 compressionThreads=None,
                  phylogenyHomologyUnitType=None,
                  phylogenyDistanceCorrectionMethod=None,
                  features=None,
@@ -350,6 +364,9 @@ def runCactusCaf(cactusDiskDatabaseString,
         args += ["--phylogenyDoSplitsWithSupportHigherThanThisAllAtOnce", str(phylogenyDoSplitsWithSupportHigherThanThisAllAtOnce)]
     if numTreeBuildingThreads is not None:
         args += ["--numTreeBuildingThreads", str(numTreeBuildingThreads)]
+    if annealingThreads is not None:
+        args += ["--annealingThreads", str(annealingThreads)]
+    args += compressionArgs(compressionCodec, compressionThreads)
     if doPhylogeny:
         args += ["--phylogeny"]
     if minimumBlockDegreeToCheckSupport is not None:
@@ -441,6 +458,9 @@ def runCactusBar(cactusDiskDatabaseString, flowerNames, logLevel=None,
                  minimumIngroupDegree=None,
                  minimumOutgroupDegree=None,
                  alignAmbiguityCharacters=False,
+                 useLastzForAnchors=False,
+                 threads=None,
+                 dpMemoryLimit=None,
                  pruneOutStubAlignments=False,
                  useProgressiveMerging=False,
                  calculateWhichEndsToComputeSeparately=False,
@@ -451,6 +471,8 @@ def runCactusBar(cactusDiskDatabaseString, flowerNames, logLevel=None,
                  minimumSizeToRescue=None,
                  minimumCoverageToRescue=None,
                  minimumNumberOfSpecies=None,
+                 compressionCodec=None,
+                 compressionThreads=None,
                  jobName=None,
                  fileStore=None,
                  features=None):
@@ -485,6 +507,12 @@ def runCactusBar(cactusDiskDatabaseString, flowerNames, logLevel=None,
         args += ["--pruneOutStubAlignments"]
     if alignAmbiguityCharacters:
         args += ["--alignAmbiguityCharacters"]
+    if useLastzForAnchors:
+        args += ["--useLastzForAnchors"]
+    if threads is not None:
+        args += ["--threads", str(threads)]
+    if dpMemoryLimit is not None:
+        args += ["--dpMemoryLimit", str(dpMemoryLimit)]
     if useProgressiveMerging:
         args += ["--useProgressiveMerging"]
     if calculateWhichEndsToComputeSeparately:
@@ -506,6 +534,7 @@ def runCactusBar(cactusDiskDatabaseString, flowerNames, logLevel=None,
         args += ["--minimumCoverageToRescue", str(minimumCoverageToRescue)]
     if minimumNumberOfSpecies is not None:
         args += ["--minimumNumberOfSpecies", str(minimumNumberOfSpecies)]
+    args += compressionArgs(compressionCodec, compressionThreads)
 
     masterMessages = cactus_call(stdin_string=flowerNames, check_output=True,
                                  parameters=["cactus_bar"] + args,
@@ -531,7 +560,9 @@ def runCactusReference(cactusDiskDatabaseString, flowerNames, logLevel=None,
                        wiggle=None, 
                        numberOfNs=None,
                        minNumberOfSequencesToSupportAdjacency=None,
-                       makeScaffolds=False):
+                       makeScaffolds=False,
+                       compressionCodec=None,
+                       compressionThreads=None):
     """Runs cactus reference."""
     logLevel = getLogLevelString2(logLevel)
     args = ["--logLevel", logLevel, "--cactusDisk", cactusDiskDatabaseString]
@@ -559,6 +590,7 @@ def runCactusReference(cactusDiskDatabaseString, flowerNames, logLevel=None,
         args += ["--minNumberOfSequencesToSupportAdjacency", str(minNumberOfSequencesToSupportAdjacency)]
     if makeScaffolds:
         args += ["--makeScaffolds"]
+    args += compressionArgs(compressionCodec, compressionThreads)
 
     masterMessages = cactus_call(stdin_string=flowerNames, check_output=True,
                                  parameters=["cactus_reference"] + args,
@@ -700,6 +732,7 @@ def runCactusHalGenerator(cactusDiskDatabaseString,
                           referenceEventString, 
                           outputFile=None,
                           showOnlySubstitutionsWithRespectToReference=False,
+                          binary=False,
                           logLevel=None,
                           jobName=None,
                           features=None,
@@ -715,6 +748,8 @@ def runCactusHalGenerator(cactusDiskDatabaseString,
         args += ["--outputFile", outputFile]
     if showOnlySubstitutionsWithRespectToReference:
         args += ["--showOnlySubstitutionsWithRespectToReference"]
+    if binary:
+        args += ["--binary"]
     cactus_call(stdin_string=flowerNames,
                 parameters=["cactus_halGenerator"] + args,
                 job_name=jobName, features=features, fileStore=fileStore)
@@ -37,6 +37,12 @@ class DbElemWrapper(object):
                 raise RuntimeError("Database conf is of type tokyo cabinet but there is no nested tokyo cabinet tag: %s" % dataString)
             if not tokyoCabinet.attrib.has_key("database_dir"):
                 raise RuntimeError("The tokyo cabinet tag has no database_dir tag: %s" % dataString)
+        elif typeString == "log_file":
+            logFile = self.confElem.find("log_file")
+            if logFile == None:
+                raise RuntimeError("Database conf is of type log file but there is no nested log file tag: %s" % dataString)
+            if not logFile.attrib.has_key("database_dir"):
+                raise RuntimeError("The log file tag has no database_dir tag: %s" % dataString)
         elif typeString == "kyoto_tycoon":
             kyotoTycoon = self.confElem.find("kyoto_tycoon")
             if kyotoTycoon == None:
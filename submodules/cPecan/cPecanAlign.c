@@ -37,24 +37,16 @@ static stHash *readFastaFile(char *filename) {
 }
 
 // copied from cPecanRealign, which is sloppy.
-void *convertToAnchorPair(void *aPair, void *extraArg) {
-    stIntTuple *i = stIntTuple_construct2(stIntTuple_get(aPair, 1), stIntTuple_get(aPair, 2));
-    stIntTuple_destruct(aPair);
-    return i;
-}
-
 // copied from cPecanRealign
 struct PairwiseAlignment *convertAlignedPairsToPairwiseAlignment(char *seqName1, char *seqName2, double score,
-        int64_t length1, int64_t length2, stList *alignedPairs) {
+        int64_t length1, int64_t length2, AlignedPairBuffer *alignedPairs) {
     //Make pairwise alignment
     int64_t pX = -1, pY = -1, mL = 0;
-    //Create an end matched pair, which is used to ensure the alignment has the correct end indels.
     struct List *opList = constructEmptyList(0, (void (*)(void *)) destructAlignmentOperation);
-    stList_append(alignedPairs, stIntTuple_construct2(length1, length2));
-    for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
-        stIntTuple *alignedPair = stList_get(alignedPairs, i);
-        int64_t x = stIntTuple_get(alignedPair, 0);
-        int64_t y = stIntTuple_get(alignedPair, 1);
+    //The pair after the last, an end matched pair, is used to ensure the alignment has the correct end indels.
+    for (int64_t i = 0; i <= alignedPairBuffer_length(alignedPairs); i++) {
+        int64_t x = i < alignedPairBuffer_length(alignedPairs) ? alignedPairs->x[i] : length1;
+        int64_t y = i < alignedPairBuffer_length(alignedPairs) ? alignedPairs->y[i] : length2;
         assert(x - pX > 0);
         assert(y - pY > 0);
         if (x - pX > 0 && y - pY > 0) { //This is a hack for filtering
@@ -81,7 +73,6 @@ struct PairwiseAlignment *convertAlignedPairsToPairwiseAlignment(char *seqName1,
     if (mL > 1) {
         listAppend(opList, constructAlignmentOperation(PAIRWISE_MATCH, mL - 1, 0));
     }
-    stIntTuple_destruct(stList_pop(alignedPairs));
     //Construct the alignment
     struct PairwiseAlignment *pA = constructPairwiseAlignment(seqName1, 0, length1, 1, seqName2, 0, length2, 1, score,
             opList);
@@ -119,36 +110,34 @@ int main(int argc, char *argv[]) {
 
             // Aligns the sequences.
             // If you have alignment constraints (anchors) you should
-            // replace this with getAlignedPairsUsingAnchors.
-            stList *alignedPairs = getAlignedPairs(stateMachine, targetSeq,
-                                                   querySeq, parameters,
-                                                   true, true);
+            // replace this with getAlignedPairBufferUsingAnchors.
+            AlignedPairBuffer *alignedPairs = getAlignedPairBuffer(stateMachine, targetSeq,
+                                                                   querySeq, parameters,
+                                                                   true, true);
             // Takes into account the probability of aligning to a
             // gap, by transforming the posterior probability into the
             // AMAP objective function (see Schwartz & Pachter, 2007).
-            alignedPairs = reweightAlignedPairs2(alignedPairs, strlen(targetSeq),
-                                                 strlen(querySeq),
-                                                 parameters->gapGamma);
+            reweightAlignedPairBuffer(alignedPairs, strlen(targetSeq),
+                                      strlen(querySeq),
+                                      parameters->gapGamma);
             // I think this calculates the optimal ordered set of
             // alignments from the unordered set of aligned pairs, not
             // completely sure.
-            alignedPairs = filterPairwiseAlignmentToMakePairsOrdered(alignedPairs,
-                                                                     targetSeq,
-                                                                     querySeq,
-                                                                     // This parameter says that the minimum posterior probability we will accept has to be at least 0.9.
-                                                                     0.9);
-
-            // After this the "aligned pairs" data structure changes,
-            // which is a little sketchy. It's just so that the
+            filterAlignedPairBufferToMakePairsOrdered(alignedPairs,
+                                                      targetSeq,
+                                                      querySeq,
+                                                      // This parameter says that the minimum posterior probability we will accept has to be at least 0.9.
+                                                      0.9);
+
+            // Orders the pairs by coordinate, so that the
             // alignment can be printed properly.
-            stList_mapReplace(alignedPairs, convertToAnchorPair, NULL);
-            stList_sort(alignedPairs, (int (*)(const void *, const void *)) stIntTuple_cmpFn);
+            alignedPairBuffer_sort(alignedPairs);
             struct PairwiseAlignment *alignment = convertAlignedPairsToPairwiseAlignment(targetHeader, queryHeader,
                                                                                   0, strlen(targetSeq), strlen(querySeq), alignedPairs);
             // Output the cigar string
             cigarWrite(stdout, alignment, 0);
 
-            stList_destruct(alignedPairs);
+            alignedPairBuffer_destruct(alignedPairs);
             destructPairwiseAlignment(alignment);
         }
         stHash_destructIterator(targetIt);
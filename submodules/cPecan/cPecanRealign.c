@@ -48,16 +48,14 @@ void usage() {
 }
 
 struct PairwiseAlignment *convertAlignedPairsToPairwiseAlignment(char *seqName1, char *seqName2, double score,
-        int64_t length1, int64_t length2, stList *alignedPairs) {
+        int64_t length1, int64_t length2, AlignedPairBuffer *alignedPairs) {
     //Make pairwise alignment
     int64_t pX = -1, pY = -1, mL = 0;
-    //Create an end matched pair, which is used to ensure the alignment has the correct end indels.
     struct List *opList = constructEmptyList(0, (void (*)(void *)) destructAlignmentOperation);
-    stList_append(alignedPairs, stIntTuple_construct2(length1, length2));
-    for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
-        stIntTuple *alignedPair = stList_get(alignedPairs, i);
-        int64_t x = stIntTuple_get(alignedPair, 0);
-        int64_t y = stIntTuple_get(alignedPair, 1);
+    //The pair after the last, an end matched pair, is used to ensure the alignment has the correct end indels.
+    for (int64_t i = 0; i <= alignedPairBuffer_length(alignedPairs); i++) {
+        int64_t x = i < alignedPairBuffer_length(alignedPairs) ? alignedPairs->x[i] : length1;
+        int64_t y = i < alignedPairBuffer_length(alignedPairs) ? alignedPairs->y[i] : length2;
         assert(x - pX > 0);
         assert(y - pY > 0);
         if (x - pX > 0 && y - pY > 0) { //This is a hack for filtering
@@ -84,7 +82,6 @@ struct PairwiseAlignment *convertAlignedPairsToPairwiseAlignment(char *seqName1,
     if (mL > 1) {
         listAppend(opList, constructAlignmentOperation(PAIRWISE_MATCH, mL - 1, 0));
     }
-    stIntTuple_destruct(stList_pop(alignedPairs));
     //Construct the alignment
     struct PairwiseAlignment *pA = constructPairwiseAlignment(seqName1, 0, length1, 1, seqName2, 0, length2, 1, score,
             opList);
@@ -268,12 +265,6 @@ void addToSequencesHash(const char *header, const char *sequence, int64_t length
     stList_destruct(tokens);
 }
 
-void *convertToAnchorPair(void *aPair, void *extraArg) {
-    stIntTuple *i = stIntTuple_construct2(stIntTuple_get(aPair, 1), stIntTuple_get(aPair, 2));
-    stIntTuple_destruct(aPair);
-    return i;
-}
-
 bool matchFn(void *aPair, void *seqs) {
     char x = toupper(((char **) seqs)[0][stIntTuple_get(aPair, 0)]);
     char y = toupper(((char **) seqs)[1][stIntTuple_get(aPair, 1)]);
@@ -292,20 +283,19 @@ bool gapGammaFilter(void *aPair, void *gapGamma) {
  * Functions to rescore an alignment by identity / or some proxy to it.
  */
 
-static int64_t getNumberOfMatchingAlignedPairs(char *subSeqX, char *subSeqY, stList *alignedPairs) {
+static int64_t getNumberOfMatchingAlignedPairs(char *subSeqX, char *subSeqY, AlignedPairBuffer *alignedPairs) {
     /*
      * Gives the average identity of matches in the alignment, treating indels as mismatches.
      */
     int64_t matches = 0;
-    for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
-        stIntTuple *aPair = stList_get(alignedPairs, i);
-        int64_t x = stIntTuple_get(aPair, 1), y = stIntTuple_get(aPair, 2);
+    for (int64_t i = 0; i < alignedPairBuffer_length(alignedPairs); i++) {
+        int64_t x = alignedPairs->x[i], y = alignedPairs->y[i];
         matches += toupper(subSeqX[x]) == toupper(subSeqY[y]) && toupper(subSeqX[x]) != 'N';
     }
     return matches;
 }
 
-double scoreByIdentity(char *subSeqX, char *subSeqY, int64_t lX, int64_t lY, stList *alignedPairs) {
+double scoreByIdentity(char *subSeqX, char *subSeqY, int64_t lX, int64_t lY, AlignedPairBuffer *alignedPairs) {
     /*
      * Gives the average identity of matches in the alignment, treating indels as mismatches.
      */
@@ -313,35 +303,26 @@ double scoreByIdentity(char *subSeqX, char *subSeqY, int64_t lX, int64_t lY, stL
     return 100.0 * ((lX + lY) == 0 ? 0 : (2.0 * matches) / (lX + lY));
 }
 
-double scoreByIdentityIgnoringGaps(char *subSeqX, char *subSeqY, stList *alignedPairs) {
+double scoreByIdentityIgnoringGaps(char *subSeqX, char *subSeqY, AlignedPairBuffer *alignedPairs) {
     /*
      * Gives the average identity of matches in the alignment, ignoring indels.
      */
     int64_t matches = getNumberOfMatchingAlignedPairs(subSeqX, subSeqY, alignedPairs);
-    return 100.0 * matches / (double) stList_length(alignedPairs);
-}
-
-static double totalScore(stList *alignedPairs) {
-    double score = 0.0;
-    for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
-        stIntTuple *aPair = stList_get(alignedPairs, i);
-        score += stIntTuple_get(aPair, 0);
-    }
-    return score;
+    return 100.0 * matches / (double) alignedPairBuffer_length(alignedPairs);
 }
 
-double scoreByPosteriorProbability(int64_t lX, int64_t lY, stList *alignedPairs) {
+double scoreByPosteriorProbability(int64_t lX, int64_t lY, AlignedPairBuffer *alignedPairs) {
     /*
      * Gives the average posterior match probability per base of the two sequences, treating bases in indels as having 0 match probability.
      */
-    return 100.0 * ((lX + lY) == 0 ? 0 : (2.0 * totalScore(alignedPairs)) / ((lX + lY) * PAIR_ALIGNMENT_PROB_1));
+    return 100.0 * ((lX + lY) == 0 ? 0 : (2.0 * (double) alignedPairBuffer_getTotalScore(alignedPairs)) / ((lX + lY) * PAIR_ALIGNMENT_PROB_1));
 }
 
-double scoreByPosteriorProbabilityIgnoringGaps(stList *alignedPairs) {
+double scoreByPosteriorProbabilityIgnoringGaps(AlignedPairBuffer *alignedPairs) {
     /*
      * Gives the average posterior match probability per base of the two sequences, ignoring indels.
      */
-    return 100.0 * totalScore(alignedPairs) / ((double) stList_length(alignedPairs) * PAIR_ALIGNMENT_PROB_1);
+    return 100.0 * (double) alignedPairBuffer_getTotalScore(alignedPairs) / ((double) alignedPairBuffer_length(alignedPairs) * PAIR_ALIGNMENT_PROB_1);
 }
 
 int64_t transformCoordinate(int64_t coordinate, int64_t coordinateShift, bool flipStrand, int64_t seqLength) {
@@ -352,38 +333,36 @@ int64_t transformCoordinate(int64_t coordinate, int64_t coordinateShift, bool fl
     return i;
 }
 
-void writePosteriorProbs(char *posteriorProbsFile, stList *alignedPairs,
+void writePosteriorProbs(char *posteriorProbsFile, AlignedPairBuffer *alignedPairs,
         int64_t coordinateShift1, bool flipStrand1, int64_t seq1Length,
         int64_t coordinateShift2, bool flipStrand2, int64_t seq2Length) {
     /*
      * Writes the posterior match probabibilities to a tab separated file, each line being X coordinate, Y coordinate, Match probability
      */
     FILE *fH = fopen(posteriorProbsFile, "w");
-    for(int64_t i=0;i<stList_length(alignedPairs); i++) {
-        stIntTuple *aPair = stList_get(alignedPairs, i);
+    for(int64_t i=0;i<alignedPairBuffer_length(alignedPairs); i++) {
         fprintf(fH, "%" PRIi64 "\t%" PRIi64 "\t%f\n",
-                transformCoordinate(stIntTuple_get(aPair, 1),
+                transformCoordinate(alignedPairs->x[i],
                         coordinateShift1, flipStrand1, seq1Length),
-                transformCoordinate(stIntTuple_get(aPair, 2),
+                transformCoordinate(alignedPairs->y[i],
                         coordinateShift2, flipStrand2, seq2Length),
-                ((double)stIntTuple_get(aPair, 0))/PAIR_ALIGNMENT_PROB_1);
+                ((double)alignedPairs->scores[i])/PAIR_ALIGNMENT_PROB_1);
     }
     fclose(fH);
 }
 
-stList *scoreAnchorPairs(stList *anchorPairs, stList *alignedPairs) {
+AlignedPairBuffer *scoreAnchorPairs(stList *anchorPairs, AlignedPairBuffer *alignedPairs) {
     /*
      * Selects the aligned pairs contained in anchor pairs.
      */
     stSortedSet *anchorPairsSet = stList_getSortedSet(anchorPairs, (int (*)(const void *, const void *))stIntTuple_cmpFn);
     assert(stList_length(anchorPairs) == stSortedSet_size(anchorPairsSet));
-    stList *scoredAnchorPairs = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    AlignedPairBuffer *scoredAnchorPairs = alignedPairBuffer_construct(stList_length(anchorPairs));
 
-    for(int64_t i=0; i<stList_length(alignedPairs); i++) {
-        stIntTuple *aPair = stList_get(alignedPairs, i);
-        stIntTuple *j = stIntTuple_construct2(stIntTuple_get(aPair, 1), stIntTuple_get(aPair, 2));
+    for(int64_t i=0; i<alignedPairBuffer_length(alignedPairs); i++) {
+        stIntTuple *j = stIntTuple_construct2(alignedPairs->x[i], alignedPairs->y[i]);
         if(stSortedSet_search(anchorPairsSet, j) != NULL) {
-            stList_append(scoredAnchorPairs, stIntTuple_construct3(stIntTuple_get(aPair, 0), stIntTuple_get(aPair, 1), stIntTuple_get(aPair, 2)));
+            alignedPairBuffer_append(scoredAnchorPairs, alignedPairs->scores[i], alignedPairs->x[i], alignedPairs->y[i]);
             stSortedSet_remove(anchorPairsSet, j);
         }
         stIntTuple_destruct(j);
@@ -393,12 +372,12 @@ stList *scoreAnchorPairs(stList *anchorPairs, stList *alignedPairs) {
     stSortedSetIterator *it = stSortedSet_getIterator(anchorPairsSet);
     stIntTuple *pair;
     while((pair = stSortedSet_getNext(it))) {
-        stList_append(scoredAnchorPairs, stIntTuple_construct3(0, stIntTuple_get(pair, 0), stIntTuple_get(pair, 1)));
+        alignedPairBuffer_append(scoredAnchorPairs, 0, stIntTuple_get(pair, 0), stIntTuple_get(pair, 1));
     }
     stSortedSet_destructIterator(it);
 
     stSortedSet_destruct(anchorPairsSet);
-    assert(stList_length(anchorPairs) == stList_length(scoredAnchorPairs));
+    assert(stList_length(anchorPairs) == alignedPairBuffer_length(scoredAnchorPairs));
 
     return scoredAnchorPairs;
 }
@@ -562,7 +541,8 @@ int main(int argc, char *argv[]) {
     struct PairwiseAlignment *pA;
     FILE *fileHandleIn = stdin;
     FILE *fileHandleOut = stdout;
-    while ((pA = cigarRead(fileHandleIn)) != NULL) {
+    stPairwiseAlignmentReader *reader = stPairwiseAlignmentReader_construct(fileHandleIn);
+    while ((pA = stPairwiseAlignmentReader_read(reader)) != NULL) {
         st_logInfo("Processing alignment for sequences: %s and %s\n", pA->contig1, pA->contig2);
         //Get sequences
         char *seqX = stHash_search(sequences, pA->contig1);
@@ -590,7 +570,7 @@ int main(int argc, char *argv[]) {
         }
         else {
             //Get posterior prob pairs
-            stList *alignedPairs = getAlignedPairsUsingAnchors(sM, subSeqX, subSeqY, filteredAnchoredPairs,
+            AlignedPairBuffer *alignedPairs = getAlignedPairBufferUsingAnchors(sM, subSeqX, subSeqY, filteredAnchoredPairs,
                     pairwiseAlignmentBandingParameters, 1, 1);
             //Output all the posterior match probs, if needed
             if(allPosteriorProbsFile != NULL) {
@@ -600,13 +580,13 @@ int main(int argc, char *argv[]) {
             }
             //Convert to partial ordered set of pairs
             if (rescoreOriginalAlignment) {
-                stList *rescoredPairs = scoreAnchorPairs(anchorPairs, alignedPairs);
-                stList_destruct(alignedPairs);
+                AlignedPairBuffer *rescoredPairs = scoreAnchorPairs(anchorPairs, alignedPairs);
+                alignedPairBuffer_destruct(alignedPairs);
                 alignedPairs = rescoredPairs;
             } else { //Shouldn't be needed if we only take pairs with > 50% posterior prob
                 //Modify to account for gaps
-                alignedPairs = reweightAlignedPairs2(alignedPairs, strlen(subSeqX), strlen(subSeqY), pairwiseAlignmentBandingParameters->gapGamma); //gapGamma);
-                alignedPairs = filterPairwiseAlignmentToMakePairsOrdered(alignedPairs, subSeqX, subSeqY, matchGamma); //gapGamma);
+                reweightAlignedPairBuffer(alignedPairs, strlen(subSeqX), strlen(subSeqY), pairwiseAlignmentBandingParameters->gapGamma); //gapGamma);
+                filterAlignedPairBufferToMakePairsOrdered(alignedPairs, subSeqX, subSeqY, matchGamma); //gapGamma);
             }
             //Rescore
             if (rescoreByPosteriorProbability) {
@@ -624,9 +604,8 @@ int main(int argc, char *argv[]) {
                                     coordinateShift1, flipStrand1, pA->end1-pA->start1,
                                     coordinateShift2, flipStrand2, pA->end2-pA->start2);
             }
-            //Convert to ordered list of sequence coordinate pairs
-            stList_mapReplace(alignedPairs, convertToAnchorPair, NULL);
-            stList_sort(alignedPairs, (int (*)(const void *, const void *)) stIntTuple_cmpFn); //Ensure we have an monotonically increasing ordering
+            //Order by sequence coordinates
+            alignedPairBuffer_sort(alignedPairs); //Ensure we have an monotonically increasing ordering
             //Convert back to cigar
             struct PairwiseAlignment *rPA = convertAlignedPairsToPairwiseAlignment(pA->contig1, pA->contig2, pA->score,
                     pA->end1, pA->end2, alignedPairs);
@@ -650,7 +629,7 @@ int main(int argc, char *argv[]) {
             }
 
             //Clean up
-            stList_destruct(alignedPairs);
+            alignedPairBuffer_destruct(alignedPairs);
             destructPairwiseAlignment(rPA);
         }
         destructPairwiseAlignment(pA);
@@ -659,6 +638,7 @@ int main(int argc, char *argv[]) {
         free(subSeqX);
         free(subSeqY);
     }
+    stPairwiseAlignmentReader_destruct(reader);
     stHash_destruct(sequences);
 
     if(expectationsFile != NULL) {
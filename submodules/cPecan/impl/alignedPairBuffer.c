@@ -0,0 +1,112 @@
+/*
+ * alignedPairBuffer.c
+ *
+ *  Packed storage for the aligned pairs computed by the pairwise aligner.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sonLib.h"
+#include "alignedPairBuffer.h"
+
+AlignedPairBuffer *alignedPairBuffer_construct(int64_t maxLength) {
+    AlignedPairBuffer *buffer = st_calloc(1, sizeof(AlignedPairBuffer));
+    alignedPairBuffer_reserve(buffer, maxLength);
+    return buffer;
+}
+
+void alignedPairBuffer_destruct(AlignedPairBuffer *buffer) {
+    free(buffer->scores);
+    free(buffer);
+}
+
+void alignedPairBuffer_reserve(AlignedPairBuffer *buffer, int64_t maxLength) {
+    if (maxLength <= buffer->maxLength) {
+        return;
+    }
+    //The three arrays live in one block, scores first, so the block is freed through the scores pointer.
+    int64_t *block = st_malloc(3 * sizeof(int64_t) * (maxLength > 0 ? maxLength : 1));
+    if (buffer->length > 0) {
+        memcpy(block, buffer->scores, sizeof(int64_t) * buffer->length);
+        memcpy(block + maxLength, buffer->x, sizeof(int64_t) * buffer->length);
+        memcpy(block + 2 * maxLength, buffer->y, sizeof(int64_t) * buffer->length);
+    }
+    free(buffer->scores);
+    buffer->scores = block;
+    buffer->x = block + maxLength;
+    buffer->y = block + 2 * maxLength;
+    buffer->maxLength = maxLength;
+}
+
+void alignedPairBuffer_shift(AlignedPairBuffer *buffer, int64_t start, int64_t offsetX, int64_t offsetY) {
+    for (int64_t i = start; i < buffer->length; i++) {
+        buffer->x[i] += offsetX;
+        buffer->y[i] += offsetY;
+    }
+}
+
+typedef struct _packedAlignedPair {
+    int64_t x;
+    int64_t y;
+    int64_t score;
+} PackedAlignedPair;
+
+static int packedAlignedPair_cmp(const void *a, const void *b) {
+    const PackedAlignedPair *i = a, *j = b;
+    if (i->x != j->x) {
+        return i->x < j->x ? -1 : 1;
+    }
+    if (i->y != j->y) {
+        return i->y < j->y ? -1 : 1;
+    }
+    return i->score < j->score ? -1 : (i->score > j->score ? 1 : 0);
+}
+
+void alignedPairBuffer_sort(AlignedPairBuffer *buffer) {
+    /*
+     * The pairs are gathered into a temporary array of structs so that qsort moves each pair as a unit.
+     */
+    PackedAlignedPair *pairs = st_malloc(sizeof(PackedAlignedPair) * (buffer->length > 0 ? buffer->length : 1));
+    for (int64_t i = 0; i < buffer->length; i++) {
+        pairs[i].x = buffer->x[i];
+        pairs[i].y = buffer->y[i];
+        pairs[i].score = buffer->scores[i];
+    }
+    qsort(pairs, buffer->length, sizeof(PackedAlignedPair), packedAlignedPair_cmp);
+    for (int64_t i = 0; i < buffer->length; i++) {
+        buffer->x[i] = pairs[i].x;
+        buffer->y[i] = pairs[i].y;
+        buffer->scores[i] = pairs[i].score;
+    }
+    free(pairs);
+}
+
+void alignedPairBuffer_filter(AlignedPairBuffer *buffer, bool (*fn)(int64_t score, int64_t x, int64_t y, void *extraArg),
+        void *extraArg) {
+    int64_t j = 0;
+    for (int64_t i = 0; i < buffer->length; i++) {
+        if (fn(buffer->scores[i], buffer->x[i], buffer->y[i], extraArg)) {
+            buffer->scores[j] = buffer->scores[i];
+            buffer->x[j] = buffer->x[i];
+            buffer->y[j++] = buffer->y[i];
+        }
+    }
+    buffer->length = j;
+}
+
+int64_t alignedPairBuffer_getTotalScore(AlignedPairBuffer *buffer) {
+    int64_t totalScore = 0;
+    for (int64_t i = 0; i < buffer->length; i++) {
+        totalScore += buffer->scores[i];
+    }
+    return totalScore;
+}
+
+stList *alignedPairBuffer_getList(AlignedPairBuffer *buffer) {
+    stList *alignedPairs = stList_construct3(buffer->length, (void (*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < buffer->length; i++) {
+        stList_set(alignedPairs, i, stIntTuple_construct3(buffer->scores[i], buffer->x[i], buffer->y[i]));
+    }
+    return alignedPairs;
+}
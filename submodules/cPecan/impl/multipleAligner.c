@@ -566,12 +566,10 @@ static Column *getColumn2(stHash *columns, int64_t seq, int64_t pos) {
     return stHash_search(columns, &c);
 }
 
-stList *filterMultipleAlignedPairs(stSet *columns, stList *multipleAlignedPairs) {
+static stHash *getPositionsToColumns(stSet *columns) {
     /*
-     * Processes the list of multipleAlignedPairs and places those that align pairs within the same column in a list which is
-     * returned. Pairs that do not make the list are cleaned up, as is the input list.
+     * Builds a hash of positions to the columns containing them.
      */
-    //Build hash of positions to columns
     stSetIterator *it = stSet_getIterator(columns);
     Column *c;
     stHash *positionsToColumns = stHash_construct3((uint64_t(*)(const void *)) column_hashFn,
@@ -584,6 +582,15 @@ stList *filterMultipleAlignedPairs(stSet *columns, stList *multipleAlignedPairs)
         } while (c2 != NULL);
     }
     stSet_destructIterator(it);
+    return positionsToColumns;
+}
+
+stList *filterMultipleAlignedPairs(stSet *columns, stList *multipleAlignedPairs) {
+    /*
+     * Processes the list of multipleAlignedPairs and places those that align pairs within the same column in a list which is
+     * returned. Pairs that do not make the list are cleaned up, as is the input list.
+     */
+    stHash *positionsToColumns = getPositionsToColumns(columns);
     //Now walk through pairs
     stList *filteredMultipleAlignedPairs = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
     while (stList_length(multipleAlignedPairs) > 0) {
@@ -601,15 +608,11 @@ stList *filterMultipleAlignedPairs(stSet *columns, stList *multipleAlignedPairs)
     return filteredMultipleAlignedPairs;
 }
 
-static int64_t getAlignmentScore(stList *alignedPairs, int64_t seqLength1, int64_t seqLength2) {
+static int64_t getAlignmentScore(AlignedPairBuffer *alignedPairs, int64_t seqLength1, int64_t seqLength2) {
     /*
      * Gets the normalised average posterior probability that a position in the shorter of the two sequences is aligned to a match.
      */
-    int64_t alignmentScore = 0;
-    for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
-        stIntTuple *alignedPair = stList_get(alignedPairs, i);
-        alignmentScore += stIntTuple_get(alignedPair, 0);
-    }
+    int64_t alignmentScore = alignedPairBuffer_getTotalScore(alignedPairs);
     int64_t j = seqLength1 < seqLength2 ? seqLength1 : seqLength2;
     j = j == 0 ? 1 : j;
     double d = (double) alignmentScore / (j * PAIR_ALIGNMENT_PROB_1);
@@ -633,6 +636,17 @@ static void convertAlignedPairsToMultipleAlignedPairs(stList *alignedPairs, stLi
     stList_destruct(alignedPairs);
 }
 
+static void convertAlignedPairBufferToMultipleAlignedPairs(AlignedPairBuffer *alignedPairs, stList *multipleAlignedPairs,
+        int64_t sequence1, int64_t sequence2) {
+    /*
+     * As convertAlignedPairsToMultipleAlignedPairs, but from a buffer of pairs, which is left unchanged.
+     */
+    for (int64_t i = 0; i < alignedPairs->length; i++) {
+        stList_append(multipleAlignedPairs, stIntTuple_construct5(alignedPairs->scores[i],
+                sequence1, alignedPairs->x[i], sequence2, alignedPairs->y[i]));
+    }
+}
+
 static stList *convertMultipleAlignedPairsToAlignedPairs(stList *multipleAlignedPairs) {
     /*
      * Converts multiple alignment matches to pairs without sequence indices, destroying the old multiple pairs in the process.
@@ -657,26 +671,87 @@ static int64_t addMultipleAlignedPairs(StateMachine *sM, int64_t sequence1, int6
      */
     SeqFrag *seqFrag1 = stList_get(seqFrags, sequence1);
     SeqFrag *seqFrag2 = stList_get(seqFrags, sequence2);
-    stList *alignedPairs = getAlignedPairs(sM, seqFrag1->seq, seqFrag2->seq, pairwiseAlignmentBandingParameters,
+    AlignedPairBuffer *alignedPairs = getAlignedPairBuffer(sM, seqFrag1->seq, seqFrag2->seq, pairwiseAlignmentBandingParameters,
             seqFrag1->leftEndId != seqFrag2->leftEndId, seqFrag1->rightEndId != seqFrag2->rightEndId);
-    alignedPairs = reweightAlignedPairs2(alignedPairs, seqFrag1->length, seqFrag2->length, pairwiseAlignmentBandingParameters->gapGamma);
+    reweightAlignedPairBuffer(alignedPairs, seqFrag1->length, seqFrag2->length, pairwiseAlignmentBandingParameters->gapGamma);
     int64_t distance = getAlignmentScore(alignedPairs, seqFrag1->length, seqFrag2->length);
-    convertAlignedPairsToMultipleAlignedPairs(alignedPairs, multipleAlignedPairs, sequence1, sequence2);
+    convertAlignedPairBufferToMultipleAlignedPairs(alignedPairs, multipleAlignedPairs, sequence1, sequence2);
+    alignedPairBuffer_destruct(alignedPairs);
     return distance;
 }
 
+typedef struct _pairwiseAlignmentJob {
+    StateMachine *sM;
+    stList *seqFrags;
+    PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters;
+    int64_t sequence1;
+    int64_t sequence2;
+    stList *multipleAlignedPairs;
+    int64_t score;
+} PairwiseAlignmentJob;
+
+static void *pairwiseAlignmentJob_run(PairwiseAlignmentJob *job) {
+    job->multipleAlignedPairs = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    job->score = addMultipleAlignedPairs(job->sM, job->sequence1, job->sequence2, job->seqFrags, job->multipleAlignedPairs,
+            job->pairwiseAlignmentBandingParameters);
+    return job;
+}
+
+static void addMultipleAlignedPairsForPairs(StateMachine *sM, stList *pairsToAlign, stList *seqFrags, stList *multipleAlignedPairs,
+        stList *seqPairSimilarityScores, PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
+    /*
+     * Computes the pairwise alignments of a list of pairs of sequences, adding the aligned pairs and a (score, seq1, seq2)
+     * tuple for each pair, in the order of the list. If the parameters allow more than one thread the alignments are
+     * computed concurrently, the results being added in the same order, so the output does not depend on the number of threads.
+     */
+    int64_t jobNumber = stList_length(pairsToAlign);
+    PairwiseAlignmentJob *jobs = st_malloc(sizeof(PairwiseAlignmentJob) * jobNumber);
+    for (int64_t i = 0; i < jobNumber; i++) {
+        stIntTuple *pairToAlign = stList_get(pairsToAlign, i);
+        PairwiseAlignmentJob job = { sM, seqFrags, pairwiseAlignmentBandingParameters,
+                stIntTuple_get(pairToAlign, 0), stIntTuple_get(pairToAlign, 1), NULL, 0 };
+        jobs[i] = job;
+    }
+    int64_t numThreads = pairwiseAlignmentBandingParameters->numThreads;
+    if (numThreads > 1 && jobNumber > 1) {
+        stThreadPool *threadPool = stThreadPool_construct(numThreads < jobNumber ? numThreads : jobNumber,
+                (void *(*)(void *)) pairwiseAlignmentJob_run, NULL);
+        for (int64_t i = jobNumber - 1; i >= 0; i--) { //The work is taken from a stack, so push in reverse
+            stThreadPool_push(threadPool, &jobs[i]);
+        }
+        stThreadPool_wait(threadPool);
+        stThreadPool_destruct(threadPool);
+    } else {
+        for (int64_t i = 0; i < jobNumber; i++) {
+            pairwiseAlignmentJob_run(&jobs[i]);
+        }
+    }
+    for (int64_t i = 0; i < jobNumber; i++) {
+        PairwiseAlignmentJob *job = &jobs[i];
+        stList_appendAll(multipleAlignedPairs, job->multipleAlignedPairs);
+        stList_setDestructor(job->multipleAlignedPairs, NULL);
+        stList_destruct(job->multipleAlignedPairs);
+        stList_append(seqPairSimilarityScores, stIntTuple_construct3(job->score, job->sequence1, job->sequence2));
+    }
+    free(jobs);
+}
+
 stList *makeAllPairwiseAlignments(StateMachine *sM, stList *seqFrags, PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, stList **seqPairSimilarityScores) {
     /*
      * Generate the set of pairwise alignments between the sequences.
      */
     *seqPairSimilarityScores = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
     stList *multipleAlignedPairs = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    stList *pairsToAlign = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
     int64_t seqNo = stList_length(seqFrags);
     for (int64_t seq1 = 0; seq1 < seqNo; seq1++) {
         for (int64_t seq2 = seq1 + 1; seq2 < seqNo; seq2++) {
-            stList_append(*seqPairSimilarityScores, stIntTuple_construct3(addMultipleAlignedPairs(sM, seq1, seq2, seqFrags, multipleAlignedPairs, pairwiseAlignmentBandingParameters), seq1, seq2));
+            stList_append(pairsToAlign, stIntTuple_construct2(seq1, seq2));
         }
     }
+    addMultipleAlignedPairsForPairs(sM, pairsToAlign, seqFrags, multipleAlignedPairs, *seqPairSimilarityScores,
+            pairwiseAlignmentBandingParameters);
+    stList_destruct(pairsToAlign);
     return multipleAlignedPairs;
 }
 
@@ -897,18 +972,12 @@ MultipleAlignment *makeAlignment(StateMachine *sM, stList *seqFrags, int64_t spa
     MultipleAlignment *mA = st_calloc(1, sizeof(MultipleAlignment));
     mA->alignedPairs = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct); //pairwise alignment pairs, with sequence indices
     stSortedSet *chosenPairwiseAlignmentsSet = getReferencePairwiseAlignments2(seqFrags);
-    stSortedSetIterator *pairIt = stSortedSet_getIterator(chosenPairwiseAlignmentsSet);
-    stIntTuple *pairToAlign;
+    stList *pairsToAlign = stSortedSet_getList(chosenPairwiseAlignmentsSet);
     mA->chosenPairwiseAlignments = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
-    while ((pairToAlign = stSortedSet_getNext(pairIt)) != NULL) {
-        int64_t seqX = stIntTuple_get(pairToAlign, 0);
-        int64_t seqY = stIntTuple_get(pairToAlign, 1);
-        //We get pairwise alignments, for this first alignment we filter the pairs greedily to make them consistent
-        stList_append(mA->chosenPairwiseAlignments, stIntTuple_construct3(addMultipleAlignedPairs(sM, seqX, seqY, seqFrags,
-                mA->alignedPairs, pairwiseAlignmentBandingParameters),
-                seqX, seqY));
-    }
-    stSortedSet_destructIterator(pairIt);
+    //We get pairwise alignments, for this first alignment we filter the pairs greedily to make them consistent
+    addMultipleAlignedPairsForPairs(sM, pairsToAlign, seqFrags, mA->alignedPairs, mA->chosenPairwiseAlignments,
+            pairwiseAlignmentBandingParameters);
+    stList_destruct(pairsToAlign);
 
     int64_t iteration = 0;
     //The first alignment of multiple aligned pairs is already consistent
@@ -923,16 +992,21 @@ MultipleAlignment *makeAlignment(StateMachine *sM, stList *seqFrags, int64_t spa
         }
         int64_t *distanceCounts = getDistanceMatrix(mA->columns, seqFrags, maxPairsToConsider);
         stSet_destruct(mA->columns);
+        //Choose the pairs to add, which only depends on the previous choices, then align them
+        stList *pairsToAlign = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
         for (int64_t seq = 0; seq < stList_length(seqFrags); seq++) {
             int64_t otherSeq = getNextBestPair(seq, distanceCounts, seqNo, chosenPairwiseAlignmentsSet);
             if (otherSeq != INT64_MAX) {
                 assert(seq != otherSeq);
                 stIntTuple *pairToAlign = makePairToAlign(seq, otherSeq);
                 assert(stSortedSet_search(chosenPairwiseAlignmentsSet, pairToAlign) == NULL);
-                stList_append(mA->chosenPairwiseAlignments, stIntTuple_construct3(addMultipleAlignedPairs(sM, seq, otherSeq, seqFrags, mA->alignedPairs, pairwiseAlignmentBandingParameters), seq, otherSeq));
+                stList_append(pairsToAlign, stIntTuple_construct2(seq, otherSeq));
                 stSortedSet_insert(chosenPairwiseAlignmentsSet, pairToAlign);
             }
         }
+        addMultipleAlignedPairsForPairs(sM, pairsToAlign, seqFrags, mA->alignedPairs, mA->chosenPairwiseAlignments,
+                pairwiseAlignmentBandingParameters);
+        stList_destruct(pairsToAlign);
         free(distanceCounts);
     }
     return NULL;
@@ -969,3 +1043,31 @@ stList *filterPairwiseAlignmentToMakePairsOrdered(stList *alignedPairs, const ch
     return alignedPairs;
 }
 
+static bool pairIsInOneColumn(int64_t score, int64_t x, int64_t y, void *positionsToColumns) {
+    return getColumn2(positionsToColumns, 0, x) == getColumn2(positionsToColumns, 1, y);
+}
+
+void filterAlignedPairBufferToMakePairsOrdered(AlignedPairBuffer *alignedPairs, const char *seqX, const char *seqY, float matchGamma) {
+    //Convert to multiple alignment pairs
+    stList *multipleAlignedPairs = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    convertAlignedPairBufferToMultipleAlignedPairs(alignedPairs, multipleAlignedPairs, 0, 1);
+
+    //Calculate optimum alignment
+    stList *seqFrags = stList_construct3(0, (void(*)(void *)) seqFrag_destruct);
+    stList_append(seqFrags, seqFrag_construct(seqX, 0, 0));
+    stList_append(seqFrags, seqFrag_construct(seqY, 0, 0));
+    stList *seqPairSimilarityScores = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    stList_append(seqPairSimilarityScores, stIntTuple_construct3(0.0, 0, 1));
+    stSet *columns = getMultipleSequenceAlignmentProgressive(seqFrags, multipleAlignedPairs, matchGamma, seqPairSimilarityScores);
+    stList_destruct(multipleAlignedPairs);
+
+    //Now filter the pairs in place to get those consistent with the alignment
+    stHash *positionsToColumns = getPositionsToColumns(columns);
+    alignedPairBuffer_filter(alignedPairs, pairIsInOneColumn, positionsToColumns);
+
+    //Cleanup
+    stHash_destruct(positionsToColumns);
+    stSet_destruct(columns);
+    stList_destruct(seqFrags);
+    stList_destruct(seqPairSimilarityScores);
+}
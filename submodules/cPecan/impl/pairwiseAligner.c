@@ -464,6 +464,7 @@ struct _dpMatrix {
     DpDiagonal **diagonals;
     int64_t diagonalNumber;
     int64_t activeDiagonals;
+    int64_t activeCells;
     int64_t stateNumber;
 };
 
@@ -473,6 +474,7 @@ DpMatrix *dpMatrix_construct(int64_t diagonalNumber, int64_t stateNumber) {
     dpMatrix->diagonalNumber = diagonalNumber;
     dpMatrix->diagonals = st_calloc(dpMatrix->diagonalNumber + 1, sizeof(DpDiagonal *));
     dpMatrix->activeDiagonals = 0;
+    dpMatrix->activeCells = 0;
     dpMatrix->stateNumber = stateNumber;
     return dpMatrix;
 }
@@ -494,6 +496,10 @@ int64_t dpMatrix_getActiveDiagonalNumber(DpMatrix *dpMatrix) {
     return dpMatrix->activeDiagonals;
 }
 
+int64_t dpMatrix_getActiveCellNumber(DpMatrix *dpMatrix) {
+    return dpMatrix->activeCells;
+}
+
 DpDiagonal *dpMatrix_createDiagonal(DpMatrix *dpMatrix, Diagonal diagonal) {
     assert(diagonal.xay >= 0);
     assert(diagonal.xay <= dpMatrix->diagonalNumber);
@@ -501,6 +507,7 @@ DpDiagonal *dpMatrix_createDiagonal(DpMatrix *dpMatrix, Diagonal diagonal) {
     DpDiagonal *dpDiagonal = dpDiagonal_construct(diagonal, dpMatrix->stateNumber);
     dpMatrix->diagonals[diagonal_getXay(diagonal)] = dpDiagonal;
     dpMatrix->activeDiagonals++;
+    dpMatrix->activeCells += diagonal_getWidth(diagonal);
     return dpDiagonal;
 }
 
@@ -510,6 +517,7 @@ void dpMatrix_deleteDiagonal(DpMatrix *dpMatrix, int64_t xay) {
     if (dpMatrix->diagonals[xay] != NULL) {
         dpMatrix->activeDiagonals--;
         assert(dpMatrix->activeDiagonals >= 0);
+        dpMatrix->activeCells -= diagonal_getWidth(dpMatrix->diagonals[xay]->diagonal);
         dpDiagonal_destruct(dpMatrix->diagonals[xay]);
         dpMatrix->diagonals[xay] = NULL;
     }
@@ -553,12 +561,110 @@ static void diagonalCalculation(StateMachine *sM, DpDiagonal *dpDiagonal, DpDiag
     }
 }
 
+static void dpDiagonal_getCellRange(DpDiagonal *dpDiagonal, int64_t xmy, int64_t length, int64_t *start, int64_t *end) {
+    //Gets the range [start, end) of the cells xmy, xmy + 2, ..., xmy + 2 * (length - 1) that are in the diagonal.
+    Diagonal diagonal = dpDiagonal->diagonal;
+    *start = xmy >= diagonal_getMinXmy(diagonal) ? 0 : (diagonal_getMinXmy(diagonal) - xmy) / 2;
+    *end = xmy > diagonal_getMaxXmy(diagonal) ? 0 : (diagonal_getMaxXmy(diagonal) - xmy) / 2 + 1;
+    if (*end > length) {
+        *end = length;
+    }
+}
+
+static void dpDiagonal_loadCells(DpDiagonal *dpDiagonal, int64_t xmy, double *cells, int64_t stride, int64_t stateNumber) {
+    /*
+     * Copies the cells xmy, xmy + 2, ... into the structure-of-arrays layout used by the diagonal kernels. Cells outside
+     * the diagonal (or all the cells if there is no diagonal) are LOG_ZERO.
+     */
+    for (int64_t i = 0; i < stride * stateNumber; i++) {
+        cells[i] = LOG_ZERO;
+    }
+    if (dpDiagonal == NULL) {
+        return;
+    }
+    int64_t start, end;
+    dpDiagonal_getCellRange(dpDiagonal, xmy, stride, &start, &end);
+    for (int64_t i = start; i < end; i++) {
+        double *cell = dpDiagonal_getCell(dpDiagonal, xmy + 2 * i);
+        for (int64_t s = 0; s < stateNumber; s++) {
+            cells[s * stride + i] = cell[s];
+        }
+    }
+}
+
+static void dpDiagonal_storeCells(DpDiagonal *dpDiagonal, int64_t xmy, double *cells, int64_t stride, int64_t stateNumber) {
+    //Inverse of dpDiagonal_loadCells, cells outside the diagonal are discarded.
+    if (dpDiagonal == NULL) {
+        return;
+    }
+    int64_t start, end;
+    dpDiagonal_getCellRange(dpDiagonal, xmy, stride, &start, &end);
+    for (int64_t i = start; i < end; i++) {
+        double *cell = dpDiagonal_getCell(dpDiagonal, xmy + 2 * i);
+        for (int64_t s = 0; s < stateNumber; s++) {
+            cell[s] = cells[s * stride + i];
+        }
+    }
+}
+
+static void diagonalCalculationVectorised(StateMachine *sM, DpDiagonal *dpDiagonal, DpDiagonal *dpDiagonalM1,
+        DpDiagonal *dpDiagonalM2, const SymbolString sX, const SymbolString sY, bool forward) {
+    /*
+     * As diagonalCalculation, but using the state machine's diagonal kernels. The cells are transposed
+     * into structure-of-arrays form, calculated, and those that were updated transposed back.
+     */
+    Diagonal diagonal = dpDiagonal->diagonal;
+    int64_t xay = diagonal_getXay(diagonal);
+    int64_t xmyL = diagonal_getMinXmy(diagonal);
+    int64_t width = diagonal_getWidth(diagonal);
+    int64_t stride = ((width + STATE_MACHINE_DIAGONAL_PADDING - 1) / STATE_MACHINE_DIAGONAL_PADDING + 1)
+            * STATE_MACHINE_DIAGONAL_PADDING; //Room for the upper cells, which are offset by one.
+    int64_t stateNumber = sM->stateNumber;
+
+    double *current = st_malloc(sizeof(double) * stride * stateNumber * 3);
+    double *previous = current + stride * stateNumber; //The lower and upper cells
+    double *middle = previous + stride * stateNumber;
+    Symbol *cX = st_malloc(sizeof(Symbol) * stride * 2);
+    Symbol *cY = cX + stride;
+
+    dpDiagonal_loadCells(dpDiagonal, xmyL, current, stride, stateNumber);
+    dpDiagonal_loadCells(dpDiagonalM1, xmyL - 1, previous, stride, stateNumber);
+    dpDiagonal_loadCells(dpDiagonalM2, xmyL, middle, stride, stateNumber);
+    for (int64_t i = 0; i < stride; i++) {
+        int64_t xmy = xmyL + 2 * i;
+        cX[i] = i < width ? getXCharacter(sX, xay, xmy) : n;
+        cY[i] = i < width ? getYCharacter(sY, xay, xmy) : n;
+    }
+
+    if (forward) {
+        sM->diagonalCalculateForward(sM, current, previous, middle, previous + 1, cX, cY, width, stride);
+        dpDiagonal_storeCells(dpDiagonal, xmyL, current, stride, stateNumber);
+    } else {
+        sM->diagonalCalculateBackward(sM, current, previous, middle, previous + 1, cX, cY, width, stride);
+        dpDiagonal_storeCells(dpDiagonalM1, xmyL - 1, previous, stride, stateNumber);
+        dpDiagonal_storeCells(dpDiagonalM2, xmyL, middle, stride, stateNumber);
+    }
+
+    free(current);
+    free(cX);
+}
+
 void diagonalCalculationForward(StateMachine *sM, int64_t xay, DpMatrix *dpMatrix, const SymbolString sX, const SymbolString sY) {
+    if (sM->diagonalCalculateForward != NULL) {
+        diagonalCalculationVectorised(sM, dpMatrix_getDiagonal(dpMatrix, xay), dpMatrix_getDiagonal(dpMatrix, xay - 1),
+                dpMatrix_getDiagonal(dpMatrix, xay - 2), sX, sY, 1);
+        return;
+    }
     diagonalCalculation(sM, dpMatrix_getDiagonal(dpMatrix, xay), dpMatrix_getDiagonal(dpMatrix, xay - 1),
             dpMatrix_getDiagonal(dpMatrix, xay - 2), sX, sY, cell_calculateForward, NULL);
 }
 
 void diagonalCalculationBackward(StateMachine *sM, int64_t xay, DpMatrix *dpMatrix, const SymbolString sX, const SymbolString sY) {
+    if (sM->diagonalCalculateBackward != NULL) {
+        diagonalCalculationVectorised(sM, dpMatrix_getDiagonal(dpMatrix, xay), dpMatrix_getDiagonal(dpMatrix, xay - 1),
+                dpMatrix_getDiagonal(dpMatrix, xay - 2), sX, sY, 0);
+        return;
+    }
     diagonalCalculation(sM, dpMatrix_getDiagonal(dpMatrix, xay), dpMatrix_getDiagonal(dpMatrix, xay - 1),
             dpMatrix_getDiagonal(dpMatrix, xay - 2), sX, sY, cell_calculateBackward, NULL);
 }
@@ -575,19 +681,25 @@ double diagonalCalculationTotalProbability(StateMachine *sM, int64_t xay, DpMatr
     if (backDiagonal != NULL && forwardDiagonal != NULL) {
         DpDiagonal *matchDiagonal = dpDiagonal_clone(backDiagonal);
         dpDiagonal_zeroValues(matchDiagonal);
-        diagonalCalculation(sM, matchDiagonal, NULL, forwardDiagonal, sX, sY, cell_calculateForward, NULL);
+        if (sM->diagonalCalculateForward != NULL) {
+            diagonalCalculationVectorised(sM, matchDiagonal, NULL, forwardDiagonal, sX, sY, 1);
+        } else {
+            diagonalCalculation(sM, matchDiagonal, NULL, forwardDiagonal, sX, sY, cell_calculateForward, NULL);
+        }
         totalProbability = logAdd(totalProbability, dpDiagonal_dotProduct(matchDiagonal, backDiagonal));
         dpDiagonal_destruct(matchDiagonal);
     }
     return totalProbability;
 }
 
-void diagonalCalculationPosteriorMatchProbs(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, DpMatrix *backwardDpMatrix,
-        const SymbolString sX, const SymbolString sY, double totalProbability, PairwiseAlignmentParameters *p,
-        void *extraArgs) {
+static void diagonalCalculationPosteriorMatchProbs2(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix,
+        DpMatrix *backwardDpMatrix, double totalProbability, PairwiseAlignmentParameters *p,
+        void (*addPair)(void *alignedPairs, int64_t score, int64_t x, int64_t y), void *alignedPairs) {
+    /*
+     * Calls addPair for each cell of the diagonal whose posterior match probability is at least the threshold.
+     */
     assert(p->threshold >= 0.0);
     assert(p->threshold <= 1.0);
-    stList *alignedPairs = ((void **) extraArgs)[0];
     DpDiagonal *forwardDiagonal = dpMatrix_getDiagonal(forwardDpMatrix, xay);
     DpDiagonal *backDiagonal = dpMatrix_getDiagonal(backwardDpMatrix, xay);
     Diagonal diagonal = forwardDiagonal->diagonal;
@@ -607,13 +719,35 @@ void diagonalCalculationPosteriorMatchProbs(StateMachine *sM, int64_t xay, DpMat
                 }
                 posteriorProbability = floor(posteriorProbability * PAIR_ALIGNMENT_PROB_1);
 
-                stList_append(alignedPairs, stIntTuple_construct3((int64_t) posteriorProbability, x - 1, y - 1));
+                addPair(alignedPairs, (int64_t) posteriorProbability, x - 1, y - 1);
             }
         }
         xmy += 2;
     }
 }
 
+static void addPairToBuffer(void *alignedPairs, int64_t score, int64_t x, int64_t y) {
+    alignedPairBuffer_append(alignedPairs, score, x, y);
+}
+
+static void addPairToList(void *alignedPairs, int64_t score, int64_t x, int64_t y) {
+    stList_append(alignedPairs, stIntTuple_construct3(score, x, y));
+}
+
+void diagonalCalculationPosteriorMatchProbsToBuffer(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, DpMatrix *backwardDpMatrix,
+        const SymbolString sX, const SymbolString sY, double totalProbability, PairwiseAlignmentParameters *p,
+        void *extraArgs) {
+    diagonalCalculationPosteriorMatchProbs2(sM, xay, forwardDpMatrix, backwardDpMatrix, totalProbability, p,
+            addPairToBuffer, ((void **) extraArgs)[0]);
+}
+
+void diagonalCalculationPosteriorMatchProbs(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, DpMatrix *backwardDpMatrix,
+        const SymbolString sX, const SymbolString sY, double totalProbability, PairwiseAlignmentParameters *p,
+        void *extraArgs) {
+    diagonalCalculationPosteriorMatchProbs2(sM, xay, forwardDpMatrix, backwardDpMatrix, totalProbability, p,
+            addPairToList, ((void **) extraArgs)[0]);
+}
+
 static void diagonalCalculationExpectations(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, DpMatrix *backwardDpMatrix,
         const SymbolString sX, const SymbolString sY, double totalProbability, PairwiseAlignmentParameters *p,
         void *extraArgs) {
@@ -635,6 +769,49 @@ static void diagonalCalculationExpectations(StateMachine *sM, int64_t xay, DpMat
 ///////////////////////////////////
 ///////////////////////////////////
 
+static bool isForwardCheckpoint(int64_t xay, int64_t checkpointInterval) {
+    /*
+     * Checkpoints are the pairs of diagonals (xay - 1, xay) where xay is a multiple of the interval,
+     * the two diagonals the forward recursion needs to restart from.
+     */
+    return xay % checkpointInterval == 0 || (xay + 1) % checkpointInterval == 0;
+}
+
+static void checkpointForwardDiagonals(DpMatrix *forwardDpMatrix, int64_t from, int64_t to, int64_t checkpointInterval) {
+    /*
+     * Deletes the forward diagonals in [from, to] that are not checkpoints.
+     */
+    for (int64_t xay = from; xay <= to; xay++) {
+        if (!isForwardCheckpoint(xay, checkpointInterval)) {
+            dpMatrix_deleteDiagonal(forwardDpMatrix, xay);
+        }
+    }
+}
+
+static void recomputeForwardDiagonal(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, Diagonal *diagonals,
+        int64_t tracedBackTo, const SymbolString sX, const SymbolString sY) {
+    /*
+     * Ensures the forward diagonal xay is present, if it is in the region being traced back, by recomputing the forward
+     * recursion from the closest pair of consecutive diagonals below it. The recomputed diagonals are kept, as
+     * the traceback needs them next. The diagonals tracedBackTo and tracedBackTo + 1 are never deleted, so
+     * there is always such a pair.
+     */
+    if (xay <= tracedBackTo + 1 || dpMatrix_getDiagonal(forwardDpMatrix, xay) != NULL) {
+        return;
+    }
+    int64_t start = xay - 1;
+    while (dpMatrix_getDiagonal(forwardDpMatrix, start) == NULL || dpMatrix_getDiagonal(forwardDpMatrix, start - 1) == NULL) {
+        start--;
+        assert(start > tracedBackTo);
+    }
+    for (int64_t i = start + 1; i <= xay; i++) {
+        if (dpMatrix_getDiagonal(forwardDpMatrix, i) == NULL) {
+            dpDiagonal_zeroValues(dpMatrix_createDiagonal(forwardDpMatrix, diagonals[i]));
+            diagonalCalculationForward(sM, i, forwardDpMatrix, sX, sY);
+        }
+    }
+}
+
 void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const SymbolString sX, const SymbolString sY,
         PairwiseAlignmentParameters *p, bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd,
         void (*diagonalPosteriorProbFn)(StateMachine *, int64_t, DpMatrix *, DpMatrix *, const SymbolString, const SymbolString, double,
@@ -655,9 +832,19 @@ void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const S
     Band *band = band_construct(anchorPairs, sX.length, sY.length, p->diagonalExpansion);
     BandIterator *forwardBandIterator = bandIterator_construct(band);
     DpMatrix *forwardDpMatrix = dpMatrix_construct(diagonalNumber, sM->stateNumber);
-    dpDiagonal_initialiseValues(dpMatrix_createDiagonal(forwardDpMatrix, bandIterator_getNext(forwardBandIterator)), sM,
+    Diagonal *diagonals = st_malloc(sizeof(Diagonal) * (diagonalNumber + 1)); //The band, so forward diagonals can be recomputed
+    diagonals[0] = bandIterator_getNext(forwardBandIterator);
+    dpDiagonal_initialiseValues(dpMatrix_createDiagonal(forwardDpMatrix, diagonals[0]), sM,
             alignmentHasRaggedLeftEnd ? sM->raggedStartStateProb : sM->startStateProb); //Initialise forward matrix.
 
+    //If the forward matrix grows beyond the memory limit only checkpoint diagonals, every checkpointInterval, are kept
+    //until the traceback, which recomputes the others from them. This costs at most one extra forward calculation
+    //of each diagonal.
+    int64_t checkpointInterval = sqrt(diagonalNumber) + 2;
+    bool checkpointing = 0;
+    int64_t checkpointedTo = -1; //The last diagonal checkpointing may have deleted, only checked by the assertions
+    (void) checkpointedTo;
+
     //Backward matrix.
     DpMatrix *backwardDpMatrix = dpMatrix_construct(diagonalNumber, sM->stateNumber);
 
@@ -665,11 +852,26 @@ void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const S
     int64_t totalPosteriorCalculations = 0;
     while (1) { //Loop that moves through the matrix forward
         Diagonal diagonal = bandIterator_getNext(forwardBandIterator);
+        diagonals[diagonal_getXay(diagonal)] = diagonal;
 
         //Forward calculation
         dpDiagonal_zeroValues(dpMatrix_createDiagonal(forwardDpMatrix, diagonal));
         diagonalCalculationForward(sM, diagonal_getXay(diagonal), forwardDpMatrix, sX, sY);
 
+        //Checkpointing, the two diagonals after the last traceback and the last two diagonals are always kept
+        if (checkpointing) {
+            if (diagonal_getXay(diagonal) - 2 > tracedBackTo + 1) {
+                checkpointForwardDiagonals(forwardDpMatrix, diagonal_getXay(diagonal) - 2, diagonal_getXay(diagonal) - 2,
+                        checkpointInterval);
+                checkpointedTo = diagonal_getXay(diagonal) - 2;
+            }
+        } else if (p->dpMemoryLimit > 0
+                && dpMatrix_getActiveCellNumber(forwardDpMatrix) * sM->stateNumber * (int64_t) sizeof(double) > p->dpMemoryLimit) {
+            checkpointing = 1;
+            checkpointForwardDiagonals(forwardDpMatrix, tracedBackTo + 2, diagonal_getXay(diagonal) - 2, checkpointInterval);
+            checkpointedTo = diagonal_getXay(diagonal) - 2;
+        }
+
         bool atEnd = diagonal_getXay(diagonal) == diagonalNumber; //Condition true at the end of the matrix
         bool tracebackPoint = diagonal_getXay(diagonal) >= tracedBackTo + p->minDiagsBetweenTraceBack
                 && diagonal_getWidth(diagonal) <= p->diagonalExpansion * 2 + 1; //Condition true when we want to do an intermediate traceback.
@@ -680,9 +882,7 @@ void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const S
             dpDiagonal_initialiseValues(dpMatrix_createDiagonal(backwardDpMatrix, diagonal), sM,
                     (atEnd && alignmentHasRaggedRightEnd) ? sM->raggedEndStateProb : sM->endStateProb);
             if (diagonal_getXay(diagonal) > tracedBackTo + 1) { //This is a diagonal between the place we trace back to and where we trace back from
-                DpDiagonal *j = dpMatrix_getDiagonal(forwardDpMatrix, diagonal_getXay(diagonal) - 1);
-                assert(j != NULL);
-                dpDiagonal_zeroValues(dpMatrix_createDiagonal(backwardDpMatrix, j->diagonal));
+                dpDiagonal_zeroValues(dpMatrix_createDiagonal(backwardDpMatrix, diagonals[diagonal_getXay(diagonal) - 1]));
             }
 
             //Do walk back
@@ -695,14 +895,20 @@ void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const S
             while (diagonal_getXay(diagonal2) > tracedBackTo) {
                 //Create the earlier diagonal
                 if (diagonal_getXay(diagonal2) > tracedBackTo + 2) {
-                    DpDiagonal *j = dpMatrix_getDiagonal(forwardDpMatrix, diagonal_getXay(diagonal2) - 2);
-                    assert(j != NULL);
-                    dpDiagonal_zeroValues(dpMatrix_createDiagonal(backwardDpMatrix, j->diagonal));
+                    dpDiagonal_zeroValues(dpMatrix_createDiagonal(backwardDpMatrix, diagonals[diagonal_getXay(diagonal2) - 2]));
                 }
                 if (diagonal_getXay(diagonal2) > tracedBackTo + 1) {
                     diagonalCalculationBackward(sM, diagonal_getXay(diagonal2), backwardDpMatrix, sX, sY);
                 }
+                if (diagonal_getXay(diagonal2) == tracedBackFrom + 1 && !atEnd) {
+                    //The next traceback restarts the forward recursion from tracedBackFrom and tracedBackFrom + 1
+                    recomputeForwardDiagonal(sM, tracedBackFrom + 1, forwardDpMatrix, diagonals, tracedBackTo, sX, sY);
+                }
                 if (diagonal_getXay(diagonal2) <= tracedBackFrom) {
+                    //Recompute any checkpointed forward diagonals needed by the posterior calculation
+                    for (int64_t i = 0; i < 3; i++) {
+                        recomputeForwardDiagonal(sM, diagonal_getXay(diagonal2) - i, forwardDpMatrix, diagonals, tracedBackTo, sX, sY);
+                    }
                     assert(dpMatrix_getDiagonal(forwardDpMatrix, diagonal_getXay(diagonal2)) != NULL);
                     assert(dpMatrix_getDiagonal(forwardDpMatrix, diagonal_getXay(diagonal2)-1) != NULL);
                     assert(dpMatrix_getDiagonal(backwardDpMatrix, diagonal_getXay(diagonal2)) != NULL);
@@ -739,8 +945,12 @@ void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const S
             assert(dpMatrix_getActiveDiagonalNumber(backwardDpMatrix) == 0);
             totalPosteriorCalculations += totalPosteriorCalculationsThisTraceback;
             if (!atEnd) {
-                assert(dpMatrix_getActiveDiagonalNumber(forwardDpMatrix) == p->traceBackDiagonals + 2);
+                //Unless checkpointing deleted diagonals after the two now kept, just the diagonals after them remain
+                assert(checkpointedTo > tracedBackTo + 1 || dpMatrix_getActiveDiagonalNumber(forwardDpMatrix) == p->traceBackDiagonals + 2);
+                assert(dpMatrix_getDiagonal(forwardDpMatrix, tracedBackTo) != NULL);
+                assert(dpMatrix_getDiagonal(forwardDpMatrix, tracedBackTo + 1) != NULL);
             }
+            checkpointing = 0;
         }
 
         if (atEnd) {
@@ -754,6 +964,7 @@ void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const S
     //Cleanup
     dpMatrix_destruct(forwardDpMatrix);
     dpMatrix_destruct(backwardDpMatrix);
+    free(diagonals);
     bandIterator_destruct(forwardBandIterator);
     band_destruct(band);
 }
@@ -889,6 +1100,355 @@ stList *getBlastPairs(const char *sX, const char *sY, int64_t lX, int64_t lY, in
     return alignedPairs;
 }
 
+///////////////////////////////////
+///////////////////////////////////
+//Seed and chain anchoring functions
+//
+//Computes anchors like getBlastPairs, but in process. Hits of a spaced seed between the two sequences are found using
+//a sorted index of the seeds in sX, extended without gaps, and the highest scoring chain of the resulting ungapped
+//segments is converted to anchor pairs. As lastz interpolates between its HSPs, the gaps between consecutive segments
+//of the chain, and at its ends, are then searched again with a shorter seed.
+///////////////////////////////////
+///////////////////////////////////
+
+#define SEED_MATCH_SCORE 1
+#define SEED_MISMATCH_SCORE -1
+#define SEED_X_DROP 8
+#define SEED_MINIMUM_SEGMENT_SCORE 20
+#define SEED_MAXIMUM_OCCURRENCES 64 //Seeds occurring more often than this in sX are treated as repeats and ignored.
+#define SEED_POSITION_BITS 40
+#define SEED_MAXIMUM_INNER_GAP 2000 //The largest gap, in either sequence, searched with the inner seed.
+#define SEED_MINIMUM_INNER_SEGMENT_SCORE 12 //Must exceed the weight of the inner seed, which every hit scores.
+
+//The 12of19 spaced seed, the default seed of lastz.
+static const char *seedPattern = "1110100110010101111";
+
+//The seed used within the gaps of the chain, where hits are much less likely to be by chance.
+static const char *innerSeedPattern = "11111111";
+
+typedef struct _segment {
+    int64_t x;
+    int64_t y;
+    int64_t length;
+    int64_t score;
+} Segment;
+
+typedef struct _segmentEnd {
+    int64_t end;
+    int64_t index;
+} SegmentEnd;
+
+//A rectangle of the alignment matrix, from the start coordinates, inclusive, to the end coordinates, exclusive.
+typedef struct _box {
+    int64_t xStart;
+    int64_t xEnd;
+    int64_t yStart;
+    int64_t yEnd;
+} Box;
+
+static int64_t seed_getBase(char c, bool repeatMask) {
+    /*
+     * Gets the two bit code of a base, or -1 if it can not be part of a seed. Lower case bases are excluded
+     * when repeat masking.
+     */
+    switch (repeatMask ? c : toupper(c)) {
+        case 'A':
+            return 0;
+        case 'C':
+            return 1;
+        case 'G':
+            return 2;
+        case 'T':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+static bool seed_getKey(const char *s, int64_t i, const char *pattern, int64_t span, bool repeatMask, uint64_t *key) {
+    *key = 0;
+    for (int64_t j = 0; j < span; j++) {
+        if (pattern[j] == '1') {
+            int64_t b = seed_getBase(s[i + j], repeatMask);
+            if (b == -1) {
+                return 0;
+            }
+            *key = (*key << 2) | b;
+        }
+    }
+    return 1;
+}
+
+static int seed_cmpEntries(const void *a, const void *b) {
+    uint64_t i = *(const uint64_t *) a, j = *(const uint64_t *) b;
+    return i > j ? 1 : (i < j ? -1 : 0);
+}
+
+static uint64_t *seed_constructIndex(const char *sX, Box *box, const char *pattern, int64_t span, bool repeatMask,
+        int64_t *entryNumber) {
+    /*
+     * Builds an array of the seeds in sX within the box, each entry holding the seed key in its high bits and the
+     * position in its low bits, sorted so that the positions of each seed are contiguous.
+     */
+    uint64_t *entries = st_malloc(sizeof(uint64_t) * (box->xEnd - box->xStart - span + 1));
+    *entryNumber = 0;
+    for (int64_t x = box->xStart; x + span <= box->xEnd; x++) {
+        uint64_t key;
+        if (seed_getKey(sX, x, pattern, span, repeatMask, &key)) {
+            entries[(*entryNumber)++] = (key << SEED_POSITION_BITS) | (uint64_t) x;
+        }
+    }
+    qsort(entries, *entryNumber, sizeof(uint64_t), seed_cmpEntries);
+    return entries;
+}
+
+static int64_t seed_findFirst(uint64_t *entries, int64_t entryNumber, uint64_t key) {
+    int64_t i = 0, j = entryNumber;
+    while (i < j) {
+        int64_t k = (i + j) / 2;
+        if ((entries[k] >> SEED_POSITION_BITS) < key) {
+            i = k + 1;
+        } else {
+            j = k;
+        }
+    }
+    return i;
+}
+
+static inline int64_t seed_score(char cX, char cY) {
+    cX = toupper(cX);
+    return cX == toupper(cY) && seed_getBase(cX, 0) != -1 ? SEED_MATCH_SCORE : SEED_MISMATCH_SCORE;
+}
+
+static Segment seed_extend(const char *sX, const char *sY, Box *box, int64_t x, int64_t y) {
+    /*
+     * Extends a seed hit at (x, y) without gaps in both directions, within the box, each extension stopping when its
+     * score drops more than SEED_X_DROP below the best seen.
+     */
+    int64_t score = 0, rightScore = 0, right = 0;
+    for (int64_t i = 0; x + i < box->xEnd && y + i < box->yEnd; i++) {
+        score += seed_score(sX[x + i], sY[y + i]);
+        if (score > rightScore) {
+            rightScore = score;
+            right = i + 1;
+        } else if (rightScore - score > SEED_X_DROP) {
+            break;
+        }
+    }
+    int64_t leftScore = 0, left = 0;
+    score = 0;
+    for (int64_t i = 1; x - i >= box->xStart && y - i >= box->yStart; i++) {
+        score += seed_score(sX[x - i], sY[y - i]);
+        if (score > leftScore) {
+            leftScore = score;
+            left = i;
+        } else if (leftScore - score > SEED_X_DROP) {
+            break;
+        }
+    }
+    Segment segment = { x - left, y - left, left + right, leftScore + rightScore };
+    return segment;
+}
+
+static Segment *seed_getSegments(const char *sX, const char *sY, Box *box, const char *pattern,
+        int64_t minimumSegmentScore, bool repeatMask, int64_t *segmentNumber) {
+    /*
+     * Gets the ungapped segments within the box containing a hit of the seed that score at least minimumSegmentScore.
+     * Each x-y diagonal records how far along it has been extended, so hits within an existing segment are not extended
+     * again.
+     */
+    int64_t span = strlen(pattern);
+    int64_t entryNumber;
+    uint64_t *entries = seed_constructIndex(sX, box, pattern, span, repeatMask, &entryNumber);
+    int64_t lX = box->xEnd - box->xStart, lY = box->yEnd - box->yStart;
+    int64_t *diagonalReach = st_calloc(lX + lY, sizeof(int64_t));
+    int64_t maxSegmentNumber = 16;
+    Segment *segments = st_malloc(sizeof(Segment) * maxSegmentNumber);
+    *segmentNumber = 0;
+    for (int64_t y = box->yStart; y + span <= box->yEnd; y++) {
+        uint64_t key;
+        if (!seed_getKey(sY, y, pattern, span, repeatMask, &key)) {
+            continue;
+        }
+        int64_t i = seed_findFirst(entries, entryNumber, key), j = i;
+        while (j < entryNumber && (entries[j] >> SEED_POSITION_BITS) == key) {
+            j++;
+        }
+        if (j - i > SEED_MAXIMUM_OCCURRENCES) {
+            continue;
+        }
+        for (; i < j; i++) {
+            int64_t x = entries[i] & (((uint64_t) 1 << SEED_POSITION_BITS) - 1);
+            int64_t *reach = &diagonalReach[(x - box->xStart) - (y - box->yStart) + lY];
+            if (x < *reach) {
+                continue;
+            }
+            Segment segment = seed_extend(sX, sY, box, x, y);
+            *reach = segment.x + segment.length > x ? segment.x + segment.length : x + 1;
+            if (segment.score >= minimumSegmentScore) {
+                if (*segmentNumber == maxSegmentNumber) {
+                    maxSegmentNumber *= 2;
+                    segments = st_realloc(segments, sizeof(Segment) * maxSegmentNumber);
+                }
+                segments[(*segmentNumber)++] = segment;
+            }
+        }
+    }
+    free(entries);
+    free(diagonalReach);
+    return segments;
+}
+
+static int seed_cmpSegmentStarts(const void *a, const void *b) {
+    const Segment *i = a, *j = b;
+    return i->x > j->x ? 1 : (i->x < j->x ? -1 : (i->y > j->y ? 1 : (i->y < j->y ? -1 : 0)));
+}
+
+static int seed_cmpSegmentEnds(const void *a, const void *b) {
+    const SegmentEnd *i = a, *j = b;
+    return i->end > j->end ? 1 : (i->end < j->end ? -1 : (i->index > j->index ? 1 : (i->index < j->index ? -1 : 0)));
+}
+
+static stList *seed_chainSegments(Segment *segments, int64_t segmentNumber, Box *box) {
+    /*
+     * Finds the highest scoring chain of segments in which each segment ends before the next starts in both sequences.
+     * Segments are visited in order of x start. Once the x start passes the x end of a segment it becomes available as a
+     * predecessor and is added to a Fenwick tree over y end coordinates, which gives the best predecessor ending
+     * before a given y in log time. Returns the chain as a list of segments, in order.
+     */
+    qsort(segments, segmentNumber, sizeof(Segment), seed_cmpSegmentStarts);
+    SegmentEnd *segmentEnds = st_malloc(sizeof(SegmentEnd) * (segmentNumber + 1));
+    for (int64_t i = 0; i < segmentNumber; i++) {
+        segmentEnds[i].end = segments[i].x + segments[i].length;
+        segmentEnds[i].index = i;
+    }
+    qsort(segmentEnds, segmentNumber, sizeof(SegmentEnd), seed_cmpSegmentEnds);
+
+    int64_t lY = box->yEnd - box->yStart;
+    int64_t *chainScores = st_malloc(sizeof(int64_t) * (segmentNumber + 1));
+    int64_t *predecessors = st_malloc(sizeof(int64_t) * (segmentNumber + 1));
+    int64_t *tree = st_malloc(sizeof(int64_t) * (lY + 1)); //Index of the best chain ending at or before each y, or -1
+    for (int64_t i = 0; i <= lY; i++) {
+        tree[i] = -1;
+    }
+    int64_t best = -1;
+    for (int64_t i = 0, j = 0; i < segmentNumber; i++) {
+        Segment *segment = &segments[i];
+        //Make available the segments that end before this one starts in x
+        for (; j < segmentNumber && segmentEnds[j].end <= segment->x; j++) {
+            int64_t k = segmentEnds[j].index;
+            assert(k < i);
+            for (int64_t l = segments[k].y + segments[k].length - box->yStart; l <= lY; l += l & -l) {
+                if (tree[l] == -1 || chainScores[k] > chainScores[tree[l]]) {
+                    tree[l] = k;
+                }
+            }
+        }
+        //Get the best predecessor that ends before this one starts in y
+        int64_t predecessor = -1;
+        for (int64_t l = segment->y - box->yStart; l > 0; l -= l & -l) {
+            if (tree[l] != -1 && (predecessor == -1 || chainScores[tree[l]] > chainScores[predecessor])) {
+                predecessor = tree[l];
+            }
+        }
+        predecessors[i] = predecessor;
+        chainScores[i] = segment->score + (predecessor != -1 ? chainScores[predecessor] : 0);
+        if (best == -1 || chainScores[i] > chainScores[best]) {
+            best = i;
+        }
+    }
+
+    stList *chain = stList_construct();
+    for (int64_t i = best; i != -1; i = predecessors[i]) {
+        stList_append(chain, &segments[i]);
+    }
+    stList_reverse(chain);
+
+    free(segmentEnds);
+    free(chainScores);
+    free(predecessors);
+    free(tree);
+    return chain;
+}
+
+static void seed_addSegmentPairs(Segment *segment, int64_t trim, stList *alignedPairs) {
+    for (int64_t l = trim; l < segment->length - trim; l++) {
+        stList_append(alignedPairs, stIntTuple_construct2(segment->x + l, segment->y + l));
+    }
+}
+
+static void seed_addInnerPairs(const char *sX, const char *sY, Box *box, int64_t trim, bool repeatMask,
+        stList *alignedPairs) {
+    /*
+     * Adds the pairs of the best chain of segments found with the inner seed within a gap of the outer chain.
+     */
+    int64_t span = strlen(innerSeedPattern);
+    if (box->xEnd - box->xStart < span || box->yEnd - box->yStart < span) {
+        return;
+    }
+    int64_t segmentNumber;
+    Segment *segments = seed_getSegments(sX, sY, box, innerSeedPattern, SEED_MINIMUM_INNER_SEGMENT_SCORE, repeatMask,
+            &segmentNumber);
+    stList *chain = seed_chainSegments(segments, segmentNumber, box);
+    for (int64_t i = 0; i < stList_length(chain); i++) {
+        seed_addSegmentPairs(stList_get(chain, i), trim, alignedPairs);
+    }
+    stList_destruct(chain);
+    free(segments);
+}
+
+stList *getSeedPairs(const char *sX, const char *sY, int64_t lX, int64_t lY, int64_t trim, bool repeatMask) {
+    /*
+     * As getBlastPairs, but computes the anchors in process. The returned pairs are strictly increasing in both
+     * x and y.
+     */
+    stList *alignedPairs = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct); //the list to put the output in
+
+    if (lX < (int64_t) strlen(seedPattern) || lY < (int64_t) strlen(seedPattern)) {
+        return alignedPairs;
+    }
+
+    Box box = { 0, lX, 0, lY };
+    int64_t segmentNumber;
+    Segment *segments = seed_getSegments(sX, sY, &box, seedPattern, SEED_MINIMUM_SEGMENT_SCORE, repeatMask,
+            &segmentNumber);
+    stList *chain = seed_chainSegments(segments, segmentNumber, &box);
+    for (int64_t i = 0; i <= stList_length(chain); i++) {
+        //Search the gap before the segment, or, after the last segment, the end of the matrix, if it is small enough,
+        //or else the part of it adjacent to the chain
+        Segment *previous = i > 0 ? stList_get(chain, i - 1) : NULL;
+        Segment *segment = i < stList_length(chain) ? stList_get(chain, i) : NULL;
+        Box gap = { previous != NULL ? previous->x + previous->length : 0, segment != NULL ? segment->x : lX,
+                    previous != NULL ? previous->y + previous->length : 0, segment != NULL ? segment->y : lY };
+        if (previous != NULL && segment != NULL) {
+            if (gap.xEnd - gap.xStart <= SEED_MAXIMUM_INNER_GAP && gap.yEnd - gap.yStart <= SEED_MAXIMUM_INNER_GAP) {
+                seed_addInnerPairs(sX, sY, &gap, trim, repeatMask, alignedPairs);
+            }
+        } else if (previous != NULL) {
+            gap.xEnd = gap.xEnd - gap.xStart > SEED_MAXIMUM_INNER_GAP ? gap.xStart + SEED_MAXIMUM_INNER_GAP : gap.xEnd;
+            gap.yEnd = gap.yEnd - gap.yStart > SEED_MAXIMUM_INNER_GAP ? gap.yStart + SEED_MAXIMUM_INNER_GAP : gap.yEnd;
+            seed_addInnerPairs(sX, sY, &gap, trim, repeatMask, alignedPairs);
+        } else if (segment != NULL) {
+            gap.xStart = gap.xEnd - gap.xStart > SEED_MAXIMUM_INNER_GAP ? gap.xEnd - SEED_MAXIMUM_INNER_GAP : gap.xStart;
+            gap.yStart = gap.yEnd - gap.yStart > SEED_MAXIMUM_INNER_GAP ? gap.yEnd - SEED_MAXIMUM_INNER_GAP : gap.yStart;
+            seed_addInnerPairs(sX, sY, &gap, trim, repeatMask, alignedPairs);
+        }
+        if (segment != NULL) {
+            seed_addSegmentPairs(segment, trim, alignedPairs);
+        }
+    }
+    stList_destruct(chain);
+    free(segments);
+
+    return alignedPairs;
+}
+
+static stList *getAnchorPairs(const char *sX, const char *sY, int64_t lX, int64_t lY, bool repeatMask,
+        PairwiseAlignmentParameters *p) {
+    return p->useLastzForAnchors ? getBlastPairs(sX, sY, lX, lY, p->constraintDiagonalTrim, repeatMask) :
+            getSeedPairs(sX, sY, lX, lY, p->constraintDiagonalTrim, repeatMask);
+}
+
 static void convertBlastPairs(stList *alignedPairs2, int64_t offsetX, int64_t offsetY) {
     /*
      * Convert the coordinates of the computed pairs.
@@ -954,7 +1514,7 @@ static void getBlastPairsForPairwiseAlignmentParametersP(const char *sX, const c
     if (matrixSize > p->anchorMatrixBiggerThanThis) {
         char *sX2 = stString_getSubString(sX, pX, lX2);
         char *sY2 = stString_getSubString(sY, pY, lY2);
-        stList *unfilteredBottomLevelAnchorPairs = getBlastPairs(sX2, sY2, lX2, lY2, p->constraintDiagonalTrim, matrixSize > p->repeatMaskMatrixBiggerThanThis);
+        stList *unfilteredBottomLevelAnchorPairs = getAnchorPairs(sX2, sY2, lX2, lY2, matrixSize > p->repeatMaskMatrixBiggerThanThis, p);
         stList_sort(unfilteredBottomLevelAnchorPairs, (int (*)(const void *, const void *)) stIntTuple_cmpFn);
         stList *bottomLevelAnchorPairs = filterToRemoveOverlap(unfilteredBottomLevelAnchorPairs);
         st_logDebug("Got %" PRIi64 " bottom level anchor pairs, which reduced to %" PRIi64 " after filtering \n",
@@ -975,7 +1535,7 @@ stList *getBlastPairsForPairwiseAlignmentParameters(const char *sX, const char *
         return stList_construct();
     }
     //Anchor pairs
-    stList *unfilteredTopLevelAnchorPairs = getBlastPairs(sX, sY, lX, lY, p->constraintDiagonalTrim, 1);
+    stList *unfilteredTopLevelAnchorPairs = getAnchorPairs(sX, sY, lX, lY, 1, p);
     stList_sort(unfilteredTopLevelAnchorPairs, (int (*)(const void *, const void *)) stIntTuple_cmpFn);
     stList *topLevelAnchorPairs = filterToRemoveOverlap(unfilteredTopLevelAnchorPairs);
     st_logDebug("Got %" PRIi64 " top level anchor pairs, which reduced to %" PRIi64 " after filtering \n",
@@ -1066,20 +1626,6 @@ stList *getSplitPoints(stList *anchorPairs, int64_t lX, int64_t lY, int64_t spli
     return splitPoints;
 }
 
-static void convertAlignedPairs(stList *alignedPairs2, int64_t offsetX, int64_t offsetY) {
-    /*
-     * Convert the coordinates of the computed pairs.
-     */
-    for (int64_t k = 0; k < stList_length(alignedPairs2); k++) {
-        stIntTuple *i = stList_get(alignedPairs2, k);
-        assert(stIntTuple_length(i) == 3);
-        stList_set(alignedPairs2, k,
-                stIntTuple_construct3(stIntTuple_get(i, 0), stIntTuple_get(i, 1) + offsetX,
-                        stIntTuple_get(i, 2) + offsetY));
-        stIntTuple_destruct(i);
-    }
-}
-
 void getPosteriorProbsWithBandingSplittingAlignmentsByLargeGaps(StateMachine *sM, stList *anchorPairs, const char *sX, const char *sY,
         int64_t lX, int64_t lY, PairwiseAlignmentParameters *p, bool alignmentHasRaggedLeftEnd,
         bool alignmentHasRaggedRightEnd,
@@ -1153,6 +1699,9 @@ PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters_construct() {
     p->splitMatrixBiggerThanThis = (int64_t) 3000 * 3000;
     p->alignAmbiguityCharacters = 0;
     p->gapGamma = 0.5;
+    p->useLastzForAnchors = 0;
+    p->numThreads = 1;
+    p->dpMemoryLimit = 0;
     return p;
 }
 
@@ -1161,34 +1710,50 @@ void pairwiseAlignmentBandingParameters_destruct(PairwiseAlignmentParameters *p)
 }
 
 static void alignedPairCoordinateCorrectionFn(int64_t offsetX, int64_t offsetY, void *extraArgs) {
-    stList *subListOfAlignedPairs = ((void **) extraArgs)[0];
-    stList *alignedPairs = ((void **) extraArgs)[1];
-    convertAlignedPairs(subListOfAlignedPairs, offsetX, offsetY); //Shift back the aligned pairs to the appropriate coordinates
-    while (stList_length(subListOfAlignedPairs) > 0) {
-        stList_append(alignedPairs, stList_pop(subListOfAlignedPairs));
-    }
+    AlignedPairBuffer *alignedPairs = ((void **) extraArgs)[0];
+    int64_t *start = ((void **) extraArgs)[1];
+    //Shift back the aligned pairs computed for the sub-matrix to the appropriate coordinates
+    alignedPairBuffer_shift(alignedPairs, *start, offsetX, offsetY);
+    *start = alignedPairBuffer_length(alignedPairs);
 }
 
-stList *getAlignedPairsUsingAnchors(StateMachine *sM, const char *sX, const char *sY, stList *anchorPairs, PairwiseAlignmentParameters *p,
-        bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd) {
+AlignedPairBuffer *getAlignedPairBufferUsingAnchors(StateMachine *sM, const char *sX, const char *sY, stList *anchorPairs,
+        PairwiseAlignmentParameters *p, bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd) {
     const int64_t lX = strlen(sX);
     const int64_t lY = strlen(sY);
 
-    //This list of pairs to be returned. Not in any order, but points must be unique
-    stList *subListOfAlignedPairs = stList_construct();
-    stList *alignedPairs = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
-    void *extraArgs[2] = { subListOfAlignedPairs, alignedPairs };
+    //The pairs to be returned. Not in any order, but points must be unique
+    AlignedPairBuffer *alignedPairs = alignedPairBuffer_construct(lX < lY ? lX : lY);
+    int64_t start = 0; //The index of the first pair of the sub-matrix currently being aligned
+    void *extraArgs[2] = { alignedPairs, &start };
 
     getPosteriorProbsWithBandingSplittingAlignmentsByLargeGaps(sM, anchorPairs, sX, sY, lX, lY, p,
-            alignmentHasRaggedLeftEnd, alignmentHasRaggedRightEnd, diagonalCalculationPosteriorMatchProbs,
+            alignmentHasRaggedLeftEnd, alignmentHasRaggedRightEnd, diagonalCalculationPosteriorMatchProbsToBuffer,
             alignedPairCoordinateCorrectionFn, extraArgs);
 
-    assert(stList_length(subListOfAlignedPairs) == 0);
-    stList_destruct(subListOfAlignedPairs);
+    assert(start == alignedPairBuffer_length(alignedPairs));
 
     return alignedPairs;
 }
 
+AlignedPairBuffer *getAlignedPairBuffer(StateMachine *sM, const char *sX, const char *sY, PairwiseAlignmentParameters *p,
+        bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd) {
+    stList *anchorPairs = getBlastPairsForPairwiseAlignmentParameters(sX, sY, strlen(sX), strlen(sY), p);
+    AlignedPairBuffer *alignedPairs = getAlignedPairBufferUsingAnchors(sM, sX, sY, anchorPairs, p, alignmentHasRaggedLeftEnd,
+            alignmentHasRaggedRightEnd);
+    stList_destruct(anchorPairs);
+    return alignedPairs;
+}
+
+stList *getAlignedPairsUsingAnchors(StateMachine *sM, const char *sX, const char *sY, stList *anchorPairs, PairwiseAlignmentParameters *p,
+        bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd) {
+    AlignedPairBuffer *alignedPairBuffer = getAlignedPairBufferUsingAnchors(sM, sX, sY, anchorPairs, p,
+            alignmentHasRaggedLeftEnd, alignmentHasRaggedRightEnd);
+    stList *alignedPairs = alignedPairBuffer_getList(alignedPairBuffer);
+    alignedPairBuffer_destruct(alignedPairBuffer);
+    return alignedPairs;
+}
+
 stList *getAlignedPairs(StateMachine *sM, const char *sX, const char *sY, PairwiseAlignmentParameters *p, bool alignmentHasRaggedLeftEnd,
         bool alignmentHasRaggedRightEnd) {
     stList *anchorPairs = getBlastPairsForPairwiseAlignmentParameters(sX, sY, strlen(sX), strlen(sY), p);
@@ -1248,6 +1813,36 @@ stList *reweightAlignedPairs(stList *alignedPairs,
     return reweightedAlignedPairs;
 }
 
+static int64_t *getIndelProbabilitiesFromBuffer(AlignedPairBuffer *alignedPairs, int64_t seqLength, bool xIfTrueElseY) {
+    int64_t *indelProbs = st_malloc(seqLength * sizeof(int64_t));
+    for(int64_t i=0; i<seqLength; i++) {
+        indelProbs[i] = PAIR_ALIGNMENT_PROB_1;
+    }
+    int64_t *positions = xIfTrueElseY ? alignedPairs->x : alignedPairs->y;
+    for(int64_t i=0; i<alignedPairs->length; i++) {
+        indelProbs[positions[i]] -= alignedPairs->scores[i];
+    }
+    for(int64_t i=0; i<seqLength; i++) {
+        if(indelProbs[i] < 0) {
+            indelProbs[i] = 0;
+        }
+    }
+    return indelProbs;
+}
+
+void reweightAlignedPairBuffer(AlignedPairBuffer *alignedPairs, int64_t seqLengthX, int64_t seqLengthY, double gapGamma) {
+    if(gapGamma <= 0.0) {
+        return;
+    }
+    int64_t *indelProbsX = getIndelProbabilitiesFromBuffer(alignedPairs, seqLengthX, 1);
+    int64_t *indelProbsY = getIndelProbabilitiesFromBuffer(alignedPairs, seqLengthY, 0);
+    for(int64_t i=0; i<alignedPairs->length; i++) {
+        alignedPairs->scores[i] -= gapGamma * (indelProbsX[alignedPairs->x[i]] + indelProbsY[alignedPairs->y[i]]);
+    }
+    free(indelProbsX);
+    free(indelProbsY);
+}
+
 stList *reweightAlignedPairs2(stList *alignedPairs, int64_t seqLengthX, int64_t seqLengthY, double gapGamma) {
     if(gapGamma <= 0.0) {
         return alignedPairs;
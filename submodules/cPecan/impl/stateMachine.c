@@ -314,6 +314,164 @@ static inline double emission_getMatchProb(const double *emissionMatchProbs, Sym
     return emissionMatchProbs[x * SYMBOL_NUMBER_NO_N + y];
 }
 
+///////////////////////////////////
+///////////////////////////////////
+//Vector lanes
+//
+//Used by the diagonal kernels, each lane holding one cell of an x+y diagonal.
+//The width is picked at compile time, if there is no SIMD support the
+//kernels are not compiled and the state machines fall back to cellCalculate.
+///////////////////////////////////
+///////////////////////////////////
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+#define VECTOR_LANES 4
+#define VECTOR_KERNELS 1
+
+typedef __m256d Vector;
+
+#define vector_load(p) _mm256_loadu_pd(p)
+#define vector_store(p, v) _mm256_storeu_pd(p, v)
+#define vector_set1(d) _mm256_set1_pd(d)
+#define vector_add(v1, v2) _mm256_add_pd(v1, v2)
+#define vector_sub(v1, v2) _mm256_sub_pd(v1, v2)
+#define vector_mul(v1, v2) _mm256_mul_pd(v1, v2)
+#define vector_max(v1, v2) _mm256_max_pd(v1, v2)
+#define vector_min(v1, v2) _mm256_min_pd(v1, v2)
+#define vector_or(v1, v2) _mm256_or_pd(v1, v2)
+#define vector_lessThanOrEqual(v1, v2) _mm256_cmp_pd(v1, v2, _CMP_LE_OQ)
+#define vector_greaterThanOrEqual(v1, v2) _mm256_cmp_pd(v1, v2, _CMP_GE_OQ)
+#define vector_equals(v1, v2) _mm256_cmp_pd(v1, v2, _CMP_EQ_OQ)
+#define vector_select(mask, v1, v2) _mm256_blendv_pd(v2, v1, mask) //v1 where mask is set, else v2
+#define vector_all(mask) (_mm256_movemask_pd(mask) == 0xF)
+
+#elif defined(__SSE2__)
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+#define VECTOR_LANES 2
+#define VECTOR_KERNELS 1
+
+typedef __m128d Vector;
+
+#define vector_load(p) _mm_loadu_pd(p)
+#define vector_store(p, v) _mm_storeu_pd(p, v)
+#define vector_set1(d) _mm_set1_pd(d)
+#define vector_add(v1, v2) _mm_add_pd(v1, v2)
+#define vector_sub(v1, v2) _mm_sub_pd(v1, v2)
+#define vector_mul(v1, v2) _mm_mul_pd(v1, v2)
+#define vector_max(v1, v2) _mm_max_pd(v1, v2)
+#define vector_min(v1, v2) _mm_min_pd(v1, v2)
+#define vector_or(v1, v2) _mm_or_pd(v1, v2)
+#define vector_lessThanOrEqual(v1, v2) _mm_cmple_pd(v1, v2)
+#define vector_greaterThanOrEqual(v1, v2) _mm_cmpge_pd(v1, v2)
+#define vector_equals(v1, v2) _mm_cmpeq_pd(v1, v2)
+#define vector_all(mask) (_mm_movemask_pd(mask) == 0x3)
+#if defined(__SSE4_1__)
+#define vector_select(mask, v1, v2) _mm_blendv_pd(v2, v1, mask)
+#else
+#define vector_select(mask, v1, v2) _mm_or_pd(_mm_and_pd(mask, v1), _mm_andnot_pd(mask, v2))
+#endif
+
+#endif
+
+#ifdef VECTOR_KERNELS
+
+#if STATE_MACHINE_DIAGONAL_PADDING % VECTOR_LANES != 0
+#error "Diagonal padding must be a multiple of the vector width"
+#endif
+
+/*
+ * Vector version of logAdd in pairwiseAligner.c. The same polynomial coefficients are used and the operations are done
+ * in the same order, so each lane gives exactly the result of the scalar function, without the branches.
+ */
+static inline Vector vector_logAdd(Vector x, Vector y) {
+    Vector max = vector_max(x, y);
+    Vector min = vector_min(x, y);
+    Vector d = vector_sub(max, min);
+    //Where the smaller term is zero or underflows the result is just the larger term
+    Vector underflow = vector_or(vector_equals(min, vector_set1(LOG_ZERO)),
+            vector_greaterThanOrEqual(d, vector_set1(7.5)));
+    if (vector_all(underflow)) { //Common, as most transitions into a state are dominated by one
+        return max;
+    }
+    //Pick the polynomial for each lane
+    Vector le1 = vector_lessThanOrEqual(d, vector_set1(1.00f));
+    Vector le2 = vector_lessThanOrEqual(d, vector_set1(2.50f));
+    Vector le3 = vector_lessThanOrEqual(d, vector_set1(4.50f));
+    Vector c3 = vector_select(le1, vector_set1(-0.009350833524763f), vector_select(le2, vector_set1(-0.014532321752540f),
+            vector_select(le3, vector_set1(-0.004605031767994f), vector_set1(-0.000458661602210f))));
+    Vector c2 = vector_select(le1, vector_set1(0.130659527668286f), vector_select(le2, vector_set1(0.139942324101744f),
+            vector_select(le3, vector_set1(0.063427417320019f), vector_set1(0.009695946122598f))));
+    Vector c1 = vector_select(le1, vector_set1(0.498799810682272f), vector_select(le2, vector_set1(0.495635523139337f),
+            vector_select(le3, vector_set1(0.695956496475118f), vector_set1(0.930734667215156f))));
+    Vector c0 = vector_select(le1, vector_set1(0.693203116424741f), vector_select(le2, vector_set1(0.692140569840976f),
+            vector_select(le3, vector_set1(0.514272634594009f), vector_set1(0.168037164329057f))));
+    Vector lookup = vector_add(vector_mul(vector_add(vector_mul(vector_add(vector_mul(c3, d), c2), d), c1), d), c0);
+    return vector_select(underflow, max, vector_add(lookup, min));
+}
+
+/*
+ * The emissions for a lane of cells. Tables are indexed by symbol (including n), so that the lookups are branch free.
+ */
+
+typedef struct _emissionTables {
+    double gapX[SYMBOL_NUMBER];
+    double gapY[SYMBOL_NUMBER];
+    double match[SYMBOL_NUMBER * SYMBOL_NUMBER];
+} EmissionTables;
+
+static void emissionTables_load(EmissionTables *eT, const double *emissionGapXProbs, const double *emissionGapYProbs,
+        const double *emissionMatchProbs) {
+    for (int64_t x = 0; x < SYMBOL_NUMBER; x++) {
+        eT->gapX[x] = emission_getGapProb(emissionGapXProbs, x);
+        eT->gapY[x] = emission_getGapProb(emissionGapYProbs, x);
+        for (int64_t y = 0; y < SYMBOL_NUMBER; y++) {
+            eT->match[x * SYMBOL_NUMBER + y] = emission_getMatchProb(emissionMatchProbs, x, y);
+        }
+    }
+}
+
+static inline void emissionTables_getLane(EmissionTables *eT, const Symbol *cX, const Symbol *cY,
+        Vector *eGapX, Vector *eMatch, Vector *eGapY) {
+    double gapX[VECTOR_LANES], match[VECTOR_LANES], gapY[VECTOR_LANES];
+    for (int64_t i = 0; i < VECTOR_LANES; i++) {
+        gapX[i] = eT->gapX[cX[i]];
+        gapY[i] = eT->gapY[cY[i]];
+        match[i] = eT->match[cX[i] * SYMBOL_NUMBER + cY[i]];
+    }
+    *eGapX = vector_load(gapX);
+    *eMatch = vector_load(match);
+    *eGapY = vector_load(gapY);
+}
+
+//Forward transition, adds from[fromState] to to[toState].
+#define VECTOR_FORWARD(to, toState, from, fromState, eP, tP) \
+    to[toState] = vector_logAdd(to[toState], vector_add(from[fromState], vector_add(eP, vector_set1(tP))))
+
+//Backward transition, adds to[toState] to from[fromState].
+#define VECTOR_BACKWARD(to, toState, from, fromState, eP, tP) \
+    from[fromState] = vector_logAdd(from[fromState], vector_add(to[toState], vector_add(eP, vector_set1(tP))))
+
+static inline void vector_loadCells(Vector *v, double *cells, int64_t i, int64_t stride, int64_t stateNumber) {
+    for (int64_t s = 0; s < stateNumber; s++) {
+        v[s] = vector_load(&cells[s * stride + i]);
+    }
+}
+
+static inline void vector_storeCells(Vector *v, double *cells, int64_t i, int64_t stride, int64_t stateNumber) {
+    for (int64_t s = 0; s < stateNumber; s++) {
+        vector_store(&cells[s * stride + i], v[s]);
+    }
+}
+
+#endif
+
 ///////////////////////////////////
 ///////////////////////////////////
 //Five state state-machine
@@ -428,6 +586,79 @@ static void stateMachine5_cellCalculate(StateMachine *sM, double *current, doubl
     }
 }
 
+#ifdef VECTOR_KERNELS
+
+/*
+ * Diagonal kernels for the five state machine. The transitions are applied in the same order as in
+ * stateMachine5_cellCalculate, so that the results are the same as those of the scalar code.
+ */
+
+static void stateMachine5_diagonalCalculateForward(StateMachine *sM, double *current, double *lower, double *middle,
+        double *upper, const Symbol *cX, const Symbol *cY, int64_t width, int64_t stride) {
+    StateMachine5 *sM5 = (StateMachine5 *) sM;
+    EmissionTables eT;
+    emissionTables_load(&eT, sM5->EMISSION_GAP_X_PROBS, sM5->EMISSION_GAP_Y_PROBS, sM5->EMISSION_MATCH_PROBS);
+    Vector c[5], l[5], m[5], u[5], eGapX, eMatch, eGapY;
+    for (int64_t i = 0; i < width; i += VECTOR_LANES) {
+        emissionTables_getLane(&eT, &cX[i], &cY[i], &eGapX, &eMatch, &eGapY);
+        vector_loadCells(c, current, i, stride, 5);
+        vector_loadCells(l, lower, i, stride, 5);
+        vector_loadCells(m, middle, i, stride, 5);
+        vector_loadCells(u, upper, i, stride, 5);
+        VECTOR_FORWARD(c, shortGapX, l, match, eGapX, sM5->TRANSITION_GAP_SHORT_OPEN_X);
+        VECTOR_FORWARD(c, shortGapX, l, shortGapX, eGapX, sM5->TRANSITION_GAP_SHORT_EXTEND_X);
+        VECTOR_FORWARD(c, longGapX, l, match, eGapX, sM5->TRANSITION_GAP_LONG_OPEN_X);
+        VECTOR_FORWARD(c, longGapX, l, longGapX, eGapX, sM5->TRANSITION_GAP_LONG_EXTEND_X);
+        VECTOR_FORWARD(c, match, m, match, eMatch, sM5->TRANSITION_MATCH_CONTINUE);
+        VECTOR_FORWARD(c, match, m, shortGapX, eMatch, sM5->TRANSITION_MATCH_FROM_SHORT_GAP_X);
+        VECTOR_FORWARD(c, match, m, shortGapY, eMatch, sM5->TRANSITION_MATCH_FROM_SHORT_GAP_Y);
+        VECTOR_FORWARD(c, match, m, longGapX, eMatch, sM5->TRANSITION_MATCH_FROM_LONG_GAP_X);
+        VECTOR_FORWARD(c, match, m, longGapY, eMatch, sM5->TRANSITION_MATCH_FROM_LONG_GAP_Y);
+        VECTOR_FORWARD(c, shortGapY, u, match, eGapY, sM5->TRANSITION_GAP_SHORT_OPEN_Y);
+        VECTOR_FORWARD(c, shortGapY, u, shortGapY, eGapY, sM5->TRANSITION_GAP_SHORT_EXTEND_Y);
+        VECTOR_FORWARD(c, longGapY, u, match, eGapY, sM5->TRANSITION_GAP_LONG_OPEN_Y);
+        VECTOR_FORWARD(c, longGapY, u, longGapY, eGapY, sM5->TRANSITION_GAP_LONG_EXTEND_Y);
+        vector_storeCells(c, current, i, stride, 5);
+    }
+}
+
+static void stateMachine5_diagonalCalculateBackward(StateMachine *sM, double *current, double *lower, double *middle,
+        double *upper, const Symbol *cX, const Symbol *cY, int64_t width, int64_t stride) {
+    /*
+     * Lower and upper overlap, the upper cell of the i-th cell being the lower cell of the (i+1)-th cell. The
+     * scalar code adds the upper contributions to a cell before the lower ones, so we do the same here.
+     */
+    StateMachine5 *sM5 = (StateMachine5 *) sM;
+    EmissionTables eT;
+    emissionTables_load(&eT, sM5->EMISSION_GAP_X_PROBS, sM5->EMISSION_GAP_Y_PROBS, sM5->EMISSION_MATCH_PROBS);
+    Vector c[5], l[5], m[5], u[5], eGapX, eMatch, eGapY;
+    for (int64_t i = 0; i < width; i += VECTOR_LANES) {
+        emissionTables_getLane(&eT, &cX[i], &cY[i], &eGapX, &eMatch, &eGapY);
+        vector_loadCells(c, current, i, stride, 5);
+        vector_loadCells(u, upper, i, stride, 5);
+        VECTOR_BACKWARD(c, shortGapY, u, match, eGapY, sM5->TRANSITION_GAP_SHORT_OPEN_Y);
+        VECTOR_BACKWARD(c, shortGapY, u, shortGapY, eGapY, sM5->TRANSITION_GAP_SHORT_EXTEND_Y);
+        VECTOR_BACKWARD(c, longGapY, u, match, eGapY, sM5->TRANSITION_GAP_LONG_OPEN_Y);
+        VECTOR_BACKWARD(c, longGapY, u, longGapY, eGapY, sM5->TRANSITION_GAP_LONG_EXTEND_Y);
+        vector_storeCells(u, upper, i, stride, 5);
+        vector_loadCells(l, lower, i, stride, 5);
+        VECTOR_BACKWARD(c, shortGapX, l, match, eGapX, sM5->TRANSITION_GAP_SHORT_OPEN_X);
+        VECTOR_BACKWARD(c, shortGapX, l, shortGapX, eGapX, sM5->TRANSITION_GAP_SHORT_EXTEND_X);
+        VECTOR_BACKWARD(c, longGapX, l, match, eGapX, sM5->TRANSITION_GAP_LONG_OPEN_X);
+        VECTOR_BACKWARD(c, longGapX, l, longGapX, eGapX, sM5->TRANSITION_GAP_LONG_EXTEND_X);
+        vector_storeCells(l, lower, i, stride, 5);
+        vector_loadCells(m, middle, i, stride, 5);
+        VECTOR_BACKWARD(c, match, m, match, eMatch, sM5->TRANSITION_MATCH_CONTINUE);
+        VECTOR_BACKWARD(c, match, m, shortGapX, eMatch, sM5->TRANSITION_MATCH_FROM_SHORT_GAP_X);
+        VECTOR_BACKWARD(c, match, m, shortGapY, eMatch, sM5->TRANSITION_MATCH_FROM_SHORT_GAP_Y);
+        VECTOR_BACKWARD(c, match, m, longGapX, eMatch, sM5->TRANSITION_MATCH_FROM_LONG_GAP_X);
+        VECTOR_BACKWARD(c, match, m, longGapY, eMatch, sM5->TRANSITION_MATCH_FROM_LONG_GAP_Y);
+        vector_storeCells(m, middle, i, stride, 5);
+    }
+}
+
+#endif
+
 StateMachine *stateMachine5_construct(StateMachineType type) {
     StateMachine5 *sM5 = st_malloc(sizeof(StateMachine5));
     sM5->TRANSITION_MATCH_CONTINUE = -0.030064059121770816; //0.9703833696510062f
@@ -463,6 +694,13 @@ StateMachine *stateMachine5_construct(StateMachineType type) {
     sM5->model.raggedStartStateProb = stateMachine5_raggedStartStateProb;
     sM5->model.raggedEndStateProb = stateMachine5_raggedEndStateProb;
     sM5->model.cellCalculate = stateMachine5_cellCalculate;
+#ifdef VECTOR_KERNELS
+    sM5->model.diagonalCalculateForward = stateMachine5_diagonalCalculateForward;
+    sM5->model.diagonalCalculateBackward = stateMachine5_diagonalCalculateBackward;
+#else
+    sM5->model.diagonalCalculateForward = NULL;
+    sM5->model.diagonalCalculateBackward = NULL;
+#endif
 
     return (StateMachine *) sM5;
 }
@@ -660,6 +898,66 @@ static void stateMachine3_cellCalculate(StateMachine *sM, double *current, doubl
     }
 }
 
+#ifdef VECTOR_KERNELS
+
+/*
+ * Diagonal kernels for the three state machine, see the five state kernels.
+ */
+
+static void stateMachine3_diagonalCalculateForward(StateMachine *sM, double *current, double *lower, double *middle,
+        double *upper, const Symbol *cX, const Symbol *cY, int64_t width, int64_t stride) {
+    StateMachine3 *sM3 = (StateMachine3 *) sM;
+    EmissionTables eT;
+    emissionTables_load(&eT, sM3->EMISSION_GAP_X_PROBS, sM3->EMISSION_GAP_Y_PROBS, sM3->EMISSION_MATCH_PROBS);
+    Vector c[3], l[3], m[3], u[3], eGapX, eMatch, eGapY;
+    for (int64_t i = 0; i < width; i += VECTOR_LANES) {
+        emissionTables_getLane(&eT, &cX[i], &cY[i], &eGapX, &eMatch, &eGapY);
+        vector_loadCells(c, current, i, stride, 3);
+        vector_loadCells(l, lower, i, stride, 3);
+        vector_loadCells(m, middle, i, stride, 3);
+        vector_loadCells(u, upper, i, stride, 3);
+        VECTOR_FORWARD(c, shortGapX, l, match, eGapX, sM3->TRANSITION_GAP_OPEN_X);
+        VECTOR_FORWARD(c, shortGapX, l, shortGapX, eGapX, sM3->TRANSITION_GAP_EXTEND_X);
+        VECTOR_FORWARD(c, shortGapX, l, shortGapY, eGapX, sM3->TRANSITION_GAP_SWITCH_TO_X);
+        VECTOR_FORWARD(c, match, m, match, eMatch, sM3->TRANSITION_MATCH_CONTINUE);
+        VECTOR_FORWARD(c, match, m, shortGapX, eMatch, sM3->TRANSITION_MATCH_FROM_GAP_X);
+        VECTOR_FORWARD(c, match, m, shortGapY, eMatch, sM3->TRANSITION_MATCH_FROM_GAP_Y);
+        VECTOR_FORWARD(c, shortGapY, u, match, eGapY, sM3->TRANSITION_GAP_OPEN_Y);
+        VECTOR_FORWARD(c, shortGapY, u, shortGapY, eGapY, sM3->TRANSITION_GAP_EXTEND_Y);
+        VECTOR_FORWARD(c, shortGapY, u, shortGapX, eGapY, sM3->TRANSITION_GAP_SWITCH_TO_Y);
+        vector_storeCells(c, current, i, stride, 3);
+    }
+}
+
+static void stateMachine3_diagonalCalculateBackward(StateMachine *sM, double *current, double *lower, double *middle,
+        double *upper, const Symbol *cX, const Symbol *cY, int64_t width, int64_t stride) {
+    StateMachine3 *sM3 = (StateMachine3 *) sM;
+    EmissionTables eT;
+    emissionTables_load(&eT, sM3->EMISSION_GAP_X_PROBS, sM3->EMISSION_GAP_Y_PROBS, sM3->EMISSION_MATCH_PROBS);
+    Vector c[3], l[3], m[3], u[3], eGapX, eMatch, eGapY;
+    for (int64_t i = 0; i < width; i += VECTOR_LANES) {
+        emissionTables_getLane(&eT, &cX[i], &cY[i], &eGapX, &eMatch, &eGapY);
+        vector_loadCells(c, current, i, stride, 3);
+        vector_loadCells(u, upper, i, stride, 3);
+        VECTOR_BACKWARD(c, shortGapY, u, match, eGapY, sM3->TRANSITION_GAP_OPEN_Y);
+        VECTOR_BACKWARD(c, shortGapY, u, shortGapY, eGapY, sM3->TRANSITION_GAP_EXTEND_Y);
+        VECTOR_BACKWARD(c, shortGapY, u, shortGapX, eGapY, sM3->TRANSITION_GAP_SWITCH_TO_Y);
+        vector_storeCells(u, upper, i, stride, 3);
+        vector_loadCells(l, lower, i, stride, 3);
+        VECTOR_BACKWARD(c, shortGapX, l, match, eGapX, sM3->TRANSITION_GAP_OPEN_X);
+        VECTOR_BACKWARD(c, shortGapX, l, shortGapX, eGapX, sM3->TRANSITION_GAP_EXTEND_X);
+        VECTOR_BACKWARD(c, shortGapX, l, shortGapY, eGapX, sM3->TRANSITION_GAP_SWITCH_TO_X);
+        vector_storeCells(l, lower, i, stride, 3);
+        vector_loadCells(m, middle, i, stride, 3);
+        VECTOR_BACKWARD(c, match, m, match, eMatch, sM3->TRANSITION_MATCH_CONTINUE);
+        VECTOR_BACKWARD(c, match, m, shortGapX, eMatch, sM3->TRANSITION_MATCH_FROM_GAP_X);
+        VECTOR_BACKWARD(c, match, m, shortGapY, eMatch, sM3->TRANSITION_MATCH_FROM_GAP_Y);
+        vector_storeCells(m, middle, i, stride, 3);
+    }
+}
+
+#endif
+
 StateMachine *stateMachine3_construct(StateMachineType type) {
     StateMachine3 *sM3 = st_malloc(sizeof(StateMachine3));
     sM3->TRANSITION_MATCH_CONTINUE = -0.030064059121770816; //0.9703833696510062f
@@ -685,6 +983,13 @@ StateMachine *stateMachine3_construct(StateMachineType type) {
     sM3->model.raggedStartStateProb = stateMachine3_raggedStartStateProb;
     sM3->model.raggedEndStateProb = stateMachine3_raggedEndStateProb;
     sM3->model.cellCalculate = stateMachine3_cellCalculate;
+#ifdef VECTOR_KERNELS
+    sM3->model.diagonalCalculateForward = stateMachine3_diagonalCalculateForward;
+    sM3->model.diagonalCalculateBackward = stateMachine3_diagonalCalculateBackward;
+#else
+    sM3->model.diagonalCalculateForward = NULL;
+    sM3->model.diagonalCalculateBackward = NULL;
+#endif
 
     return (StateMachine *) sM3;
 }
@@ -0,0 +1,73 @@
+/*
+ * alignedPairBuffer.h
+ *
+ *  Packed storage for the aligned pairs computed by the pairwise aligner.
+ */
+
+#ifndef ALIGNEDPAIRBUFFER_H_
+#define ALIGNEDPAIRBUFFER_H_
+
+#include "sonLib.h"
+
+/*
+ * A growable array of aligned pairs, each a (score, x, y) triple, stored as three parallel arrays that
+ * share a single allocation. This replaces a list of stIntTuples, which costs an allocation and a pointer
+ * per pair.
+ */
+typedef struct _alignedPairBuffer {
+    int64_t length;
+    int64_t maxLength;
+    int64_t *scores;
+    int64_t *x;
+    int64_t *y;
+} AlignedPairBuffer;
+
+AlignedPairBuffer *alignedPairBuffer_construct(int64_t maxLength);
+
+void alignedPairBuffer_destruct(AlignedPairBuffer *buffer);
+
+/*
+ * Ensures the buffer can hold at least maxLength pairs without reallocating.
+ */
+void alignedPairBuffer_reserve(AlignedPairBuffer *buffer, int64_t maxLength);
+
+static inline void alignedPairBuffer_append(AlignedPairBuffer *buffer, int64_t score, int64_t x, int64_t y) {
+    if (buffer->length == buffer->maxLength) {
+        alignedPairBuffer_reserve(buffer, buffer->maxLength * 2 + 16);
+    }
+    buffer->scores[buffer->length] = score;
+    buffer->x[buffer->length] = x;
+    buffer->y[buffer->length++] = y;
+}
+
+static inline int64_t alignedPairBuffer_length(AlignedPairBuffer *buffer) {
+    return buffer->length;
+}
+
+/*
+ * Adds the given offsets to the coordinates of the pairs from index start onwards.
+ */
+void alignedPairBuffer_shift(AlignedPairBuffer *buffer, int64_t start, int64_t offsetX, int64_t offsetY);
+
+/*
+ * Sorts the pairs by x coordinate, then y coordinate, then score.
+ */
+void alignedPairBuffer_sort(AlignedPairBuffer *buffer);
+
+/*
+ * Removes, in place, the pairs for which fn returns false, keeping the order of the remaining pairs.
+ */
+void alignedPairBuffer_filter(AlignedPairBuffer *buffer, bool (*fn)(int64_t score, int64_t x, int64_t y, void *extraArg),
+        void *extraArg);
+
+/*
+ * Sum of the scores of the pairs.
+ */
+int64_t alignedPairBuffer_getTotalScore(AlignedPairBuffer *buffer);
+
+/*
+ * Converts to the list of (score, x, y) stIntTuples used by the older interface.
+ */
+stList *alignedPairBuffer_getList(AlignedPairBuffer *buffer);
+
+#endif /* ALIGNEDPAIRBUFFER_H_ */
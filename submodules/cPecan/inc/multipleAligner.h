@@ -66,6 +66,11 @@ void seqFrag_destruct(SeqFrag *seqFrag);
  */
 stList *filterPairwiseAlignmentToMakePairsOrdered(stList *alignedPairs, const char *seqX, const char *seqY, float matchGamma);
 
+/*
+ * As filterPairwiseAlignmentToMakePairsOrdered, but removing the pairs not in the alignment from the buffer in place.
+ */
+void filterAlignedPairBufferToMakePairsOrdered(AlignedPairBuffer *alignedPairs, const char *seqX, const char *seqY, float matchGamma);
+
 /*
  * Declarations for functions tested by unit-tests, but probably not really useful for stuff outside of this module.
  */
@@ -18,6 +18,7 @@
 #include "sonLib.h"
 #include "pairwiseAlignment.h"
 #include "stateMachine.h"
+#include "alignedPairBuffer.h"
 
 //The exception string
 extern const char *PAIRWISE_ALIGNMENT_EXCEPTION_ID;
@@ -36,6 +37,9 @@ typedef struct _pairwiseAlignmentBandingParameters {
     int64_t splitMatrixBiggerThanThis; //Any matrix in the anchors bigger than this is split into two.
     bool alignAmbiguityCharacters;
     float gapGamma; //The AMAP gap-gamma parameter which controls the degree to which indel probabilities are factored into the alignment.
+    bool useLastzForAnchors; //Find anchors by running lastz instead of using the in process seed and chain anchorer.
+    int64_t numThreads; //Number of threads with which to compute the pairwise alignments of a multiple alignment. Must be one with useLastzForAnchors, as getBlastPairs is not thread safe.
+    int64_t dpMemoryLimit; //If greater than zero, bytes of forward matrix above which only checkpoint diagonals are stored, the others being recomputed.
 } PairwiseAlignmentParameters;
 
 PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters_construct();
@@ -51,6 +55,15 @@ stList *convertPairwiseForwardStrandAlignmentToAnchorPairs(struct PairwiseAlignm
 
 stList *getAlignedPairsUsingAnchors(StateMachine *sM, const char *sX, const char *sY, stList *anchorPairs, PairwiseAlignmentParameters *p, bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd);
 
+/*
+ * As getAlignedPairs and getAlignedPairsUsingAnchors, but returning the (score, x, y) pairs in a packed buffer.
+ */
+AlignedPairBuffer *getAlignedPairBuffer(StateMachine *sM, const char *sX, const char *sY, PairwiseAlignmentParameters *p,
+        bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd);
+
+AlignedPairBuffer *getAlignedPairBufferUsingAnchors(StateMachine *sM, const char *sX, const char *sY, stList *anchorPairs,
+        PairwiseAlignmentParameters *p, bool alignmentHasRaggedLeftEnd, bool alignmentHasRaggedRightEnd);
+
 /*
  * Expectation calculation functions for EM algorithms.
  */
@@ -174,6 +187,8 @@ DpDiagonal *dpMatrix_getDiagonal(DpMatrix *dpMatrix, int64_t xay);
 
 int64_t dpMatrix_getActiveDiagonalNumber(DpMatrix *dpMatrix);
 
+int64_t dpMatrix_getActiveCellNumber(DpMatrix *dpMatrix);
+
 DpDiagonal *dpMatrix_createDiagonal(DpMatrix *dpMatrix, Diagonal diagonal);
 
 void dpMatrix_deleteDiagonal(DpMatrix *dpMatrix, int64_t xay);
@@ -187,10 +202,16 @@ void diagonalCalculationBackward(StateMachine *sM, int64_t xay, DpMatrix *dpMatr
 double diagonalCalculationTotalProbability(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, DpMatrix *backwardDpMatrix,
         const SymbolString sX, const SymbolString sY);
 
+//Appends the posterior match probabilities of the diagonal, as (score, x, y) stIntTuples, to the stList in extraArgs[0].
 void diagonalCalculationPosteriorMatchProbs(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, DpMatrix *backwardDpMatrix,
         const SymbolString sX, const SymbolString sY,
         double totalProbability, PairwiseAlignmentParameters *p, void *extraArgs);
 
+//As diagonalCalculationPosteriorMatchProbs, but appending to the AlignedPairBuffer in extraArgs[0].
+void diagonalCalculationPosteriorMatchProbsToBuffer(StateMachine *sM, int64_t xay, DpMatrix *forwardDpMatrix, DpMatrix *backwardDpMatrix,
+        const SymbolString sX, const SymbolString sY,
+        double totalProbability, PairwiseAlignmentParameters *p, void *extraArgs);
+
 //Banded matrix calculation of posterior probs
 
 void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const SymbolString sX, const SymbolString sY,
@@ -202,6 +223,8 @@ void getPosteriorProbsWithBanding(StateMachine *sM, stList *anchorPairs, const S
 
 stList *getBlastPairs(const char *sX, const char *sY, int64_t lX, int64_t lY, int64_t trim, bool repeatMask);
 
+stList *getSeedPairs(const char *sX, const char *sY, int64_t lX, int64_t lY, int64_t trim, bool repeatMask);
+
 stList *getBlastPairsForPairwiseAlignmentParameters(const char *sX, const char *sY, const int64_t lX, const int64_t lY,
         PairwiseAlignmentParameters *p);
 
@@ -228,4 +251,7 @@ stList *reweightAlignedPairs(stList *alignedPairs,
 
 stList *reweightAlignedPairs2(stList *alignedPairs, int64_t seqLengthX, int64_t seqLengthY, double gapGamma);
 
+//As reweightAlignedPairs2, but updates the scores of the buffer in place.
+void reweightAlignedPairBuffer(AlignedPairBuffer *alignedPairs, int64_t seqLengthX, int64_t seqLengthY, double gapGamma);
+
 #endif /* PAIRWISEALIGNER_H_ */
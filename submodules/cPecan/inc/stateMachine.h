@@ -50,8 +50,22 @@ struct _stateMachine {
     //Cells (states at a given coordinate(
     void (*cellCalculate)(StateMachine *sM, double *current, double *lower, double *middle, double *upper, Symbol cX, Symbol cY,
             void(*doTransition)(double *, double *, int64_t, int64_t, double, double, void *), void *extraArgs);
+
+    //Diagonals (all the cells of an x+y diagonal at once). These are optional, vectorised versions of the forward and
+    //backward cell calculations, and are NULL if the state machine has no such kernel, in which case cellCalculate is used.
+    //Cells are stored as structure-of-arrays, state s of the i-th cell being at cells[s * stride + i]. Lower and upper
+    //are the cells of the previous diagonal at xmy - 1 and xmy + 1 of the i-th current cell, middle the cell of the
+    //diagonal before that at xmy. cX and cY are the symbols of the current cells. All arrays must be padded to a multiple
+    //of STATE_MACHINE_DIAGONAL_PADDING beyond width, padding cells being LOG_ZERO.
+    void (*diagonalCalculateForward)(StateMachine *sM, double *current, double *lower, double *middle, double *upper,
+            const Symbol *cX, const Symbol *cY, int64_t width, int64_t stride);
+
+    void (*diagonalCalculateBackward)(StateMachine *sM, double *current, double *lower, double *middle, double *upper,
+            const Symbol *cX, const Symbol *cY, int64_t width, int64_t stride);
 };
 
+#define STATE_MACHINE_DIAGONAL_PADDING 4
+
 /*
  * Hmm for loading/unloading HMMs and storing expectations.
  */
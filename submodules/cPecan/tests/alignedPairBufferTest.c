@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "CuTest.h"
+#include "sonLib.h"
+#include "pairwiseAligner.h"
+#include "multipleAligner.h"
+#include "alignedPairBuffer.h"
+#include "randomSequences.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void checkBufferEqualsList(CuTest *testCase, AlignedPairBuffer *buffer, stList *alignedPairs) {
+    CuAssertIntEquals(testCase, stList_length(alignedPairs), alignedPairBuffer_length(buffer));
+    for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
+        stIntTuple *alignedPair = stList_get(alignedPairs, i);
+        CuAssertIntEquals(testCase, stIntTuple_get(alignedPair, 0), buffer->scores[i]);
+        CuAssertIntEquals(testCase, stIntTuple_get(alignedPair, 1), buffer->x[i]);
+        CuAssertIntEquals(testCase, stIntTuple_get(alignedPair, 2), buffer->y[i]);
+    }
+}
+
+static int cmpAlignedPairs(stIntTuple *alignedPair1, stIntTuple *alignedPair2) {
+    //Same order as alignedPairBuffer_sort, by x, then y, then score.
+    for (int64_t i = 1; i < 4; i++) {
+        int64_t j = stIntTuple_get(alignedPair1, i % 3), k = stIntTuple_get(alignedPair2, i % 3);
+        if (j != k) {
+            return j < k ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static bool keepEvenScores(int64_t score, int64_t x, int64_t y, void *extraArg) {
+    return score % 2 == 0;
+}
+
+static void test_alignedPairBuffer(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        //Make a random list of pairs and the equivalent buffer
+        stList *alignedPairs = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+        AlignedPairBuffer *buffer = alignedPairBuffer_construct(st_randomInt(0, 10));
+        AlignedPairBuffer *buffer2 = alignedPairBuffer_construct(0);
+        int64_t pairNumber = st_randomInt(0, 1000);
+        for (int64_t i = 0; i < pairNumber; i++) {
+            int64_t score = st_randomInt(0, 100), x = st_randomInt(0, 100), y = st_randomInt(0, 100);
+            stList_append(alignedPairs, stIntTuple_construct3(score, x, y));
+            alignedPairBuffer_append(buffer, score, x, y);
+            alignedPairBuffer_append(buffer2, score, x, y);
+        }
+        checkBufferEqualsList(testCase, buffer, alignedPairs);
+        checkBufferEqualsList(testCase, buffer2, alignedPairs);
+
+        //Converter
+        stList *alignedPairs2 = alignedPairBuffer_getList(buffer);
+        checkBufferEqualsList(testCase, buffer, alignedPairs2);
+        stList_destruct(alignedPairs2);
+
+        //Total score
+        int64_t totalScore = 0;
+        for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
+            totalScore += stIntTuple_get(stList_get(alignedPairs, i), 0);
+        }
+        CuAssertIntEquals(testCase, totalScore, alignedPairBuffer_getTotalScore(buffer));
+
+        //Shift
+        int64_t start = st_randomInt(0, pairNumber + 1);
+        alignedPairBuffer_shift(buffer, start, 5, 7);
+        CuAssertIntEquals(testCase, pairNumber, alignedPairBuffer_length(buffer));
+        for (int64_t i = 0; i < pairNumber; i++) {
+            stIntTuple *alignedPair = stList_get(alignedPairs, i);
+            int64_t offsetX = i >= start ? 5 : 0, offsetY = i >= start ? 7 : 0;
+            CuAssertIntEquals(testCase, stIntTuple_get(alignedPair, 0), buffer->scores[i]);
+            CuAssertIntEquals(testCase, stIntTuple_get(alignedPair, 1) + offsetX, buffer->x[i]);
+            CuAssertIntEquals(testCase, stIntTuple_get(alignedPair, 2) + offsetY, buffer->y[i]);
+        }
+        alignedPairBuffer_destruct(buffer);
+
+        //Sort
+        alignedPairBuffer_sort(buffer2);
+        stList_sort(alignedPairs, (int (*)(const void *, const void *)) cmpAlignedPairs);
+        checkBufferEqualsList(testCase, buffer2, alignedPairs);
+
+        //Filter
+        alignedPairBuffer_filter(buffer2, keepEvenScores, NULL);
+        for (int64_t i = stList_length(alignedPairs) - 1; i >= 0; i--) {
+            if (stIntTuple_get(stList_get(alignedPairs, i), 0) % 2 != 0) {
+                stIntTuple_destruct(stList_remove(alignedPairs, i));
+            }
+        }
+        checkBufferEqualsList(testCase, buffer2, alignedPairs);
+
+        alignedPairBuffer_destruct(buffer2);
+        stList_destruct(alignedPairs);
+    }
+}
+
+static void test_getAlignedPairBuffer(CuTest *testCase) {
+    /*
+     * Checks the buffered pipeline gives the same pairs as the list based one.
+     */
+    StateMachine *sM = stateMachine5_construct(fiveState);
+    PairwiseAlignmentParameters *p = pairwiseAlignmentBandingParameters_construct();
+    p->splitMatrixBiggerThanThis = 50 * 50; //So that the coordinates of split matrices are corrected
+    for (int64_t test = 0; test < 20; test++) {
+        char *sX = getRandomSequence(st_randomInt(0, 300));
+        char *sY = evolveSequence(sX);
+        int64_t lX = strlen(sX), lY = strlen(sY);
+
+        stList *alignedPairs = getAlignedPairs(sM, sX, sY, p, 0, 0);
+        AlignedPairBuffer *buffer = getAlignedPairBuffer(sM, sX, sY, p, 0, 0);
+        alignedPairBuffer_sort(buffer);
+        stList_sort(alignedPairs, (int (*)(const void *, const void *)) cmpAlignedPairs);
+        checkBufferEqualsList(testCase, buffer, alignedPairs);
+
+        //Reweighting
+        alignedPairs = reweightAlignedPairs2(alignedPairs, lX, lY, p->gapGamma);
+        reweightAlignedPairBuffer(buffer, lX, lY, p->gapGamma);
+        checkBufferEqualsList(testCase, buffer, alignedPairs);
+
+        //Filtering to an ordered alignment
+        filterAlignedPairBufferToMakePairsOrdered(buffer, sX, sY, 0.2);
+        alignedPairBuffer_sort(buffer);
+        for (int64_t i = 1; i < alignedPairBuffer_length(buffer); i++) {
+            CuAssertTrue(testCase, buffer->x[i - 1] < buffer->x[i]);
+            CuAssertTrue(testCase, buffer->y[i - 1] < buffer->y[i]);
+        }
+
+        alignedPairBuffer_destruct(buffer);
+        stList_destruct(alignedPairs);
+        free(sX);
+        free(sY);
+    }
+    pairwiseAlignmentBandingParameters_destruct(p);
+    stateMachine_destruct(sM);
+}
+
+CuSuite* alignedPairBufferTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_alignedPairBuffer);
+    SUITE_ADD_TEST(suite, test_getAlignedPairBuffer);
+    return suite;
+}
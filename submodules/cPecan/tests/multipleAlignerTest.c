@@ -231,6 +231,32 @@ static void test_multipleAlignerRandom(CuTest *testCase) {
     }
 }
 
+static void test_makeAllPairwiseAlignmentsThreaded(CuTest *testCase) {
+    //The pairwise alignments computed with several threads should be identical to those computed with one.
+    for (int64_t test = 0; test < 5; test++) {
+        setup();
+        stList *seqFrags = getRandomSeqFrags(st_randomInt(0, 10), 100);
+        stList *seqPairSimilarityScores, *threadedSeqPairSimilarityScores;
+        stList *multipleAlignedPairs = makeAllPairwiseAlignments(stateMachine, seqFrags, pabp, &seqPairSimilarityScores);
+        pabp->numThreads = 4;
+        stList *threadedMultipleAlignedPairs = makeAllPairwiseAlignments(stateMachine, seqFrags, pabp, &threadedSeqPairSimilarityScores);
+        CuAssertIntEquals(testCase, stList_length(multipleAlignedPairs), stList_length(threadedMultipleAlignedPairs));
+        for (int64_t i = 0; i < stList_length(multipleAlignedPairs); i++) {
+            CuAssertTrue(testCase, stIntTuple_equalsFn(stList_get(multipleAlignedPairs, i), stList_get(threadedMultipleAlignedPairs, i)));
+        }
+        CuAssertIntEquals(testCase, stList_length(seqPairSimilarityScores), stList_length(threadedSeqPairSimilarityScores));
+        for (int64_t i = 0; i < stList_length(seqPairSimilarityScores); i++) {
+            CuAssertTrue(testCase, stIntTuple_equalsFn(stList_get(seqPairSimilarityScores, i), stList_get(threadedSeqPairSimilarityScores, i)));
+        }
+        stList_destruct(seqFrags);
+        stList_destruct(multipleAlignedPairs);
+        stList_destruct(threadedMultipleAlignedPairs);
+        stList_destruct(seqPairSimilarityScores);
+        stList_destruct(threadedSeqPairSimilarityScores);
+        teardown();
+    }
+}
+
 CuSuite* multipleAlignerTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_getDistanceMatrix);
@@ -241,6 +267,7 @@ CuSuite* multipleAlignerTestSuite(void) {
     SUITE_ADD_TEST(suite, test_makeAlignmentUsingAllPairs);
     SUITE_ADD_TEST(suite, test_multipleAlignerAllPairsRandom);
     SUITE_ADD_TEST(suite, test_multipleAlignerRandom);
+    SUITE_ADD_TEST(suite, test_makeAllPairwiseAlignmentsThreaded);
 
     return suite;
 }
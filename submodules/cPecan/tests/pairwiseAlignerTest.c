@@ -366,6 +366,99 @@ static void checkAlignedPairs(CuTest *testCase, stList *blastPairs, int64_t lX,
     stSortedSet_destruct(pairs);
 }
 
+static void checkDiagonalsEqual(CuTest *testCase, DpDiagonal *dpDiagonal1, DpDiagonal *dpDiagonal2, Diagonal d, int64_t stateNumber) {
+    for (int64_t xmy = diagonal_getMinXmy(d); xmy <= diagonal_getMaxXmy(d); xmy += 2) {
+        double *cell1 = dpDiagonal_getCell(dpDiagonal1, xmy);
+        double *cell2 = dpDiagonal_getCell(dpDiagonal2, xmy);
+        for (int64_t s = 0; s < stateNumber; s++) {
+            if (cell1[s] == LOG_ZERO || cell2[s] == LOG_ZERO) {
+                CuAssertTrue(testCase, cell1[s] == cell2[s]);
+            } else {
+                CuAssertDblEquals(testCase, cell1[s], cell2[s], 0.0000000001);
+            }
+        }
+    }
+}
+
+static void test_diagonalKernels(CuTest *testCase) {
+    /*
+     * Checks the vectorised diagonal kernels of the state machines against the scalar cell calculations.
+     */
+    StateMachineType types[4] = { fiveState, fiveStateAsymmetric, threeState, threeStateAsymmetric };
+    for (int64_t test = 0; test < 100; test++) {
+        StateMachineType type = types[test % 4];
+        Hmm *hmm = hmm_constructEmpty(0.0, type);
+        hmm_randomise(hmm);
+        StateMachine *sM = hmm_getStateMachine(hmm);
+        StateMachine *sMScalar = hmm_getStateMachine(hmm); //Uses the scalar cell calculations as a reference
+        sMScalar->diagonalCalculateForward = NULL;
+        sMScalar->diagonalCalculateBackward = NULL;
+
+        char *sX = getRandomSequence(st_randomInt(0, 50));
+        char *sY = evolveSequence(sX);
+        int64_t lX = strlen(sX), lY = strlen(sY);
+        SymbolString sX2 = symbolString_construct(sX, lX);
+        SymbolString sY2 = symbolString_construct(sY, lY);
+        stList *anchorPairs = getRandomAnchorPairs(lX, lY);
+        Band *band = band_construct(anchorPairs, lX, lY, 2 * st_randomInt(0, 10));
+        BandIterator *bandIt = bandIterator_construct(band);
+
+        DpMatrix *dpMatrices[4];
+        for (int64_t i = 0; i < 4; i++) {
+            dpMatrices[i] = dpMatrix_construct(lX + lY, sM->stateNumber);
+        }
+        for (int64_t i = 0; i <= lX + lY; i++) {
+            Diagonal d = bandIterator_getNext(bandIt);
+            for (int64_t j = 0; j < 4; j++) {
+                dpDiagonal_zeroValues(dpMatrix_createDiagonal(dpMatrices[j], d));
+            }
+        }
+        dpDiagonal_initialiseValues(dpMatrix_getDiagonal(dpMatrices[0], 0), sM, sM->startStateProb);
+        dpDiagonal_initialiseValues(dpMatrix_getDiagonal(dpMatrices[1], 0), sM, sM->startStateProb);
+        dpDiagonal_initialiseValues(dpMatrix_getDiagonal(dpMatrices[2], lX + lY), sM, sM->endStateProb);
+        dpDiagonal_initialiseValues(dpMatrix_getDiagonal(dpMatrices[3], lX + lY), sM, sM->endStateProb);
+
+        for (int64_t i = 1; i <= lX + lY; i++) {
+            diagonalCalculationForward(sM, i, dpMatrices[0], sX2, sY2);
+            diagonalCalculationForward(sMScalar, i, dpMatrices[1], sX2, sY2);
+        }
+        for (int64_t i = lX + lY; i > 0; i--) {
+            diagonalCalculationBackward(sM, i, dpMatrices[2], sX2, sY2);
+            diagonalCalculationBackward(sMScalar, i, dpMatrices[3], sX2, sY2);
+        }
+
+        for (int64_t i = 0; i <= lX + lY; i++) {
+            Diagonal d = bandIterator_getPrevious(bandIt);
+            checkDiagonalsEqual(testCase, dpMatrix_getDiagonal(dpMatrices[0], diagonal_getXay(d)),
+                    dpMatrix_getDiagonal(dpMatrices[1], diagonal_getXay(d)), d, sM->stateNumber);
+            checkDiagonalsEqual(testCase, dpMatrix_getDiagonal(dpMatrices[2], diagonal_getXay(d)),
+                    dpMatrix_getDiagonal(dpMatrices[3], diagonal_getXay(d)), d, sM->stateNumber);
+            CuAssertDblEquals(testCase,
+                    diagonalCalculationTotalProbability(sM, diagonal_getXay(d), dpMatrices[0], dpMatrices[2], sX2, sY2),
+                    diagonalCalculationTotalProbability(sMScalar, diagonal_getXay(d), dpMatrices[1], dpMatrices[3], sX2, sY2),
+                    0.0000000001);
+        }
+
+        //Cleanup
+        for (int64_t i = 0; i < 4; i++) {
+            for (int64_t j = 0; j <= lX + lY; j++) {
+                dpMatrix_deleteDiagonal(dpMatrices[i], j);
+            }
+            dpMatrix_destruct(dpMatrices[i]);
+        }
+        bandIterator_destruct(bandIt);
+        band_destruct(band);
+        stList_destruct(anchorPairs);
+        free(sX2.sequence);
+        free(sY2.sequence);
+        free(sX);
+        free(sY);
+        stateMachine_destruct(sM);
+        stateMachine_destruct(sMScalar);
+        hmm_destruct(hmm);
+    }
+}
+
 static void test_getAlignedPairsWithBanding(CuTest *testCase) {
     for (int64_t test = 0; test < 100; test++) {
         //Make a pair of sequences
@@ -452,6 +545,126 @@ static void test_getBlastPairs(CuTest *testCase) {
     }
 }
 
+static void test_getSeedPairs(CuTest *testCase) {
+    /*
+     * Test the in process seed and chain anchorer, comparing its anchors to those found by lastz.
+     */
+    for (int64_t test = 0; test < 10; test++) {
+        //Make a pair of sequences
+        char *seqX = getRandomSequence(st_randomInt(0, 10000));
+        char *seqY = evolveSequence(seqX);
+        int64_t lX = strlen(seqX), lY = strlen(seqY);
+
+        int64_t trim = st_randomInt(0, 5);
+        bool repeatMask = st_random() > 0.5;
+        st_logInfo("Using random trim %" PRIi64 ", repeat mask %" PRIi64 " \n", trim, repeatMask);
+
+        stList *seedPairs = getSeedPairs(seqX, seqY, lX, lY, trim, repeatMask);
+        checkBlastPairs(testCase, seedPairs, lX, lY, 1);
+
+        //The anchors should largely agree with those of lastz
+        stList *blastPairs = getBlastPairs(seqX, seqY, lX, lY, trim, repeatMask);
+        stSortedSet *blastPairsSet = stList_getSortedSet(blastPairs, (int (*)(const void *, const void *)) stIntTuple_cmpFn);
+        int64_t sharedPairs = 0;
+        for (int64_t i = 0; i < stList_length(seedPairs); i++) {
+            if (stSortedSet_search(blastPairsSet, stList_get(seedPairs, i)) != NULL) {
+                sharedPairs++;
+            }
+        }
+        st_logInfo("Got %" PRIi64 " seed pairs and %" PRIi64 " blast pairs, of which %" PRIi64 " are shared\n",
+                stList_length(seedPairs), stList_length(blastPairs), sharedPairs);
+        if (!repeatMask && stList_length(blastPairs) > 1000) {
+            CuAssertTrue(testCase, stList_length(seedPairs) > 0);
+        }
+        if (!repeatMask && stList_length(seedPairs) > 100) {
+            CuAssertTrue(testCase, sharedPairs >= 0.9 * stList_length(seedPairs));
+        }
+
+        stSortedSet_destruct(blastPairsSet);
+        stList_destruct(blastPairs);
+        stList_destruct(seedPairs);
+        free(seqX);
+        free(seqY);
+    }
+}
+
+static char *getRandomRelatedSequence(const char *seqX, int64_t divergence) {
+    /*
+     * Evolves the sequence the given number of times, then, at random, copies a segment of it to a random point,
+     * so that it has a repeat.
+     */
+    char *seqY = stString_copy(seqX);
+    for (int64_t i = 0; i < divergence; i++) {
+        char *seqY2 = evolveSequence(seqY);
+        free(seqY);
+        seqY = seqY2;
+    }
+    int64_t lY = strlen(seqY);
+    if (lY > 0 && st_random() > 0.5) {
+        int64_t start = st_randomInt(0, lY), length = st_randomInt(0, lY - start + 1), point = st_randomInt(0, lY + 1);
+        char *seqY2 = st_malloc(lY + length + 1);
+        memcpy(seqY2, seqY, point);
+        memcpy(seqY2 + point, seqY + start, length);
+        memcpy(seqY2 + point + length, seqY + point, lY - point + 1);
+        free(seqY);
+        seqY = seqY2;
+    }
+    return seqY;
+}
+
+static void test_getSeedPairsRandom(CuTest *testCase) {
+    /*
+     * Compares the anchors of the in process anchorer to those of lastz, the anchorer it replaced, on random pairs of
+     * sequences of a wide range of lengths and divergences, some with repeats and some unrelated.
+     */
+    int64_t totalSharedPairs = 0, totalBlastPairs = 0;
+    for (int64_t test = 0; test < 20; test++) {
+        char *seqX = getRandomSequence(st_randomInt(0, 50000));
+        int64_t divergence = st_randomInt(0, 4); //Zero gives an unrelated sequence
+        char *seqY = divergence > 0 ? getRandomRelatedSequence(seqX, divergence) : getRandomSequence(strlen(seqX));
+        int64_t lX = strlen(seqX), lY = strlen(seqY);
+        int64_t trim = st_randomInt(0, 5);
+
+        stList *seedPairs = getSeedPairs(seqX, seqY, lX, lY, trim, 0);
+        checkBlastPairs(testCase, seedPairs, lX, lY, 1);
+        stList *blastPairs = getBlastPairs(seqX, seqY, lX, lY, trim, 0);
+        checkBlastPairs(testCase, blastPairs, lX, lY, 0);
+
+        stSortedSet *blastPairsSet = stList_getSortedSet(blastPairs, (int (*)(const void *, const void *)) stIntTuple_cmpFn);
+        int64_t sharedPairs = 0;
+        for (int64_t i = 0; i < stList_length(seedPairs); i++) {
+            if (stSortedSet_search(blastPairsSet, stList_get(seedPairs, i)) != NULL) {
+                sharedPairs++;
+            }
+        }
+        st_logInfo("Divergence %" PRIi64 ", lengths %" PRIi64 " %" PRIi64 ": got %" PRIi64 " seed pairs and %" PRIi64
+                " blast pairs, of which %" PRIi64 " are shared\n", divergence, lX, lY, stList_length(seedPairs),
+                stList_length(blastPairs), sharedPairs);
+
+        //Where lastz finds a substantial alignment so should the anchorer, and its anchors should mostly be lastz's
+        if (stList_length(blastPairs) > 1000) {
+            CuAssertTrue(testCase, sharedPairs > 0);
+        }
+        if (stList_length(seedPairs) > 100) {
+            CuAssertTrue(testCase, sharedPairs >= 0.7 * stList_length(seedPairs));
+        }
+        if (divergence == 1 || divergence == 2) {
+            totalSharedPairs += sharedPairs;
+            totalBlastPairs += stList_length(blastPairs);
+        }
+
+        stSortedSet_destruct(blastPairsSet);
+        stList_destruct(blastPairs);
+        stList_destruct(seedPairs);
+        free(seqX);
+        free(seqY);
+    }
+    //Lastz extends with gaps, so recovers more of the diverged sequences, but across the less diverged ones the
+    //anchorer should find most of its anchors. The most diverged are left out, as lastz may find little in them too.
+    st_logInfo("Got %" PRIi64 " of %" PRIi64 " blast pairs\n", totalSharedPairs, totalBlastPairs);
+    CuAssertTrue(testCase, totalSharedPairs >= 0.4 * totalBlastPairs);
+}
+
 static void test_filterToRemoveOverlap(CuTest *testCase) {
     for (int64_t i = 0; i < 100; i++) {
         //Make random pairs
@@ -483,7 +696,7 @@ static void test_filterToRemoveOverlap(CuTest *testCase) {
                 stIntTuple *pair2 = stList_get(pairs, j);
                 int64_t x2 = stIntTuple_get(pair2, 0);
                 int64_t y2 = stIntTuple_get(pair2, 1);
-                if ((x2 <= x && y2 >= y) || (x2 >= x && y2 <= y)) {
+                if (j != i && ((x2 <= x && y2 >= y) || (x2 >= x && y2 <= y))) {
                     nonOverlapping = 0;
                     break;
                 }
@@ -523,6 +736,7 @@ static void test_getBlastPairsWithRecursion(CuTest *testCase) {
         st_logInfo("Sequence Y to align: %s END, seq length %" PRIi64 "\n", seqY, lY);
 
         PairwiseAlignmentParameters *p = pairwiseAlignmentBandingParameters_construct();
+        p->useLastzForAnchors = test % 2;
 
         stList *blastPairs = getBlastPairsForPairwiseAlignmentParameters(seqX, seqY, lX, lY, p);
 
@@ -831,6 +1045,70 @@ static void test_em_3State(CuTest *testCase) {
     test_em(testCase, threeState);
 }
 
+static void test_getPosteriorProbsWithCheckpointing(CuTest *testCase) {
+    /*
+     * Checks the checkpointed forward calculation, used when the forward matrix exceeds the memory limit,
+     * gives exactly the same posterior probabilities and expectations as keeping the whole forward matrix.
+     */
+    for (int64_t test = 0; test < 20; test++) {
+        char *sX = getRandomSequence(st_randomInt(0, 300));
+        char *sY = evolveSequence(sX);
+        int64_t lX = strlen(sX);
+        int64_t lY = strlen(sY);
+        SymbolString sX2 = symbolString_construct(sX, lX);
+        SymbolString sY2 = symbolString_construct(sY, lY);
+        PairwiseAlignmentParameters *p = pairwiseAlignmentBandingParameters_construct();
+        p->traceBackDiagonals = st_randomInt(1, 10);
+        p->minDiagsBetweenTraceBack = p->traceBackDiagonals + st_randomInt(2, 10);
+        p->diagonalExpansion = st_randomInt(0, 10) * 2;
+        StateMachine *sM = stateMachine5_construct(fiveState);
+        //With anchors there are many tracebacks, without there is one over the whole matrix
+        stList *anchorPairs = test % 2 == 0 ? getRandomAnchorPairs(lX, lY) : stList_construct();
+
+        AlignedPairBuffer *alignedPairs = alignedPairBuffer_construct(0);
+        void *extraArgs[1] = { alignedPairs };
+        getPosteriorProbsWithBanding(sM, anchorPairs, sX2, sY2, p, 0, 0, diagonalCalculationPosteriorMatchProbsToBuffer,
+                extraArgs);
+        Hmm *hmmExpectations = hmm_constructEmpty(0.0, fiveState);
+        getExpectationsUsingAnchors(sM, hmmExpectations, sX, sY, anchorPairs, p, 0, 0);
+
+        p->dpMemoryLimit = st_randomInt(1, 10000);
+        AlignedPairBuffer *alignedPairs2 = alignedPairBuffer_construct(0);
+        extraArgs[0] = alignedPairs2;
+        getPosteriorProbsWithBanding(sM, anchorPairs, sX2, sY2, p, 0, 0, diagonalCalculationPosteriorMatchProbsToBuffer,
+                extraArgs);
+        Hmm *hmmExpectations2 = hmm_constructEmpty(0.0, fiveState);
+        getExpectationsUsingAnchors(sM, hmmExpectations2, sX, sY, anchorPairs, p, 0, 0);
+
+        //The pairs are computed in the same order, so should be identical
+        CuAssertIntEquals(testCase, alignedPairBuffer_length(alignedPairs), alignedPairBuffer_length(alignedPairs2));
+        for (int64_t i = 0; i < alignedPairBuffer_length(alignedPairs); i++) {
+            CuAssertIntEquals(testCase, alignedPairs->scores[i], alignedPairs2->scores[i]);
+            CuAssertIntEquals(testCase, alignedPairs->x[i], alignedPairs2->x[i]);
+            CuAssertIntEquals(testCase, alignedPairs->y[i], alignedPairs2->y[i]);
+        }
+        CuAssertDblEquals(testCase, hmmExpectations->likelihood, hmmExpectations2->likelihood, 0.0);
+        for (int64_t i = 0; i < hmmExpectations->stateNumber; i++) {
+            for (int64_t j = 0; j < hmmExpectations->stateNumber; j++) {
+                CuAssertDblEquals(testCase, hmm_getTransition(hmmExpectations, i, j), hmm_getTransition(hmmExpectations2, i, j), 0.0);
+            }
+        }
+
+        //Cleanup
+        hmm_destruct(hmmExpectations);
+        hmm_destruct(hmmExpectations2);
+        alignedPairBuffer_destruct(alignedPairs);
+        alignedPairBuffer_destruct(alignedPairs2);
+        stList_destruct(anchorPairs);
+        stateMachine_destruct(sM);
+        pairwiseAlignmentBandingParameters_destruct(p);
+        free(sX);
+        free(sY);
+        free(sX2.sequence);
+        free(sY2.sequence);
+    }
+}
+
 CuSuite* pairwiseAlignmentTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_diagonal);
@@ -841,6 +1119,7 @@ CuSuite* pairwiseAlignmentTestSuite(void) {
     SUITE_ADD_TEST(suite, test_dpDiagonal);
     SUITE_ADD_TEST(suite, test_dpMatrix);
     SUITE_ADD_TEST(suite, test_diagonalDPCalculations);
+    SUITE_ADD_TEST(suite, test_diagonalKernels);
     SUITE_ADD_TEST(suite, test_getAlignedPairsWithBanding);
     SUITE_ADD_TEST(suite, test_getBlastPairs);
     SUITE_ADD_TEST(suite, test_getBlastPairsWithRecursion);
@@ -855,6 +1134,9 @@ CuSuite* pairwiseAlignmentTestSuite(void) {
     SUITE_ADD_TEST(suite, test_em_3State);
     SUITE_ADD_TEST(suite, test_em_3StateAsymmetric);
     SUITE_ADD_TEST(suite, test_em_5State);
+    SUITE_ADD_TEST(suite, test_getSeedPairs);
+    SUITE_ADD_TEST(suite, test_getSeedPairsRandom);
+    SUITE_ADD_TEST(suite, test_getPosteriorProbsWithCheckpointing);
 
     return suite;
 }
@@ -16,7 +16,8 @@
 
 typedef  std::map<std::string, std::vector<hal::Sequence::Info>* > GenMapType;
 /**
- * Scan the .hal file to determine the demensions of each genome (event)
+ * Scan the .hal file to determine the demensions of each genome (event).
+ * Only the header is read from a binary file.
  */
 class CactusHalScanDimensions : protected CactusHalScanner
 {
@@ -40,6 +41,9 @@ protected:
    void scanTopSegment(CactusHalTopSegment& topSegment);
    void scanBottomSegment(CactusHalBottomSegment& botSegment);
    void scanEndOfFile();
+   void scanSequenceDimensions(CactusHalSequence& sequence,
+                               hal_size_t length,
+                               hal_size_t numSegments);
 
    void resetCurrent();
    void flushCurrentIntoMap();
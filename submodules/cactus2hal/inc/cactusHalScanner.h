@@ -9,6 +9,7 @@
 
 #include <string>
 #include <fstream>
+#include <vector>
 
 extern "C" {
 #include "commonC.h"
@@ -22,6 +23,10 @@ extern "C" {
 
 /**
  * abstract base class for scanning through a .hal file as output by cactus.  
+ * The file can be in the text .c2h format or in the binary one, which 
+ * starts with the dimensions of all the sequences (both are described 
+ * in cactus's hal/impl/hal.c).  The format is detected from the start of
+ * the file.
  */
 class CactusHalScanner
 {
@@ -30,8 +35,18 @@ public:
    CactusHalScanner();
    virtual ~CactusHalScanner();
 
+   /** Scan all the sequences and segments in the file, in order */
    void scan(const std::string& halFilePath);
 
+   /** Scan just the dimensions of the sequences, from the header of a 
+    * binary file, without reading the segments.  scanSequenceDimensions()
+    * is called for each sequence, in order.  Returns false without 
+    * scanning anything if the file is in the text format, where the 
+    * dimensions are only known by scanning all the segments */
+   bool scanHeader(const std::string& halFilePath);
+
+   /** Check if a file is in the binary format */
+   static bool isBinary(const std::string& halFilePath);
 
 protected:
 
@@ -39,10 +54,37 @@ protected:
    virtual void scanTopSegment(CactusHalTopSegment& topSegment) = 0;
    virtual void scanBottomSegment(CactusHalBottomSegment& botSegment) = 0;
    virtual void scanEndOfFile() = 0;
-
-protected:
+   /** Called by scanHeader(), does nothing by default */
+   virtual void scanSequenceDimensions(CactusHalSequence& sequence,
+                                       hal_size_t length,
+                                       hal_size_t numSegments);
 
    std::ifstream _halFile;
+
+private:
+
+   struct BinarySequenceInfo
+   {
+      CactusHalSequence _sequence;
+      hal_size_t _numSegments;
+      hal_size_t _length;
+   };
+
+   void open(const std::string& halFilePath);
+   void scanText();
+   void scanBinary();
+   void readBinaryHeader(const std::string& halFilePath);
+   int64_t readBinaryInt();
+   void readBinaryString(std::string& outString);
+
+   static const char BinaryMagic[4];
+   static const int64_t BinaryVersion;
+   /** Number of 64 bit integers in each segment record */
+   static const size_t BinarySegmentSize;
+   /** Number of segment records read at once */
+   static const size_t BinaryBufferSegments;
+
+   std::vector<BinarySequenceInfo> _binaryHeader;
 };
 
 #endif
@@ -43,7 +43,10 @@ void CactusHalScanDimensions::scanDimensions(const string& halFilePath,
   _genomeMap.clear();
   resetCurrent();
   _faReader.open(fastaFilePath);
-  scan(halFilePath);
+  if (scanHeader(halFilePath) == false)
+  {
+    scan(halFilePath);
+  }
 }
 
 void CactusHalScanDimensions::scanSequence(CactusHalSequence& sequence)
@@ -75,6 +78,28 @@ void CactusHalScanDimensions::scanEndOfFile()
   flushCurrentIntoMap();
 }
 
+void CactusHalScanDimensions::scanSequenceDimensions(
+  CactusHalSequence& sequence, hal_size_t length, hal_size_t numSegments)
+{
+  if (sequence._isBottom==true)
+  {
+    _parentGenome=sequence._event;
+  }
+  flushCurrentIntoMap();
+  _currentGenome = sequence._event;
+  _currentInfo._name = sequence._name;
+  if (sequence._isBottom == true)
+  {
+    _currentInfo._numBottomSegments = numSegments;
+  }
+  else
+  {
+    _currentInfo._numTopSegments = numSegments;
+  }
+  _currentSeqLength = length;
+  flushCurrentIntoMap();
+}
+
 void CactusHalScanDimensions::resetCurrent()
 {
   _currentGenome.clear();
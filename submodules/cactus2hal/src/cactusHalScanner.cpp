@@ -7,6 +7,8 @@
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 
 #include "cactusHalScanner.h"
 
@@ -24,15 +26,78 @@ CactusHalScanner::~CactusHalScanner()
 
 }
 
+const char CactusHalScanner::BinaryMagic[4] = {'C', '2', 'H', 'B'};
+const int64_t CactusHalScanner::BinaryVersion = 1;
+const size_t CactusHalScanner::BinarySegmentSize = 4;
+const size_t CactusHalScanner::BinaryBufferSegments = 65536;
+
 void CactusHalScanner::scan(const std::string& halFilePath)
 {
-  _halFile.open(halFilePath.c_str());
+  if (isBinary(halFilePath) == true)
+  {
+    open(halFilePath);
+    readBinaryHeader(halFilePath);
+    scanBinary();
+  }
+  else
+  {
+    open(halFilePath);
+    scanText();
+  }
+  _halFile.close();
+}
+
+bool CactusHalScanner::scanHeader(const std::string& halFilePath)
+{
+  if (isBinary(halFilePath) == false)
+  {
+    return false;
+  }
+  open(halFilePath);
+  readBinaryHeader(halFilePath);
+  _halFile.close();
+  for (size_t i = 0; i < _binaryHeader.size(); ++i)
+  {
+    scanSequenceDimensions(_binaryHeader[i]._sequence, 
+                           _binaryHeader[i]._length,
+                           _binaryHeader[i]._numSegments);
+  }
+  return true;
+}
+
+bool CactusHalScanner::isBinary(const std::string& halFilePath)
+{
+  ifstream halFile(halFilePath.c_str(), ios::in | ios::binary);
+  if (!halFile)
+  {
+    throw runtime_error("error opening path: " + halFilePath);
+  }
+  char magic[sizeof(BinaryMagic)];
+  halFile.read(magic, sizeof(magic));
+  return halFile.gcount() == (streamsize)sizeof(magic) &&
+     memcmp(magic, BinaryMagic, sizeof(magic)) == 0;
+}
+
+void CactusHalScanner::scanSequenceDimensions(CactusHalSequence& sequence,
+                                              hal_size_t length,
+                                              hal_size_t numSegments)
+{
+
+}
+
+void CactusHalScanner::open(const std::string& halFilePath)
+{
+  _halFile.clear();
+  _halFile.open(halFilePath.c_str(), ios::in | ios::binary);
 
   if (!_halFile)
   {
     throw runtime_error("error opening path: " + halFilePath);
   }
-  
+}
+
+void CactusHalScanner::scanText()
+{
   string buffer;
   CactusHalSequence sequenceBuffer;
   CactusHalBottomSegment bsegBuffer;
@@ -86,10 +151,119 @@ void CactusHalScanner::scan(const std::string& halFilePath)
   }
 
   scanEndOfFile();  
-  _halFile.close();
 }
 
+void CactusHalScanner::readBinaryHeader(const std::string& halFilePath)
+{
+  char magic[sizeof(BinaryMagic)];
+  _halFile.read(magic, sizeof(magic));
+  int64_t version = readBinaryInt();
+  if (version != BinaryVersion)
+  {
+    stringstream ss;
+    ss << "unsupported binary c2h version " << version << " in " 
+       << halFilePath;
+    throw runtime_error(ss.str());
+  }
+  int64_t numSequences = readBinaryInt();
+  if (numSequences < 0)
+  {
+    throw runtime_error("invalid number of sequences in " + halFilePath);
+  }
+  _binaryHeader.clear();
+  _binaryHeader.resize(numSequences);
+  for (int64_t i = 0; i < numSequences; ++i)
+  {
+    BinarySequenceInfo& info = _binaryHeader[i];
+    readBinaryString(info._sequence._event);
+    readBinaryString(info._sequence._name);
+    info._sequence._isBottom = readBinaryInt() != 0;
+    int64_t numSegments = readBinaryInt();
+    int64_t length = readBinaryInt();
+    if (numSegments < 0 || length < 0)
+    {
+      throw runtime_error("invalid dimensions for sequence " + 
+                          info._sequence._name + " in " + halFilePath);
+    }
+    info._numSegments = numSegments;
+    info._length = length;
+  }
+}
 
+void CactusHalScanner::scanBinary()
+{
+  CactusHalBottomSegment bsegBuffer;
+  CactusHalTopSegment tsegBuffer;
+  vector<int64_t> buffer;
 
+  for (size_t i = 0; i < _binaryHeader.size(); ++i)
+  {
+    BinarySequenceInfo& info = _binaryHeader[i];
+    scanSequence(info._sequence);
+    hal_size_t numRead = 0;
+    while (numRead < info._numSegments)
+    {
+      size_t numSegments = min((hal_size_t)BinaryBufferSegments,
+                               info._numSegments - numRead);
+      buffer.resize(numSegments * BinarySegmentSize);
+      _halFile.read((char*)&buffer[0], buffer.size() * sizeof(int64_t));
+      if (!_halFile.good())
+      {
+        throw runtime_error("error reading segments of sequence " + 
+                            info._sequence._name);
+      }
+      for (size_t j = 0; j < numSegments; ++j)
+      {
+        const int64_t* segment = &buffer[j * BinarySegmentSize];
+        if (info._sequence._isBottom == true)
+        {
+          bsegBuffer._name = segment[0];
+          bsegBuffer._start = segment[1];
+          bsegBuffer._length = segment[2];
+          scanBottomSegment(bsegBuffer);
+        }
+        else
+        {
+          tsegBuffer._start = segment[0];
+          tsegBuffer._length = segment[1];
+          tsegBuffer._parent = segment[2];
+          // same as the text format: insertions are reversed
+          tsegBuffer._reversed = segment[3] == 0;
+          scanTopSegment(tsegBuffer);
+        }
+      }
+      numRead += numSegments;
+    }
+  }
+
+  scanEndOfFile();
+}
 
+int64_t CactusHalScanner::readBinaryInt()
+{
+  int64_t i;
+  _halFile.read((char*)&i, sizeof(int64_t));
+  if (!_halFile.good())
+  {
+    throw runtime_error("unexpected end of binary c2h file");
+  }
+  return i;
+}
 
+void CactusHalScanner::readBinaryString(string& outString)
+{
+  int64_t length = readBinaryInt();
+  if (length < 0)
+  {
+    throw runtime_error("invalid string length in binary c2h file");
+  }
+  outString.resize(length);
+  if (length > 0)
+  {
+    _halFile.read(&outString[0], length);
+    if (!_halFile.good())
+    {
+      throw runtime_error("unexpected end of binary c2h file");
+    }
+  }
+}
@@ -98,6 +98,44 @@ static void setupSmallTempFile()
   ofile.close();
 }
 
+// the same alignment as the small file, in the binary format
+static void writeBinaryInt(ofstream& ofile, int64_t i)
+{
+  ofile.write((const char*)&i, sizeof(int64_t));
+}
+
+static void writeBinaryString(ofstream& ofile, const string& s)
+{
+  writeBinaryInt(ofile, s.length());
+  ofile.write(s.c_str(), s.length());
+}
+
+static void setupSmallBinaryTempFile()
+{
+  tempFilePath = getTempFile();
+  ofstream ofile(tempFilePath, ios::out | ios::binary);
+  ofile.write("C2HB", 4);
+  writeBinaryInt(ofile, 1);
+  writeBinaryInt(ofile, 2);
+  writeBinaryString(ofile, "sMouse-sRat");
+  writeBinaryString(ofile, "sMouse-sRat.0");
+  writeBinaryInt(ofile, 1);
+  writeBinaryInt(ofile, 2);
+  writeBinaryInt(ofile, 36);
+  writeBinaryString(ofile, "simMouse");
+  writeBinaryString(ofile, "simMouse.chrP");
+  writeBinaryInt(ofile, 0);
+  writeBinaryInt(ofile, 3);
+  writeBinaryInt(ofile, 102);
+  int64_t segments[] = {3105231943071985136, 0, 28, 0,
+                        3105231943071985139, 28, 8, 0,
+                        0, 67, 1918814916236546103, 1,
+                        7132328, 2, NULL_NAME, 0,
+                        152, 33, 2772809995576667241, 0};
+  ofile.write((const char*)segments, sizeof(segments));
+  ofile.close();
+}
+
 static void tearDownTempFile()
 {
   removeTempFile(tempFilePath);
@@ -127,13 +165,8 @@ public:
    }
 };
 
-void cactusHalScannerSmallTest(CuTest *testCase)
+static void checkSmallScan(CuTest *testCase, TestScanner& scanner)
 {
-  setupSmallTempFile();
-
-  TestScanner scanner;
-  scanner.scan(tempFilePath);
-  
   CuAssertTrue(testCase, scanner._sequences.size() == 2);
   CuAssertTrue(testCase, scanner._sequences[0]._event == "sMouse-sRat");
   CuAssertTrue(testCase, scanner._sequences[0]._name == "sMouse-sRat.0");
@@ -166,6 +199,57 @@ void cactusHalScannerSmallTest(CuTest *testCase)
   CuAssertTrue(testCase, scanner._topSegments[2]._length == 33);
   CuAssertTrue(testCase, scanner._topSegments[2]._parent == 2772809995576667241);
   CuAssertTrue(testCase, scanner._topSegments[2]._reversed == true);
+}
+
+void cactusHalScannerSmallTest(CuTest *testCase)
+{
+  setupSmallTempFile();
+
+  CuAssertTrue(testCase, CactusHalScanner::isBinary(tempFilePath) == false);
+  TestScanner scanner;
+  CuAssertTrue(testCase, scanner.scanHeader(tempFilePath) == false);
+  CuAssertTrue(testCase, scanner._sequences.empty());
+  scanner.scan(tempFilePath);
+  checkSmallScan(testCase, scanner);
+
+  tearDownTempFile();
+}
+
+class TestHeaderScanner : public TestScanner
+{
+public:
+   vector<hal_size_t> _lengths;
+   vector<hal_size_t> _numSegments;
+   void scanSequenceDimensions(CactusHalSequence& sequence,
+                               hal_size_t length,
+                               hal_size_t numSegments)
+   {
+     _sequences.push_back(sequence);
+     _lengths.push_back(length);
+     _numSegments.push_back(numSegments);
+   }
+};
+
+void cactusHalScannerSmallBinaryTest(CuTest *testCase)
+{
+  setupSmallBinaryTempFile();
+
+  CuAssertTrue(testCase, CactusHalScanner::isBinary(tempFilePath) == true);
+  TestScanner scanner;
+  scanner.scan(tempFilePath);
+  checkSmallScan(testCase, scanner);
+
+  TestHeaderScanner headerScanner;
+  CuAssertTrue(testCase, headerScanner.scanHeader(tempFilePath) == true);
+  CuAssertTrue(testCase, headerScanner._sequences.size() == 2);
+  CuAssertTrue(testCase, headerScanner._sequences[0]._name == "sMouse-sRat.0");
+  CuAssertTrue(testCase, headerScanner._sequences[1]._name == "simMouse.chrP");
+  CuAssertTrue(testCase, headerScanner._lengths[0] == 36);
+  CuAssertTrue(testCase, headerScanner._lengths[1] == 102);
+  CuAssertTrue(testCase, headerScanner._numSegments[0] == 2);
+  CuAssertTrue(testCase, headerScanner._numSegments[1] == 3);
+  CuAssertTrue(testCase, headerScanner._bottomSegments.empty());
+  CuAssertTrue(testCase, headerScanner._topSegments.empty());
 
   tearDownTempFile();
 }
@@ -177,6 +261,7 @@ CuSuite* cactusHalScannerTestSuite(void)
   SUITE_ADD_TEST(suite, cactusHalScannerTopSegmentTest);
   SUITE_ADD_TEST(suite, cactusHalScannerBottomSegmentTest);
   SUITE_ADD_TEST(suite, cactusHalScannerSmallTest);
+  SUITE_ADD_TEST(suite, cactusHalScannerSmallBinaryTest);
   return suite;
 }
 
@@ -49,6 +49,9 @@ HDF5Alignment::HDF5Alignment() :
   HDF5CLParser defaultOptions(true);  
   defaultOptions.applyToDCProps(_dcprops);
   defaultOptions.applyToAProps(_aprops);
+  _arrayPages = defaultOptions.getArrayPages();
+  _arrayReadahead = defaultOptions.getArrayReadahead();
+  _lockHolder.release();
 }
 
 HDF5Alignment::HDF5Alignment(const H5::FileCreatPropList& fileCreateProps,
@@ -60,7 +63,9 @@ HDF5Alignment::HDF5Alignment(const H5::FileCreatPropList& fileCreateProps,
   _metaData(NULL),
   _tree(NULL),
   _dirty(false),
-  _inMemory(inMemory)
+  _inMemory(inMemory),
+  _arrayPages(HDF5CLParser::DefaultArrayPages),
+  _arrayReadahead(HDF5CLParser::DefaultArrayReadahead)
 {
   _cprops.copy(fileCreateProps);
   _aprops.copy(fileAccessProps);
@@ -74,15 +79,19 @@ HDF5Alignment::HDF5Alignment(const H5::FileCreatPropList& fileCreateProps,
     _aprops.getCache(mdc, rdc, rdcb, w0);    
     _aprops.setCache(mdc, 0, 0, 0.);
   }
+  _lockHolder.release();
 }
 
 HDF5Alignment::~HDF5Alignment()
 {
+  // released once the HDF5 members are destroyed
+  _lockHolder.acquire();
   close();
 }
 
 void HDF5Alignment::createNew(const string& alignmentPath)
 {
+  HDF5Lock lock;
   close();
   _flags = H5F_ACC_TRUNC;
   if (!ofstream(alignmentPath.c_str()))
@@ -105,6 +114,7 @@ void HDF5Alignment::createNew(const string& alignmentPath)
 // todo: properly handle readonly
 void HDF5Alignment::open(const string& alignmentPath, bool readOnly)
 {
+  HDF5Lock lock;
   close();
   delete _file;
   int _flags = readOnly ? H5F_ACC_RDONLY : H5F_ACC_RDWR;
@@ -140,6 +150,7 @@ void HDF5Alignment::open(const string& alignmentPath) const
    
 void HDF5Alignment::close()
 {
+  HDF5Lock lock;
   if (_file != NULL)
   {
     writeTree();
@@ -180,6 +191,7 @@ void HDF5Alignment::close()
 // same as above but don't write anything to disk.
 void HDF5Alignment::close() const
 {
+  HDF5Lock lock;
   if (_file != NULL)
   {
     if (_tree != NULL)
@@ -215,6 +227,7 @@ void HDF5Alignment::close() const
 
 void HDF5Alignment::setOptionsFromParser(CLParserConstPtr parser) const
 {
+  HDF5Lock lock;
   const HDF5CLParser* hdf5Parser = 
      dynamic_cast<const HDF5CLParser*>(parser.get());
   if (hdf5Parser == NULL)
@@ -225,6 +238,8 @@ void HDF5Alignment::setOptionsFromParser(CLParserConstPtr parser) const
   hdf5Parser->applyToDCProps(_dcprops);
   hdf5Parser->applyToAProps(_aprops);
   _inMemory = hdf5Parser->getInMemory();
+  _arrayPages = hdf5Parser->getArrayPages();
+  _arrayReadahead = hdf5Parser->getArrayReadahead();
   if (_inMemory == true)
   {
     int mdc;
@@ -248,6 +263,7 @@ Genome*  HDF5Alignment::insertGenome(const string& name,
                                      const string& childName,
                                      double upperBranchLength)
 {
+  HDF5Lock lock;
   if (name.empty() == true || parentName.empty() || childName.empty())
   {
     throw hal_exception("name can't be empty");
@@ -278,7 +294,8 @@ Genome*  HDF5Alignment::insertGenome(const string& name,
   stTree_setParent(child, newNode);
   stTree_setBranchLength(child, lowerBranchLength);
 
-  HDF5Genome* genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory);
+  HDF5Genome* genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory,
+                                      _arrayPages, _arrayReadahead);
   _openGenomes.insert(pair<string, HDF5Genome*>(name, genome));
   _dirty = true;
   return genome;
@@ -288,6 +305,7 @@ Genome*  HDF5Alignment::addLeafGenome(const string& name,
                                       const string& parentName,
                                       double branchLength)
 {
+  HDF5Lock lock;
   if (name.empty() == true || parentName.empty())
   {
     throw hal_exception("name can't be empty");
@@ -309,7 +327,8 @@ Genome*  HDF5Alignment::addLeafGenome(const string& name,
   stTree_setBranchLength(node, branchLength);
   _nodeMap.insert(pair<string, stTree*>(name, node));
 
-  HDF5Genome* genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory);
+  HDF5Genome* genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory,
+                                      _arrayPages, _arrayReadahead);
   _openGenomes.insert(pair<string, HDF5Genome*>(name, genome));
   _dirty = true;
   return genome;
@@ -318,6 +337,7 @@ Genome*  HDF5Alignment::addLeafGenome(const string& name,
 Genome* HDF5Alignment::addRootGenome(const string& name,
                                         double branchLength)
 {
+  HDF5Lock lock;
   if (name.empty() == true)
   {
     throw hal_exception("name can't be empty");
@@ -337,7 +357,8 @@ Genome* HDF5Alignment::addRootGenome(const string& name,
   _tree = node;
   _nodeMap.insert(pair<string, stTree*>(name, node));
 
-  HDF5Genome* genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory);
+  HDF5Genome* genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory,
+                                      _arrayPages, _arrayReadahead);
   _openGenomes.insert(pair<string, HDF5Genome*>(name, genome));
   _dirty = true;
   return genome;
@@ -347,6 +368,7 @@ Genome* HDF5Alignment::addRootGenome(const string& name,
 // (so that's what is done here right now)
 void HDF5Alignment::removeGenome(const string& name)
 {
+  HDF5Lock lock;
   map<string, stTree*>::iterator findIt = _nodeMap.find(name);
   if (findIt == _nodeMap.end())
   {
@@ -463,11 +485,13 @@ const Genome* HDF5Alignment::openGenome(const string& name) const
   {
     return mapit->second;
   }
+  HDF5Lock lock;
   HDF5Genome* genome = NULL;
   if (_nodeMap.find(name) != _nodeMap.end())
   {
     genome = new HDF5Genome(name, const_cast<HDF5Alignment*>(this), 
-                            _file, _dcprops, _inMemory);
+                            _file, _dcprops, _inMemory,
+                            _arrayPages, _arrayReadahead);
     _openGenomes.insert(pair<string, HDF5Genome*>(name, genome));
   }
   return genome;
@@ -480,10 +504,12 @@ Genome* HDF5Alignment::openGenome(const string& name)
   {
     return mapit->second;
   }
+  HDF5Lock lock;
   HDF5Genome* genome = NULL;
   if (_nodeMap.find(name) != _nodeMap.end())
   {
-    genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory);
+    genome = new HDF5Genome(name, this, _file, _dcprops, _inMemory,
+                            _arrayPages, _arrayReadahead);
     _openGenomes.insert(pair<string, HDF5Genome*>(name, genome));
   }
   return genome;
@@ -491,6 +517,7 @@ Genome* HDF5Alignment::openGenome(const string& name)
 
 void HDF5Alignment::closeGenome(const Genome* genome) const
 {
+  HDF5Lock lock;
   string name = genome->getName();
   map<string, HDF5Genome*>::iterator mapIt = _openGenomes.find(name);
   if (mapIt == _openGenomes.end())
@@ -667,6 +694,7 @@ string HDF5Alignment::getNewickTree() const
 
 string HDF5Alignment::getVersion() const
 {
+  HDF5Lock lock;
   try
   {
     H5::Exception::dontPrint();
@@ -755,6 +783,7 @@ void HDF5Alignment::loadTree()
 
 void HDF5Alignment::replaceNewickTree(const string &newNewickString)
 {
+  HDF5Lock lock;
   _nodeMap.clear();
   HDF5MetaData treeMeta(_file, TreeGroupName);
   treeMeta.set(TreeGroupName, newNewickString);
@@ -13,6 +13,7 @@
 #include "halAlignmentInstance.h"
 #include "hdf5Genome.h"
 #include "hdf5MetaData.h"
+#include "hdf5Lock.h"
 
 typedef struct _stTree stTree;
 
@@ -117,6 +118,8 @@ protected:
 
 protected:
 
+   // must come first, see HDF5LockHolder
+   HDF5LockHolder _lockHolder;
    H5::H5File* _file;
    mutable H5::FileCreatPropList _cprops;
    mutable H5::FileAccPropList _aprops;
@@ -132,6 +135,8 @@ protected:
    bool _dirty;
    mutable std::map<std::string, HDF5Genome*> _openGenomes;
    mutable bool _inMemory;
+   mutable hal_size_t _arrayPages;
+   mutable hal_size_t _arrayReadahead;
 };
 
 }
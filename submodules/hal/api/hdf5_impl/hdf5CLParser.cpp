@@ -21,6 +21,8 @@ const hsize_t HDF5CLParser::DefaultCacheRDCElems = 599999;
 const hsize_t HDF5CLParser::DefaultCacheRDCBytes = 15728640;
 const double HDF5CLParser::DefaultCacheW0 = 0.75;
 const bool HDF5CLParser::DefaultInMemory = false;
+const hsize_t HDF5CLParser::DefaultArrayPages = 4;
+const hsize_t HDF5CLParser::DefaultArrayReadahead = 1;
 
 HDF5CLParser::HDF5CLParser(bool createOptions) :
   CLParser()
@@ -41,6 +43,10 @@ HDF5CLParser::HDF5CLParser(bool createOptions) :
   addOption("cacheW0", "w0 parameter fro hdf5 cache", DefaultCacheW0);
   addOptionFlag("inMemory", "load all data in memory (and disable hdf5 cache)",
                 DefaultInMemory);
+  addOption("arrayPages", "number of chunks of each array to keep in memory,"
+            " evicting the least recently used", DefaultArrayPages);
+  addOption("arrayReadahead", "number of chunks to read ahead when an array"
+            " is read in order (less than arrayPages)", DefaultArrayReadahead);
 #ifdef ENABLE_UDC
   addOption("udcCacheDir", "udc cache path for *input* hal file(s).",
             "\"\"");
@@ -75,3 +81,13 @@ bool HDF5CLParser::getInMemory() const
 {
   return getFlag("inMemory");
 }
+
+hsize_t HDF5CLParser::getArrayPages() const
+{
+  return getOption<hsize_t>("arrayPages");
+}
+
+hsize_t HDF5CLParser::getArrayReadahead() const
+{
+  return getOption<hsize_t>("arrayReadahead");
+}
@@ -24,6 +24,8 @@ public:
    void applyToDCProps(H5::DSetCreatPropList& dcprops) const;
    void applyToAProps(H5::FileAccPropList& aprops) const;
    bool getInMemory() const;
+   hsize_t getArrayPages() const;
+   hsize_t getArrayReadahead() const;
 
    static const hsize_t DefaultChunkSize;
    static const hsize_t DefaultDeflate;
@@ -32,6 +34,8 @@ public:
    static const hsize_t DefaultCacheRDCBytes;
    static const double DefaultCacheW0;
    static const bool DefaultInMemory;
+   static const hsize_t DefaultArrayPages;
+   static const hsize_t DefaultArrayReadahead;
 
 protected:
    // Nobody creates this class except through the interface. 
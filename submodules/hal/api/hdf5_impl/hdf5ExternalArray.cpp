@@ -6,28 +6,38 @@
 
 #include <cassert>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 #include "hdf5ExternalArray.h"
+#include "hdf5Lock.h"
 
 using namespace hal;
 using namespace H5;
 using namespace std;
 
+static const hsize_t NoSlot = static_cast<hsize_t>(-1);
+
 /** Constructor */
 HDF5ExternalArray::HDF5ExternalArray() :
   _file(NULL),
   _size(0),
   _chunkSize(0),
-  _bufStart(0),
+  _bufStart(1),
   _bufEnd(0),
   _bufSize(0),
   _buf(NULL),
-  _dirty(false)
+  _dirty(false),
+  _pageSize(0),
+  _maxPages(1),
+  _numReadaheadPages(0),
+  _curSlot(NoSlot),
+  _lastPageIdx(NoSlot)
 {}
 
 /** Destructor */
 HDF5ExternalArray::~HDF5ExternalArray()
 {
-  delete [] _buf;
+  clearPool();
 }
 
 // Create a new dataset in specifed location
@@ -36,8 +46,11 @@ void HDF5ExternalArray::create(PortableH5Location* file,
                                const DataType& dataType,
                                hsize_t numElements,
                                const DSetCreatPropList* inCparms,
-                               hsize_t chunksInBuffer)
+                               hsize_t chunksInBuffer,
+                               hsize_t numPages,
+                               hsize_t numReadaheadPages)
 {
+  HDF5Lock lock;
   // copy in parameters
   _file = file;
   _path = path;
@@ -75,24 +88,27 @@ void HDF5ExternalArray::create(PortableH5Location* file,
     _chunkSize = 0;
   }
   
-  // create the internal data buffer
-  _bufSize = _chunkSize > 1 ? _chunkSize : _size;  
-  _bufStart = 0;
-  _bufEnd = _bufStart + _bufSize - 1;
-  delete [] _buf;
-  _buf = new char[_bufSize * _dataSize];
-
   // create the hdf5 array
   _dataSet = _file->createDataSet(_path, _dataType, _dataSpace, cparms);
-  _chunkSpace = DataSpace(1, &_bufSize);
+
+  // the first page is current, without reading it from the new array
+  initPool(numPages, numReadaheadPages);
+  if (_size > 0)
+  {
+    hsize_t slot = getFreeSlot();
+    addPage(slot, 0);
+    setCurrent(slot);
+  }
   assert(getSize() == numElements);
   assert(_bufSize > 0 || _size == 0);
 }
 
 // Load an existing dataset into memory
 void HDF5ExternalArray::load(PortableH5Location* file, const H5std_string& path,
-                             hsize_t chunksInBuffer)
+                             hsize_t chunksInBuffer, hsize_t numPages,
+                             hsize_t numReadaheadPages)
 {
+  HDF5Lock lock;
   // load up the parameters
   _file = file;
   _path = path;
@@ -126,47 +142,188 @@ void HDF5ExternalArray::load(PortableH5Location* file, const H5std_string& path,
     _chunkSize = 0;
   }
   
-  // create the internal data buffer
-  _bufSize = _chunkSize > 1 ? _chunkSize : _size;  
-  _bufEnd = _bufStart + _bufSize - 1;
-  // set out of range to ensure page happens
-  _bufStart = _bufEnd + 1;
-  delete [] _buf;
-  _buf = new char[_bufSize * _dataSize];
-
-  assert(_bufSize > 0 || _size == 0);
+  // no page is current, to ensure page happens
+  initPool(numPages, numReadaheadPages);
 }
 
-// Write the memory buffer back to the file 
+// Write the updated pages back to the file 
 void HDF5ExternalArray::write()
 {
-  if (_dirty == true)
+  HDF5Lock lock;
+  if (_curSlot != NoSlot)
   {
-    _dataSpace.selectHyperslab(H5S_SELECT_SET, &_bufSize, &_bufStart);
-    _dataSet.write(_buf, _dataType, _chunkSpace, _dataSpace);
+    _pages[_curSlot]._dirty = _pages[_curSlot]._dirty || _dirty;
+    _dirty = false;
+  }
+  // in page order, so the file is written sequentially
+  for (map<hsize_t, hsize_t>::iterator i = _pageMap.begin(); 
+       i != _pageMap.end(); ++i)
+  {
+    if (_pages[i->second]._dirty == true)
+    {
+      writePage(_pages[i->second]);
+    }
   }
 }
 
 // Page chunk containing index i into memory 
 void HDF5ExternalArray::page(hsize_t i)
 {
-  if (_dirty == true)
+  assert(i < _size);
+  hsize_t pageIdx = i / _pageSize;
+  map<hsize_t, hsize_t>::iterator mapIt = _pageMap.find(pageIdx);
+  if (mapIt != _pageMap.end())
   {
-    write();
+    setCurrent(mapIt->second);
+    return;
   }
-  _bufSize = _chunkSize > 1 ? _chunkSize : _size;  
-  _bufStart = (i / _bufSize) * _bufSize; // todo: review
-  _bufEnd = _bufStart + _bufSize - 1;  
 
-  if (_bufEnd >= _size)
+  // only a miss calls into HDF5 (to read the page, and maybe to write 
+  // back the one it evicts)
+  HDF5Lock lock;
+
+  // if we're reading in order, read the following pages that aren't 
+  // in memory along with this one
+  hsize_t numPages = 1;
+  if (_numReadaheadPages > 0 && pageIdx == _lastPageIdx + 1)
   {
-    _bufEnd = _size - 1;
-    _bufSize = _bufEnd - _bufStart + 1;
+    while (numPages <= _numReadaheadPages && 
+           (pageIdx + numPages) * _pageSize < _size &&
+           _pageMap.find(pageIdx + numPages) == _pageMap.end())
+    {
+      ++numPages;
+    }
   }
+  _lastPageIdx = pageIdx + numPages - 1;
 
-  _chunkSpace = DataSpace(1, &_bufSize);
-  _dataSpace.selectHyperslab(H5S_SELECT_SET, &_bufSize, &_bufStart);
-  _dataSet.read(_buf, _dataType, _chunkSpace, _dataSpace);
-  _dirty = false;
+  hsize_t slot = NoSlot;
+  if (numPages == 1)
+  {
+    slot = getFreeSlot();
+    addPage(slot, pageIdx);
+    Page& page = _pages[slot];
+    DataSpace memSpace(1, &page._size);
+    _dataSpace.selectHyperslab(H5S_SELECT_SET, &page._size, &page._start);
+    _dataSet.read(page._buf, _dataType, memSpace, _dataSpace);
+  }
+  else
+  {
+    hsize_t start = pageIdx * _pageSize;
+    hsize_t count = min(numPages * _pageSize, _size - start);
+    _readaheadBuf.resize(count * _dataSize);
+    DataSpace memSpace(1, &count);
+    _dataSpace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+    _dataSet.read(&_readaheadBuf[0], _dataType, memSpace, _dataSpace);
+    // add the last page first, so the requested page is the most 
+    // recently used.  the readahead is less than the pool size, so none 
+    // of these pages evict each other
+    for (hsize_t j = numPages; j > 0; --j)
+    {
+      slot = getFreeSlot();
+      addPage(slot, pageIdx + j - 1);
+      Page& page = _pages[slot];
+      memcpy(page._buf, &_readaheadBuf[(j - 1) * _pageSize * _dataSize],
+             page._size * _dataSize);
+    }
+  }
+  setCurrent(slot);
   assert(_bufSize > 0 || _size == 0);
 }
+
+void HDF5ExternalArray::initPool(hsize_t numPages, hsize_t numReadaheadPages)
+{
+  clearPool();
+  _pageSize = _chunkSize > 1 ? _chunkSize : _size;
+  hsize_t numPagesInArray = 
+     _pageSize > 0 ? (_size + _pageSize - 1) / _pageSize : 0;
+  _maxPages = max((hsize_t)1, min(numPages, numPagesInArray));
+  _numReadaheadPages = min(numReadaheadPages, _maxPages - 1);
+}
+
+void HDF5ExternalArray::clearPool()
+{
+  for (size_t i = 0; i < _pages.size(); ++i)
+  {
+    delete [] _pages[i]._buf;
+  }
+  _pages.clear();
+  _pageMap.clear();
+  _lru.clear();
+  _readaheadBuf.clear();
+  _curSlot = NoSlot;
+  _lastPageIdx = NoSlot;
+  _buf = NULL;
+  _bufStart = 1;
+  _bufEnd = 0;
+  _bufSize = 0;
+  _dirty = false;
+}
+
+hsize_t HDF5ExternalArray::getFreeSlot()
+{
+  // pages are only allocated when needed, so small arrays and arrays
+  // that are only accessed in a few places stay small
+  if (_pages.size() < _maxPages)
+  {
+    Page page;
+    page._buf = new char[_pageSize * _dataSize];
+    page._dirty = false;
+    _pages.push_back(page);
+    return _pages.size() - 1;
+  }
+  
+  hsize_t slot = _lru.back();
+  Page& page = _pages[slot];
+  if (slot == _curSlot)
+  {
+    page._dirty = page._dirty || _dirty;
+    _dirty = false;
+    _curSlot = NoSlot;
+    _buf = NULL;
+    _bufStart = 1;
+    _bufEnd = 0;
+    _bufSize = 0;
+  }
+  if (page._dirty == true)
+  {
+    writePage(page);
+  }
+  _lru.pop_back();
+  _pageMap.erase(page._start / _pageSize);
+  return slot;
+}
+
+void HDF5ExternalArray::addPage(hsize_t slot, hsize_t pageIdx)
+{
+  Page& page = _pages[slot];
+  page._start = pageIdx * _pageSize;
+  page._size = min(_pageSize, _size - page._start);
+  page._dirty = false;
+  _lru.push_front(slot);
+  page._lruPos = _lru.begin();
+  _pageMap[pageIdx] = slot;
+}
+
+void HDF5ExternalArray::setCurrent(hsize_t slot)
+{
+  if (_curSlot != NoSlot)
+  {
+    _pages[_curSlot]._dirty = _pages[_curSlot]._dirty || _dirty;
+  }
+  Page& page = _pages[slot];
+  _lru.splice(_lru.begin(), _lru, page._lruPos);
+  _curSlot = slot;
+  _buf = page._buf;
+  _bufStart = page._start;
+  _bufSize = page._size;
+  _bufEnd = _bufStart + _bufSize - 1;
+  _dirty = false;
+}
+
+void HDF5ExternalArray::writePage(Page& page)
+{
+  DataSpace memSpace(1, &page._size);
+  _dataSpace.selectHyperslab(H5S_SELECT_SET, &page._size, &page._start);
+  _dataSet.write(page._buf, _dataType, memSpace, _dataSpace);
+  page._dirty = false;
+}
@@ -8,6 +8,9 @@
 #define _HDF5EXTERNALARRAY_H
 
 #include <cassert>
+#include <list>
+#include <map>
+#include <vector>
 #include <H5Cpp.h>
 #include "halDefs.h"
 
@@ -33,6 +36,16 @@ namespace hal {
  * We can't use compiler tpying of the input objects (and instead just 
  * expose the raw void* data) because the elements' sizes are not known
  * at compile time, and we don't want to move it around once its read.
+ *
+ * Up to numPages pages are kept in memory at once, so that access jumping
+ * between a few regions of the array does not re-read a page on every
+ * jump.  When the pool is full the least recently used page is evicted,
+ * and written back first if it was updated.  When pages are read in
+ * order, the next numReadaheadPages pages are read along with each one,
+ * in a single HDF5 read.
+ *
+ * Calls into HDF5 are made holding the HDF5Lock.  Pages that are already
+ * in memory are read without it.
  */
 class HDF5ExternalArray
 {
@@ -54,13 +67,18 @@ public:
      * 0: load entire array into buffer
      * 1: use default chunking (from dataset)
      * N: buffersize will be N chunks. 
+    * @param numPages Maximum number of buffers (pages) kept in memory
+    * @param numReadaheadPages Number of pages to read ahead of
+    * sequential access (at most numPages - 1 are used)
      */
    void create(H5::PortableH5Location* file, 
                const H5std_string& path, 
                const H5::DataType& dataType,
                hsize_t numElements,
                const H5::DSetCreatPropList* inCparms = NULL,
-               hsize_t chunksInBuffer = 1);
+               hsize_t chunksInBuffer = 1,
+               hsize_t numPages = 1,
+               hsize_t numReadaheadPages = 0);
  
    /** Load an existing dataset into memory
      * @param file Pointer to the HDF5 file in which to create array
@@ -69,11 +87,15 @@ public:
      * 0: load entire array into buffer
      * 1: use default chunking (from dataset)
      * N: buffersize will be N chunks. 
+     * @param numPages Maximum number of buffers (pages) kept in memory
+     * @param numReadaheadPages Number of pages to read ahead of 
+     * sequential access (at most numPages - 1 are used)
      */
    void load(H5::PortableH5Location* file, const H5std_string& path,
-             hsize_t chunksInBuffer = 1);
+             hsize_t chunksInBuffer = 1, hsize_t numPages = 1,
+             hsize_t numReadaheadPages = 0);
    
-   /** Write the memory buffer back to the file */
+   /** Write the updated memory buffers back to the file */
    void write();
 
    /** Access the raw data at given index
@@ -110,9 +132,45 @@ public:
    
 protected:
 
-   /** Read chunk from file */
+   /** A buffer holding one page of the array */
+   struct Page
+   {
+      /** Index of first element in the page */
+      hsize_t _start;
+      /** Number of elements in the page */
+      hsize_t _size;
+      /** Element data */
+      char* _buf;
+      /** Flag saying the page must be written back before eviction */
+      bool _dirty;
+      /** Position of the page in the LRU list */
+      std::list<hsize_t>::iterator _lruPos;
+   };
+
+   /** Make the page containing index i the current buffer, reading it
+    * (and any readahead) from file if it is not in the pool */
    void page(hsize_t i);
 
+   /** Set up the (empty) page pool for the array */
+   void initPool(hsize_t numPages, hsize_t numReadaheadPages);
+
+   /** Free the page pool */
+   void clearPool();
+
+   /** Get a slot for a new page, evicting the least recently used
+    * page if the pool is full */
+   hsize_t getFreeSlot();
+
+   /** Put the page in the given slot into the pool as page number
+    * pageIdx, as the most recently used */
+   void addPage(hsize_t slot, hsize_t pageIdx);
+
+   /** Make the page in the given slot the current buffer */
+   void setCurrent(hsize_t slot);
+
+   /** Write a page back to the file */
+   void writePage(Page& page);
+
    /** Pointer to file that owns this dataset */
    H5::PortableH5Location* _file;
    /** Path of dataset in file */
@@ -129,19 +187,39 @@ protected:
    hsize_t _chunkSize;
    /** Size of datatype in bytes */
    hsize_t _dataSize;
-   /** Index of first element in memory buffer */
+   /** Index of first element in the current page (greater than 
+    * _bufEnd if there is no current page) */
    hsize_t _bufStart;
-   /** Index of last element in memory buffer */
+   /** Index of last element in the current page */
    hsize_t _bufEnd;
-   /** Number of elements in memory buffer */
+   /** Number of elements in the current page */
    hsize_t _bufSize;
-   /** In-memory buffer */
+   /** Buffer of the current page (owned by the pool) */
    char* _buf;
-   /** Dimensional information for in-memory buffer */
-   H5::DataSpace _chunkSpace;
    /** Flag saying we should write to disk on write
-    * or page-out calls (set by getUpdate()) */
+    * or page-out calls (set by getUpdate()).  This is the flag of the 
+    * current page, only folded into it when another page is made current
+    * or the array is written */
    bool _dirty;
+   /** Number of elements in a page (the last page may be shorter) */
+   hsize_t _pageSize;
+   /** The pool of pages, some of which may not be in use yet */
+   std::vector<Page> _pages;
+   /** Maximum number of pages in the pool */
+   hsize_t _maxPages;
+   /** Number of pages to read ahead of sequential access */
+   hsize_t _numReadaheadPages;
+   /** Map from page number to slot in _pages */
+   std::map<hsize_t, hsize_t> _pageMap;
+   /** Slots in use, most recently used first */
+   std::list<hsize_t> _lru;
+   /** Slot of the current page, or NoSlot (-1) if there is none */
+   hsize_t _curSlot;
+   /** Number of the last page read from file, to detect sequential 
+    * access */
+   hsize_t _lastPageIdx;
+   /** Buffer for reading a page along with its readahead */
+   std::vector<char> _readaheadBuf;
 
 private:
 
@@ -37,13 +37,17 @@ HDF5Genome::HDF5Genome(const string& name,
                        HDF5Alignment* alignment,
                        PortableH5Location* h5Parent,
                        const DSetCreatPropList& dcProps,
-                       bool inMemory) :
+                       bool inMemory,
+                       hal_size_t numPagesInArrayPool,
+                       hal_size_t numReadaheadPages) :
   _alignment(alignment),
   _h5Parent(h5Parent),
   _name(name),
   _numChildrenInBottomArray(0),
   _totalSequenceLength(0),
   _numChunksInArrayBuffer(inMemory ? 0 : 1),
+  _numPagesInArrayPool(numPagesInArrayPool),
+  _numReadaheadPages(numReadaheadPages),
   _parentCache(NULL)
 {
   _dcprops.copy(dcProps);
@@ -162,17 +166,20 @@ void HDF5Genome::setDimensions(
     dnaDC.copy(_dcprops);
     dnaDC.setChunk(1, &chunk);
     _dnaArray.create(&_group, dnaArrayName, HDF5DNA::dataType(), 
-                     arrayLength, &dnaDC, _numChunksInArrayBuffer);
+                     arrayLength, &dnaDC, _numChunksInArrayBuffer,
+                     _numPagesInArrayPool, _numReadaheadPages);
   }
   if (totalSeq > 0)
   {
     _sequenceIdxArray.create(&_group, sequenceIdxArrayName, 
                              HDF5Sequence::idxDataType(), 
-                             totalSeq + 1, &_dcprops, _numChunksInArrayBuffer);
+                             totalSeq + 1, &_dcprops, _numChunksInArrayBuffer,
+                             _numPagesInArrayPool, _numReadaheadPages);
 
     _sequenceNameArray.create(&_group, sequenceNameArrayName, 
                               HDF5Sequence::nameDataType(maxName + 1), 
-                              totalSeq, &_dcprops, _numChunksInArrayBuffer);
+                              totalSeq, &_dcprops, _numChunksInArrayBuffer,
+                              _numPagesInArrayPool, _numReadaheadPages);
 
     writeSequences(sequenceDimensions);    
   }
@@ -359,7 +366,8 @@ void HDF5Genome::setGenomeTopDimensions(
   }
   catch (H5::Exception){}
   _topArray.create(&_group, topArrayName, HDF5TopSegment::dataType(), 
-                   numTopSegments + 1, &_dcprops, _numChunksInArrayBuffer);
+                   numTopSegments + 1, &_dcprops, _numChunksInArrayBuffer,
+                   _numPagesInArrayPool, _numReadaheadPages);
   _parentCache = NULL;
 }
 
@@ -394,7 +402,8 @@ void HDF5Genome::setGenomeBottomDimensions(
 
   _bottomArray.create(&_group, bottomArrayName, 
                       HDF5BottomSegment::dataType(numChildren), 
-                      numBottomSegments + 1, &botDC, _numChunksInArrayBuffer);
+                      numBottomSegments + 1, &botDC, _numChunksInArrayBuffer,
+                      _numPagesInArrayPool, _numReadaheadPages);
   _numChildrenInBottomArray = numChildren;
   _childCache.clear();
 }
@@ -799,20 +808,23 @@ void HDF5Genome::read()
   try
   {
     _group.openDataSet(dnaArrayName);
-    _dnaArray.load(&_group, dnaArrayName, _numChunksInArrayBuffer);    
+    _dnaArray.load(&_group, dnaArrayName, _numChunksInArrayBuffer,
+                   _numPagesInArrayPool, _numReadaheadPages);
   }
   catch (H5::Exception){}
 
   try
   {
     _group.openDataSet(topArrayName);
-    _topArray.load(&_group, topArrayName, _numChunksInArrayBuffer);
+    _topArray.load(&_group, topArrayName, _numChunksInArrayBuffer,
+                   _numPagesInArrayPool, _numReadaheadPages);
   }
   catch (H5::Exception){}
   try
   {
     _group.openDataSet(bottomArrayName);
-    _bottomArray.load(&_group, bottomArrayName, _numChunksInArrayBuffer);
+    _bottomArray.load(&_group, bottomArrayName, _numChunksInArrayBuffer,
+                      _numPagesInArrayPool, _numReadaheadPages);
     _numChildrenInBottomArray = 
        HDF5BottomSegment::numChildrenFromDataType(_bottomArray.getDataType());
   }
@@ -823,14 +835,16 @@ void HDF5Genome::read()
   {
     _group.openDataSet(sequenceIdxArrayName);
     _sequenceIdxArray.load(&_group, sequenceIdxArrayName, 
-                           _numChunksInArrayBuffer);
+                           _numChunksInArrayBuffer,
+                           _numPagesInArrayPool, _numReadaheadPages);
   }
   catch (H5::Exception){}
   try
   {
     _group.openDataSet(sequenceNameArrayName);
     _sequenceNameArray.load(&_group, sequenceNameArrayName, 
-                            _numChunksInArrayBuffer);
+                            _numChunksInArrayBuffer,
+                            _numPagesInArrayPool, _numReadaheadPages);
   }
   catch (H5::Exception){}
 
@@ -42,7 +42,9 @@ public:
               HDF5Alignment* alignment,
               H5::PortableH5Location* h5Parent,
               const H5::DSetCreatPropList& dcProps,
-              bool inMemory);
+              bool inMemory,
+              hal_size_t numPagesInArrayPool = 1,
+              hal_size_t numReadaheadPages = 0);
 
    virtual ~HDF5Genome();
 
@@ -202,6 +204,8 @@ protected:
    hal_size_t _numChildrenInBottomArray;
    hal_size_t _totalSequenceLength;
    hal_size_t _numChunksInArrayBuffer;
+   hal_size_t _numPagesInArrayPool;
+   hal_size_t _numReadaheadPages;
 
    mutable Genome* _parentCache;
    mutable std::vector<Genome*> _childCache;
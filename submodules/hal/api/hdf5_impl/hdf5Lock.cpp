@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2013 by Glenn Hickey (hickey@soe.ucsc.edu)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <pthread.h>
+#include "halDefs.h"
+#include "hdf5Lock.h"
+
+using namespace hal;
+
+static pthread_once_t hdf5LockOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t hdf5Mutex;
+
+static void initHDF5Lock()
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&hdf5Mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+void HDF5Lock::lock()
+{
+  pthread_once(&hdf5LockOnce, initHDF5Lock);
+  if (pthread_mutex_lock(&hdf5Mutex) != 0)
+  {
+    throw hal_exception("Unable to take the HDF5 lock");
+  }
+}
+
+void HDF5Lock::unlock()
+{
+  pthread_mutex_unlock(&hdf5Mutex);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2013 by Glenn Hickey (hickey@soe.ucsc.edu)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HDF5LOCK_H
+#define _HDF5LOCK_H
+
+namespace hal {
+
+/** 
+ * Lock serializing the calls made into the HDF5 library by different
+ * threads.  The HDF5 library is not reentrant unless it is built 
+ * threadsafe, so each thread using its own alignment is not enough: 
+ * the library's own state is shared.  The lock is taken only around the
+ * calls into HDF5 (opening and closing alignments and genomes, and 
+ * reading and writing array pages), so reads of pages that are already 
+ * in memory run concurrently.  The lock is recursive, so the HDF5
+ * classes can take it without knowing if a caller already holds it.
+ */
+class HDF5Lock
+{
+public:
+   /** Takes the lock for the scope of the object */
+   HDF5Lock() { lock(); }
+   ~HDF5Lock() { unlock(); }
+
+   static void lock();
+   static void unlock();
+
+private:
+   HDF5Lock(const HDF5Lock&);
+   HDF5Lock& operator=(const HDF5Lock&);
+};
+
+/**
+ * Holds the HDF5Lock until it is released or the holder is destroyed.  
+ * As the first member of a class that owns HDF5 objects, it is 
+ * constructed before and destroyed after them, so the lock can be held 
+ * while the HDF5 members are made (taking it in the holder's constructor
+ * and releasing it at the end of the constructor body) and destroyed 
+ * (taking it again in the destructor body).
+ */
+class HDF5LockHolder
+{
+public:
+   HDF5LockHolder() : _held(false) { acquire(); }
+   ~HDF5LockHolder() { release(); }
+
+   void acquire() { if (!_held) { HDF5Lock::lock(); _held = true; } }
+   void release() { if (_held) { _held = false; HDF5Lock::unlock(); } }
+
+private:
+   HDF5LockHolder(const HDF5LockHolder&);
+   HDF5LockHolder& operator=(const HDF5LockHolder&);
+   bool _held;
+};
+
+}
+#endif
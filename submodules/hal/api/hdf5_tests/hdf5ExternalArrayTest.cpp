@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <string>
+#include <cstdlib>
 #include <H5Cpp.h>
 #include "allTests.h"
 #include "hdf5ExternalArray.h"
@@ -159,11 +160,83 @@ void hdf5ExternalArrayTestCompression(CuTest *testCase)
   }
 }
 
+void hdf5ExternalArrayTestPool(CuTest *testCase)
+{
+  // pages and readahead pages for each run
+  static const hsize_t poolSizes[][2] = {{1, 0}, {2, 1}, {3, 0}, {8, 3}, 
+                                         {1000, 2}};
+  static const hsize_t numPoolSizes = 5;
+  hsize_t chunkSize = 1000;
+  for (hsize_t poolIdx = 0; poolIdx < numPoolSizes; ++poolIdx)
+  {
+    hsize_t numPages = poolSizes[poolIdx][0];
+    hsize_t numReadaheadPages = poolSizes[poolIdx][1];
+    setup();
+    try 
+    {
+      IntType datatype(PredType::NATIVE_HSIZE);
+      H5File file(H5std_string(fileName), H5F_ACC_TRUNC);
+      HDF5ExternalArray myArray;
+      DSetCreatPropList cparms;
+      cparms.setDeflate(2);
+      cparms.setChunk(1, &chunkSize);
+      myArray.create(&file, datasetName, datatype, N, &cparms, 1,
+                     numPages, numReadaheadPages);
+      for (hsize_t i = 0; i < N; ++i)
+      {
+        myArray.setValue<hsize_t>(i, 0, i);
+      }
+      // jump around, so updated pages are evicted before they are written
+      for (hsize_t i = 0; i < 20000; ++i)
+      {
+        hsize_t j = (hsize_t)rand() % N;
+        numbers[j] = myArray.getValue<hsize_t>(j, 0) + N;
+        myArray.setValue<hsize_t>(j, 0, numbers[j]);
+      }
+      myArray.write();
+      file.flush(H5F_SCOPE_LOCAL);
+      file.close();
+
+      H5File rfile(H5std_string(fileName), H5F_ACC_RDONLY);
+      HDF5ExternalArray myrArray;
+      myrArray.load(&rfile, datasetName, 1, numPages, numReadaheadPages);
+      for (hsize_t i = 0; i < 20000; ++i)
+      {
+        // alternate between two regions, as when following segments 
+        // between genomes, and between random places
+        hsize_t j = (hsize_t)rand() % N;
+        if (i % 4 < 2)
+        {
+          j = (i % 2) * (N / 2) + (i / 4) % 2000;
+        }
+        CuAssertTrue(testCase, 
+                     myrArray.getValue<hsize_t>(j, 0) == (hsize_t)numbers[j]);
+      }
+      for (hsize_t i = 0; i < N; ++i)
+      {
+        CuAssertTrue(testCase, 
+                     myrArray.getValue<hsize_t>(i, 0) == (hsize_t)numbers[i]);
+      }
+    }
+    catch(Exception& exception)
+    {
+      cerr << exception.getCDetailMsg() << endl;
+      CuAssertTrue(testCase, 0);
+    }
+    catch(...)
+    {
+      CuAssertTrue(testCase, 0);
+    }
+    teardown();
+  }
+}
+
 CuSuite* hdf5ExternalArrayTestSuite(void) 
 {
   CuSuite* suite = CuSuiteNew();
   SUITE_ADD_TEST(suite, hdf5ExternalArrayTestCreate);
   SUITE_ADD_TEST(suite, hdf5ExternalArrayTestLoad);
   SUITE_ADD_TEST(suite, hdf5ExternalArrayTestCompression);
+  SUITE_ADD_TEST(suite, hdf5ExternalArrayTestPool);
   return suite;
 }
@@ -29,6 +29,9 @@ struct hal_remove_const<const T> {
  * supported automatically.  Dynamic casting (base to derived) 
  * is achieved with the downCast method().
  *
+ * The reference count is updated atomically, so copies of the same
+ * pointer can be made and released from different threads.  (Access
+ * to the pointed-to object is not synchronized.)
  */
 template <class T> 
 class counted_ptr
@@ -179,7 +182,7 @@ inline void counted_ptr<T>::acquire(const counted_ptr<U>& c)
   {
     _ptr = const_cast<Tnc*>(static_cast<T*>(c._ptr));
     _counter = c._counter;
-    ++(*_counter);
+    __sync_add_and_fetch(_counter, 1);
   }
   else 
   {
@@ -198,7 +201,7 @@ inline void counted_ptr<T>::dynamicAcquire(const counted_ptr<U>& c)
   {
     _ptr = temp;
     _counter = c._counter;
-    ++(*_counter);
+    __sync_add_and_fetch(_counter, 1);
   }
   else 
   {
@@ -212,7 +215,7 @@ inline void counted_ptr<T>::release()
 {
   if (_counter) 
   {
-    if (--(*_counter) == 0) 
+    if (__sync_sub_and_fetch(_counter, 1) == 0) 
     {
       delete _ptr;
       delete _counter;
@@ -21,24 +21,51 @@
 #include "halLodManager.h"
 #include "halMafExport.h"
 
-#ifdef ENABLE_UDC
 #include <pthread.h>
-static pthread_mutex_t HAL_MUTEX;
-#define HAL_LOCK pthread_mutex_lock(&HAL_MUTEX);
-#define HAL_UNLOCK pthread_mutex_unlock(&HAL_MUTEX);
-#else
-#define HAL_LOCK
-#define HAL_UNLOCK
-#endif
 
 using namespace std;
 using namespace hal;
 
-typedef map<int, pair<string, LodManagerPtr> > HandleMap;
+/** An open alignment.  Each thread that queries the handle loads its own
+ * LodManager for it (see getLodManager()), so queries on different 
+ * threads share no alignment, genome or iterator state and need no 
+ * common lock.  The serial number tells a thread that its LodManager 
+ * was loaded for an earlier handle with the same number. */
+struct HandleInfo
+{
+  string _path;
+  bool _isLod;
+  hal_size_t _serial;
+};
+typedef map<int, HandleInfo> HandleMap;
 static HandleMap handleMap;
+static hal_size_t handleSerial = 0;
+/** Protects handleMap.  Also held while LodManagers are loaded and 
+ * destroyed, as opening a file (udc in particular) is not reentrant */
+static pthread_mutex_t handleMutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct ThreadHandle
+{
+  hal_size_t _serial;
+  LodManagerPtr _lodManager;
+};
+typedef map<int, ThreadHandle> ThreadHandleMap;
+static pthread_key_t threadHandleKey;
+static pthread_once_t threadHandleOnce = PTHREAD_ONCE_INIT;
+
+/** Holds handleMutex for its scope */
+class HandleLock
+{
+public:
+  HandleLock() { pthread_mutex_lock(&handleMutex); }
+  ~HandleLock() { pthread_mutex_unlock(&handleMutex); }
+};
+
+static ThreadHandleMap& getThreadHandleMap();
+static LodManagerPtr loadLodManager(const HandleInfo& info);
+static LodManagerPtr getLodManager(int handle);
 
 static int halOpenLodOrHal(char* inputPath, bool isLod, char **errStr);
-static void checkHandle(int handle);
 static void checkGenomes(int halHandle, 
                          AlignmentConstPtr alignment, const string& qSpecies,
                          const string& tSpecies, const string& tChrom);
@@ -88,14 +115,14 @@ extern "C" int halOpen(char* halFilePath, char **errStr)
 
 int halOpenLodOrHal(char* inputPath, bool isLod, char **errStr)
 {
-  HAL_LOCK
   int handle = -1;
   try
   {
+    HandleLock lock;
     for (HandleMap::iterator mapIt = handleMap.begin(); 
          mapIt != handleMap.end(); ++mapIt)
     {
-      if (mapIt->second.first == string(inputPath))
+      if (mapIt->second._path == string(inputPath))
       {
         handle = mapIt->first;
       }
@@ -111,18 +138,17 @@ int halOpenLodOrHal(char* inputPath, bool isLod, char **errStr)
       {
         handle = mapIt->first + 1;
       }
-      LodManagerPtr lodManager(new LodManager());
-      if (isLod == true)
-      {
-        lodManager->loadLODFile(inputPath);
-      }
-      else
-      {
-        lodManager->loadSingeHALFile(inputPath);
-      }
-      handleMap.insert(pair<int, pair<string, LodManagerPtr> >(
-                         handle, pair<string, LodManagerPtr>(
-                           inputPath, lodManager)));
+      HandleInfo info;
+      info._path = inputPath;
+      info._isLod = isLod;
+      info._serial = ++handleSerial;
+      // load it here, so that a bad path is reported by the open.  
+      // this thread keeps it for its queries.
+      ThreadHandle threadHandle;
+      threadHandle._serial = info._serial;
+      threadHandle._lodManager = loadLodManager(info);
+      handleMap.insert(pair<int, HandleInfo>(handle, info));
+      getThreadHandleMap()[handle] = threadHandle;
     }
   }
   catch(exception& e)
@@ -147,16 +173,15 @@ int halOpenLodOrHal(char* inputPath, bool isLod, char **errStr)
     *errStr = stString_copy(ss.str().c_str());
     handle = -1;
   }
-  HAL_UNLOCK
   return handle;
 }
 
 extern "C" int halClose(int handle, char **errStr)
 {
-  HAL_LOCK
   int ret = 0;
   try
   {
+    HandleLock lock;
     HandleMap::iterator mapIt = handleMap.find(handle);
     if (mapIt == handleMap.end())
     {
@@ -165,6 +190,8 @@ extern "C" int halClose(int handle, char **errStr)
       throw hal_exception(ss.str());
     }
     handleMap.erase(mapIt);
+    // other threads drop their copies the next time they are queried
+    getThreadHandleMap().erase(handle);
   }
   catch(exception& e)
   {
@@ -188,7 +215,6 @@ extern "C" int halClose(int handle, char **errStr)
     *errStr = stString_copy(ss.str().c_str());
     ret = -1;
   }
-  HAL_UNLOCK
   return ret;
 }
 
@@ -246,7 +272,6 @@ struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
                                                       const char *coalescenceLimitName,
                                                       char **errStr)
 {
-  HAL_LOCK
   hal_block_results_t* results = NULL;
   try
   {
@@ -347,7 +372,6 @@ struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
     *errStr = stString_copy(ss.str().c_str());
     results = NULL;
   }
-  HAL_UNLOCK
   return results;
 }
 
@@ -446,7 +470,6 @@ extern "C" hal_int_t halGetMAF(FILE* outFile,
                                int doDupes,
                                char **errStr)
 {
-  HAL_LOCK
   hal_int_t numBytes = 0;
   try
   {
@@ -528,13 +551,11 @@ extern "C" hal_int_t halGetMAF(FILE* outFile,
     *errStr = stString_copy(ss.str().c_str());
     numBytes = -1;
   }
-  HAL_UNLOCK
   return numBytes;
 }
 
 extern "C" struct hal_species_t *halGetSpecies(int halHandle, char **errStr)
 {
-  HAL_LOCK
   hal_species_t* head = NULL;
   try
   {
@@ -609,7 +630,6 @@ extern "C" struct hal_species_t *halGetSpecies(int halHandle, char **errStr)
     *errStr = stString_copy(ss.str().c_str());
     head = NULL;
   }
-  HAL_UNLOCK
   return head;
 }
 
@@ -617,7 +637,6 @@ extern "C" struct hal_species_t *halGetPossibleCoalescenceLimits(int halHandle,
                                                                  const char *qSpecies,
                                                                  const char *tSpecies,
                                                                  char **errStr) {
-  HAL_LOCK
   hal_species_t* head = NULL;
   try
   {
@@ -685,7 +704,6 @@ extern "C" struct hal_species_t *halGetPossibleCoalescenceLimits(int halHandle,
     *errStr = stString_copy(ss.str().c_str());
     head = NULL;
   }
-  HAL_UNLOCK
   return head;
 }
 
@@ -704,7 +722,6 @@ extern "C" struct hal_chromosome_t *halGetChroms(int halHandle,
                                                  char* speciesName,
                                                  char **errStr)
 {
-  HAL_LOCK
   hal_chromosome_t* head = NULL;
   try
   {
@@ -771,7 +788,6 @@ extern "C" struct hal_chromosome_t *halGetChroms(int halHandle,
     *errStr = stString_copy(ss.str().c_str());
     head = NULL;
   }
-  HAL_UNLOCK
   return head;
 }
 
@@ -780,7 +796,6 @@ extern "C" char *halGetDna(int halHandle,
                            hal_int_t start, hal_int_t end,
                            char **errStr)
 {
-  HAL_LOCK
   char* dna = NULL;
   try
   {
@@ -836,25 +851,15 @@ extern "C" char *halGetDna(int halHandle,
     *errStr = stString_copy(ss.str().c_str());
     dna = NULL;
   }
-  HAL_UNLOCK
   return dna;
 }
 
 extern "C" hal_int_t halGetMaxLODQueryLength(int halHandle, char **errStr)
 {
-  HAL_LOCK
   hal_int_t ret = 0;
   try
   {
-    HandleMap::iterator mapIt = handleMap.find(halHandle);
-    if (mapIt == handleMap.end())
-    {
-      stringstream ss;
-      ss << "error getting Max LOD Query Length.  handle " 
-         << halHandle << ": not found";
-      throw hal_exception(ss.str());
-    }
-    ret = (hal_int_t)mapIt->second.second->getMaxQueryLength();
+    ret = (hal_int_t)getLodManager(halHandle)->getMaxQueryLength();
   }
   catch(exception& e)
   {
@@ -879,12 +884,56 @@ extern "C" hal_int_t halGetMaxLODQueryLength(int halHandle, char **errStr)
     *errStr = stString_copy(ss.str().c_str());
     ret = -1;
   }
-  HAL_UNLOCK
   return ret;
 }
 
-void checkHandle(int handle)
+static void deleteThreadHandleMap(void* threadHandleMap)
+{
+  HandleLock lock;
+  delete static_cast<ThreadHandleMap*>(threadHandleMap);
+}
+
+static void createThreadHandleKey()
+{
+  if (pthread_key_create(&threadHandleKey, deleteThreadHandleMap) != 0)
+  {
+    throw hal_exception("Unable to create thread-specific key for "
+                        "alignment handles");
+  }
+}
+
+ThreadHandleMap& getThreadHandleMap()
+{
+  pthread_once(&threadHandleOnce, createThreadHandleKey);
+  ThreadHandleMap* threadHandleMap = 
+     static_cast<ThreadHandleMap*>(pthread_getspecific(threadHandleKey));
+  if (threadHandleMap == NULL)
+  {
+    threadHandleMap = new ThreadHandleMap();
+    pthread_setspecific(threadHandleKey, threadHandleMap);
+  }
+  return *threadHandleMap;
+}
+
+LodManagerPtr loadLodManager(const HandleInfo& info)
+{
+  LodManagerPtr lodManager(new LodManager());
+  if (info._isLod == true)
+  {
+    lodManager->loadLODFile(info._path);
+  }
+  else
+  {
+    lodManager->loadSingeHALFile(info._path);
+  }
+  return lodManager;
+}
+
+LodManagerPtr getLodManager(int handle)
 {
+  ThreadHandleMap& threadHandleMap = getThreadHandleMap();
+  ThreadHandleMap::iterator threadIt = threadHandleMap.find(handle);
+  HandleLock lock;
   HandleMap::iterator mapIt = handleMap.find(handle);
   if (mapIt == handleMap.end())
   {
@@ -892,12 +941,32 @@ void checkHandle(int handle)
     ss << "Handle " << handle << "not found in alignment map";
     throw hal_exception(ss.str());
   }
-  if (mapIt->second.second.get() == NULL)
+  if (threadIt != threadHandleMap.end() && 
+      threadIt->second._serial == mapIt->second._serial)
   {
-    stringstream ss;
-    ss << "Handle " << handle << "points to NULL alignment";
-    throw hal_exception(ss.str());
+    return threadIt->second._lodManager;
   }
+
+  // first query of the handle from this thread: drop anything kept for 
+  // handles that have since been closed, and load our own copy
+  for (ThreadHandleMap::iterator i = threadHandleMap.begin(); 
+       i != threadHandleMap.end();)
+  {
+    HandleMap::iterator j = handleMap.find(i->first);
+    if (j == handleMap.end() || j->second._serial != i->second._serial)
+    {
+      threadHandleMap.erase(i++);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+  ThreadHandle threadHandle;
+  threadHandle._serial = mapIt->second._serial;
+  threadHandle._lodManager = loadLodManager(mapIt->second);
+  threadHandleMap[handle] = threadHandle;
+  return threadHandle._lodManager;
 }
 
 void checkGenomes(int halHandle, 
@@ -934,16 +1003,12 @@ void checkGenomes(int halHandle,
 AlignmentConstPtr getExistingAlignment(int handle, hal_size_t queryLength,
                                        bool needDNASequence)
 {
-  checkHandle(handle);
-  HandleMap::iterator mapIt = handleMap.find(handle);
-  return mapIt->second.second->getAlignment(queryLength, needDNASequence);
+  return getLodManager(handle)->getAlignment(queryLength, needDNASequence);
 }
 
 bool isAlignmentLod0(int handle, hal_size_t queryLength)
 {
-  checkHandle(handle);
-  HandleMap::iterator mapIt = handleMap.find(handle);
-  return mapIt->second.second->isLod0(queryLength);
+  return getLodManager(handle)->isLod0(queryLength);
 }
 
 char* copyCString(const string& inString)
@@ -1415,7 +1480,6 @@ extern "C" struct hal_metadata_t *halGetGenomeMetadata(int halHandle,
                                                        const char *genomeName,
                                                        char **errStr)
 {
-  HAL_LOCK
   struct hal_metadata_t *ret = NULL;
   try {
     AlignmentConstPtr alignment = 
@@ -1468,7 +1532,6 @@ extern "C" struct hal_metadata_t *halGetGenomeMetadata(int halHandle,
     *errStr = stString_copy(ss.str().c_str());
     ret = NULL;
   }
-  HAL_UNLOCK
   return ret;
 }
 
@@ -14,6 +14,11 @@ extern "C" {
 /** This is all prototype code to evaluate how to get blocks streamed 
  * from HAL to the browser. Interface is speficied by Brian */
 
+/** The functions below can be called from several threads at once, 
+ * including with the same handle.  Each thread opens its own copy of
+ * the alignment the first time it uses a handle, and keeps it until the
+ * handle is closed or the thread exits. */
+
 /* keep integer type definition in one place */
 typedef long hal_int_t;
 
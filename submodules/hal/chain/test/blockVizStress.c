@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "halBlockViz.h"
+
+/* Issues random halGetBlocksInTargetRange queries from an increasing 
+ * number of threads sharing one handle, and reports the query throughput
+ * for each thread count.  Every result is checked against the number of
+ * blocks the same query returned when run alone. */
+
+struct bvs_args_t
+{
+   char* path; 
+   char* qSpecies; 
+   char* tSpecies;
+   char* tChrom; 
+   int tStart; 
+   int tEnd;
+   int maxThreads;
+   int numQueries;
+   int queryLength;
+};
+
+struct bvs_query_t
+{
+   int tStart;
+   int tEnd;
+   int numBlocks;
+};
+
+struct bvs_thread_t
+{
+   int handle;
+   struct bvs_args_t* args;
+   struct bvs_query_t* queries;
+   int firstQuery;
+   int numErrors;
+};
+
+static int parseArgs(int argc, char** argv, struct bvs_args_t* args)
+{
+  if (argc < 7 || argc > 10)
+  {
+    return -1;
+  }
+  args->path = argv[1];
+  args->qSpecies = argv[2];
+  args->tSpecies = argv[3];
+  args->tChrom = argv[4];
+  if (sscanf(argv[5], "%d", &args->tStart) != 1 || 
+      sscanf(argv[6], "%d", &args->tEnd) != 1 ||
+      args->tEnd <= args->tStart)
+  {
+    return -1;
+  }
+  args->maxThreads = 8;
+  if (argc >= 8 && (sscanf(argv[7], "%d", &args->maxThreads) != 1 ||
+                    args->maxThreads < 1))
+  {
+    return -1;
+  }
+  args->numQueries = 100;
+  if (argc >= 9 && (sscanf(argv[8], "%d", &args->numQueries) != 1 ||
+                    args->numQueries < 1))
+  {
+    return -1;
+  }
+  args->queryLength = 10000;
+  if (argc >= 10 && (sscanf(argv[9], "%d", &args->queryLength) != 1 ||
+                     args->queryLength < 1))
+  {
+    return -1;
+  }
+  return 0; 
+}
+
+static int openWrapper(char* path)
+{
+  if (strcmp(path + strlen(path) - 3, "hal") == 0)
+  {
+    return halOpen(path, NULL);
+  }
+  return halOpenLOD(path, NULL);
+}
+
+/* returns the number of mapped blocks, or -1 on error */
+static int runQuery(int handle, struct bvs_args_t* args, 
+                    struct bvs_query_t* query)
+{
+  char* errStr = NULL;
+  struct hal_block_results_t* results = 
+     halGetBlocksInTargetRange(handle, args->qSpecies, args->tSpecies,
+                               args->tChrom, query->tStart, query->tEnd,
+                               0, HAL_NO_SEQUENCE, HAL_QUERY_AND_TARGET_DUPS,
+                               1, NULL, &errStr);
+  if (results == NULL)
+  {
+    fprintf(stderr, "%s\n", errStr != NULL ? errStr : "query failed");
+    free(errStr);
+    return -1;
+  }
+  int numBlocks = 0;
+  struct hal_block_t* block;
+  for (block = results->mappedBlocks; block != NULL; block = block->next)
+  {
+    ++numBlocks;
+  }
+  halFreeBlockResults(results);
+  return numBlocks;
+}
+
+static void* runQueries(void* threadArgs)
+{
+  struct bvs_thread_t* thread = (struct bvs_thread_t*)threadArgs;
+  int i;
+  for (i = 0; i < thread->args->numQueries; ++i)
+  {
+    /* each thread starts at a different query, so they don't all read 
+     * the same part of the file at the same time */
+    struct bvs_query_t* query = 
+       &thread->queries[(thread->firstQuery + i) % thread->args->numQueries];
+    if (runQuery(thread->handle, thread->args, query) != query->numBlocks)
+    {
+      ++thread->numErrors;
+    }
+  }
+  return NULL;
+}
+
+static double getTime()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.;
+}
+
+int main(int argc, char** argv)
+{
+  struct bvs_args_t args;
+  
+  if (parseArgs(argc, argv, &args) != 0)
+  {
+    fprintf(stderr, "Usage: %s <halLodPath> <qSpecies> <tSpecies> <tChrom> "
+            "<tStart> <tEnd> [maxThreads=8] [numQueries=100] "
+            "[queryLength=10000]\n\n", argv[0]);
+    return -1;
+  }
+     
+  int handle = openWrapper(args.path);
+  if (handle < 0)
+  {
+    return -1;
+  }
+
+  /* the expected results, from running the queries on their own */
+  struct bvs_query_t* queries = (struct bvs_query_t*)
+     malloc(args.numQueries * sizeof(struct bvs_query_t));
+  unsigned int seed = 1;
+  int i;
+  for (i = 0; i < args.numQueries; ++i)
+  {
+    int length = args.queryLength < args.tEnd - args.tStart ? 
+       args.queryLength : args.tEnd - args.tStart;
+    queries[i].tStart = args.tStart + 
+       rand_r(&seed) % (args.tEnd - args.tStart - length + 1);
+    queries[i].tEnd = queries[i].tStart + length;
+    queries[i].numBlocks = runQuery(handle, &args, &queries[i]);
+    if (queries[i].numBlocks < 0)
+    {
+      free(queries);
+      return -1;
+    }
+  }
+
+  int ret = 0;
+  int numThreads;
+  printf("threads\tqueries\tseconds\tqueries/sec\n");
+  for (numThreads = 1; numThreads <= args.maxThreads; numThreads *= 2)
+  {
+    pthread_t* threads = (pthread_t*)malloc(numThreads * sizeof(pthread_t));
+    struct bvs_thread_t* threadArgs = (struct bvs_thread_t*)
+       malloc(numThreads * sizeof(struct bvs_thread_t));
+    double start = getTime();
+    for (i = 0; i < numThreads; ++i)
+    {
+      threadArgs[i].handle = handle;
+      threadArgs[i].args = &args;
+      threadArgs[i].queries = queries;
+      threadArgs[i].firstQuery = i * args.numQueries / numThreads;
+      threadArgs[i].numErrors = 0;
+      if (pthread_create(&threads[i], NULL, runQueries, &threadArgs[i]) != 0)
+      {
+        fprintf(stderr, "Unable to create thread\n");
+        return -1;
+      }
+    }
+    int numErrors = 0;
+    for (i = 0; i < numThreads; ++i)
+    {
+      pthread_join(threads[i], NULL);
+      numErrors += threadArgs[i].numErrors;
+    }
+    double seconds = getTime() - start;
+    int numQueries = numThreads * args.numQueries;
+    printf("%d\t%d\t%.3f\t%.1f\n", numThreads, numQueries, seconds, 
+           seconds > 0 ? numQueries / seconds : 0.);
+    if (numErrors > 0)
+    {
+      fprintf(stderr, "%d queries with %d threads returned different "
+              "results than when run alone\n", numErrors, numThreads);
+      ret = -1;
+    }
+    free(threads);
+    free(threadArgs);
+  }
+  free(queries);
+  halClose(handle, NULL);
+  return ret;
+}
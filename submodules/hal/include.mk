@@ -11,8 +11,8 @@ include  ${sonLibRootPath}/include.mk
 
 dataSetsPath=/Users/hickey/Documents/Devel/genomes/datasets
 
-cflags += -I${sonLibPath} -fPIC
-cppflags += -I${sonLibPath} -fPIC
+cflags += -I${sonLibPath} -fPIC -pthread
+cppflags += -I${sonLibPath} -fPIC -pthread
 
 basicLibs = ${sonLibPath}/sonLib.a ${sonLibPath}/cuTest.a
 basicLibsDependencies = ${basicLibs}
@@ -35,8 +35,8 @@ ifdef ENABLE_UDC
 		SAMTABIXDIR = /hive/data/outside/samtabix/${MACHTYPE}
 	endif
 
-	cppflags += -DENABLE_UDC -I${KENTSRC}/src/inc -pthread
-	cflags += -I${KENTSRC}/src/inc -pthread
+	cppflags += -DENABLE_UDC -I${KENTSRC}/src/inc
+	cflags += -I${KENTSRC}/src/inc
 	basicLibs += ${KENTSRC}/src/lib/${MACHTYPE}/jkweb.a  ${SAMTABIXDIR}/libsamtabix.a -lssl -lcrypto
 endif
 
@@ -255,6 +255,90 @@ struct _referenceTerm {
     int64_t index;
 };
 
+/*
+ * The order of the nodes within an interval is kept by their indices, labels that increase along the interval, so that
+ * reference_cmp is a comparison of labels. The labels are maintained as an order maintenance list, using the scheme of
+ * Bender et al. ("Two simplified algorithms for maintaining order in a list", 2002): when a node is inserted between two
+ * nodes with adjacent labels the smallest aligned range of labels around it that is sparse enough is relabelled evenly.
+ * A range of 2^i labels is sparse enough if it holds no more than (2/T)^i nodes, for a constant 1 < T < 2, which gives
+ * amortized O(log n) relabellings per insert, rather than the O(n) of relabelling the whole interval.
+ */
+
+static const int64_t labelBits = 62;
+static const int64_t maxLabel = (((int64_t) 1) << 62) - 1;
+static const double labelDensityThreshold = 1.3; //T, larger values relabel smaller ranges but lower the capacity
+
+static void spreadLabels(referenceTerm *rT, int64_t count, int64_t base, int64_t size) {
+    /*
+     * Gives the count nodes starting from rT equally spaced labels in the range base to base + size - 1.
+     */
+    assert(count > 0 && count <= size);
+    int64_t spacer = size / count;
+    for (int64_t i = 0; i < count; i++) {
+        assert(rT != NULL);
+        rT->index = base + i * spacer;
+        rT = rT->nTerm;
+    }
+}
+
+static void relabel(referenceTerm *rT) {
+    /*
+     * Labels rT, a newly inserted node whose neighbours have adjacent labels, by relabelling the smallest sparse enough
+     * range of labels containing the label of its predecessor.
+     */
+    assert(rT->pTerm != NULL && rT->nTerm != NULL);
+    int64_t label = rT->pTerm->index;
+    referenceTerm *left = rT, *right = rT; //The first and last nodes in the range, rT being counted whatever its label
+    int64_t count = 1, base = label, size = 1;
+    double maxCount = 1.0;
+    for (int64_t i = 1; i <= labelBits; i++) {
+        size <<= 1;
+        base = label & ~(size - 1);
+        maxCount *= 2.0 / labelDensityThreshold;
+        while (left->pTerm != NULL && left->pTerm->index >= base) {
+            left = left->pTerm;
+            count++;
+        }
+        while (right->nTerm != NULL && right->nTerm->index <= base + (size - 1)) {
+            right = right->nTerm;
+            count++;
+        }
+        if (count <= maxCount) {
+            break;
+        }
+    }
+    //If no range is sparse enough the last one, which holds every label, is relabelled
+    if (count > 1000) {
+        st_logDebug("Relabelling %" PRIi64 " nodes of a reference interval\n", count);
+    }
+    spreadLabels(left, count, base, size);
+}
+
+static void relabelSuffix(referenceTerm *pTerm) {
+    /*
+     * Restores the order of the labels after the nodes following pTerm have been joined to it from another interval,
+     * relabelling them evenly above pTerm's label, or relabelling the whole interval if too few labels are left.
+     */
+    int64_t count = 0;
+    bool ordered = 1;
+    for (referenceTerm *rT = pTerm->nTerm, *rTP = pTerm; rT != NULL; rTP = rT, rT = rT->nTerm) {
+        ordered = ordered && rT->index > rTP->index;
+        count++;
+    }
+    if (ordered) {
+        return;
+    }
+    if (maxLabel - pTerm->index >= count) {
+        spreadLabels(pTerm->nTerm, count, pTerm->index + 1, maxLabel - pTerm->index);
+    } else {
+        int64_t length = 0;
+        for (referenceTerm *rT = pTerm->first; rT != NULL; rT = rT->nTerm) {
+            length++;
+        }
+        spreadLabels(pTerm->first, length, 0, maxLabel + 1);
+    }
+}
+
 struct _reference {
     int64_t nodeNumber;
     referenceTerm **nodesInGraph;
@@ -312,7 +396,7 @@ void reference_makeNewInterval(reference *ref, int64_t firstNode, int64_t lastNo
     rTF->first = rTF;
     rTL->first = rTF;
     rTF->index = 0;
-    rTL->index = INT64_MAX; //This forces the rebalancing code to be exercised.
+    rTL->index = maxLabel;
     reference_insertNodeP(ref, rTF);
     reference_insertNodeP(ref, rTL);
     stList_append(ref->referenceIntervals, rTF);
@@ -361,27 +445,11 @@ void reference_insertNode(reference *ref, int64_t pNode, int64_t node) {
     //Deal with indices
     assert(rT->nTerm->index - rTP->index >= 1);
     if (rT->nTerm->index - rTP->index == 1) { //Need to rebalance
-        //Work out the length of the chain
-        referenceTerm *rT2 = rTP->first;
-        int64_t length = 0;
-        while (rT2 != NULL) {
-            length++;
-            rT2 = rT2->nTerm;
-        }
-        //Now give every one equi-distant labels.
-        assert(length > 1);
-        st_logDebug("Rebalancing a reference string with %" PRIi64 " elements\n", length);
-        int64_t spacer = INT64_MAX / (length - 1);
-        assert(spacer > 0);
-        rT2 = rTP->first;
-        rT2->index = 0;
-        while (rT2->nTerm != NULL) {
-            rT2->nTerm->index = rT2->index + spacer;
-            rT2 = rT2->nTerm;
-        }
+        relabel(rT);
+    } else {
+        rT->index = rTP->index + (rT->nTerm->index - rTP->index) / 2;
     }
-    assert(rT->nTerm->index - rTP->index > 1);
-    rT->index = rTP->index + (rT->nTerm->index - rTP->index) / 2;
+    assert(rT->index > rTP->index && rT->index < rT->nTerm->index);
 }
 
 static void reference_insertNode2(reference *ref, insertPoint *iP) {
@@ -514,6 +582,9 @@ void reference_translocateIntervals(reference *ref, int64_t pNode1, int64_t nNod
     assert(nNode2Term->first == pNode2Term->first);
     setFirstPointer(nNode1Term, pNode2Term->first);
     setFirstPointer(nNode2Term, pNode1Term->first);
+    //Correct the order of the indices
+    relabelSuffix(pNode1Term);
+    relabelSuffix(pNode2Term);
 }
 
 void reference_splitInterval(reference *ref, int64_t pNode, int64_t stub1, int64_t stub2) {
@@ -282,6 +282,99 @@ bool toySplitFn(int64_t pNode, reference *ref, void *extraArgs) {
     return st_random() > 0.5;
 }
 
+static void checkReferenceOrder(CuTest *testCase) {
+    //Checks the nodes of each interval compare in the order of the interval.
+    for (int64_t i = 0; i < reference_getIntervalNumber(ref); i++) {
+        int64_t n = reference_getFirstOfInterval(ref, i);
+        int64_t length = reference_getRemainingIntervalLength(ref, n);
+        while (reference_getNext(ref, n) != INT64_MAX) {
+            int64_t m = reference_getNext(ref, n);
+            CuAssertIntEquals(testCase, -1, reference_cmp(ref, n, m));
+            CuAssertIntEquals(testCase, 1, reference_cmp(ref, m, n));
+            CuAssertIntEquals(testCase, 0, reference_cmp(ref, m, m));
+            CuAssertIntEquals(testCase, length - 1, reference_getRemainingIntervalLength(ref, m));
+            length--;
+            n = m;
+        }
+        CuAssertIntEquals(testCase, 1, length);
+    }
+}
+
+static void insertNodesRandomly(void) {
+    /*
+     * Inserts nodes after random nodes, a lot of them after the same node, so that the labels between two nodes run
+     * out and the relabelling is exercised.
+     */
+    int64_t insertNumber = st_randomInt(0, 5000);
+    int64_t pNode = 1;
+    for (int64_t i = 0; i < insertNumber; i++) {
+        if (st_random() > 0.9) {
+            pNode = st_randomInt(1, nodeNumber + 1);
+            if (reference_getNext(ref, pNode) == INT64_MAX) {
+                pNode = reference_getPrevious(ref, pNode);
+            }
+        }
+        nodeNumber++;
+        reference_insertNode(ref, pNode, st_random() > 0.5 ? nodeNumber : -nodeNumber);
+    }
+}
+
+static void testReference_insertOrder(CuTest *testCase) {
+    for (int64_t i = 0; i < testNumber; i++) {
+        setup();
+        nodeNumber = 2 * intervalNumber; //Only the stubs are in the reference
+        insertNodesRandomly();
+        checkIsValidReference(testCase);
+        checkReferenceOrder(testCase);
+        teardown();
+    }
+}
+
+static bool randomSplitFn(int64_t pNode, reference *ref, void *extraArgs) {
+    return st_random() > 0.9;
+}
+
+static void testReference_remakeIntervalsOrder(CuTest *testCase) {
+    /*
+     * Splits the intervals and rejoins the start of each split interval to the end of the next, so that nodes from
+     * different intervals are joined together, checking the order is kept.
+     */
+    for (int64_t i = 0; i < testNumber; i++) {
+        setup();
+        nodeNumber = 2 * intervalNumber;
+        insertNodesRandomly();
+        int64_t *lastNodes = st_malloc(sizeof(int64_t) * intervalNumber);
+        for (int64_t j = 0; j < intervalNumber; j++) {
+            lastNodes[j] = reference_getLast(ref, reference_getFirstOfInterval(ref, j));
+        }
+        stList *extraStubNodes = splitReferenceAtIndicatedLocations(ref, randomSplitFn, NULL);
+        checkReferenceOrder(testCase);
+        stList *splitIntervals = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+        for (int64_t j = 0; j < intervalNumber; j++) {
+            int64_t n = reference_getFirstOfInterval(ref, j);
+            if (reference_getLast(ref, n) != lastNodes[j]) {
+                stList_append(splitIntervals, stIntTuple_construct2(n, lastNodes[j]));
+            }
+        }
+        stList *intervals = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+        for (int64_t j = 0; j < stList_length(splitIntervals); j++) {
+            stIntTuple *interval1 = stList_get(splitIntervals, j);
+            stIntTuple *interval2 = stList_get(splitIntervals, (j + 1) % stList_length(splitIntervals));
+            stList_append(intervals, stIntTuple_construct2(stIntTuple_get(interval1, 0), stIntTuple_get(interval2, 1)));
+        }
+        stList *prunedExtraStubNodes = remakeReferenceIntervals(ref, intervals, extraStubNodes);
+        CuAssertIntEquals(testCase, intervalNumber + stList_length(prunedExtraStubNodes) / 2,
+                reference_getIntervalNumber(ref));
+        checkReferenceOrder(testCase);
+        stList_destruct(prunedExtraStubNodes);
+        stList_destruct(extraStubNodes);
+        stList_destruct(intervals);
+        stList_destruct(splitIntervals);
+        free(lastNodes);
+        teardown();
+    }
+}
+
 static void testMakeReferenceGreedily(CuTest *testCase) {
     long double maxScore = 0, achievedScore = 0;
     for (int64_t i = 0; i < testNumber; i++) {
@@ -401,6 +494,8 @@ CuSuite* referenceProblem2TestSuite(void) {
     SUITE_ADD_TEST(suite, testReference_splitInterval);
     SUITE_ADD_TEST(suite, testReference_getMaximumNode);
     SUITE_ADD_TEST(suite, testReference_removeIntervals);
+    SUITE_ADD_TEST(suite, testReference_insertOrder);
+    SUITE_ADD_TEST(suite, testReference_remakeIntervalsOrder);
     SUITE_ADD_TEST(suite, testADBDCExample);
     return suite;
 }
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include <stdlib.h>
+#include <time.h>
+#include "sonLib.h"
+#include "stReferenceProblem2.h"
+
+/*
+ * Times inserting nodes into a reference interval, after random nodes, always after the first node, which runs out of
+ * labels fastest, and each after the last inserted, as when an interval is extended.
+ *
+ * Usage: referenceOrderBenchmark [nodeNumber] [seed]
+ */
+
+typedef enum {
+    randomInserts, frontInserts, appendInserts
+} InsertPattern;
+
+static const char *patternNames[] = { "random", "front", "append" };
+
+static double insertNodes(int64_t nodeNumber, InsertPattern pattern) {
+    reference *ref = reference_construct(nodeNumber + 2);
+    reference_makeNewInterval(ref, 1, 2);
+    int64_t pNode = 1;
+    clock_t startTime = clock();
+    for (int64_t n = 3; n < nodeNumber + 3; n++) {
+        if (pattern == randomInserts) {
+            //Any node but the last stub, 2
+            pNode = st_randomInt(1, n);
+            pNode = pNode == 2 ? 1 : pNode;
+        } else if (pattern == appendInserts) {
+            pNode = n == 3 ? 1 : n - 1;
+        }
+        reference_insertNode(ref, pNode, n);
+    }
+    double seconds = ((double) (clock() - startTime)) / CLOCKS_PER_SEC;
+    //Check the order
+    int64_t n = 1, length = 1;
+    while (reference_getNext(ref, n) != INT64_MAX) {
+        if (reference_cmp(ref, n, reference_getNext(ref, n)) != -1) {
+            st_errAbort("Nodes %" PRIi64 " and %" PRIi64 " are out of order", n, reference_getNext(ref, n));
+        }
+        n = reference_getNext(ref, n);
+        length++;
+    }
+    if (length != nodeNumber + 2) {
+        st_errAbort("Expected %" PRIi64 " nodes, got %" PRIi64, nodeNumber + 2, length);
+    }
+    reference_destruct(ref);
+    return seconds;
+}
+
+static int64_t parseArgument(const char *name, const char *string, int64_t minimum) {
+    char *end;
+    int64_t i = strtoll(string, &end, 10);
+    if (end == string || *end != '\0' || i < minimum) {
+        st_errAbort("Error parsing the %s argument: %s", name, string);
+    }
+    return i;
+}
+
+int main(int argc, char *argv[]) {
+    int64_t nodeNumber = argc > 1 ? parseArgument("nodeNumber", argv[1], 0) : 1000000;
+    st_randomSeed(argc > 2 ? parseArgument("seed", argv[2], INT64_MIN) : 0);
+    fprintf(stdout, "pattern\tnodes\tseconds\tinserts/sec\n");
+    for (int64_t i = 0; i < 3; i++) {
+        double seconds = insertNodes(nodeNumber, i);
+        fprintf(stdout, "%s\t%" PRIi64 "\t%.3f\t%.0f\n", patternNames[i], nodeNumber, seconds,
+                seconds > 0 ? nodeNumber / seconds : 0.0);
+    }
+    return 0;
+}
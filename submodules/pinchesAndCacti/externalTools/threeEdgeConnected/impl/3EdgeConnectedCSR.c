@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tsin's absorb-eject algorithm for 3-edge connected components (Y. H. Tsin, "A simple 3-edge-connected component
+ * algorithm", Theory of Computing Systems, 2007), over a graph in compressed sparse row form.
+ *
+ * A depth first search absorbs into each node w the nodes that are found to be 3-edge connected to it. The nodes
+ * absorbed into w form its sigma set, kept as a circular list through nextSigma. The w-path is the path of tree
+ * descendants of w that may still be absorbed into it, linked through nextOnPath (a node that is its own successor
+ * ends the path). Each node also keeps the list of its outgoing back edges, those going to an ancestor, which is
+ * appended to the list of whatever node absorbs it. When the search backs up from a child u that is left with at most
+ * two edges to the rest of the graph, u and its sigma set are ejected as a component.
+ *
+ * The search uses an explicit stack, so the depth of the graph is not limited by the size of the call stack, and all
+ * per node state is kept together in one array, indexed by node.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "sonLib.h"
+#include "3EdgeConnectedCSR.h"
+
+typedef struct _node {
+    int64_t pre; //Preorder number, or -1 if not yet visited
+    int64_t lowpt; //Lowest preorder number reachable by a back edge from the node's absorbed subtree
+    int64_t nd; //Number of descendants, including the node
+    int64_t parent;
+    int64_t nextEdge; //The edges not yet scanned are those before this index
+    int64_t nextOnPath;
+    int64_t nextSigma;
+    int64_t backEdges, lastBackEdge; //Head and tail of the list of outgoing back edges, -1 if empty
+    bool parentEdgeSeen; //The first edge to the parent is the tree edge, any other is a back edge
+} Node;
+
+typedef struct _backEdge {
+    int64_t target;
+    int64_t next;
+} BackEdge;
+
+typedef struct _threeEdgeSearch {
+    Node *nodes;
+    BackEdge *backEdges;
+    int64_t backEdgeNumber;
+    int64_t *componentOffsets;
+    int64_t *componentNodes;
+    int64_t componentNumber;
+    int64_t componentNodeNumber;
+} ThreeEdgeSearch;
+
+static void visitNode(ThreeEdgeSearch *search, int64_t w, int64_t parent, int64_t pre, const int64_t *edgeOffsets) {
+    Node *node = &search->nodes[w];
+    node->pre = pre;
+    node->lowpt = pre;
+    node->nd = 1;
+    node->parent = parent;
+    node->nextEdge = edgeOffsets[w + 1]; //Edges are scanned from last to first, the order of the list based version
+    node->nextOnPath = w;
+    node->nextSigma = w;
+    node->backEdges = -1;
+    node->lastBackEdge = -1;
+    node->parentEdgeSeen = 0;
+}
+
+static void absorbPath(ThreeEdgeSearch *search, int64_t w, int64_t x, int64_t end) {
+    /*
+     * Absorbs into w the nodes of the path starting at x, up to and including end, or to the end of the path if end is -1.
+     */
+    Node *nodes = search->nodes;
+    if (w == x || w == end) {
+        return;
+    }
+    int64_t previous = w;
+    while (previous != x) {
+        //Join the sigma sets
+        int64_t i = nodes[w].nextSigma;
+        nodes[w].nextSigma = nodes[x].nextSigma;
+        nodes[x].nextSigma = i;
+        //And the back edges
+        if (nodes[x].backEdges != -1) {
+            if (nodes[w].backEdges == -1) {
+                nodes[w].backEdges = nodes[x].backEdges;
+            } else {
+                search->backEdges[nodes[w].lastBackEdge].next = nodes[x].backEdges;
+            }
+            nodes[w].lastBackEdge = nodes[x].lastBackEdge;
+        }
+        previous = x;
+        if (x != end) {
+            x = nodes[x].nextOnPath;
+        }
+    }
+}
+
+static void addComponent(ThreeEdgeSearch *search, int64_t u) {
+    /*
+     * Outputs the sigma set of u as a component.
+     */
+    search->componentOffsets[search->componentNumber++] = search->componentNodeNumber;
+    int64_t x = u;
+    do {
+        search->componentNodes[search->componentNodeNumber++] = x;
+        x = search->nodes[x].nextSigma;
+    } while (x != u);
+}
+
+static void backUp(ThreeEdgeSearch *search, int64_t w, int64_t u) {
+    /*
+     * Called when the search backs up the tree edge from the child u to w.
+     */
+    Node *nodes = search->nodes;
+    BackEdge *backEdges = search->backEdges;
+    Node *nodeW = &nodes[w], *nodeU = &nodes[u];
+    nodeW->nd += nodeU->nd;
+
+    //Work out if u has at most two edges left. Back edges that now end inside u's sigma set are self loops, and are removed.
+    bool degreeTwo;
+    if (nodeU->nextOnPath == u) { //The u-path is empty, so u has at most two edges if it has at most one back edge
+        int64_t backEdgeNumber = 0, first = -1;
+        while (backEdgeNumber <= 1 && nodeU->backEdges != -1) {
+            int64_t i = nodeU->backEdges;
+            if (nodeU->pre > nodes[backEdges[i].target].pre) {
+                if (++backEdgeNumber == 1) { //Hold the first back edge out of the list while looking for a second
+                    first = i;
+                    nodeU->backEdges = backEdges[i].next;
+                }
+            } else {
+                nodeU->backEdges = backEdges[i].next;
+            }
+        }
+        if (backEdgeNumber > 0) {
+            backEdges[first].next = nodeU->backEdges;
+            nodeU->backEdges = first;
+        }
+        degreeTwo = backEdgeNumber <= 1;
+    } else { //Otherwise it has at most two edges if it has no back edges
+        while (nodeU->backEdges != -1 && nodeU->pre <= nodes[backEdges[nodeU->backEdges].target].pre) {
+            nodeU->backEdges = backEdges[nodeU->backEdges].next;
+        }
+        degreeTwo = nodeU->backEdges == -1;
+    }
+
+    int64_t pu = u; //The first node of the u-path that w may absorb
+    if (degreeTwo) { //Eject u
+        if (nodeU->nextOnPath != u) {
+            pu = nodeU->nextOnPath;
+        } else {
+            pu = w;
+            if (nodeU->backEdges != -1) { //Its single back edge now leaves w
+                int64_t i = nodeU->backEdges;
+                if (nodeW->backEdges == -1) {
+                    nodeW->lastBackEdge = i;
+                }
+                backEdges[i].next = nodeW->backEdges;
+                nodeW->backEdges = i;
+            }
+        }
+        addComponent(search, u);
+    }
+    if (nodeW->lowpt <= nodeU->lowpt) {
+        absorbPath(search, w, pu, -1);
+    } else {
+        nodeW->lowpt = nodeU->lowpt;
+        absorbPath(search, w, nodeW->nextOnPath, -1);
+        nodeW->nextOnPath = pu;
+    }
+}
+
+static void scanVisitedEdge(ThreeEdgeSearch *search, int64_t w, int64_t u) {
+    /*
+     * Processes the edge from w to the already visited node u.
+     */
+    Node *nodes = search->nodes;
+    Node *nodeW = &nodes[w];
+    if (u == nodeW->parent && !nodeW->parentEdgeSeen) {
+        nodeW->parentEdgeSeen = 1;
+    } else if (nodeW->pre > nodes[u].pre) { //An outgoing back edge
+        int64_t i = search->backEdgeNumber++;
+        search->backEdges[i].target = u;
+        search->backEdges[i].next = nodeW->backEdges;
+        if (nodeW->backEdges == -1) {
+            nodeW->lastBackEdge = i;
+        }
+        nodeW->backEdges = i;
+        if (nodes[u].pre < nodeW->lowpt) {
+            absorbPath(search, w, nodeW->nextOnPath, -1);
+            nodeW->nextOnPath = w;
+            nodeW->lowpt = nodes[u].pre;
+        }
+    } else if (nodeW->nextOnPath != w) { //An incoming back edge, from a descendant u: absorb the w-path down to u's ancestor
+        int64_t parent = w, child = nodeW->nextOnPath;
+        while (parent != child && nodes[child].pre <= nodes[u].pre && nodes[u].pre <= nodes[child].pre + nodes[child].nd - 1) {
+            parent = child;
+            child = nodes[child].nextOnPath;
+        }
+        absorbPath(search, w, nodeW->nextOnPath, parent);
+        nodeW->nextOnPath = parent == nodes[parent].nextOnPath ? w : nodes[parent].nextOnPath;
+    }
+}
+
+int64_t computeThreeEdgeConnectedComponentsCSR(int64_t nodeNumber, const int64_t *edgeOffsets, const int64_t *edgeTargets,
+        int64_t **componentOffsets, int64_t **componentNodes) {
+    ThreeEdgeSearch search;
+    search.nodes = st_malloc(sizeof(Node) * (nodeNumber > 0 ? nodeNumber : 1));
+    //Each edge is an outgoing back edge at most once
+    search.backEdges = st_malloc(sizeof(BackEdge) * (edgeOffsets[nodeNumber] / 2 + 1));
+    search.backEdgeNumber = 0;
+    search.componentOffsets = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    search.componentNodes = st_malloc(sizeof(int64_t) * (nodeNumber > 0 ? nodeNumber : 1));
+    search.componentNumber = 0;
+    search.componentNodeNumber = 0;
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        search.nodes[i].pre = -1;
+    }
+
+    int64_t *stack = st_malloc(sizeof(int64_t) * (nodeNumber > 0 ? nodeNumber : 1));
+    int64_t pre = 0;
+    for (int64_t r = 0; r < nodeNumber; r++) {
+        if (search.nodes[r].pre != -1) {
+            continue;
+        }
+        int64_t stackLength = 0;
+        visitNode(&search, r, -1, pre++, edgeOffsets);
+        stack[stackLength++] = r;
+        while (stackLength > 0) {
+            int64_t w = stack[stackLength - 1];
+            Node *nodeW = &search.nodes[w];
+            if (nodeW->nextEdge > edgeOffsets[w]) {
+                int64_t u = edgeTargets[--nodeW->nextEdge];
+                assert(u >= 0 && u < nodeNumber);
+                if (search.nodes[u].pre == -1) { //A tree edge, descend
+                    visitNode(&search, u, w, pre++, edgeOffsets);
+                    stack[stackLength++] = u;
+                } else {
+                    scanVisitedEdge(&search, w, u);
+                }
+            } else if (--stackLength > 0) {
+                backUp(&search, stack[stackLength - 1], w);
+            }
+        }
+        addComponent(&search, r);
+    }
+    assert(search.componentNodeNumber == nodeNumber);
+    search.componentOffsets[search.componentNumber] = nodeNumber;
+
+    free(stack);
+    free(search.nodes);
+    free(search.backEdges);
+    *componentOffsets = search.componentOffsets;
+    *componentNodes = search.componentNodes;
+    return search.componentNumber;
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef THREE_EDGE_CONNECTED_CSR_H_
+#define THREE_EDGE_CONNECTED_CSR_H_
+
+#include <stdint.h>
+
+/*
+ * Computes the 3-edge connected components of an undirected multigraph, using Tsin's absorb-eject
+ * algorithm, as computeThreeEdgeConnectedComponents does, but without recursion and with the graph in
+ * compressed sparse row form.
+ *
+ * The nodes are numbered from 0 to nodeNumber - 1. The neighbours of node i are
+ * edgeTargets[edgeOffsets[i]] to edgeTargets[edgeOffsets[i + 1] - 1], so edgeOffsets has nodeNumber + 1
+ * entries. Each edge is listed by both its nodes, and a self loop twice by its node.
+ *
+ * Returns the number of components, n, and sets componentOffsets to an array of n + 1 entries and
+ * componentNodes to an array of nodeNumber entries, such that the nodes of component j are
+ * componentNodes[componentOffsets[j]] to componentNodes[componentOffsets[j + 1] - 1]. Given the same
+ * graph the components, and the nodes within them, are in the same order as those returned by
+ * computeThreeEdgeConnectedComponents. Both arrays are to be freed by the caller.
+ */
+int64_t computeThreeEdgeConnectedComponentsCSR(int64_t nodeNumber, const int64_t *edgeOffsets, const int64_t *edgeTargets,
+        int64_t **componentOffsets, int64_t **componentNodes);
+
+#endif
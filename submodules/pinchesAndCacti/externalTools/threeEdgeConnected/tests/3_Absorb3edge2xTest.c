@@ -11,9 +11,12 @@
  *      Author: benedictpaten
  */
 
+#include <stdlib.h>
+
 #include "sonLib.h"
 #include "CuTest.h"
 #include "3_Absorb3edge2x.h"
+#include "3EdgeConnectedCSR.h"
 
 void addEdgeToList(stList *vertices, int64_t vertex1, int64_t vertex2) {
     stList *edges = stList_get(vertices, vertex1);
@@ -88,8 +91,101 @@ static void test_3EdgeFunction(CuTest *testCase) {
     }
 }
 
+static void getCSRGraph(stList *vertices, int64_t **edgeOffsets, int64_t **edgeTargets) {
+    int64_t edgeNumber = 0;
+    for(int64_t i=0; i<stList_length(vertices); i++) {
+        edgeNumber += stList_length(stList_get(vertices, i));
+    }
+    *edgeOffsets = st_malloc(sizeof(int64_t) * (stList_length(vertices) + 1));
+    *edgeTargets = st_malloc(sizeof(int64_t) * (edgeNumber > 0 ? edgeNumber : 1));
+    int64_t j = 0;
+    for(int64_t i=0; i<stList_length(vertices); i++) {
+        (*edgeOffsets)[i] = j;
+        stList *edges = stList_get(vertices, i);
+        for(int64_t k=0; k<stList_length(edges); k++) {
+            (*edgeTargets)[j++] = stIntTuple_get(stList_get(edges, k), 0);
+        }
+    }
+    (*edgeOffsets)[stList_length(vertices)] = j;
+}
+
+static void test_3EdgeFunctionCSR(CuTest *testCase) {
+    /*
+     * Checks the compressed sparse row version gives the same components, in the same order, as the list based version.
+     */
+    for(int64_t test=0; test<500; test++) {
+        int64_t vertexNumber = st_randomInt(0, 100);
+        int64_t edgeNumber = vertexNumber > 0 ? st_randomInt(0, test % 2 == 0 ? 2 * vertexNumber : vertexNumber * vertexNumber) : 0;
+        stList *vertices = getRandomGraph(vertexNumber, edgeNumber);
+        int64_t *edgeOffsets, *edgeTargets, *componentOffsets, *componentNodes;
+        getCSRGraph(vertices, &edgeOffsets, &edgeTargets);
+
+        stList *threeEdgeConnectedComponents = computeThreeEdgeConnectedComponents(vertices);
+        int64_t componentNumber = computeThreeEdgeConnectedComponentsCSR(vertexNumber, edgeOffsets, edgeTargets,
+                &componentOffsets, &componentNodes);
+
+        CuAssertIntEquals(testCase, stList_length(threeEdgeConnectedComponents), componentNumber);
+        for(int64_t i=0; i<componentNumber; i++) {
+            stList *threeEdgeConnectedComponent = stList_get(threeEdgeConnectedComponents, i);
+            CuAssertIntEquals(testCase, stList_length(threeEdgeConnectedComponent), componentOffsets[i+1] - componentOffsets[i]);
+            for(int64_t j=0; j<stList_length(threeEdgeConnectedComponent); j++) {
+                CuAssertIntEquals(testCase, stIntTuple_get(stList_get(threeEdgeConnectedComponent, j), 0),
+                        componentNodes[componentOffsets[i] + j]);
+            }
+        }
+        CuAssertIntEquals(testCase, vertexNumber, componentOffsets[componentNumber]);
+
+        stList_destruct(threeEdgeConnectedComponents);
+        stList_destruct(vertices);
+        free(edgeOffsets);
+        free(edgeTargets);
+        free(componentOffsets);
+        free(componentNodes);
+    }
+}
+
+static void test_3EdgeFunctionCSR_deepGraph(CuTest *testCase) {
+    /*
+     * A long cycle, with a chord of parallel edges in the middle, gives a search far deeper than the call stack would allow.
+     */
+    int64_t vertexNumber = 1000000;
+    int64_t *edgeOffsets = st_malloc(sizeof(int64_t) * (vertexNumber + 1));
+    int64_t *edgeTargets = st_malloc(sizeof(int64_t) * (2 * vertexNumber + 2));
+    int64_t j = 0;
+    for(int64_t i=0; i<vertexNumber; i++) {
+        edgeOffsets[i] = j;
+        edgeTargets[j++] = (i + vertexNumber - 1) % vertexNumber;
+        edgeTargets[j++] = (i + 1) % vertexNumber;
+        if(i == 0 || i == vertexNumber / 2) {
+            edgeTargets[j++] = i == 0 ? vertexNumber / 2 : 0;
+        }
+    }
+    edgeOffsets[vertexNumber] = j;
+    int64_t *componentOffsets, *componentNodes;
+    int64_t componentNumber = computeThreeEdgeConnectedComponentsCSR(vertexNumber, edgeOffsets, edgeTargets,
+            &componentOffsets, &componentNodes);
+    //The two ends of the chord are 3-edge connected, every other vertex is on its own
+    CuAssertIntEquals(testCase, vertexNumber - 1, componentNumber);
+    int64_t pairs = 0;
+    for(int64_t i=0; i<componentNumber; i++) {
+        if(componentOffsets[i+1] - componentOffsets[i] == 2) {
+            pairs++;
+            int64_t x = componentNodes[componentOffsets[i]], y = componentNodes[componentOffsets[i] + 1];
+            CuAssertIntEquals(testCase, vertexNumber / 2, x + y);
+            CuAssertTrue(testCase, x == 0 || y == 0);
+        }
+    }
+    CuAssertIntEquals(testCase, 1, pairs);
+    free(edgeOffsets);
+    free(edgeTargets);
+    free(componentOffsets);
+    free(componentNodes);
+}
+
 CuSuite* threeEdgeTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_3EdgeFunction);
+    SUITE_ADD_TEST(suite, test_3EdgeFunctionCSR);
+    SUITE_ADD_TEST(suite, test_3EdgeFunctionCSR_deepGraph);
     return suite;
 }
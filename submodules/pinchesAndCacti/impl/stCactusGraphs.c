@@ -7,7 +7,7 @@
 
 #include "sonLib.h"
 #include "stCactusGraphs.h"
-#include "3_Absorb3edge2x.h"
+#include "3EdgeConnectedCSR.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -15,6 +15,7 @@ struct _stCactusNode {
     stCactusEdgeEnd *head;
     stCactusEdgeEnd *tail;
     void *nodeObject;
+    int64_t index; //Scratch space, used to number the nodes when collapsing the graph
 };
 
 struct _stCactusEdgeEnd {
@@ -220,45 +221,45 @@ stCactusNode *stCactusGraph_getNode(stCactusGraph *node, void *nodeObject) {
 }
 
 void stCactusGraph_collapseToCactus(stCactusGraph *graph, void *(*mergeNodeObjects)(void *, void *), stCactusNode *startNode) {
-    //Basic data structures
-    stHash *nodesToPositions = stHash_construct();
-    stHash *positionsToNodes = stHash_construct3((uint64_t(*)(const void *)) stIntTuple_hashKey,
-            (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct, NULL);
-    stList *adjacencyList = stList_construct3(0, (void(*)(void *)) stList_destruct);
-
-    //Set up and run the three edge connected code.
+    //Number the nodes
+    int64_t nodeNumber = stCactusGraph_getNodeNumber(graph);
+    stCactusNode **nodes = st_malloc(sizeof(stCactusNode *) * (nodeNumber > 0 ? nodeNumber : 1));
+    int64_t *edgeOffsets = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
     stCactusGraphNodeIt *nodeIt = stCactusGraphNodeIterator_construct(graph);
     stCactusNode *node;
-    int64_t nodeIdCounter = 0;
-    while ((node = stCactusGraphNodeIterator_getNext(nodeIt)) != NULL) {
-        stIntTuple *nodeId = stIntTuple_construct1( nodeIdCounter++);
-        stHash_insert(nodesToPositions, node, nodeId);
-        stHash_insert(positionsToNodes, nodeId, node);
+    int64_t edgeEndNumber = 0;
+    for (int64_t i = 0; (node = stCactusGraphNodeIterator_getNext(nodeIt)) != NULL; i++) {
+        node->index = i;
+        nodes[i] = node;
+        edgeOffsets[i] = edgeEndNumber;
+        stCactusNodeEdgeEndIt edgeEndIt = stCactusNode_getEdgeEndIt(node);
+        while (stCactusNodeEdgeEndIt_getNext(&edgeEndIt) != NULL) {
+            edgeEndNumber++;
+        }
     }
     stCactusGraphNodeIterator_destruct(nodeIt);
-    nodeIt = stCactusGraphNodeIterator_construct(graph);
-    while ((node = stCactusGraphNodeIterator_getNext(nodeIt)) != NULL) {
-        stList *edges = stList_construct();
-        stList_append(adjacencyList, edges);
-        stCactusNodeEdgeEndIt edgeEndIt = stCactusNode_getEdgeEndIt(node);
+    edgeOffsets[nodeNumber] = edgeEndNumber;
+
+    //Build the graph in compressed sparse row form, with an entry for each edge end
+    int64_t *edgeTargets = st_malloc(sizeof(int64_t) * (edgeEndNumber > 0 ? edgeEndNumber : 1));
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        int64_t j = edgeOffsets[i];
+        stCactusNodeEdgeEndIt edgeEndIt = stCactusNode_getEdgeEndIt(nodes[i]);
         stCactusEdgeEnd *edgeEnd;
         while ((edgeEnd = stCactusNodeEdgeEndIt_getNext(&edgeEndIt)) != NULL) {
-            stCactusNode *otherNode = stCactusEdgeEnd_getOtherNode(edgeEnd);
-            stIntTuple *otherNodeId = stHash_search(nodesToPositions, otherNode);
-            assert(otherNodeId != NULL);
-            stList_append(edges, otherNodeId);
+            edgeTargets[j++] = stCactusEdgeEnd_getOtherNode(edgeEnd)->index;
         }
+        assert(j == edgeOffsets[i + 1]);
     }
-    stCactusGraphNodeIterator_destruct(nodeIt);
+
     //Now do the merging
-    stList *_3EdgeConnectedComponents = computeThreeEdgeConnectedComponents(adjacencyList);
-    for (int64_t i = 0; i < stList_length(_3EdgeConnectedComponents); i++) {
-        stList *_3EdgeConnectedComponent = stList_get(_3EdgeConnectedComponents, i);
-        stCactusNode *node = stHash_search(positionsToNodes, stList_get(_3EdgeConnectedComponent, 0));
-        assert(node != NULL);
-        for (int64_t j = 1; j < stList_length(_3EdgeConnectedComponent); j++) {
-            stCactusNode *otherNode = stHash_search(positionsToNodes, stList_get(_3EdgeConnectedComponent, j));
-            assert(otherNode != NULL);
+    int64_t *componentOffsets, *componentNodes;
+    int64_t componentNumber = computeThreeEdgeConnectedComponentsCSR(nodeNumber, edgeOffsets, edgeTargets, &componentOffsets,
+            &componentNodes);
+    for (int64_t i = 0; i < componentNumber; i++) {
+        stCactusNode *node = nodes[componentNodes[componentOffsets[i]]];
+        for (int64_t j = componentOffsets[i] + 1; j < componentOffsets[i + 1]; j++) {
+            stCactusNode *otherNode = nodes[componentNodes[j]];
             assert(node != otherNode);
             if (otherNode == startNode) { //This prevents the start node from being destructed.
                 otherNode = node;
@@ -268,10 +269,11 @@ void stCactusGraph_collapseToCactus(stCactusGraph *graph, void *(*mergeNodeObjec
         }
     }
     //Cleanup
-    stList_destruct(adjacencyList);
-    stList_destruct(_3EdgeConnectedComponents);
-    stHash_destruct(nodesToPositions);
-    stHash_destruct(positionsToNodes);
+    free(nodes);
+    free(edgeOffsets);
+    free(edgeTargets);
+    free(componentOffsets);
+    free(componentNodes);
 
     //Mark the cycles
     stList *components = stCactusGraph_getComponents(graph, 0);
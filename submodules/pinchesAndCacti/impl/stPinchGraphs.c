@@ -352,7 +352,7 @@ int64_t stPinchThread_getLength(stPinchThread *thread) {
 }
 
 stPinchSegment *stPinchThread_getSegment(stPinchThread *thread, int64_t coordinate) {
-    static stPinchSegment segment;
+    stPinchSegment segment; //On the stack, so distinct threads can be pinched concurrently
     segment.start = coordinate;
     stPinchSegment *segment2 = stSortedSet_searchLessThanOrEqual(thread->segments, &segment);
     if (segment2 == NULL) {
@@ -603,7 +603,7 @@ stPinchThread *stPinchThreadSet_addThread(stPinchThreadSet *threadSet, int64_t n
 }
 
 stPinchThread *stPinchThreadSet_getThread(stPinchThreadSet *threadSet, int64_t name) {
-    static stPinchThread thread;
+    stPinchThread thread;
     thread.name = name;
     return stHash_search(threadSet->threadsHash, &thread);
 }
@@ -762,6 +762,113 @@ stList *stPinchThreadSet_getAdjacencyComponents2(stPinchThreadSet *threadSet, st
     return adjacencyComponents;
 }
 
+stList *stPinchThreadSet_getAdjacencyComponentsForThreads(stList *threads, stHash **endsToAdjacencyComponents) {
+    *endsToAdjacencyComponents = stHash_construct3(stPinchEnd_hashFn, stPinchEnd_equalsFn, NULL, NULL);
+    stList *adjacencyComponents = stList_construct3(0, (void(*)(void *)) stList_destruct);
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stPinchSegment *segment = stPinchThread_getFirst(stList_get(threads, i));
+        while (segment != NULL) {
+            stPinchBlock *block = stPinchSegment_getBlock(segment);
+            if (block != NULL && stPinchBlock_getFirst(block) == segment) { //Each block once
+                stPinchThreadSet_getAdjacencyComponentsP(*endsToAdjacencyComponents, adjacencyComponents, block, 0);
+                stPinchThreadSet_getAdjacencyComponentsP(*endsToAdjacencyComponents, adjacencyComponents, block, 1);
+            }
+            segment = stPinchSegment_get3Prime(segment);
+        }
+    }
+    return adjacencyComponents;
+}
+
+static int compareBlockAddresses(const void *a, const void *b) {
+    uintptr_t i = (uintptr_t) *(stPinchBlock **) a, j = (uintptr_t) *(stPinchBlock **) b;
+    return i > j ? 1 : (i < j ? -1 : 0);
+}
+
+static int64_t getBlockIndex(stPinchBlock **blocks, int64_t blockNumber, stPinchBlock *block) {
+    int64_t min = 0, max = blockNumber - 1;
+    while (min < max) { //Binary search of the blocks, which are sorted by address
+        int64_t mid = (min + max) / 2;
+        if ((uintptr_t) blocks[mid] < (uintptr_t) block) {
+            min = mid + 1;
+        } else {
+            max = mid;
+        }
+    }
+    assert(blocks[min] == block);
+    return min;
+}
+
+static int64_t getEndRoot(int64_t *endParents, int64_t end) {
+    while (endParents[end] != end) { //Path halving
+        endParents[end] = endParents[endParents[end]];
+        end = endParents[end];
+    }
+    return end;
+}
+
+int64_t stPinchThreadSet_getAdjacencyComponentGraph(stPinchThreadSet *threadSet, stPinchBlock ***blocks, int64_t *blockNumber,
+        int64_t **endNodes, int64_t **edgeOffsets, int64_t **edgeTargets) {
+    //Number the blocks in address order, so the number of a block can be found by binary search, end i of block j
+    //being 2 * j + i
+    *blockNumber = stPinchThreadSet_getTotalBlockNumber(threadSet);
+    *blocks = st_malloc(sizeof(stPinchBlock *) * (*blockNumber > 0 ? *blockNumber : 1));
+    stPinchThreadSetBlockIt blockIt = stPinchThreadSet_getBlockIt(threadSet);
+    stPinchBlock *block;
+    for (int64_t i = 0; (block = stPinchThreadSetBlockIt_getNext(&blockIt)) != NULL; i++) {
+        (*blocks)[i] = block;
+    }
+    qsort(*blocks, *blockNumber, sizeof(stPinchBlock *), compareBlockAddresses);
+
+    //Join the ends connected by each adjacency, those of consecutive block segments of a thread
+    int64_t endNumber = 2 * *blockNumber;
+    int64_t *endParents = st_malloc(sizeof(int64_t) * (endNumber > 0 ? endNumber : 1));
+    for (int64_t i = 0; i < endNumber; i++) {
+        endParents[i] = i;
+    }
+    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet);
+    stPinchThread *thread;
+    while ((thread = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
+        int64_t pEnd = -1; //The 3' end of the last block segment
+        for (stPinchSegment *segment = stPinchThread_getFirst(thread); segment != NULL; segment = stPinchSegment_get3Prime(segment)) {
+            if (segment->block != NULL) {
+                int64_t i = getBlockIndex(*blocks, *blockNumber, segment->block);
+                if (pEnd != -1) {
+                    int64_t root1 = getEndRoot(endParents, pEnd);
+                    int64_t root2 = getEndRoot(endParents, 2 * i + segment->blockOrientation);
+                    endParents[root1 > root2 ? root1 : root2] = root1 > root2 ? root2 : root1;
+                }
+                pEnd = 2 * i + !segment->blockOrientation;
+            }
+        }
+    }
+
+    //Number the adjacency components, in order of their first end
+    *endNodes = st_malloc(sizeof(int64_t) * (endNumber > 0 ? endNumber : 1));
+    int64_t nodeNumber = 0;
+    for (int64_t i = 0; i < endNumber; i++) {
+        int64_t root = getEndRoot(endParents, i);
+        (*endNodes)[i] = root == i ? nodeNumber++ : (*endNodes)[root]; //Roots are the smallest end of their component
+    }
+    free(endParents);
+
+    //Make the graph, with a block edge between the nodes of the two ends of each block
+    *edgeOffsets = st_calloc(nodeNumber + 1, sizeof(int64_t));
+    for (int64_t i = 0; i < endNumber; i++) {
+        (*edgeOffsets)[(*endNodes)[i] + 1]++;
+    }
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        (*edgeOffsets)[i + 1] += (*edgeOffsets)[i];
+    }
+    *edgeTargets = st_malloc(sizeof(int64_t) * (endNumber > 0 ? endNumber : 1));
+    int64_t *nextEdges = st_malloc(sizeof(int64_t) * (nodeNumber > 0 ? nodeNumber : 1));
+    memcpy(nextEdges, *edgeOffsets, sizeof(int64_t) * nodeNumber);
+    for (int64_t i = 0; i < endNumber; i++) {
+        (*edgeTargets)[nextEdges[(*endNodes)[i]]++] = (*endNodes)[i ^ 1];
+    }
+    free(nextEdges);
+    return nodeNumber;
+}
+
 stList *stPinchThreadSet_getAdjacencyComponents(stPinchThreadSet *threadSet) {
     stHash *endsToAdjacencyComponents;
     stList *adjacencyComponents = stPinchThreadSet_getAdjacencyComponents2(threadSet, &endsToAdjacencyComponents);
@@ -807,6 +914,36 @@ stSortedSet *stPinchThreadSet_getThreadComponents(stPinchThreadSet *threadSet) {
     return threadComponentsSet;
 }
 
+stSortedSet *stPinchThreadSet_getThreadComponentsForThreads(stList *threads) {
+    stUnionFind *components = stUnionFind_construct();
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stUnionFind_add(components, stList_get(threads, i));
+    }
+
+    //Join each thread to the first thread of each of its blocks
+    for (int64_t i = 0; i < stList_length(threads); i++) {
+        stPinchThread *thread = stList_get(threads, i);
+        stPinchSegment *segment = stPinchThread_getFirst(thread);
+        while (segment != NULL) {
+            stPinchBlock *block = stPinchSegment_getBlock(segment);
+            if (block != NULL) {
+                stUnionFind_union(components, thread, stPinchSegment_getThread(stPinchBlock_getFirst(block)));
+            }
+            segment = stPinchSegment_get3Prime(segment);
+        }
+    }
+
+    stSortedSet *threadComponentsSet = stSortedSet_construct2((void(*)(void *)) stList_destruct);
+    stUnionFindIt *componentsIt = stUnionFind_getIterator(components);
+    stSet *component;
+    while ((component = stUnionFindIt_getNext(componentsIt)) != NULL) {
+        stSortedSet_insert(threadComponentsSet, stSet_getList(component));
+    }
+    stUnionFind_destructIterator(componentsIt);
+    stUnionFind_destruct(components);
+    return threadComponentsSet;
+}
+
 //stPinchEnd
 
 //Block ends
@@ -162,6 +162,30 @@ stList *stPinchThreadSet_getAdjacencyComponents(stPinchThreadSet *threadSet);
  */
 stList *stPinchThreadSet_getAdjacencyComponents2(stPinchThreadSet *threadSet, stHash **edgeEndsToAdjacencyComponents);
 
+/*
+ * Same as stPinchThreadSet_getAdjacencyComponents2, but only for the blocks of the given threads, which must
+ * be a union of thread components (see below), so that every block end's adjacency component is complete.
+ */
+stList *stPinchThreadSet_getAdjacencyComponentsForThreads(stList *threads, stHash **edgeEndsToAdjacencyComponents);
+
+/*
+ * Gets the graph whose nodes are the adjacency components and whose edges are the blocks, each
+ * joining the components of its two ends, in compressed sparse row form, as taken by
+ * computeThreeEdgeConnectedComponentsCSR. This is much cheaper to build than the adjacency
+ * components themselves, as no pinch ends are made and no hashes are built. Returns the number of
+ * nodes, n, and sets:
+ *
+ * blocks: an array of the blockNumber blocks, sorted by address, the index of a block being its number.
+ * endNodes: an array of 2 * blockNumber entries, such that endNodes[2 * j + i] is the node of the
+ * end of orientation i of block j. Nodes are numbered in order of their first end.
+ * edgeOffsets and edgeTargets: the neighbours of node k are edgeTargets[edgeOffsets[k]] to
+ * edgeTargets[edgeOffsets[k + 1] - 1], with one entry for each block end in the node.
+ *
+ * All the arrays are to be freed by the caller.
+ */
+int64_t stPinchThreadSet_getAdjacencyComponentGraph(stPinchThreadSet *threadSet, stPinchBlock ***blocks, int64_t *blockNumber,
+        int64_t **endNodes, int64_t **edgeOffsets, int64_t **edgeTargets);
+
 /*
  * Get a list of thread components. Each thread component is a list of
  * stPinchThreads that transitively share at least one block (although
@@ -170,6 +194,12 @@ stList *stPinchThreadSet_getAdjacencyComponents2(stPinchThreadSet *threadSet, st
  */
 stSortedSet *stPinchThreadSet_getThreadComponents(stPinchThreadSet *threadSet);
 
+/*
+ * Same as stPinchThreadSet_getThreadComponents, but only for the given threads, which must be a union of thread
+ * components.
+ */
+stSortedSet *stPinchThreadSet_getThreadComponentsForThreads(stList *threads);
+
 /*
  * Get a random set of randomly named threads that share no homology.
  */
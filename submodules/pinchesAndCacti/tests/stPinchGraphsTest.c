@@ -936,6 +936,118 @@ static void testStPinchThreadSet_getThreadComponents(CuTest *testCase) {
     }
 }
 
+static void testStPinchThreadSet_getComponentsForThreads(CuTest *testCase) {
+    /*
+     * Each thread component, taken on its own, has the same thread and adjacency components as it does in
+     * the whole graph.
+     */
+    for (int64_t test = 0; test < 100; test++) {
+        stPinchThreadSet *threadSet = stPinchThreadSet_getRandomGraph();
+        stHash *endsToAdjacencyComponents;
+        stList *adjacencyComponents = stPinchThreadSet_getAdjacencyComponents2(threadSet, &endsToAdjacencyComponents);
+        stSortedSet *threadComponents = stPinchThreadSet_getThreadComponents(threadSet);
+        stSortedSetIterator *it = stSortedSet_getIterator(threadComponents);
+        stList *threadComponent;
+        int64_t totalEnds = 0;
+        while ((threadComponent = stSortedSet_getNext(it)) != NULL) {
+            stSortedSet *threadComponents2 = stPinchThreadSet_getThreadComponentsForThreads(threadComponent);
+            CuAssertIntEquals(testCase, 1, stSortedSet_size(threadComponents2));
+            CuAssertIntEquals(testCase, stList_length(threadComponent), stList_length(stSortedSet_getFirst(threadComponents2)));
+            stSortedSet_destruct(threadComponents2);
+
+            stHash *endsToAdjacencyComponents2;
+            stList *adjacencyComponents2 = stPinchThreadSet_getAdjacencyComponentsForThreads(threadComponent, &endsToAdjacencyComponents2);
+            for (int64_t i = 0; i < stList_length(adjacencyComponents2); i++) {
+                stList *adjacencyComponent2 = stList_get(adjacencyComponents2, i);
+                stList *adjacencyComponent = stHash_search(endsToAdjacencyComponents, stList_get(adjacencyComponent2, 0));
+                CuAssertTrue(testCase, adjacencyComponent != NULL);
+                CuAssertIntEquals(testCase, stList_length(adjacencyComponent), stList_length(adjacencyComponent2));
+                for (int64_t j = 0; j < stList_length(adjacencyComponent2); j++) {
+                    CuAssertPtrEquals(testCase, adjacencyComponent, stHash_search(endsToAdjacencyComponents, stList_get(adjacencyComponent2, j)));
+                }
+            }
+            totalEnds += stHash_size(endsToAdjacencyComponents2);
+            stHash_destruct(endsToAdjacencyComponents2);
+            stList_destruct(adjacencyComponents2);
+        }
+        CuAssertIntEquals(testCase, stHash_size(endsToAdjacencyComponents), totalEnds);
+        stSortedSet_destructIterator(it);
+        stSortedSet_destruct(threadComponents);
+        stHash_destruct(endsToAdjacencyComponents);
+        stList_destruct(adjacencyComponents);
+        stPinchThreadSet_destruct(threadSet);
+    }
+}
+
+static void testStPinchThreadSet_getAdjacencyComponentGraph(CuTest *testCase) {
+    /*
+     * The nodes of the graph are the adjacency components, and each block is an edge between the nodes of its ends.
+     */
+    for (int64_t test = 0; test < 100; test++) {
+        stPinchThreadSet *threadSet = stPinchThreadSet_getRandomGraph();
+        stHash *endsToAdjacencyComponents;
+        stList *adjacencyComponents = stPinchThreadSet_getAdjacencyComponents2(threadSet, &endsToAdjacencyComponents);
+        stPinchBlock **blocks;
+        int64_t blockNumber, *endNodes, *edgeOffsets, *edgeTargets;
+        int64_t nodeNumber = stPinchThreadSet_getAdjacencyComponentGraph(threadSet, &blocks, &blockNumber, &endNodes, &edgeOffsets,
+                &edgeTargets);
+        CuAssertIntEquals(testCase, stPinchThreadSet_getTotalBlockNumber(threadSet), blockNumber);
+        CuAssertIntEquals(testCase, stList_length(adjacencyComponents), nodeNumber);
+
+        //Ends are in the same node if and only if they are in the same adjacency component
+        stHash *adjacencyComponentsToNodes = stHash_construct();
+        for (int64_t i = 0; i < 2 * blockNumber; i++) {
+            stPinchEnd end = stPinchEnd_constructStatic(blocks[i / 2], i % 2);
+            stList *adjacencyComponent = stHash_search(endsToAdjacencyComponents, &end);
+            CuAssertTrue(testCase, adjacencyComponent != NULL);
+            CuAssertTrue(testCase, endNodes[i] >= 0 && endNodes[i] < nodeNumber);
+            void *node = stHash_search(adjacencyComponentsToNodes, adjacencyComponent);
+            if (node == NULL) {
+                stHash_insert(adjacencyComponentsToNodes, adjacencyComponent, (void *) (endNodes[i] + 1));
+            } else {
+                CuAssertIntEquals(testCase, (int64_t) node - 1, endNodes[i]);
+            }
+        }
+        CuAssertIntEquals(testCase, nodeNumber, stHash_size(adjacencyComponentsToNodes));
+
+        //Each node has an edge for each of its ends, going to the other end of the block
+        CuAssertIntEquals(testCase, 0, edgeOffsets[0]);
+        CuAssertIntEquals(testCase, 2 * blockNumber, edgeOffsets[nodeNumber]);
+        for (int64_t i = 0; i < stList_length(adjacencyComponents); i++) {
+            stList *adjacencyComponent = stList_get(adjacencyComponents, i);
+            int64_t node = (int64_t) stHash_search(adjacencyComponentsToNodes, adjacencyComponent) - 1;
+            CuAssertIntEquals(testCase, stList_length(adjacencyComponent), edgeOffsets[node + 1] - edgeOffsets[node]);
+            stList *targets = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+            for (int64_t j = 0; j < stList_length(adjacencyComponent); j++) {
+                stPinchEnd *end = stList_get(adjacencyComponent, j);
+                stPinchEnd otherEnd = stPinchEnd_constructStatic(stPinchEnd_getBlock(end), !stPinchEnd_getOrientation(end));
+                stList_append(targets, stIntTuple_construct1((int64_t) stHash_search(adjacencyComponentsToNodes,
+                        stHash_search(endsToAdjacencyComponents, &otherEnd)) - 1));
+            }
+            stList_sort(targets, (int(*)(const void *, const void *)) stIntTuple_cmpFn);
+            stList *targets2 = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+            for (int64_t j = edgeOffsets[node]; j < edgeOffsets[node + 1]; j++) {
+                stList_append(targets2, stIntTuple_construct1(edgeTargets[j]));
+            }
+            stList_sort(targets2, (int(*)(const void *, const void *)) stIntTuple_cmpFn);
+            for (int64_t j = 0; j < stList_length(targets); j++) {
+                CuAssertIntEquals(testCase, stIntTuple_get(stList_get(targets, j), 0), stIntTuple_get(stList_get(targets2, j), 0));
+            }
+            stList_destruct(targets);
+            stList_destruct(targets2);
+        }
+
+        stHash_destruct(adjacencyComponentsToNodes);
+        free(blocks);
+        free(endNodes);
+        free(edgeOffsets);
+        free(edgeTargets);
+        stHash_destruct(endsToAdjacencyComponents);
+        stList_destruct(adjacencyComponents);
+        stPinchThreadSet_destruct(threadSet);
+    }
+}
+
 static void testStPinchThreadSet_trimAlignments_randomTests(CuTest *testCase) {
     //return;
     for (int64_t test = 0; test < 100; test++) {
@@ -1396,8 +1508,10 @@ CuSuite* stPinchGraphsTestSuite(void) {
     SUITE_ADD_TEST(suite, testStPinchThread_filterPinch_randomTests);
     SUITE_ADD_TEST(suite, testStPinchThreadSet_getAdjacencyComponents);
     SUITE_ADD_TEST(suite, testStPinchThreadSet_getAdjacencyComponents_randomTests);
+    SUITE_ADD_TEST(suite, testStPinchThreadSet_getAdjacencyComponentGraph);
     SUITE_ADD_TEST(suite, testStPinchThreadSet_joinTrivialBoundaries_randomTests);
     SUITE_ADD_TEST(suite, testStPinchThreadSet_getThreadComponents);
+    SUITE_ADD_TEST(suite, testStPinchThreadSet_getComponentsForThreads);
     SUITE_ADD_TEST(suite, testStPinchThreadSet_trimAlignments_randomTests);
     SUITE_ADD_TEST(suite, testStPinchInterval);
     SUITE_ADD_TEST(suite, testStPinchThreadSet_getLabelIntervals);
@@ -60,6 +60,39 @@ avl_create(avl_comparison_func *compare, void *param,
     return tree;
 }
 
+/* Builds a perfectly balanced subtree from the |n| items of |items|,
+ which are in ascending order, storing its height in |*height|. */
+static struct avl_node *
+avl_build_subtree(struct avl_table *tree, void **items, size_t n, int *height) {
+    if (n == 0) {
+        *height = 0;
+        return NULL;
+    }
+    size_t mid = n / 2;
+    int leftHeight, rightHeight;
+    struct avl_node *p = tree->avl_alloc->libavl_malloc(tree->avl_alloc, sizeof *p);
+    assert(p != NULL);
+    p->avl_data = items[mid];
+    p->avl_link[0] = avl_build_subtree(tree, items, mid, &leftHeight);
+    p->avl_link[1] = avl_build_subtree(tree, items + mid + 1, n - mid - 1, &rightHeight);
+    p->avl_balance = rightHeight - leftHeight;
+    assert(p->avl_balance == 0 || p->avl_balance == -1);
+    *height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+    return p;
+}
+
+/* Fills the empty |tree| with the |n| items of |items|, which must be
+ in strictly ascending order, in linear time. */
+void
+avl_build(struct avl_table *tree, void **items, size_t n) {
+    int height;
+
+    assert (tree != NULL && tree->avl_root == NULL);
+    tree->avl_root = avl_build_subtree(tree, items, n, &height);
+    tree->avl_count = n;
+    tree->avl_generation++;
+}
+
 /* Search |tree| for an item matching |item|, and return it if found.
  Otherwise return |NULL|. */
 void *
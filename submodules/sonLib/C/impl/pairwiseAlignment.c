@@ -4,9 +4,12 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#define _POSIX_C_SOURCE 200809L //For fileno
 #include <inttypes.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include "pairwiseAlignment.h"
 #include "commonC.h"
@@ -132,7 +135,7 @@ char cigarReadFn(char type, int64_t *withProb) {
     }
 }
 
-struct PairwiseAlignment *cigarRead(FILE *fileHandle) {
+static struct PairwiseAlignment *cigarReadText(FILE *fileHandle) {
     struct PairwiseAlignment *pA;
     static char cA[BIG_STRING_ARRAY_SIZE+1]; //STRING_ARRAY_SIZE];
     int64_t type, length, withProb;
@@ -239,3 +242,421 @@ void cigarWrite(FILE *fileHandle, struct PairwiseAlignment *pA, int64_t withProb
     fprintf(fileHandle, "\n");
 }
 
+
+/*
+ * Binary records, see pairwiseAlignment.h for the layout of a block.
+ */
+
+#define BINARY_MAGIC "\0PAB"
+#define BINARY_MAGIC_LENGTH 4
+#define BINARY_VERSION 1
+#define BINARY_FLAG_PROBS 1
+#define BINARY_BLOCK_RECORDS 4096 //A block is written out once it holds this many records
+#define BINARY_BLOCK_BYTES (1 << 22) //or this many bytes of records
+
+typedef struct _byteBuffer {
+    uint8_t *bytes;
+    int64_t length;
+    int64_t maxLength;
+} ByteBuffer;
+
+static void byteBuffer_reserve(ByteBuffer *buffer, int64_t length) {
+    if (buffer->length + length > buffer->maxLength) {
+        buffer->maxLength = (buffer->length + length) * 2;
+        buffer->bytes = st_realloc(buffer->bytes, buffer->maxLength);
+    }
+}
+
+static void byteBuffer_putBytes(ByteBuffer *buffer, const void *bytes, int64_t length) {
+    byteBuffer_reserve(buffer, length);
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+static void byteBuffer_putVarint(ByteBuffer *buffer, uint64_t i) {
+    byteBuffer_reserve(buffer, 10);
+    while (i >= 0x80) {
+        buffer->bytes[buffer->length++] = (uint8_t) (i | 0x80);
+        i >>= 7;
+    }
+    buffer->bytes[buffer->length++] = (uint8_t) i;
+}
+
+static void byteBuffer_putFloat(ByteBuffer *buffer, float f) {
+    uint32_t i;
+    memcpy(&i, &f, sizeof(uint32_t));
+    byteBuffer_reserve(buffer, 4);
+    for (int64_t j = 0; j < 4; j++) {
+        buffer->bytes[buffer->length++] = (uint8_t) (i >> (8 * j));
+    }
+}
+
+struct _stPairwiseAlignmentWriter {
+    FILE *fileHandle;
+    bool writeProbs;
+    stHash *contigIndices; //Names of the contigs in the block to their index in the table, plus one
+    stList *contigs;
+    ByteBuffer records;
+    int64_t recordNumber;
+};
+
+stPairwiseAlignmentWriter *stPairwiseAlignmentWriter_construct(FILE *fileHandle, bool writeProbs) {
+    stPairwiseAlignmentWriter *writer = st_calloc(1, sizeof(stPairwiseAlignmentWriter));
+    writer->fileHandle = fileHandle;
+    writer->writeProbs = writeProbs;
+    writer->contigIndices = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+    writer->contigs = stList_construct3(0, free);
+    return writer;
+}
+
+static uint64_t writer_getContigIndex(stPairwiseAlignmentWriter *writer, char *contig) {
+    int64_t i = (int64_t) stHash_search(writer->contigIndices, contig);
+    if (i == 0) {
+        char *contigCopy = stString_copy(contig);
+        stList_append(writer->contigs, contigCopy);
+        i = stList_length(writer->contigs);
+        stHash_insert(writer->contigIndices, contigCopy, (void *) i);
+    }
+    return i - 1;
+}
+
+void stPairwiseAlignmentWriter_write(stPairwiseAlignmentWriter *writer, struct PairwiseAlignment *pA) {
+    ByteBuffer *records = &writer->records;
+    uint8_t strands = (pA->strand1 ? 1 : 0) | (pA->strand2 ? 2 : 0);
+    byteBuffer_putBytes(records, &strands, 1);
+    byteBuffer_putVarint(records, writer_getContigIndex(writer, pA->contig1));
+    byteBuffer_putVarint(records, pA->start1);
+    byteBuffer_putVarint(records, writer_getContigIndex(writer, pA->contig2));
+    byteBuffer_putVarint(records, pA->start2);
+    byteBuffer_putFloat(records, pA->score);
+    byteBuffer_putVarint(records, pA->operationList->length);
+    for (int64_t i = 0; i < pA->operationList->length; i++) {
+        struct AlignmentOperation *oP = pA->operationList->list[i];
+        assert(oP->length >= 0);
+        assert(oP->opType == PAIRWISE_MATCH || oP->opType == PAIRWISE_INDEL_X || oP->opType == PAIRWISE_INDEL_Y);
+        byteBuffer_putVarint(records, ((uint64_t) oP->length << 2) | (uint64_t) oP->opType);
+        if (writer->writeProbs) {
+            byteBuffer_putFloat(records, oP->score);
+        }
+    }
+    if (++writer->recordNumber >= BINARY_BLOCK_RECORDS || records->length >= BINARY_BLOCK_BYTES) {
+        stPairwiseAlignmentWriter_flush(writer);
+    }
+}
+
+void stPairwiseAlignmentWriter_flush(stPairwiseAlignmentWriter *writer) {
+    if (writer->recordNumber == 0) {
+        return;
+    }
+    ByteBuffer header = { NULL, 0, 0 };
+    byteBuffer_putBytes(&header, BINARY_MAGIC, BINARY_MAGIC_LENGTH);
+    uint8_t versionAndFlags[2] = { BINARY_VERSION, writer->writeProbs ? BINARY_FLAG_PROBS : 0 };
+    byteBuffer_putBytes(&header, versionAndFlags, 2);
+    byteBuffer_putVarint(&header, writer->recordNumber);
+    byteBuffer_putVarint(&header, stList_length(writer->contigs));
+    byteBuffer_putVarint(&header, writer->records.length);
+    for (int64_t i = 0; i < stList_length(writer->contigs); i++) {
+        char *contig = stList_get(writer->contigs, i);
+        int64_t length = strlen(contig);
+        byteBuffer_putVarint(&header, length);
+        byteBuffer_putBytes(&header, contig, length);
+    }
+    if (fwrite(header.bytes, 1, header.length, writer->fileHandle) != (size_t) header.length
+            || fwrite(writer->records.bytes, 1, writer->records.length, writer->fileHandle)
+                    != (size_t) writer->records.length) {
+        st_errAbort("Error writing a block of binary alignments");
+    }
+    free(header.bytes);
+
+    //Start an empty block
+    writer->records.length = 0;
+    writer->recordNumber = 0;
+    stHash_destruct(writer->contigIndices);
+    writer->contigIndices = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+    stList_destruct(writer->contigs);
+    writer->contigs = stList_construct3(0, free);
+}
+
+void stPairwiseAlignmentWriter_destruct(stPairwiseAlignmentWriter *writer) {
+    stPairwiseAlignmentWriter_flush(writer);
+    stHash_destruct(writer->contigIndices);
+    stList_destruct(writer->contigs);
+    free(writer->records.bytes);
+    free(writer);
+}
+
+struct _stPairwiseAlignmentReader {
+    FILE *fileHandle;
+    bool readProbs; //Whether the records of the current block have operation scores
+    char **contigs;
+    int64_t contigNumber;
+    ByteBuffer records;
+    int64_t offset; //Of the next record in the buffer
+    int64_t remainingRecords; //In the current block
+    int64_t blockEnd; //Offset in the file of the end of the current block, or -1 if the file is not seekable
+};
+
+stPairwiseAlignmentReader *stPairwiseAlignmentReader_construct(FILE *fileHandle) {
+    stPairwiseAlignmentReader *reader = st_calloc(1, sizeof(stPairwiseAlignmentReader));
+    reader->fileHandle = fileHandle;
+    reader->blockEnd = -1;
+    return reader;
+}
+
+static void reader_freeContigs(stPairwiseAlignmentReader *reader) {
+    for (int64_t i = 0; i < reader->contigNumber; i++) {
+        free(reader->contigs[i]);
+    }
+    free(reader->contigs);
+    reader->contigs = NULL;
+    reader->contigNumber = 0;
+}
+
+void stPairwiseAlignmentReader_destruct(stPairwiseAlignmentReader *reader) {
+    reader_freeContigs(reader);
+    free(reader->records.bytes);
+    free(reader);
+}
+
+bool stPairwiseAlignment_isBinary(FILE *fileHandle) {
+    int c = getc(fileHandle);
+    if (c == EOF) {
+        return 0;
+    }
+    ungetc(c, fileHandle);
+    return c == BINARY_MAGIC[0];
+}
+
+static uint64_t reader_readVarintFromFile(FILE *fileHandle) {
+    uint64_t i = 0;
+    for (int64_t shift = 0; shift < 64; shift += 7) {
+        int c = getc(fileHandle);
+        if (c == EOF) {
+            break;
+        }
+        i |= ((uint64_t) (c & 0x7f)) << shift;
+        if ((c & 0x80) == 0) {
+            return i;
+        }
+    }
+    st_errAbort("Truncated or corrupt header in a block of binary alignments");
+    return 0;
+}
+
+static void reader_readBlock(stPairwiseAlignmentReader *reader) {
+    /*
+     * Reads the header, the contig table and the records of the next block into memory.
+     */
+    FILE *fileHandle = reader->fileHandle;
+    char magic[BINARY_MAGIC_LENGTH + 2];
+    if (fread(magic, 1, BINARY_MAGIC_LENGTH + 2, fileHandle) != BINARY_MAGIC_LENGTH + 2
+            || memcmp(magic, BINARY_MAGIC, BINARY_MAGIC_LENGTH) != 0) {
+        st_errAbort("Expected the start of a block of binary alignments");
+    }
+    if (magic[BINARY_MAGIC_LENGTH] != BINARY_VERSION) {
+        st_errAbort("Unsupported binary alignment version: %i", (int) magic[BINARY_MAGIC_LENGTH]);
+    }
+    reader->readProbs = (magic[BINARY_MAGIC_LENGTH + 1] & BINARY_FLAG_PROBS) != 0;
+    reader->remainingRecords = reader_readVarintFromFile(fileHandle);
+    int64_t contigNumber = reader_readVarintFromFile(fileHandle);
+    int64_t recordsLength = reader_readVarintFromFile(fileHandle);
+
+    reader_freeContigs(reader);
+    reader->contigs = st_malloc(sizeof(char *) * (contigNumber > 0 ? contigNumber : 1));
+    for (int64_t i = 0; i < contigNumber; i++) {
+        int64_t length = reader_readVarintFromFile(fileHandle);
+        char *contig = st_malloc(length + 1);
+        if (fread(contig, 1, length, fileHandle) != (size_t) length) {
+            st_errAbort("Truncated contig table in a block of binary alignments");
+        }
+        contig[length] = '\0';
+        reader->contigs[reader->contigNumber++] = contig;
+    }
+
+    reader->records.length = 0;
+    byteBuffer_reserve(&reader->records, recordsLength);
+    if (fread(reader->records.bytes, 1, recordsLength, fileHandle) != (size_t) recordsLength) {
+        st_errAbort("Truncated records in a block of binary alignments");
+    }
+    reader->records.length = recordsLength;
+    reader->offset = 0;
+    reader->blockEnd = ftell(fileHandle);
+}
+
+static uint64_t reader_getVarint(stPairwiseAlignmentReader *reader) {
+    uint64_t i = 0;
+    for (int64_t shift = 0; shift < 64 && reader->offset < reader->records.length; shift += 7) {
+        uint8_t b = reader->records.bytes[reader->offset++];
+        i |= ((uint64_t) (b & 0x7f)) << shift;
+        if ((b & 0x80) == 0) {
+            return i;
+        }
+    }
+    st_errAbort("Corrupt record in a block of binary alignments");
+    return 0;
+}
+
+static float reader_getFloat(stPairwiseAlignmentReader *reader) {
+    if (reader->offset + 4 > reader->records.length) {
+        st_errAbort("Corrupt record in a block of binary alignments");
+    }
+    uint32_t i = 0;
+    for (int64_t j = 0; j < 4; j++) {
+        i |= ((uint32_t) reader->records.bytes[reader->offset++]) << (8 * j);
+    }
+    float f;
+    memcpy(&f, &i, sizeof(float));
+    return f;
+}
+
+static char *reader_getContig(stPairwiseAlignmentReader *reader) {
+    uint64_t i = reader_getVarint(reader);
+    if (i >= (uint64_t) reader->contigNumber) {
+        st_errAbort("Contig index out of range in a block of binary alignments");
+    }
+    return stString_copy(reader->contigs[i]);
+}
+
+static struct PairwiseAlignment *reader_decodeRecord(stPairwiseAlignmentReader *reader) {
+    struct PairwiseAlignment *pA = st_malloc(sizeof(struct PairwiseAlignment));
+    if (reader->offset >= reader->records.length) {
+        st_errAbort("Corrupt record in a block of binary alignments");
+    }
+    uint8_t strands = reader->records.bytes[reader->offset++];
+    pA->strand1 = strands & 1;
+    pA->strand2 = (strands >> 1) & 1;
+    pA->contig1 = reader_getContig(reader);
+    pA->start1 = reader_getVarint(reader);
+    pA->contig2 = reader_getContig(reader);
+    pA->start2 = reader_getVarint(reader);
+    pA->score = reader_getFloat(reader);
+    int64_t operationNumber = reader_getVarint(reader);
+    //Every operation takes at least a byte, which bounds the list allocated for a corrupt count
+    if (operationNumber > reader->records.length - reader->offset) {
+        st_errAbort("Corrupt record in a block of binary alignments");
+    }
+    pA->operationList = constructEmptyList(operationNumber, (void (*)(void *))destructAlignmentOperation);
+    int64_t length1 = 0, length2 = 0;
+    for (int64_t i = 0; i < operationNumber; i++) {
+        uint64_t j = reader_getVarint(reader);
+        int64_t type = j & 3, length = j >> 2;
+        if (type != PAIRWISE_MATCH && type != PAIRWISE_INDEL_X && type != PAIRWISE_INDEL_Y) {
+            st_errAbort("Corrupt operation in a block of binary alignments");
+        }
+        float score = reader->readProbs ? reader_getFloat(reader) : 0.0;
+        pA->operationList->list[i] = constructAlignmentOperation(type, length, score);
+        if (type != PAIRWISE_INDEL_Y) {
+            length1 += length;
+        }
+        if (type != PAIRWISE_INDEL_X) {
+            length2 += length;
+        }
+    }
+    pA->end1 = pA->strand1 ? pA->start1 + length1 : pA->start1 - length1;
+    pA->end2 = pA->strand2 ? pA->start2 + length2 : pA->start2 - length2;
+    checkPairwiseAlignment(pA);
+    return pA;
+}
+
+struct PairwiseAlignment *stPairwiseAlignmentReader_read(stPairwiseAlignmentReader *reader) {
+    while (reader->remainingRecords == 0) {
+        int c = getc(reader->fileHandle);
+        if (c == EOF) {
+            return NULL;
+        }
+        ungetc(c, reader->fileHandle);
+        if (c != BINARY_MAGIC[0]) {
+            return cigarReadText(reader->fileHandle);
+        }
+        reader_readBlock(reader);
+    }
+    struct PairwiseAlignment *pA = reader_decodeRecord(reader);
+    if (--reader->remainingRecords == 0 && reader->offset != reader->records.length) {
+        st_errAbort("Trailing bytes after the records of a block of binary alignments");
+    }
+    return pA;
+}
+
+/*
+ * The readers of the files that cigarRead is part way through a binary block of, keyed by file handle. A reader is
+ * dropped once its block is read. It is only used again if the handle is still on the same file, at the offset the
+ * block ended at, so one left by a file closed mid-block, or by a file since rewound, e.g. by the pinch iterator, is
+ * replaced. Unseekable streams can not be checked like this, so cigarRead does not keep readers for them. Use a
+ * stPairwiseAlignmentReader to read binary blocks of more than one record from a pipe.
+ */
+typedef struct _cigarReadState {
+    stPairwiseAlignmentReader *reader;
+    dev_t device;
+    ino_t inode;
+} CigarReadState;
+
+static stHash *cigarReadStates = NULL;
+static pthread_mutex_t cigarReadStatesMutex = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * The number of states in the table, changed under the mutex but read by cigarRead without it. A state for a file can
+ * only have been left by an earlier read of that file, which happens before the current one, so a read of the count
+ * that misses changes made by other threads only ever misses states for other files.
+ */
+static volatile int64_t cigarReadStateNumber = 0;
+
+static void cigarReadState_destruct(CigarReadState *state) {
+    stPairwiseAlignmentReader_destruct(state->reader);
+    free(state);
+}
+
+static CigarReadState *cigarReadState_remove(FILE *fileHandle) {
+    /*
+     * Takes the state of the file, if any, out of the table, so that it is owned by the caller while it is read.
+     */
+    pthread_mutex_lock(&cigarReadStatesMutex);
+    CigarReadState *state = cigarReadStates != NULL ? stHash_remove(cigarReadStates, fileHandle) : NULL;
+    if (state != NULL) {
+        cigarReadStateNumber--;
+    }
+    pthread_mutex_unlock(&cigarReadStatesMutex);
+    return state;
+}
+
+static void cigarReadState_insert(FILE *fileHandle, CigarReadState *state) {
+    pthread_mutex_lock(&cigarReadStatesMutex);
+    if (cigarReadStates == NULL) {
+        cigarReadStates = stHash_construct();
+    }
+    stHash_insert(cigarReadStates, fileHandle, state);
+    cigarReadStateNumber++;
+    pthread_mutex_unlock(&cigarReadStatesMutex);
+}
+
+struct PairwiseAlignment *cigarRead(FILE *fileHandle) {
+    //Text, with no binary block part read in any file, needs none of the checks below
+    if (cigarReadStateNumber == 0 && !stPairwiseAlignment_isBinary(fileHandle)) {
+        return cigarReadText(fileHandle);
+    }
+    struct stat fileStat;
+    bool seekable = fstat(fileno(fileHandle), &fileStat) == 0 && ftell(fileHandle) != -1;
+    CigarReadState *state = cigarReadState_remove(fileHandle);
+    if (state != NULL && (!seekable || state->device != fileStat.st_dev || state->inode != fileStat.st_ino
+            || ftell(fileHandle) != state->reader->blockEnd)) { //Left by another file, or the file has moved
+        cigarReadState_destruct(state);
+        state = NULL;
+    }
+    if (state == NULL) {
+        if (!stPairwiseAlignment_isBinary(fileHandle)) {
+            return cigarReadText(fileHandle);
+        }
+        state = st_malloc(sizeof(CigarReadState));
+        state->reader = stPairwiseAlignmentReader_construct(fileHandle);
+        state->device = fileStat.st_dev;
+        state->inode = fileStat.st_ino;
+    }
+    struct PairwiseAlignment *pA = stPairwiseAlignmentReader_read(state->reader);
+    if (state->reader->remainingRecords == 0) {
+        cigarReadState_destruct(state);
+    } else if (!seekable) {
+        st_errAbort("cigarRead can not read a block of more than one binary alignment from an unseekable stream, "
+                "use a stPairwiseAlignmentReader");
+    } else {
+        cigarReadState_insert(fileHandle, state);
+    }
+    return pA;
+}
@@ -0,0 +1,632 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * An external merge sort of alignment files. Chunks of the input are sorted in memory, on a thread pool, and
+ * written out as runs, which are then merged with a heap.
+ *
+ * Text cigars are kept as the lines read, with only the fields before the operations parsed to compare them, so
+ * they are written out unchanged. Binary records are decoded, and written out as binary records.
+ */
+
+#define _POSIX_C_SOURCE 200809L //For getline and mkstemp
+
+#include <inttypes.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "pairwiseAlignment.h"
+#include "commonC.h"
+
+#define SORT_MERGE_FAN_IN 64 //The most runs merged at once, which bounds the number of files held open
+#define SORT_ALLOCATION_OVERHEAD 16 //Allowed for each malloc when estimating the memory held by a record
+
+typedef int (*AlignmentCmpFn)(const struct PairwiseAlignment *, const struct PairwiseAlignment *);
+
+int stPairwiseAlignment_cmpByDescendingScore(const struct PairwiseAlignment *pA1, const struct PairwiseAlignment *pA2) {
+    if (pA1->score != pA2->score) {
+        return pA1->score > pA2->score ? -1 : 1;
+    }
+    return strcmp(pA1->contig2, pA2->contig2);
+}
+
+int stPairwiseAlignment_cmpByFirstSequenceStart(const struct PairwiseAlignment *pA1, const struct PairwiseAlignment *pA2) {
+    int i = strcmp(pA1->contig1, pA2->contig1);
+    if (i != 0) {
+        return i;
+    }
+    if (pA1->start1 != pA2->start1) {
+        return pA1->start1 < pA2->start1 ? -1 : 1;
+    }
+    return pA1->end1 < pA2->end1 ? -1 : (pA1->end1 > pA2->end1 ? 1 : 0);
+}
+
+int stPairwiseAlignment_cmpBySecondSequenceStart(const struct PairwiseAlignment *pA1, const struct PairwiseAlignment *pA2) {
+    int i = strcmp(pA1->contig2, pA2->contig2);
+    if (i != 0) {
+        return i;
+    }
+    if (pA1->start2 != pA2->start2) {
+        return pA1->start2 < pA2->start2 ? -1 : 1;
+    }
+    return pA1->end2 < pA2->end2 ? -1 : (pA1->end2 > pA2->end2 ? 1 : 0);
+}
+
+/*
+ * A record being sorted: a decoded binary record, or a text cigar line with the fields of key before the operations
+ * parsed from it.
+ */
+typedef struct _sortRecord {
+    struct PairwiseAlignment *pA; //The alignment compared, either a decoded binary record or key
+    struct PairwiseAlignment key;
+    int64_t lineLength; //Of the text line, or -1 for a binary record
+    char line[]; //The text line, then the names of the second and first contigs
+} SortRecord;
+
+static char *parseToken(char **string, int64_t *length) {
+    char *token = *string;
+    while (isspace((unsigned char) *token)) {
+        token++;
+    }
+    char *end = token;
+    while (*end != '\0' && !isspace((unsigned char) *end)) {
+        end++;
+    }
+    *length = end - token;
+    *string = end;
+    return token;
+}
+
+static bool parseCoordinate(char **string, int64_t *coordinate) {
+    char *end;
+    *coordinate = strtoll(*string, &end, 10);
+    bool parsed = end != *string;
+    *string = end;
+    return parsed;
+}
+
+static bool parseStrand(char **string, int64_t *strand) {
+    int64_t length;
+    char *token = parseToken(string, &length);
+    *strand = *token == '+';
+    return length == 1 && (*token == '+' || *token == '-');
+}
+
+static SortRecord *sortRecord_constructFromLine(char *line, int64_t lineLength) {
+    /*
+     * Parses the fields before the operations of a cigar line: the second contig, its start, end and strand, the
+     * same for the first contig, then the score.
+     */
+    int64_t contig2Length, contig1Length, length;
+    char *string = line;
+    char *token = parseToken(&string, &length);
+    if (length != 6 || strncmp(token, "cigar:", 6) != 0) {
+        st_errAbort("Expected a cigar line, or a binary block, when sorting alignments, got: %s", line);
+    }
+    char *contig2 = parseToken(&string, &contig2Length);
+    int64_t start2 = 0, end2 = 0, strand2 = 0, start1 = 0, end1 = 0, strand1 = 0;
+    bool parsed = contig2Length > 0 && parseCoordinate(&string, &start2) && parseCoordinate(&string, &end2)
+            && parseStrand(&string, &strand2);
+    char *contig1 = parseToken(&string, &contig1Length);
+    parsed = parsed && contig1Length > 0 && parseCoordinate(&string, &start1) && parseCoordinate(&string, &end1)
+            && parseStrand(&string, &strand1);
+    char *end;
+    float score = strtof(string, &end);
+    if (!parsed || end == string) {
+        st_errAbort("Malformed cigar line when sorting alignments: %s", line);
+    }
+
+    SortRecord *record = st_malloc(sizeof(SortRecord) + lineLength + contig2Length + contig1Length + 3);
+    record->lineLength = lineLength;
+    memcpy(record->line, line, lineLength + 1);
+    record->key.contig2 = record->line + lineLength + 1;
+    memcpy(record->key.contig2, contig2, contig2Length);
+    record->key.contig2[contig2Length] = '\0';
+    record->key.contig1 = record->key.contig2 + contig2Length + 1;
+    memcpy(record->key.contig1, contig1, contig1Length);
+    record->key.contig1[contig1Length] = '\0';
+    record->key.start2 = start2;
+    record->key.end2 = end2;
+    record->key.strand2 = strand2;
+    record->key.start1 = start1;
+    record->key.end1 = end1;
+    record->key.strand1 = strand1;
+    record->key.score = score;
+    record->key.operationList = NULL;
+    record->pA = &record->key;
+    return record;
+}
+
+static SortRecord *sortRecord_constructFromAlignment(struct PairwiseAlignment *pA) {
+    SortRecord *record = st_malloc(sizeof(SortRecord));
+    record->pA = pA;
+    record->lineLength = -1;
+    return record;
+}
+
+static void sortRecord_destruct(SortRecord *record) {
+    if (record->lineLength == -1) {
+        destructPairwiseAlignment(record->pA);
+    }
+    free(record);
+}
+
+static int64_t sortRecord_getMemory(SortRecord *record) {
+    /*
+     * An estimate of the memory held by a record, including the pointer to it.
+     */
+    if (record->lineLength != -1) {
+        return sizeof(SortRecord *) + sizeof(SortRecord) + 2 * record->lineLength + SORT_ALLOCATION_OVERHEAD;
+    }
+    struct PairwiseAlignment *pA = record->pA;
+    int64_t operationNumber = pA->operationList->length;
+    return sizeof(SortRecord *) + sizeof(SortRecord) + sizeof(struct PairwiseAlignment) + sizeof(struct List)
+            + strlen(pA->contig1) + strlen(pA->contig2) + 2 + pA->operationList->maxLength * sizeof(void *)
+            + operationNumber * sizeof(struct AlignmentOperation) + (6 + operationNumber) * SORT_ALLOCATION_OVERHEAD;
+}
+
+static bool sortRecord_equals(SortRecord *record1, SortRecord *record2) {
+    /*
+     * Returns non-zero if the records are the same alignment: the same line, ignoring a missing final newline, or
+     * binary records with the same fields and operations.
+     */
+    if (record1->lineLength != -1) {
+        int64_t length1 = record1->lineLength - (record1->line[record1->lineLength - 1] == '\n');
+        int64_t length2 = record2->lineLength - (record2->line[record2->lineLength - 1] == '\n');
+        return length1 == length2 && memcmp(record1->line, record2->line, length1) == 0;
+    }
+    struct PairwiseAlignment *pA1 = record1->pA, *pA2 = record2->pA;
+    if (pA1->start1 != pA2->start1 || pA1->end1 != pA2->end1 || pA1->strand1 != pA2->strand1
+            || pA1->start2 != pA2->start2 || pA1->end2 != pA2->end2 || pA1->strand2 != pA2->strand2
+            || pA1->score != pA2->score || pA1->operationList->length != pA2->operationList->length
+            || strcmp(pA1->contig1, pA2->contig1) != 0 || strcmp(pA1->contig2, pA2->contig2) != 0) {
+        return 0;
+    }
+    for (int64_t i = 0; i < pA1->operationList->length; i++) {
+        struct AlignmentOperation *op1 = pA1->operationList->list[i], *op2 = pA2->operationList->list[i];
+        if (op1->opType != op2->opType || op1->length != op2->length || op1->score != op2->score) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint64_t hashBytes(uint64_t hash, const void *bytes, int64_t length) {
+    //FNV-1a
+    for (int64_t i = 0; i < length; i++) {
+        hash = (hash ^ ((const unsigned char *) bytes)[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t sortRecord_hashFn(const void *record) {
+    /*
+     * Hashes the record so that records equal by sortRecord_equals have the same hash. The scores are left out, as
+     * the floats 0.0 and -0.0 are equal but have different bytes.
+     */
+    const SortRecord *record1 = record;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    if (record1->lineLength != -1) {
+        int64_t length = record1->lineLength - (record1->line[record1->lineLength - 1] == '\n');
+        return hashBytes(hash, record1->line, length);
+    }
+    struct PairwiseAlignment *pA = record1->pA;
+    int64_t coordinates[] = { pA->start1, pA->end1, pA->strand1, pA->start2, pA->end2, pA->strand2 };
+    hash = hashBytes(hash, coordinates, sizeof(coordinates));
+    hash = hashBytes(hash, pA->contig1, strlen(pA->contig1) + 1);
+    hash = hashBytes(hash, pA->contig2, strlen(pA->contig2) + 1);
+    for (int64_t i = 0; i < pA->operationList->length; i++) {
+        struct AlignmentOperation *op = pA->operationList->list[i];
+        int64_t operation[] = { op->opType, op->length };
+        hash = hashBytes(hash, operation, sizeof(operation));
+    }
+    return hash;
+}
+
+static int sortRecord_equalsFn(const void *record1, const void *record2) {
+    return sortRecord_equals((SortRecord *) record1, (SortRecord *) record2);
+}
+
+static bool sortRecord_hasProbs(SortRecord *record) {
+    struct List *operationList = record->pA->operationList;
+    for (int64_t i = 0; i < operationList->length; i++) {
+        if (((struct AlignmentOperation *) operationList->list[i])->score != 0.0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Where records are read from: text cigar lines, or, if reader is not NULL, binary records.
+ */
+typedef struct _sortInput {
+    FILE *fileHandle;
+    stPairwiseAlignmentReader *reader;
+    char *line;
+    size_t lineCapacity;
+} SortInput;
+
+static void sortInput_open(SortInput *input, const char *file, bool binary) {
+    input->fileHandle = fopen(file, "r");
+    if (input->fileHandle == NULL) {
+        st_errnoAbort("Could not open the file %s of alignments to sort", file);
+    }
+    input->reader = binary ? stPairwiseAlignmentReader_construct(input->fileHandle) : NULL;
+    input->line = NULL;
+    input->lineCapacity = 0;
+}
+
+static SortRecord *sortInput_read(SortInput *input) {
+    if (input->reader != NULL) {
+        struct PairwiseAlignment *pA = stPairwiseAlignmentReader_read(input->reader);
+        return pA != NULL ? sortRecord_constructFromAlignment(pA) : NULL;
+    }
+    ssize_t lineLength;
+    while ((lineLength = getline(&input->line, &input->lineCapacity, input->fileHandle)) != -1) {
+        if (lineLength > 0 && input->line[0] == '\0') {
+            st_errAbort("Found a binary block after text cigars when sorting alignments, "
+                    "convert the file to a single format first");
+        }
+        //Blank lines are dropped
+        int64_t i = 0;
+        while (i < lineLength && isspace((unsigned char) input->line[i])) {
+            i++;
+        }
+        if (i < lineLength) {
+            return sortRecord_constructFromLine(input->line, lineLength);
+        }
+    }
+    return NULL;
+}
+
+static void sortInput_close(SortInput *input) {
+    if (input->reader != NULL) {
+        stPairwiseAlignmentReader_destruct(input->reader);
+    }
+    free(input->line);
+    fclose(input->fileHandle);
+}
+
+/*
+ * Where records are written: text cigar lines, or, if writer is not NULL, binary records. If keyRecords is not NULL,
+ * records the same as one already written with an equal key are dropped.
+ */
+typedef struct _sortOutput {
+    FILE *fileHandle;
+    stPairwiseAlignmentWriter *writer;
+    AlignmentCmpFn cmpFn;
+    stList *keyRecords; //The records written with the key of the last record written, which it owns
+    stSet *keyRecordSet; //The same records, to look them up by content
+} SortOutput;
+
+static void sortOutput_open(SortOutput *output, const char *file, bool binary, bool writeProbs,
+        AlignmentCmpFn cmpFn, bool unique) {
+    output->fileHandle = fopen(file, "w");
+    if (output->fileHandle == NULL) {
+        st_errnoAbort("Could not open the file %s to write sorted alignments", file);
+    }
+    output->writer = binary ? stPairwiseAlignmentWriter_construct(output->fileHandle, writeProbs) : NULL;
+    output->cmpFn = cmpFn;
+    output->keyRecords = unique ? stList_construct3(0, (void (*)(void *)) sortRecord_destruct) : NULL;
+    output->keyRecordSet = unique ? stSet_construct3(sortRecord_hashFn, sortRecord_equalsFn, NULL) : NULL;
+}
+
+static void sortOutput_write(SortOutput *output, SortRecord *record) {
+    /*
+     * Writes the record, which must not sort before the last record written, and frees it.
+     */
+    if (output->keyRecords != NULL) {
+        if (stList_length(output->keyRecords) > 0
+                && output->cmpFn(((SortRecord *) stList_peek(output->keyRecords))->pA, record->pA) != 0) {
+            while (stList_length(output->keyRecords) > 0) {
+                SortRecord *keyRecord = stList_pop(output->keyRecords);
+                stSet_remove(output->keyRecordSet, keyRecord);
+                sortRecord_destruct(keyRecord);
+            }
+        }
+        if (stSet_search(output->keyRecordSet, record) != NULL) {
+            sortRecord_destruct(record);
+            return;
+        }
+    }
+    if (output->writer != NULL) {
+        stPairwiseAlignmentWriter_write(output->writer, record->pA);
+    } else {
+        assert(record->lineLength != -1);
+        if (fwrite(record->line, 1, record->lineLength, output->fileHandle) != (size_t) record->lineLength) {
+            st_errnoAbort("Error writing sorted alignments");
+        }
+        if (record->line[record->lineLength - 1] != '\n') { //The last line of the input may have no newline
+            fputc('\n', output->fileHandle);
+        }
+    }
+    if (output->keyRecords != NULL) {
+        stList_append(output->keyRecords, record);
+        stSet_insert(output->keyRecordSet, record);
+    } else {
+        sortRecord_destruct(record);
+    }
+}
+
+static void sortOutput_close(SortOutput *output) {
+    if (output->keyRecords != NULL) {
+        stSet_destruct(output->keyRecordSet);
+        stList_destruct(output->keyRecords);
+    }
+    if (output->writer != NULL) {
+        stPairwiseAlignmentWriter_destruct(output->writer);
+    }
+    if (fclose(output->fileHandle) != 0) {
+        st_errnoAbort("Error closing a file of sorted alignments");
+    }
+}
+
+static char *getRunFile(const char *tempDir) {
+    char *runFile = stString_print("%s/stPairwiseAlignmentSort_XXXXXX", tempDir);
+    int fd = mkstemp(runFile);
+    if (fd == -1) {
+        st_errnoAbort("Could not make a temporary file in %s to sort alignments", tempDir);
+    }
+    close(fd);
+    return runFile;
+}
+
+static void mergeSort(SortRecord **records, SortRecord **buffer, int64_t length, AlignmentCmpFn cmpFn) {
+    /*
+     * A stable sort, using a buffer of at least length / 2 entries.
+     */
+    if (length < 2) {
+        return;
+    }
+    int64_t half = length / 2;
+    mergeSort(records, buffer, half, cmpFn);
+    mergeSort(records + half, buffer, length - half, cmpFn);
+    if (cmpFn(records[half - 1]->pA, records[half]->pA) <= 0) {
+        return;
+    }
+    memcpy(buffer, records, half * sizeof(SortRecord *));
+    int64_t i = 0, j = half, k = 0;
+    while (i < half && j < length) {
+        records[k++] = cmpFn(records[j]->pA, buffer[i]->pA) < 0 ? records[j++] : buffer[i++];
+    }
+    while (i < half) {
+        records[k++] = buffer[i++];
+    }
+}
+
+/*
+ * A chunk of the input, which is sorted and written out as a run.
+ */
+typedef struct _sortChunk {
+    SortRecord **records;
+    int64_t length;
+    AlignmentCmpFn cmpFn;
+    bool binary;
+    char *runFile;
+} SortChunk;
+
+static void sortChunkInto(SortChunk *chunk, SortOutput *output) {
+    /*
+     * Sorts the chunk and writes it to the output, freeing it.
+     */
+    SortRecord **buffer = st_malloc(sizeof(SortRecord *) * (chunk->length / 2 + 1));
+    mergeSort(chunk->records, buffer, chunk->length, chunk->cmpFn);
+    free(buffer);
+    for (int64_t i = 0; i < chunk->length; i++) {
+        sortOutput_write(output, chunk->records[i]);
+    }
+    free(chunk->records);
+    free(chunk);
+}
+
+static void *sortChunk(void *arg) {
+    //Binary runs keep the scores of the operations, so nothing is lost before the final output
+    SortChunk *chunk = arg;
+    SortOutput output;
+    sortOutput_open(&output, chunk->runFile, chunk->binary, 1, chunk->cmpFn, 0);
+    sortChunkInto(chunk, &output);
+    sortOutput_close(&output);
+    return NULL;
+}
+
+/*
+ * A run being merged, holding its next record.
+ */
+typedef struct _run {
+    SortInput input;
+    SortRecord *record;
+    int64_t index; //Of the run, so that equal records are taken from the earlier run
+} Run;
+
+static bool run_lessThan(Run *run1, Run *run2, AlignmentCmpFn cmpFn) {
+    int i = cmpFn(run1->record->pA, run2->record->pA);
+    return i < 0 || (i == 0 && run1->index < run2->index);
+}
+
+static void heap_siftDown(Run **heap, int64_t length, int64_t i, AlignmentCmpFn cmpFn) {
+    while (1) {
+        int64_t smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < length && run_lessThan(heap[left], heap[smallest], cmpFn)) {
+            smallest = left;
+        }
+        if (right < length && run_lessThan(heap[right], heap[smallest], cmpFn)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        Run *run = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = run;
+        i = smallest;
+    }
+}
+
+static void mergeRuns(char **runFiles, int64_t runNumber, bool binary, AlignmentCmpFn cmpFn, SortOutput *output) {
+    /*
+     * Merges the runs into the output, then deletes them.
+     */
+    Run *runs = st_malloc(sizeof(Run) * runNumber);
+    Run **heap = st_malloc(sizeof(Run *) * runNumber);
+    int64_t heapLength = 0;
+    for (int64_t i = 0; i < runNumber; i++) {
+        Run *run = &runs[i];
+        sortInput_open(&run->input, runFiles[i], binary);
+        run->record = sortInput_read(&run->input);
+        run->index = i;
+        if (run->record != NULL) {
+            heap[heapLength++] = run;
+        }
+    }
+    for (int64_t i = heapLength / 2 - 1; i >= 0; i--) {
+        heap_siftDown(heap, heapLength, i, cmpFn);
+    }
+    while (heapLength > 0) {
+        Run *run = heap[0];
+        sortOutput_write(output, run->record);
+        if ((run->record = sortInput_read(&run->input)) == NULL) {
+            heap[0] = heap[--heapLength];
+        }
+        heap_siftDown(heap, heapLength, 0, cmpFn);
+    }
+    for (int64_t i = 0; i < runNumber; i++) {
+        sortInput_close(&runs[i].input);
+        remove(runFiles[i]);
+    }
+    free(runs);
+    free(heap);
+}
+
+/*
+ * A group of consecutive runs, merged into a single run in a pass of the merge.
+ */
+typedef struct _mergeTask {
+    char **runFiles;
+    int64_t runNumber;
+    AlignmentCmpFn cmpFn;
+    bool binary;
+    char *runFile;
+} MergeTask;
+
+static char **getRunFiles(stList *runFiles, int64_t start, int64_t length) {
+    char **runFilesArray = st_malloc(sizeof(char *) * length);
+    for (int64_t i = 0; i < length; i++) {
+        runFilesArray[i] = stList_get(runFiles, start + i);
+    }
+    return runFilesArray;
+}
+
+static void *mergeTask(void *arg) {
+    MergeTask *task = arg;
+    SortOutput output;
+    sortOutput_open(&output, task->runFile, task->binary, 1, task->cmpFn, 0);
+    mergeRuns(task->runFiles, task->runNumber, task->binary, task->cmpFn, &output);
+    sortOutput_close(&output);
+    free(task->runFiles);
+    free(task);
+    return NULL;
+}
+
+void stPairwiseAlignment_sortFile(const char *inputFile, const char *outputFile, AlignmentCmpFn cmpFn,
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir, bool unique) {
+    assert(threadNumber >= 1);
+    if (tempDir == NULL) {
+        tempDir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    }
+    SortInput input;
+    sortInput_open(&input, inputFile, 0);
+    bool binary = stPairwiseAlignment_isBinary(input.fileHandle);
+    if (binary) {
+        input.reader = stPairwiseAlignmentReader_construct(input.fileHandle);
+    }
+    bool writeProbs = 0; //Whether the binary output needs the scores of the operations
+
+    /*
+     * Read the input in chunks, each sorted and written out as a run on the thread pool. At most threadNumber chunks
+     * are held at once, including the one being read.
+     */
+    int64_t chunkBudget = memoryBudget / threadNumber;
+    stThreadPool *threadPool = stThreadPool_construct(threadNumber, sortChunk, NULL);
+    stList *runFiles = stList_construct3(0, free);
+    int64_t chunksInFlight = 0;
+    SortChunk *lastChunk = NULL; //The input, if it fits in a single chunk
+    SortRecord *record = sortInput_read(&input);
+    while (record != NULL) {
+        SortChunk *chunk = st_malloc(sizeof(SortChunk));
+        int64_t maxLength = 1024;
+        chunk->records = st_malloc(sizeof(SortRecord *) * maxLength);
+        chunk->length = 0;
+        chunk->cmpFn = cmpFn;
+        chunk->binary = binary;
+        int64_t chunkMemory = 0;
+        do { //Every chunk holds at least one record, whatever the budget
+            if (chunk->length == maxLength) {
+                maxLength *= 2;
+                chunk->records = st_realloc(chunk->records, sizeof(SortRecord *) * maxLength);
+            }
+            chunk->records[chunk->length++] = record;
+            chunkMemory += sortRecord_getMemory(record);
+            writeProbs = writeProbs || (binary && sortRecord_hasProbs(record));
+            record = sortInput_read(&input);
+        } while (record != NULL && chunkMemory < chunkBudget);
+
+        if (record == NULL && stList_length(runFiles) == 0) {
+            lastChunk = chunk;
+            break;
+        }
+        chunk->runFile = getRunFile(tempDir);
+        stList_append(runFiles, chunk->runFile);
+        stThreadPool_push(threadPool, chunk);
+        if (++chunksInFlight == threadNumber) {
+            stThreadPool_wait(threadPool);
+            chunksInFlight = 0;
+        }
+    }
+    stThreadPool_wait(threadPool);
+    stThreadPool_destruct(threadPool);
+    sortInput_close(&input);
+
+    SortOutput output;
+    if (stList_length(runFiles) == 0) { //Sort the input in memory, if there is any
+        sortOutput_open(&output, outputFile, binary, writeProbs, cmpFn, unique);
+        if (lastChunk != NULL) {
+            sortChunkInto(lastChunk, &output);
+        }
+        sortOutput_close(&output);
+    } else {
+        /*
+         * Merge consecutive groups of runs, in parallel, until they can all be merged at once.
+         */
+        threadPool = stThreadPool_construct(threadNumber, mergeTask, NULL);
+        while (stList_length(runFiles) > SORT_MERGE_FAN_IN) {
+            stList *mergedRunFiles = stList_construct3(0, free);
+            for (int64_t i = 0; i < stList_length(runFiles); i += SORT_MERGE_FAN_IN) {
+                MergeTask *task = st_malloc(sizeof(MergeTask));
+                task->runNumber = stList_length(runFiles) - i < SORT_MERGE_FAN_IN ? stList_length(runFiles) - i : SORT_MERGE_FAN_IN;
+                task->runFiles = getRunFiles(runFiles, i, task->runNumber);
+                task->cmpFn = cmpFn;
+                task->binary = binary;
+                task->runFile = getRunFile(tempDir);
+                stList_append(mergedRunFiles, task->runFile);
+                stThreadPool_push(threadPool, task);
+            }
+            stThreadPool_wait(threadPool);
+            stList_destruct(runFiles);
+            runFiles = mergedRunFiles;
+        }
+        stThreadPool_destruct(threadPool);
+
+        sortOutput_open(&output, outputFile, binary, writeProbs, cmpFn, unique);
+        char **finalRunFiles = getRunFiles(runFiles, 0, stList_length(runFiles));
+        mergeRuns(finalRunFiles, stList_length(runFiles), binary, cmpFn, &output);
+        free(finalRunFiles);
+        sortOutput_close(&output);
+    }
+    stList_destruct(runFiles);
+}
@@ -16,34 +16,28 @@
 #include "lz4.h"
 
 #include "sonLibGlobalsInternal.h"
+#include <pthread.h>
 
 const char *ST_COMPRESSION_EXCEPTION_ID = "ST_COMPRESSION_EXCEPTION";
 
 //2^30, should be safe and big enough to find good compression.
 #define ST_LZ4_CHUNK_SIZE 1073741824
 
-void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
-    /*
-     * Uses the lz4 algorithm to provide very fast compression.
-     */
-    int64_t bufferSize = sizeInBytes + (1 + sizeInBytes/255 + 16) * (1 + sizeInBytes/ST_LZ4_CHUNK_SIZE);
-    char *buffer = st_malloc(sizeof(char) * bufferSize);
-    int64_t outputOffset=0;
-    /*
-     * Breaks sequence to compress up into 1 gig chunks, to avoid overflows.
-     */
-    for(int64_t inputOffset=0; inputOffset < sizeInBytes; inputOffset += ST_LZ4_CHUNK_SIZE) {
-        char subChunk = inputOffset + ST_LZ4_CHUNK_SIZE < sizeInBytes;
-        int64_t bytesWritten = LZ4_compress(((char*)data) + inputOffset, buffer+(outputOffset+1), subChunk ? ST_LZ4_CHUNK_SIZE : sizeInBytes - inputOffset);
-        *(buffer+outputOffset) = subChunk;
-        outputOffset += 1+bytesWritten;
-        assert(outputOffset <= bufferSize);
-    }
-    *compressedSizeInBytes = outputOffset;
-    return st_realloc(buffer, sizeof(char) * outputOffset);
-}
+/*
+ * Records compressed by stCompression_compress2 start with a header tagging the codec used and giving
+ * the uncompressed size, so they can be decompressed into a buffer of the right size in one go. The first
+ * byte of a record in the older, untagged lz4 format is always 0 or 1, so can not be the tag.
+ */
+#define ST_COMPRESSION_TAG 0xC5
+#define ST_COMPRESSION_HEADER_SIZE 10 //The tag, the codec and the uncompressed size.
 
-void *stCompression_decompress(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes) {
+//Below this many bytes a batch is not worth handing to threads.
+#define ST_COMPRESSION_MIN_PARALLEL_BATCH 65536
+
+/*
+ * Decompresses a record in the untagged lz4 format written by earlier versions.
+ */
+static void *decompressLegacy(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes) {
     int64_t bufferSize = compressedSizeInBytes * 2 + 1;
     char *buffer = st_malloc(sizeof(char) * bufferSize);
     int64_t outputOffset=0;
@@ -87,6 +81,240 @@ void *stCompression_decompress(void *compressedData, int64_t compressedSizeInByt
     return st_realloc(buffer, sizeof(char) * outputOffset);
 }
 
+static void *compressLz4(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, bool highCompression) {
+    /*
+     * Each chunk of up to ST_LZ4_CHUNK_SIZE bytes is written as its compressed size followed by its compressed bytes.
+     */
+    int64_t chunkNumber = (sizeInBytes + ST_LZ4_CHUNK_SIZE - 1) / ST_LZ4_CHUNK_SIZE;
+    int64_t bufferSize = ST_COMPRESSION_HEADER_SIZE + sizeInBytes + (1 + sizeInBytes / 255 + 16 + sizeof(int32_t)) * chunkNumber;
+    char *buffer = st_malloc(sizeof(char) * bufferSize);
+    int64_t outputOffset = ST_COMPRESSION_HEADER_SIZE;
+    for (int64_t inputOffset = 0; inputOffset < sizeInBytes; inputOffset += ST_LZ4_CHUNK_SIZE) {
+        int32_t chunkSize = sizeInBytes - inputOffset < ST_LZ4_CHUNK_SIZE ? sizeInBytes - inputOffset : ST_LZ4_CHUNK_SIZE;
+        char *source = (char *) data + inputOffset, *destination = buffer + outputOffset + sizeof(int32_t);
+        int32_t bytesWritten = highCompression ? LZ4_compressHC(source, destination, chunkSize) : LZ4_compress(source, destination, chunkSize);
+        memcpy(buffer + outputOffset, &bytesWritten, sizeof(int32_t));
+        outputOffset += sizeof(int32_t) + bytesWritten;
+        assert(outputOffset <= bufferSize);
+    }
+    *compressedSizeInBytes = outputOffset;
+    return st_realloc(buffer, sizeof(char) * outputOffset);
+}
+
+static void decompressLz4(char *compressedData, int64_t compressedSizeInBytes, char *buffer, int64_t sizeInBytes) {
+    int64_t inputOffset = 0;
+    for (int64_t outputOffset = 0; outputOffset < sizeInBytes; outputOffset += ST_LZ4_CHUNK_SIZE) {
+        int32_t chunkSize = sizeInBytes - outputOffset < ST_LZ4_CHUNK_SIZE ? sizeInBytes - outputOffset : ST_LZ4_CHUNK_SIZE;
+        int32_t compressedChunkSize;
+        if (compressedSizeInBytes - inputOffset < (int64_t) sizeof(int32_t)) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "An lz4 compressed record is truncated");
+        }
+        memcpy(&compressedChunkSize, compressedData + inputOffset, sizeof(int32_t));
+        inputOffset += sizeof(int32_t);
+        if (compressedChunkSize < 0 || compressedChunkSize > compressedSizeInBytes - inputOffset
+                || LZ4_uncompress_unknownOutputSize(compressedData + inputOffset, buffer + outputOffset, compressedChunkSize,
+                        chunkSize) != chunkSize) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Failed to uncompress an lz4 chunk of %" PRIi64 " bytes", (int64_t) chunkSize);
+        }
+        inputOffset += compressedChunkSize;
+    }
+}
+
+void *stCompression_compress2(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, stCompressionCodec codec,
+        int64_t level) {
+    char *compressedData;
+    switch (codec) {
+        case ST_COMPRESSION_LZ4:
+        case ST_COMPRESSION_LZ4HC:
+            compressedData = compressLz4(data, sizeInBytes, compressedSizeInBytes, codec == ST_COMPRESSION_LZ4HC);
+            break;
+        case ST_COMPRESSION_ZLIB: {
+            int64_t zlibSize;
+            void *zlibData = stCompression_compressZlib(data, sizeInBytes, &zlibSize, level);
+            *compressedSizeInBytes = ST_COMPRESSION_HEADER_SIZE + zlibSize;
+            compressedData = st_malloc(*compressedSizeInBytes);
+            memcpy(compressedData + ST_COMPRESSION_HEADER_SIZE, zlibData, zlibSize);
+            free(zlibData);
+            break;
+        }
+        default:
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Unknown compression codec: %i", (int) codec);
+            return NULL;
+    }
+    compressedData[0] = (char) ST_COMPRESSION_TAG;
+    compressedData[1] = (char) codec;
+    memcpy(compressedData + 2, &sizeInBytes, sizeof(int64_t));
+    return compressedData;
+}
+
+void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
+    return stCompression_compress2(data, sizeInBytes, compressedSizeInBytes, ST_COMPRESSION_LZ4, level);
+}
+
+stCompressionCodec stCompression_getCodec(void *compressedData, int64_t compressedSizeInBytes) {
+    if (compressedSizeInBytes >= ST_COMPRESSION_HEADER_SIZE && ((unsigned char *) compressedData)[0] == ST_COMPRESSION_TAG) {
+        return (stCompressionCodec) ((char *) compressedData)[1];
+    }
+    return ST_COMPRESSION_UNTAGGED;
+}
+
+stCompressionCodec stCompression_parseCodec(const char *name) {
+    if (strcmp(name, "lz4") == 0) {
+        return ST_COMPRESSION_LZ4;
+    }
+    if (strcmp(name, "lz4hc") == 0) {
+        return ST_COMPRESSION_LZ4HC;
+    }
+    if (strcmp(name, "zlib") == 0) {
+        return ST_COMPRESSION_ZLIB;
+    }
+    return ST_COMPRESSION_UNTAGGED;
+}
+
+void *stCompression_decompress(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes) {
+    stCompressionCodec codec = stCompression_getCodec(compressedData, compressedSizeInBytes);
+    if (codec == ST_COMPRESSION_UNTAGGED) {
+        return decompressLegacy(compressedData, compressedSizeInBytes, sizeInBytes);
+    }
+    char *payload = (char *) compressedData + ST_COMPRESSION_HEADER_SIZE;
+    int64_t payloadSize = compressedSizeInBytes - ST_COMPRESSION_HEADER_SIZE;
+    memcpy(sizeInBytes, (char *) compressedData + 2, sizeof(int64_t));
+    if (*sizeInBytes < 0) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "A compressed record has a negative size");
+    }
+    switch (codec) {
+        case ST_COMPRESSION_LZ4:
+        case ST_COMPRESSION_LZ4HC: {
+            char *buffer = st_malloc(*sizeInBytes > 0 ? *sizeInBytes : 1);
+            stTry {
+                decompressLz4(payload, payloadSize, buffer, *sizeInBytes);
+            } stCatch(except) {
+                free(buffer);
+                stThrowNewCause(except, ST_COMPRESSION_EXCEPTION_ID, "Failed to decompress a record");
+            } stTryEnd;
+            return buffer;
+        }
+        case ST_COMPRESSION_ZLIB: {
+            int64_t zlibSize;
+            void *buffer = stCompression_decompressZlib(payload, payloadSize, &zlibSize);
+            if (zlibSize != *sizeInBytes) {
+                free(buffer);
+                stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "A zlib compressed record has the wrong size");
+            }
+            return buffer;
+        }
+        default:
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Unknown compression codec: %i", (int) codec);
+            return NULL;
+    }
+}
+
+/*
+ * Bulk compression. The records are split into contiguous ranges of roughly equal numbers of bytes, which
+ * are compressed or decompressed by a pool of threads.
+ */
+
+typedef struct _bulkJob {
+    void **input;
+    int64_t *inputSizes;
+    void **output;
+    int64_t *outputSizes;
+    bool compress;
+    stCompressionCodec codec;
+    int64_t level;
+    pthread_mutex_t lock;
+    char *errorMessage; //The message of the first exception thrown by a worker, if any.
+} BulkJob;
+
+typedef struct _bulkRange {
+    BulkJob *job;
+    int64_t start, end;
+} BulkRange;
+
+static void processRange(BulkJob *job, int64_t start, int64_t end) {
+    for (int64_t i = start; i < end; i++) {
+        job->output[i] = job->compress ?
+                stCompression_compress2(job->input[i], job->inputSizes[i], &job->outputSizes[i], job->codec, job->level) :
+                stCompression_decompress(job->input[i], job->inputSizes[i], &job->outputSizes[i]);
+    }
+}
+
+static void *processRangeOnThread(void *workUnit) {
+    BulkRange *range = workUnit;
+    BulkJob *job = range->job;
+    stTry {
+        processRange(job, range->start, range->end);
+    } stCatch(except) {
+        //Exceptions can not cross threads, so the message is kept to be rethrown by the caller
+        pthread_mutex_lock(&job->lock);
+        if (job->errorMessage == NULL) {
+            job->errorMessage = stString_copy(stExcept_getMsg(except));
+        }
+        pthread_mutex_unlock(&job->lock);
+    } stTryEnd;
+    return NULL;
+}
+
+static void processBulk(BulkJob *job, int64_t recordNumber, int64_t threadNumber) {
+    memset(job->output, 0, sizeof(void *) * recordNumber);
+    pthread_mutex_init(&job->lock, NULL);
+    job->errorMessage = NULL;
+    int64_t totalSize = 0;
+    for (int64_t i = 0; i < recordNumber; i++) {
+        totalSize += job->inputSizes[i];
+    }
+    if (threadNumber <= 1 || recordNumber < 2 || totalSize < ST_COMPRESSION_MIN_PARALLEL_BATCH) {
+        BulkRange range = { job, 0, recordNumber };
+        processRangeOnThread(&range);
+    } else {
+        //A few ranges per thread, to even out the load
+        int64_t rangeNumber = threadNumber * 4 < recordNumber ? threadNumber * 4 : recordNumber;
+        BulkRange *ranges = st_calloc(rangeNumber, sizeof(BulkRange));
+        int64_t r = 0, rangeSize = 0;
+        for (int64_t i = 0; i < recordNumber; i++) {
+            rangeSize += job->inputSizes[i];
+            if (rangeSize * rangeNumber >= totalSize && r < rangeNumber - 1 && i < recordNumber - 1) {
+                ranges[r].end = i + 1;
+                ranges[++r].start = i + 1;
+                rangeSize = 0;
+            }
+        }
+        ranges[r].end = recordNumber;
+        rangeNumber = r + 1;
+        stThreadPool *threadPool = stThreadPool_construct(threadNumber < rangeNumber ? threadNumber : rangeNumber,
+                processRangeOnThread, NULL);
+        for (int64_t i = 0; i < rangeNumber; i++) {
+            ranges[i].job = job;
+            stThreadPool_push(threadPool, &ranges[i]);
+        }
+        stThreadPool_wait(threadPool);
+        stThreadPool_destruct(threadPool);
+        free(ranges);
+    }
+    pthread_mutex_destroy(&job->lock);
+    if (job->errorMessage != NULL) {
+        for (int64_t i = 0; i < recordNumber; i++) {
+            free(job->output[i]);
+            job->output[i] = NULL;
+        }
+        stExcept *except = stExcept_new(ST_COMPRESSION_EXCEPTION_ID, "%s", job->errorMessage);
+        free(job->errorMessage);
+        stThrow(except);
+    }
+}
+
+void stCompression_compressBulk(void **data, int64_t *sizesInBytes, int64_t recordNumber, void **compressedData,
+        int64_t *compressedSizesInBytes, stCompressionCodec codec, int64_t level, int64_t threadNumber) {
+    BulkJob job = { data, sizesInBytes, compressedData, compressedSizesInBytes, 1, codec, level };
+    processBulk(&job, recordNumber, threadNumber);
+}
+
+void stCompression_decompressBulk(void **compressedData, int64_t *compressedSizesInBytes, int64_t recordNumber, void **data,
+        int64_t *sizesInBytes, int64_t threadNumber) {
+    BulkJob job = { compressedData, compressedSizesInBytes, data, sizesInBytes, 0 };
+    processBulk(&job, recordNumber, threadNumber);
+}
+
 #define Z_CHUNK 262144
 
 void *stCompression_compressZlib(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
@@ -38,6 +38,9 @@ stKVDatabase *stKVDatabase_construct(stKVDatabaseConf *conf, bool create) {
                     "requested Tokyo Cabinet database, however sonlib is not compiled with Tokyo Cabinet support");
 #endif
             break;
+        case stKVDatabaseTypeLogFile:
+            stKVDatabase_initialise_logFile(database, conf, create);
+            break;
         case stKVDatabaseTypeKyotoTycoon:
 #ifdef HAVE_KYOTO_TYCOON
             stKVDatabase_initialise_kyotoTycoon(database, conf, create);
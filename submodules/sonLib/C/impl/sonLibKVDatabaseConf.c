@@ -42,6 +42,13 @@ stKVDatabaseConf *stKVDatabaseConf_constructTokyoCabinet(const char *databaseDir
     return conf;
 }
 
+stKVDatabaseConf *stKVDatabaseConf_constructLogFile(const char *databaseDir) {
+    stKVDatabaseConf *conf = stSafeCCalloc(sizeof(stKVDatabaseConf));
+    conf->type = stKVDatabaseTypeLogFile;
+    conf->databaseDir = stString_copy(databaseDir);
+    return conf;
+}
+
 stKVDatabaseConf *stKVDatabaseConf_constructKyotoTycoon(const char *host, unsigned port, int timeout,
                                                         int64_t maxRecordSize, int64_t maxBulkSetSize,
                                                         int64_t maxBulkSetNumRecords,
@@ -228,6 +235,8 @@ static stKVDatabaseConf *constructFromString(const char *xmlString) {
     }
     if (stString_eq(type, "tokyo_cabinet")) {
         databaseConf = stKVDatabaseConf_constructTokyoCabinet(getXmlValueRequired(hash, "database_dir"));
+    } else if (stString_eq(type, "log_file")) {
+        databaseConf = stKVDatabaseConf_constructLogFile(getXmlValueRequired(hash, "database_dir"));
     } else if (stString_eq(type, "kyoto_tycoon")) {
         databaseConf = stKVDatabaseConf_constructKyotoTycoon(getXmlValueRequired(hash, "host"), 
                                                         getXmlPort(hash), 
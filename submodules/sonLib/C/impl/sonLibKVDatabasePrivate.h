@@ -61,6 +61,11 @@ struct stKVDatabaseBulkResult {
  */
 void stKVDatabase_initialise_tokyoCabinet(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
 
+/*
+ * Function initialises the pointers of the stKVDatabase object with functions for the embedded log file database.
+ */
+void stKVDatabase_initialise_logFile(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
+
 /*
  * Function initialises the pointers of the stKVDatabase object with functions for MySql.
  */
@@ -0,0 +1,885 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_LogFile.c
+ *
+ * An embedded, single-file key/value store that needs no server process.
+ *
+ * Records are appended to a log file ("data.log" in the database directory). Each record
+ * is a fixed size header (key, size, checksum) followed by the value; a removal is written
+ * as a record with size -1. A record is never rewritten, so a value found at a given offset
+ * stays valid for the life of the file and readers can pread it without holding any lock.
+ *
+ * The location of the latest record for each key is kept in two layers. The base layer is an
+ * index file ("data.index"), a key sorted array of (key, offset, size) entries covering a
+ * prefix of the log, which is mmapped on open and binary searched. The top layer is an
+ * in-memory hash of the records appended to the log after that prefix, built by replaying
+ * the log tail on open. The index file is rewritten when the database is closed, so reopening
+ * a large database only costs the replay of what was written in the last session.
+ *
+ * Bulk sets and removes are encoded into a single buffer, appended with one write and synced
+ * with one fdatasync (a group commit). The log is locked with fcntl while it is appended to,
+ * so several processes may write to the same database; a process notices records appended by
+ * others when it next writes, or when it looks for a key it can not find. A torn record left
+ * at the end of the log by a crash fails its checksum and is truncated away.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+#define LOG_FILE_MAGIC "stKVLog1"
+#define INDEX_FILE_MAGIC "stKVIdx1"
+#define REMOVED_RECORD_SIZE -1
+
+typedef struct _logFileHeader {
+    char magic[8];
+    int64_t id; //Distinguishes this log from earlier logs of the same name, so a stale index is not used.
+} LogFileHeader;
+
+typedef struct _logRecordHeader {
+    int64_t key;
+    int64_t size;
+    uint32_t checksum;
+    uint32_t padding;
+} LogRecordHeader;
+
+typedef struct _indexFileHeader {
+    char magic[8];
+    int64_t logId;
+    int64_t logLength; //The prefix of the log covered by the index.
+    int64_t entryNumber;
+} IndexFileHeader;
+
+/*
+ * The location of a record, offset being that of the value. Removed records have size
+ * REMOVED_RECORD_SIZE.
+ */
+typedef struct _indexEntry {
+    int64_t key;
+    int64_t offset;
+    int64_t size;
+} IndexEntry;
+
+typedef struct _logFileDB {
+    char *logPath;
+    char *indexPath;
+    int fd;
+    int64_t id;
+    int64_t logLength; //Length of the log that has been read into the index.
+    int64_t recordNumber;
+    //Base layer, mmapped from the index file.
+    void *indexMap;
+    int64_t indexMapSize;
+    IndexEntry *baseEntries;
+    int64_t baseEntryNumber;
+    int64_t baseLogLength;
+    //Top layer, the records appended to the log after those in the index file.
+    stHash *entries;
+    pthread_rwlock_t lock;
+} LogFileDB;
+
+static uint64_t indexEntry_hashKey(const IndexEntry *entry) {
+    return (uint64_t) entry->key * 0x9E3779B97F4A7C15ULL;
+}
+
+static int indexEntry_equalKeys(const IndexEntry *entry1, const IndexEntry *entry2) {
+    return entry1->key == entry2->key;
+}
+
+static uint32_t getChecksum(int64_t key, int64_t size, const void *value) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, (const Bytef *) &key, sizeof(int64_t));
+    crc = crc32(crc, (const Bytef *) &size, sizeof(int64_t));
+    if (size > 0) {
+        crc = crc32(crc, (const Bytef *) value, size);
+    }
+    return (uint32_t) crc;
+}
+
+/*
+ * File helpers.
+ */
+
+static void writeFully(int fd, const void *buffer, int64_t size, const char *path) {
+    const char *cA = buffer;
+    while (size > 0) {
+        ssize_t i = write(fd, cA, size);
+        if (i < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Writing to log database file %s failed: %s", path, strerror(errno));
+        }
+        cA += i;
+        size -= i;
+    }
+}
+
+static bool readFully(int fd, void *buffer, int64_t size, int64_t offset) {
+    char *cA = buffer;
+    while (size > 0) {
+        ssize_t i = pread(fd, cA, size, offset);
+        if (i < 0 && errno == EINTR) {
+            continue;
+        }
+        if (i <= 0) {
+            return false;
+        }
+        cA += i;
+        size -= i;
+        offset += i;
+    }
+    return true;
+}
+
+static int64_t getFileLength(int fd, const char *path) {
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Could not stat log database file %s: %s", path, strerror(errno));
+    }
+    return fileStat.st_size;
+}
+
+/*
+ * Throws an exception with the given message, which is freed.
+ */
+static void throwError(char *error) {
+    stExcept *ex = stExcept_new(ST_KV_DATABASE_EXCEPTION_ID, "%s", error);
+    free(error);
+    stThrow(ex);
+}
+
+/*
+ * Takes (or releases, with type F_UNLCK) a lock on the whole log, shared between processes.
+ */
+static void lockLog(LogFileDB *db, short type) {
+    struct flock fileLock;
+    memset(&fileLock, 0, sizeof(struct flock));
+    fileLock.l_type = type;
+    fileLock.l_whence = SEEK_SET;
+    while (fcntl(db->fd, F_SETLKW, &fileLock) != 0) {
+        if (errno != EINTR) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Could not lock log database file %s: %s", db->logPath, strerror(errno));
+        }
+    }
+}
+
+/*
+ * Index lookups, the top layer shadows the base layer.
+ */
+
+static IndexEntry *getBaseEntry(LogFileDB *db, int64_t key) {
+    int64_t i = 0, j = db->baseEntryNumber;
+    while (i < j) {
+        int64_t k = i + (j - i) / 2;
+        if (db->baseEntries[k].key < key) {
+            i = k + 1;
+        } else {
+            j = k;
+        }
+    }
+    return i < db->baseEntryNumber && db->baseEntries[i].key == key ? &db->baseEntries[i] : NULL;
+}
+
+static IndexEntry *getEntry(LogFileDB *db, int64_t key) {
+    IndexEntry query;
+    query.key = key;
+    IndexEntry *entry = stHash_search(db->entries, &query);
+    if (entry == NULL) {
+        entry = getBaseEntry(db, key);
+    }
+    return entry != NULL && entry->size != REMOVED_RECORD_SIZE ? entry : NULL;
+}
+
+static void setEntry(LogFileDB *db, int64_t key, int64_t offset, int64_t size) {
+    bool existed = getEntry(db, key) != NULL;
+    IndexEntry query;
+    query.key = key;
+    IndexEntry *entry = stHash_search(db->entries, &query);
+    if (entry == NULL) {
+        entry = st_malloc(sizeof(IndexEntry));
+        entry->key = key;
+        stHash_insert(db->entries, entry, entry);
+    }
+    entry->offset = offset;
+    entry->size = size;
+    db->recordNumber += (size != REMOVED_RECORD_SIZE ? 1 : 0) - (existed ? 1 : 0);
+}
+
+/*
+ * Reads the records appended to the log since it was last read into the index. Must be called
+ * holding the log lock. If truncate is true (the lock is exclusive) an incomplete record at the
+ * end of the log can only be left over from a crash, and is removed.
+ */
+static void catchUp(LogFileDB *db, bool truncate) {
+    int64_t fileLength = getFileLength(db->fd, db->logPath);
+    void *value = NULL;
+    int64_t valueCapacity = 0;
+    while (db->logLength + (int64_t) sizeof(LogRecordHeader) <= fileLength) {
+        LogRecordHeader header;
+        if (!readFully(db->fd, &header, sizeof(LogRecordHeader), db->logLength) || header.size < REMOVED_RECORD_SIZE
+                || db->logLength + (int64_t) sizeof(LogRecordHeader) + (header.size > 0 ? header.size : 0) > fileLength) {
+            break;
+        }
+        if (header.size > valueCapacity) {
+            free(value);
+            valueCapacity = header.size;
+            value = st_malloc(valueCapacity);
+        }
+        if ((header.size > 0 && !readFully(db->fd, value, header.size, db->logLength + sizeof(LogRecordHeader)))
+                || getChecksum(header.key, header.size, value) != header.checksum) {
+            break;
+        }
+        setEntry(db, header.key, db->logLength + sizeof(LogRecordHeader), header.size);
+        db->logLength += sizeof(LogRecordHeader) + (header.size > 0 ? header.size : 0);
+    }
+    free(value);
+    if (truncate && db->logLength < fileLength) {
+        if (ftruncate(db->fd, db->logLength) != 0) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Could not truncate log database file %s: %s", db->logPath, strerror(errno));
+        }
+    }
+}
+
+/*
+ * The index file.
+ */
+
+static void loadIndex(LogFileDB *db) {
+    int fd = open(db->indexPath, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    int64_t size = getFileLength(fd, db->indexPath);
+    if (size >= (int64_t) sizeof(IndexFileHeader)) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            IndexFileHeader *header = map;
+            if (memcmp(header->magic, INDEX_FILE_MAGIC, 8) == 0 && header->logId == db->id
+                    && header->logLength <= getFileLength(db->fd, db->logPath)
+                    && size == (int64_t) sizeof(IndexFileHeader) + header->entryNumber * (int64_t) sizeof(IndexEntry)) {
+                db->indexMap = map;
+                db->indexMapSize = size;
+                db->baseEntries = (IndexEntry *) ((char *) map + sizeof(IndexFileHeader));
+                db->baseEntryNumber = header->entryNumber;
+                db->baseLogLength = db->logLength = header->logLength;
+                db->recordNumber = header->entryNumber;
+            } else {
+                munmap(map, size);
+            }
+        }
+    }
+    close(fd);
+}
+
+static int indexEntry_cmp(const IndexEntry *entry1, const IndexEntry *entry2) {
+    return entry1->key < entry2->key ? -1 : (entry1->key > entry2->key ? 1 : 0);
+}
+
+/*
+ * Merges the two layers into a new index file, written to a temporary file and renamed into place
+ * so that a concurrent open sees either the old or the new index.
+ */
+static void writeIndex(LogFileDB *db) {
+    if (db->logLength == db->baseLogLength) {
+        return;
+    }
+    stList *topEntries = stHash_getValues(db->entries);
+    stList_sort(topEntries, (int (*)(const void *, const void *)) indexEntry_cmp);
+    char *tempPath = stString_print("%s.%" PRIi64 ".tmp", db->indexPath, (int64_t) getpid());
+    FILE *fileHandle = fopen(tempPath, "wb");
+    if (fileHandle == NULL) {
+        stList_destruct(topEntries);
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Could not write log database index %s", tempPath);
+    }
+    IndexFileHeader header;
+    memcpy(header.magic, INDEX_FILE_MAGIC, 8);
+    header.logId = db->id;
+    header.logLength = db->logLength;
+    header.entryNumber = db->recordNumber;
+    fwrite(&header, sizeof(IndexFileHeader), 1, fileHandle);
+    int64_t i = 0, j = 0, entryNumber = 0;
+    while (i < db->baseEntryNumber || j < stList_length(topEntries)) {
+        IndexEntry *entry;
+        if (j == stList_length(topEntries) || (i < db->baseEntryNumber && db->baseEntries[i].key < ((IndexEntry *) stList_get(topEntries, j))->key)) {
+            entry = &db->baseEntries[i++];
+        } else {
+            entry = stList_get(topEntries, j++);
+            if (i < db->baseEntryNumber && db->baseEntries[i].key == entry->key) {
+                i++; //Shadowed
+            }
+        }
+        if (entry->size != REMOVED_RECORD_SIZE) {
+            fwrite(entry, sizeof(IndexEntry), 1, fileHandle);
+            entryNumber++;
+        }
+    }
+    stList_destruct(topEntries);
+    assert(entryNumber == db->recordNumber);
+    bool failed = ferror(fileHandle) || fclose(fileHandle) != 0;
+    if (failed || rename(tempPath, db->indexPath) != 0) {
+        remove(tempPath);
+        free(tempPath);
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Could not write log database index %s", db->indexPath);
+    }
+    free(tempPath);
+}
+
+/*
+ * Construction and destruction.
+ */
+
+static void closeDB(LogFileDB *db) {
+    stHash_destruct(db->entries);
+    if (db->indexMap != NULL) {
+        munmap(db->indexMap, db->indexMapSize);
+    }
+    pthread_rwlock_destroy(&db->lock);
+    close(db->fd);
+    free(db->logPath);
+    free(db->indexPath);
+    free(db);
+}
+
+static LogFileDB *constructDB(stKVDatabaseConf *conf, bool create) {
+    const char *dbDir = stKVDatabaseConf_getDir(conf);
+    mkdir(dbDir, S_IRWXU); // just let the open generate the error
+    LogFileDB *db = st_calloc(1, sizeof(LogFileDB));
+    db->logPath = stString_print("%s/data.log", dbDir);
+    db->indexPath = stString_print("%s/data.index", dbDir);
+    db->fd = open(db->logPath, O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    if (db->fd < 0) {
+        char *error = stString_print("Opening log database: %s with error: %s", db->logPath, strerror(errno));
+        free(db->logPath);
+        free(db->indexPath);
+        free(db);
+        throwError(error);
+    }
+    db->entries = stHash_construct3((uint64_t (*)(const void *)) indexEntry_hashKey,
+            (int (*)(const void *, const void *)) indexEntry_equalKeys, NULL, free);
+    pthread_rwlock_init(&db->lock, NULL);
+
+    lockLog(db, F_WRLCK);
+    LogFileHeader header;
+    if (create || getFileLength(db->fd, db->logPath) < (int64_t) sizeof(LogFileHeader)) {
+        if (ftruncate(db->fd, 0) != 0) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Could not truncate log database file %s: %s", db->logPath, strerror(errno));
+        }
+        remove(db->indexPath);
+        memcpy(header.magic, LOG_FILE_MAGIC, 8);
+        header.id = (((int64_t) time(NULL)) << 24) ^ ((int64_t) getpid() << 4) ^ (int64_t) (size_t) db;
+        writeFully(db->fd, &header, sizeof(LogFileHeader), db->logPath);
+    } else if (!readFully(db->fd, &header, sizeof(LogFileHeader), 0) || memcmp(header.magic, LOG_FILE_MAGIC, 8) != 0) {
+        char *error = stString_print("The file %s is not a log database", db->logPath);
+        closeDB(db);
+        throwError(error);
+    }
+    db->id = header.id;
+    db->logLength = sizeof(LogFileHeader);
+    loadIndex(db);
+    catchUp(db, true);
+    lockLog(db, F_UNLCK);
+    return db;
+}
+
+static void destructDB(stKVDatabase *database) {
+    LogFileDB *db = database->dbImpl;
+    if (db != NULL) {
+        database->dbImpl = NULL;
+        stTry {
+            lockLog(db, F_WRLCK);
+            fdatasync(db->fd);
+            writeIndex(db);
+            lockLog(db, F_UNLCK);
+        } stCatch(ex) {
+            closeDB(db);
+            stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID, "Closing log database failed");
+        } stTryEnd;
+        closeDB(db);
+    }
+}
+
+static void deleteDB(stKVDatabase *database) {
+    LogFileDB *db = database->dbImpl;
+    if (db != NULL) {
+        database->dbImpl = NULL;
+        remove(db->logPath);
+        remove(db->indexPath);
+        closeDB(db);
+    }
+    rmdir(stKVDatabaseConf_getDir(stKVDatabase_getConf(database)));
+}
+
+/*
+ * Writing. All writes take the thread lock, then the log lock, catch up with the records
+ * written by other processes, check the requests against the updated index and append.
+ */
+
+static void startWrite(LogFileDB *db) {
+    pthread_rwlock_wrlock(&db->lock);
+    stTry {
+        lockLog(db, F_WRLCK);
+        catchUp(db, true);
+    } stCatch(ex) {
+        pthread_rwlock_unlock(&db->lock);
+        stThrow(ex);
+    } stTryEnd;
+}
+
+static void endWrite(LogFileDB *db) {
+    lockLog(db, F_UNLCK);
+    pthread_rwlock_unlock(&db->lock);
+}
+
+static void appendRecord(stList *buffer, int64_t key, const void *value, int64_t size) {
+    //The buffer is a list of (pointer, length) pieces, gathered so a group is written in one go.
+    LogRecordHeader *header = st_calloc(1, sizeof(LogRecordHeader));
+    header->key = key;
+    header->size = size;
+    header->checksum = getChecksum(key, size, value);
+    stList_append(buffer, header);
+    if (size > 0) {
+        stList_append(buffer, (void *) value);
+    }
+}
+
+/*
+ * Writes the records in the buffer to the log in one write and indexes them.
+ */
+static void writeRecords(LogFileDB *db, stList *buffer, bool sync) {
+    int64_t totalSize = 0;
+    for (int64_t i = 0; i < stList_length(buffer); i++) {
+        LogRecordHeader *header = stList_get(buffer, i);
+        totalSize += sizeof(LogRecordHeader);
+        if (header->size > 0) {
+            totalSize += header->size;
+            i++;
+        }
+    }
+    char *block = st_malloc(totalSize > 0 ? totalSize : 1), *cA = block;
+    for (int64_t i = 0; i < stList_length(buffer); i++) {
+        LogRecordHeader *header = stList_get(buffer, i);
+        memcpy(cA, header, sizeof(LogRecordHeader));
+        cA += sizeof(LogRecordHeader);
+        if (header->size > 0) {
+            memcpy(cA, stList_get(buffer, ++i), header->size);
+            cA += header->size;
+        }
+    }
+    stTry {
+        writeFully(db->fd, block, totalSize, db->logPath);
+        if (sync && fdatasync(db->fd) != 0) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Syncing log database file %s failed: %s", db->logPath, strerror(errno));
+        }
+    } stCatch(ex) {
+        free(block);
+        stThrow(ex);
+    } stTryEnd;
+    free(block);
+    for (int64_t i = 0; i < stList_length(buffer); i++) {
+        LogRecordHeader *header = stList_get(buffer, i);
+        setEntry(db, header->key, db->logLength + sizeof(LogRecordHeader), header->size);
+        db->logLength += sizeof(LogRecordHeader) + (header->size > 0 ? header->size : 0);
+        if (header->size > 0) {
+            i++;
+        }
+        free(header);
+    }
+}
+
+static stList *constructBuffer() {
+    return stList_construct();
+}
+
+static void destructBuffer(stList *buffer) {
+    for (int64_t i = 0; i < stList_length(buffer); i++) {
+        LogRecordHeader *header = stList_get(buffer, i);
+        if (header->size > 0) {
+            i++;
+        }
+        free(header);
+    }
+    stList_destruct(buffer);
+}
+
+/*
+ * Checks a write against the index, returning an error message (to be freed) or NULL if the
+ * write is allowed. The keys written earlier in the same group are in the pending hash.
+ */
+static char *checkWrite(LogFileDB *db, int64_t key, enum stKVDatabaseBulkRequestType type, stHash *pending) {
+    bool exists;
+    IndexEntry query;
+    query.key = key;
+    IndexEntry *pendingEntry = pending != NULL ? stHash_search(pending, &query) : NULL;
+    if (pendingEntry != NULL) {
+        exists = pendingEntry->size != REMOVED_RECORD_SIZE;
+    } else {
+        exists = getEntry(db, key) != NULL;
+    }
+    if (type == INSERT && exists) {
+        return stString_print("Attempt to insert a key in the database that already exists: %" PRIi64, key);
+    }
+    if (type == UPDATE && !exists) {
+        return stString_print("Attempt to update a key in the database that doesn't exists: %" PRIi64, key);
+    }
+    return NULL;
+}
+
+static void writeRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord,
+        enum stKVDatabaseBulkRequestType type) {
+    LogFileDB *db = database->dbImpl;
+    startWrite(db);
+    char *error = checkWrite(db, key, type, NULL);
+    if (error == NULL) {
+        stList *buffer = constructBuffer();
+        appendRecord(buffer, key, value, sizeOfRecord);
+        stTry {
+            writeRecords(db, buffer, false);
+        } stCatch(ex) {
+            destructBuffer(buffer);
+            endWrite(db);
+            stThrow(ex);
+        } stTryEnd;
+        stList_destruct(buffer);
+    }
+    endWrite(db);
+    if (error != NULL) {
+        throwError(error);
+    }
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    writeRecord(database, key, value, sizeOfRecord, INSERT);
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    writeRecord(database, key, &value, sizeof(int64_t), INSERT);
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    writeRecord(database, key, value, sizeOfRecord, UPDATE);
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    writeRecord(database, key, &value, sizeof(int64_t), UPDATE);
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    writeRecord(database, key, value, sizeOfRecord, SET);
+}
+
+/*
+ * Checks and writes a group of records as a single append, either all of the requests
+ * are applied or none are. Records with size REMOVED_RECORD_SIZE are removals.
+ */
+static void writeGroup(stKVDatabase *database, stList *keys, stList *values, stList *sizes, stList *types) {
+    LogFileDB *db = database->dbImpl;
+    startWrite(db);
+    stHash *pending = stHash_construct3((uint64_t (*)(const void *)) indexEntry_hashKey,
+            (int (*)(const void *, const void *)) indexEntry_equalKeys, NULL, free);
+    stList *buffer = constructBuffer();
+    char *error = NULL;
+    for (int64_t i = 0; i < stList_length(keys) && error == NULL; i++) {
+        int64_t key = *(int64_t *) stList_get(keys, i), size = *(int64_t *) stList_get(sizes, i);
+        if (size == REMOVED_RECORD_SIZE) {
+            if (checkWrite(db, key, UPDATE, pending) != NULL) {
+                error = stString_print("Removing key not found: %" PRIi64, key);
+            }
+        } else {
+            error = checkWrite(db, key, *(enum stKVDatabaseBulkRequestType *) stList_get(types, i), pending);
+        }
+        if (error == NULL) {
+            IndexEntry query;
+            query.key = key;
+            IndexEntry *entry = stHash_search(pending, &query);
+            if (entry == NULL) {
+                entry = st_calloc(1, sizeof(IndexEntry));
+                entry->key = key;
+                stHash_insert(pending, entry, entry);
+            }
+            entry->size = size;
+            appendRecord(buffer, key, stList_get(values, i), size);
+        }
+    }
+    stHash_destruct(pending);
+    if (error == NULL) {
+        stTry {
+            writeRecords(db, buffer, true);
+        } stCatch(ex) {
+            destructBuffer(buffer);
+            endWrite(db);
+            stThrow(ex);
+        } stTryEnd;
+        stList_destruct(buffer);
+    } else {
+        destructBuffer(buffer);
+    }
+    endWrite(db);
+    if (error != NULL) {
+        throwError(error);
+    }
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    int64_t n = stList_length(records);
+    stList *keys = stList_construct(), *values = stList_construct(), *sizes = stList_construct(), *types = stList_construct();
+    for (int64_t i = 0; i < n; i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        stList_append(keys, &request->key);
+        stList_append(values, request->value);
+        stList_append(sizes, &request->size);
+        stList_append(types, &request->type);
+    }
+    stTry {
+        writeGroup(database, keys, values, sizes, types);
+    } stCatch(ex) {
+        stList_destruct(keys);
+        stList_destruct(values);
+        stList_destruct(sizes);
+        stList_destruct(types);
+        stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID, "log database bulk set records failed");
+    } stTryEnd;
+    stList_destruct(keys);
+    stList_destruct(values);
+    stList_destruct(sizes);
+    stList_destruct(types);
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    int64_t n = stList_length(records);
+    int64_t *keyArray = st_malloc(sizeof(int64_t) * (n > 0 ? n : 1)), removedSize = REMOVED_RECORD_SIZE;
+    stList *keys = stList_construct(), *values = stList_construct(), *sizes = stList_construct(), *types = stList_construct();
+    for (int64_t i = 0; i < n; i++) {
+        keyArray[i] = stIntTuple_get(stList_get(records, i), 0);
+        stList_append(keys, &keyArray[i]);
+        stList_append(values, NULL);
+        stList_append(sizes, &removedSize);
+        stList_append(types, NULL);
+    }
+    stTry {
+        writeGroup(database, keys, values, sizes, types);
+    } stCatch(ex) {
+        free(keyArray);
+        stList_destruct(keys);
+        stList_destruct(values);
+        stList_destruct(sizes);
+        stList_destruct(types);
+        stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID, "log database bulk remove records failed");
+    } stTryEnd;
+    free(keyArray);
+    stList_destruct(keys);
+    stList_destruct(values);
+    stList_destruct(sizes);
+    stList_destruct(types);
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    stList *records = stList_construct3(1, (void (*)(void *)) stIntTuple_destruct);
+    stList_set(records, 0, stIntTuple_construct1(key));
+    stTry {
+        bulkRemoveRecords(database, records);
+    } stCatch(ex) {
+        stList_destruct(records);
+        stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID, "Removing key/value from log database failed: %" PRIi64, key);
+    } stTryEnd;
+    stList_destruct(records);
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    LogFileDB *db = database->dbImpl;
+    startWrite(db);
+    IndexEntry *entry = getEntry(db, key);
+    int64_t value = INT64_MIN;
+    char *error = NULL;
+    if (entry == NULL || entry->size < (int64_t) sizeof(int64_t) || !readFully(db->fd, &value, sizeof(int64_t), entry->offset)) {
+        error = stString_print("log database increment of record %" PRIi64 " failed, no such record", key);
+    } else {
+        value += incrementAmount;
+        stList *buffer = constructBuffer();
+        appendRecord(buffer, key, &value, sizeof(int64_t));
+        stTry {
+            writeRecords(db, buffer, false);
+        } stCatch(ex) {
+            destructBuffer(buffer);
+            endWrite(db);
+            stThrow(ex);
+        } stTryEnd;
+        stList_destruct(buffer);
+    }
+    endWrite(db);
+    if (error != NULL) {
+        throwError(error);
+    }
+    return value;
+}
+
+/*
+ * Reading. The index is searched under a shared lock; the value is then read without any lock,
+ * as the log is never rewritten.
+ */
+
+static bool getLocation(LogFileDB *db, int64_t key, int64_t *offset, int64_t *size) {
+    IndexEntry *entry = getEntry(db, key);
+    if (entry == NULL) {
+        return false;
+    }
+    *offset = entry->offset;
+    *size = entry->size;
+    return true;
+}
+
+/*
+ * Reads in any records appended by other processes, must be called holding the thread lock
+ * for writing.
+ */
+static void refresh(LogFileDB *db) {
+    if (getFileLength(db->fd, db->logPath) > db->logLength) {
+        stTry {
+            lockLog(db, F_RDLCK);
+            catchUp(db, false);
+            lockLog(db, F_UNLCK);
+        } stCatch(ex) {
+            pthread_rwlock_unlock(&db->lock);
+            stThrow(ex);
+        } stTryEnd;
+    }
+}
+
+static bool findRecord(LogFileDB *db, int64_t key, int64_t *offset, int64_t *size) {
+    pthread_rwlock_rdlock(&db->lock);
+    bool found = getLocation(db, key, offset, size);
+    bool stale = !found && getFileLength(db->fd, db->logPath) > db->logLength;
+    pthread_rwlock_unlock(&db->lock);
+    if (stale) { //Another process may have written the record
+        pthread_rwlock_wrlock(&db->lock);
+        refresh(db);
+        found = getLocation(db, key, offset, size);
+        pthread_rwlock_unlock(&db->lock);
+    }
+    return found;
+}
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    int64_t offset, size;
+    return findRecord(database->dbImpl, key, &offset, &size);
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    LogFileDB *db = database->dbImpl;
+    pthread_rwlock_wrlock(&db->lock);
+    refresh(db);
+    int64_t recordNumber = db->recordNumber;
+    pthread_rwlock_unlock(&db->lock);
+    return recordNumber;
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    LogFileDB *db = database->dbImpl;
+    int64_t offset, size;
+    if (!findRecord(db, key, &offset, &size)) {
+        return NULL;
+    }
+    void *record = st_malloc(size > 0 ? size : 1);
+    if (!readFully(db->fd, record, size, offset)) {
+        free(record);
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Reading record %" PRIi64 " from log database file %s failed", key, db->logPath);
+    }
+    *recordSize = size;
+    return record;
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    int64_t i;
+    return getRecord2(database, key, &i);
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    int64_t recordSize;
+    int64_t *record = getRecord2(database, key, &recordSize);
+    if (record == NULL) {
+        return -1;
+    }
+    int64_t value = *record;
+    free(record);
+    return value;
+}
+
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize) {
+    LogFileDB *db = database->dbImpl;
+    int64_t offset, size;
+    if (!findRecord(db, key, &offset, &size)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The record does not exist: %" PRIi64 " for partial retrieval", key);
+    }
+    if (size != recordSize) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The given record size is incorrect: %" PRIi64 ", should be %" PRIi64, recordSize, size);
+    }
+    if (zeroBasedByteOffset < 0 || sizeInBytes < 0 || zeroBasedByteOffset + sizeInBytes > recordSize) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Partial record retrieval to out of bounds memory, record size: %" PRIi64
+                ", requested start: %" PRIi64 ", requested size: %" PRIi64, recordSize, zeroBasedByteOffset, sizeInBytes);
+    }
+    void *partialRecord = st_malloc(sizeInBytes > 0 ? sizeInBytes : 1);
+    if (!readFully(db->fd, partialRecord, sizeInBytes, offset + zeroBasedByteOffset)) {
+        free(partialRecord);
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Reading record %" PRIi64 " from log database file %s failed", key, db->logPath);
+    }
+    return partialRecord;
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList* keys) {
+    int64_t n = stList_length(keys);
+    stList* results = stList_construct3(n, (void(*)(void *))stKVDatabaseBulkResult_destruct);
+    for (int64_t i = 0; i < n; ++i) {
+        int64_t recordSize = 0;
+        void* record = getRecord2(database, *((int64_t*)stList_get(keys, i)), &recordSize);
+        stList_set(results, i, stKVDatabaseBulkResult_construct(record, recordSize));
+    }
+    return results;
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    stList* results = stList_construct3(numRecords, (void(*)(void *))stKVDatabaseBulkResult_destruct);
+    for (int64_t i = 0; i < numRecords; ++i) {
+        int64_t recordSize = 0;
+        void* record = getRecord2(database, firstKey + i, &recordSize);
+        stList_set(results, i, stKVDatabaseBulkResult_construct(record, recordSize));
+    }
+    return results;
+}
+
+//initialisation function
+
+void stKVDatabase_initialise_logFile(stKVDatabase *database, stKVDatabaseConf *conf, bool create) {
+    database->dbImpl = constructDB(stKVDatabase_getConf(database), create);
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+}
@@ -8,10 +8,31 @@
 
 const char *RANDOM_EXCEPTION_ID = "RANDOM_EXCEPTION";
 
+static __thread bool threadIsSeeded = 0;
+static __thread uint64_t threadState;
+
 void st_randomSeed(int64_t seed) {
     srand(seed);
 }
 
+void st_randomSeedThread(int64_t seed) {
+    threadIsSeeded = 1;
+    threadState = seed;
+}
+
+void st_randomUnseedThread(void) {
+    threadIsSeeded = 0;
+}
+
+static double st_randomThread(void) {
+    //splitmix64, taking the top 53 bits as the fraction of a double in [0, 1)
+    uint64_t z = (threadState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
 int64_t st_randomInt64(int64_t min, int64_t max) {
     int64_t i;
     if (min < INT32_MIN && max > INT32_MAX) { //Possible overflow condition, deal with by switching to doubles
@@ -37,6 +58,9 @@ int64_t st_randomInt(int64_t min, int64_t max) {
 }
 
 double st_random(void) {
+    if (threadIsSeeded) {
+        return st_randomThread();
+    }
     static const double i = RAND_MAX+1.0;
     double d = rand()/i;
     return d >= 1.0 ? 0.9999 : (d < 0.0 ? 0.0 : d);
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+//Sharded cache functions
+
+#include "sonLibGlobalsInternal.h"
+#include <pthread.h>
+
+#define DEFAULT_SHARD_NUMBER 16
+#define MIN_TABLE_SIZE 16
+
+typedef struct _shardedCacheRecord {
+    /*
+     * A record and its key, in a single allocation.
+     */
+    int64_t key;
+    int64_t size;
+    bool referenced; //The CLOCK reference bit, set when the record is used.
+    char record[];
+} ShardedCacheRecord;
+
+typedef struct _shard {
+    pthread_mutex_t lock;
+    // Open addressing hash table with linear probing, empty slots are NULL.
+    ShardedCacheRecord **table;
+    int64_t tableSize; //A power of two.
+    int64_t length;
+    // The CLOCK hand, the index of the next slot of the table to consider for eviction.
+    int64_t hand;
+    // Current size of records (not including overhead) and this shard's share of the cache's maximum size.
+    size_t curSize;
+    size_t maxSize;
+    int64_t hits, misses, evictions, rejections;
+} Shard;
+
+struct stShardedCache {
+    Shard *shards;
+    int64_t shardNumber; //A power of two.
+};
+
+static uint64_t hashKey(int64_t key) {
+    /*
+     * The 64 bit finaliser of MurmurHash3, which spreads consecutive names over the shards and slots.
+     */
+    uint64_t h = key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static Shard *getShard(stShardedCache *cache, uint64_t hash) {
+    //The high bits pick the shard, the low bits the slot, so they are independent
+    return &cache->shards[(hash >> 32) & (cache->shardNumber - 1)];
+}
+
+static int64_t getSlot(Shard *shard, uint64_t hash) {
+    return hash & (shard->tableSize - 1);
+}
+
+/*
+ * Hash table functions, all called with the shard locked.
+ */
+
+static int64_t findSlot(Shard *shard, int64_t key, uint64_t hash) {
+    /*
+     * Returns the slot holding the record with the key, or the empty slot that ends its probe sequence.
+     */
+    int64_t i = getSlot(shard, hash);
+    while (shard->table[i] != NULL && shard->table[i]->key != key) {
+        i = (i + 1) & (shard->tableSize - 1);
+    }
+    return i;
+}
+
+static void insertIntoTable(ShardedCacheRecord **table, int64_t tableSize, ShardedCacheRecord *record) {
+    int64_t i = hashKey(record->key) & (tableSize - 1);
+    while (table[i] != NULL) {
+        i = (i + 1) & (tableSize - 1);
+    }
+    table[i] = record;
+}
+
+static void resizeTable(Shard *shard, int64_t tableSize) {
+    ShardedCacheRecord **table = st_calloc(tableSize, sizeof(ShardedCacheRecord *));
+    for (int64_t i = 0; i < shard->tableSize; i++) {
+        if (shard->table[i] != NULL) {
+            insertIntoTable(table, tableSize, shard->table[i]);
+        }
+    }
+    free(shard->table);
+    shard->table = table;
+    shard->tableSize = tableSize;
+    shard->hand = 0;
+}
+
+static void removeSlot(Shard *shard, int64_t i) {
+    /*
+     * Frees the record in the slot, then shifts back any records in the rest of the probe sequence
+     * that would no longer be found, so no tombstones are needed.
+     */
+    ShardedCacheRecord *record = shard->table[i];
+    assert(record != NULL);
+    assert(shard->curSize >= record->size);
+    shard->curSize -= record->size;
+    shard->length--;
+    free(record);
+    shard->table[i] = NULL;
+    int64_t mask = shard->tableSize - 1;
+    for (int64_t j = (i + 1) & mask; shard->table[j] != NULL; j = (j + 1) & mask) {
+        int64_t k = getSlot(shard, hashKey(shard->table[j]->key)); //The home slot of the record in j
+        //The record can move to the hole in i if i lies cyclically in [k, j)
+        if ((i <= j) ? (k <= i || k > j) : (k <= i && k > j)) {
+            shard->table[i] = shard->table[j];
+            shard->table[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+static void evict(Shard *shard, size_t size) {
+    /*
+     * Evicts records until there is space for a record of the given size. The hand sweeps the table,
+     * giving records that have been used since it last passed a second chance.
+     */
+    while (shard->length > 0 && shard->maxSize - shard->curSize < size) {
+        ShardedCacheRecord *record = shard->table[shard->hand];
+        if (record == NULL) {
+            shard->hand = (shard->hand + 1) & (shard->tableSize - 1);
+        } else if (record->referenced) {
+            record->referenced = 0;
+            shard->hand = (shard->hand + 1) & (shard->tableSize - 1);
+        } else {
+            //A record shifted back into the hand's slot is considered next
+            removeSlot(shard, shard->hand);
+            shard->evictions++;
+        }
+    }
+}
+
+static void clearShard(Shard *shard) {
+    for (int64_t i = 0; i < shard->tableSize; i++) {
+        free(shard->table[i]);
+        shard->table[i] = NULL;
+    }
+    shard->length = 0;
+    shard->curSize = 0;
+    shard->hand = 0;
+}
+
+static ShardedCacheRecord *getRecord(Shard *shard, int64_t key, uint64_t hash) {
+    /*
+     * Gets the record, marking it as used and counting the hit or miss.
+     */
+    ShardedCacheRecord *record = shard->table[findSlot(shard, key, hash)];
+    if (record != NULL) {
+        record->referenced = 1;
+        shard->hits++;
+    } else {
+        shard->misses++;
+    }
+    return record;
+}
+
+/*
+ * Public functions
+ */
+
+stShardedCache *stShardedCache_construct(size_t maxSize, int64_t shardNumber) {
+    stShardedCache *cache = st_malloc(sizeof(stShardedCache));
+    cache->shardNumber = 1;
+    while (cache->shardNumber < (shardNumber > 0 ? shardNumber : DEFAULT_SHARD_NUMBER)) {
+        cache->shardNumber *= 2;
+    }
+    cache->shards = st_calloc(cache->shardNumber, sizeof(Shard));
+    for (int64_t i = 0; i < cache->shardNumber; i++) {
+        Shard *shard = &cache->shards[i];
+        if (pthread_mutex_init(&shard->lock, NULL) != 0) {
+            st_errAbort("Could not initialise the lock of a cache shard");
+        }
+        shard->tableSize = MIN_TABLE_SIZE;
+        shard->table = st_calloc(shard->tableSize, sizeof(ShardedCacheRecord *));
+        shard->maxSize = maxSize / cache->shardNumber;
+    }
+    return cache;
+}
+
+stShardedCache *stShardedCache_construct2(void) {
+    return stShardedCache_construct(SIZE_MAX, 0);
+}
+
+void stShardedCache_destruct(stShardedCache *cache) {
+    for (int64_t i = 0; i < cache->shardNumber; i++) {
+        Shard *shard = &cache->shards[i];
+        clearShard(shard);
+        free(shard->table);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(cache->shards);
+    free(cache);
+}
+
+void stShardedCache_clear(stShardedCache *cache) {
+    for (int64_t i = 0; i < cache->shardNumber; i++) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        clearShard(shard);
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+bool stShardedCache_setRecord(stShardedCache *cache, int64_t key, const void *value, int64_t sizeInBytes) {
+    assert(value != NULL || sizeInBytes == 0);
+    assert(sizeInBytes >= 0);
+    uint64_t hash = hashKey(key);
+    Shard *shard = getShard(cache, hash);
+    //Make the record before taking the lock
+    ShardedCacheRecord *record = NULL;
+    if ((size_t) sizeInBytes <= shard->maxSize) {
+        record = st_malloc(sizeof(ShardedCacheRecord) + sizeInBytes);
+        record->key = key;
+        record->size = sizeInBytes;
+        record->referenced = 0;
+        memcpy(record->record, value, sizeInBytes);
+    }
+    pthread_mutex_lock(&shard->lock);
+    int64_t i = findSlot(shard, key, hash);
+    if (shard->table[i] != NULL) {
+        removeSlot(shard, i);
+    }
+    if (record == NULL) {
+        shard->rejections++;
+        pthread_mutex_unlock(&shard->lock);
+        return 0;
+    }
+    evict(shard, sizeInBytes);
+    if (2 * (shard->length + 1) > shard->tableSize) { //Keep the load at most a half, so probe sequences are short
+        resizeTable(shard, 2 * shard->tableSize);
+    }
+    insertIntoTable(shard->table, shard->tableSize, record);
+    shard->length++;
+    shard->curSize += sizeInBytes;
+    pthread_mutex_unlock(&shard->lock);
+    return 1;
+}
+
+bool stShardedCache_containsRecord(stShardedCache *cache, int64_t key) {
+    uint64_t hash = hashKey(key);
+    Shard *shard = getShard(cache, hash);
+    pthread_mutex_lock(&shard->lock);
+    bool contained = shard->table[findSlot(shard, key, hash)] != NULL;
+    pthread_mutex_unlock(&shard->lock);
+    return contained;
+}
+
+void *stShardedCache_getRecord(stShardedCache *cache, int64_t key, int64_t *recordSize) {
+    uint64_t hash = hashKey(key);
+    Shard *shard = getShard(cache, hash);
+    pthread_mutex_lock(&shard->lock);
+    ShardedCacheRecord *record = getRecord(shard, key, hash);
+    void *value = NULL;
+    if (record != NULL) {
+        value = memcpy(st_malloc(record->size), record->record, record->size);
+        *recordSize = record->size;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return value;
+}
+
+bool stShardedCache_applyToRecord(stShardedCache *cache, int64_t key,
+        void (*fn)(const void *record, int64_t recordSize, void *extraArg), void *extraArg) {
+    uint64_t hash = hashKey(key);
+    Shard *shard = getShard(cache, hash);
+    pthread_mutex_lock(&shard->lock);
+    ShardedCacheRecord *record = getRecord(shard, key, hash);
+    if (record != NULL) {
+        fn(record->record, record->size, extraArg);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return record != NULL;
+}
+
+void stShardedCache_removeRecord(stShardedCache *cache, int64_t key) {
+    uint64_t hash = hashKey(key);
+    Shard *shard = getShard(cache, hash);
+    pthread_mutex_lock(&shard->lock);
+    int64_t i = findSlot(shard, key, hash);
+    if (shard->table[i] != NULL) {
+        removeSlot(shard, i);
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+size_t stShardedCache_size(stShardedCache *cache) {
+    size_t size = 0;
+    for (int64_t i = 0; i < cache->shardNumber; i++) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        size += shard->curSize;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return size;
+}
+
+int64_t stShardedCache_length(stShardedCache *cache) {
+    int64_t length = 0;
+    for (int64_t i = 0; i < cache->shardNumber; i++) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        length += shard->length;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return length;
+}
+
+void stShardedCache_getCounters(stShardedCache *cache, int64_t *hits, int64_t *misses, int64_t *evictions,
+        int64_t *rejections) {
+    int64_t counters[4] = { 0, 0, 0, 0 };
+    for (int64_t i = 0; i < cache->shardNumber; i++) {
+        Shard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        counters[0] += shard->hits;
+        counters[1] += shard->misses;
+        counters[2] += shard->evictions;
+        counters[3] += shard->rejections;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    if (hits != NULL) {
+        *hits = counters[0];
+    }
+    if (misses != NULL) {
+        *misses = counters[1];
+    }
+    if (evictions != NULL) {
+        *evictions = counters[2];
+    }
+    if (rejections != NULL) {
+        *rejections = counters[3];
+    }
+}
@@ -75,6 +75,24 @@ static struct _stSortedSet_construct3Fn *stSortedSet_getComparator(stSortedSet *
     return (struct _stSortedSet_construct3Fn *)sortedSet->sortedSet->avl_param;
 }
 
+stSortedSet *stSortedSet_constructFromSortedList(stList *list, int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *)) {
+    stSortedSet *sortedSet = stSortedSet_construct3(compareFn, destructElementFn);
+    int64_t length = stList_length(list);
+    void **items = st_malloc(sizeof(void *) * (length > 0 ? length : 1));
+    for (int64_t i = 0; i < length; i++) {
+        items[i] = stList_get(list, i);
+        if (i > 0 && stSortedSet_getComparator(sortedSet)->compareFn(items[i - 1], items[i]) >= 0) {
+            free(items);
+            stSortedSet_destruct(sortedSet);
+            stThrowNew(SORTED_SET_EXCEPTION_ID, "the list to construct a sorted set from is not in strictly ascending order");
+        }
+    }
+    avl_build(sortedSet->sortedSet, items, length);
+    free(items);
+    return sortedSet;
+}
+
 stSortedSet *stSortedSet_copyConstruct(stSortedSet *sortedSet, void (*destructElementFn)(void *)) {
     stSortedSet *sortedSet2 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet)->compareFn, destructElementFn);
     stSortedSetIterator *it = stSortedSet_getIterator(sortedSet);
@@ -184,11 +184,12 @@ bool stThreadPool_done(stThreadPool *threadPool) {
 // queue will be unfinished.
 void stThreadPool_destruct(stThreadPool *threadPool) {
     // Wake all currently running threads so they know that they need
-    // to die.
+    // to die. The flag is set under the stack lock so that a thread
+    // can't check it and then miss the wake up.
+    pthread_mutex_lock(&threadPool->stackLock);
     threadPool->killFlag = true;
-    for (int64_t i = 0; i < threadPool->numThreads; i++) {
-        pthread_cond_signal(&threadPool->stackCond);
-    }
+    pthread_cond_broadcast(&threadPool->stackCond);
+    pthread_mutex_unlock(&threadPool->stackLock);
     // Ensure that all threads are dead before freeing the memory out
     // from under them.
     for (int64_t i = 0; i < threadPool->numThreads; i++) {
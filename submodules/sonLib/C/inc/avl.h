@@ -102,6 +102,7 @@ void *avl_delete (struct avl_table *, const void *);
 void *avl_find (const struct avl_table *, const void *);
 void avl_assert_insert (struct avl_table *, void *);
 void *avl_assert_delete (struct avl_table *, void *);
+void avl_build (struct avl_table *, void **, size_t);
 
 #define avl_count(table) ((size_t) (table)->avl_count)
 
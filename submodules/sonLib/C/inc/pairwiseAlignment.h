@@ -56,8 +56,104 @@ void checkPairwiseAlignment(struct PairwiseAlignment *pA);
 
 void cigarWrite(FILE *fileHandle, struct PairwiseAlignment *pA, int64_t writeProbs);
 
+/*
+ * Reads the next alignment from the file, or returns NULL at the end of the file. The file may hold text cigars,
+ * blocks of binary records written by a stPairwiseAlignmentWriter, or a mix of the two, which is detected as the file
+ * is read. Binary blocks of more than one record can only be read this way from seekable files; streams should be read
+ * with a stPairwiseAlignmentReader, which is also cheaper as it keeps no per file state.
+ */
 struct PairwiseAlignment *cigarRead(FILE *fileHandle);
 
+/*
+ * Binary alignment records.
+ *
+ * The records are written in blocks, each self contained, so that binary files can be concatenated, with each
+ * other or with text cigar files. A block is:
+ *
+ * The magic bytes "\0PAB", a version byte and a flags byte (bit 0 set if the operations carry scores),
+ * then as varints (unsigned LEB128) the number of records, the number of contigs and the length in bytes of
+ * the records. Then the contig table, each contig name a varint length followed by its characters, then the
+ * records. A record is a byte holding the strands (bit 0 strand1, bit 1 strand2), then as varints the contig
+ * index and start of the first sequence and the contig index and start of the second sequence, then the score
+ * as a little endian IEEE float, then the number of operations as a varint, then each operation as a varint of
+ * (length << 2 | opType), followed, if the block has scores, by the operation score as a little endian float.
+ * The ends are not stored, they are implied by the operations.
+ */
+
+typedef struct _stPairwiseAlignmentWriter stPairwiseAlignmentWriter;
+
+typedef struct _stPairwiseAlignmentReader stPairwiseAlignmentReader;
+
+/*
+ * Creates a writer of binary records to the given file, which it does not close. If writeProbs is true the scores
+ * of the operations are kept, as cigarWrite does.
+ */
+stPairwiseAlignmentWriter *stPairwiseAlignmentWriter_construct(FILE *fileHandle, bool writeProbs);
+
+/*
+ * Adds an alignment to the current block, writing the block out if it is full.
+ */
+void stPairwiseAlignmentWriter_write(stPairwiseAlignmentWriter *writer, struct PairwiseAlignment *pA);
+
+/*
+ * Writes out the current block, if it holds any records.
+ */
+void stPairwiseAlignmentWriter_flush(stPairwiseAlignmentWriter *writer);
+
+/*
+ * Flushes and frees the writer.
+ */
+void stPairwiseAlignmentWriter_destruct(stPairwiseAlignmentWriter *writer);
+
+/*
+ * Creates a reader of alignments from the given file, which it does not close. Text cigars and binary blocks are
+ * both read.
+ */
+stPairwiseAlignmentReader *stPairwiseAlignmentReader_construct(FILE *fileHandle);
+
+/*
+ * Returns the next alignment, or NULL at the end of the file.
+ */
+struct PairwiseAlignment *stPairwiseAlignmentReader_read(stPairwiseAlignmentReader *reader);
+
+void stPairwiseAlignmentReader_destruct(stPairwiseAlignmentReader *reader);
+
+/*
+ * Returns non-zero if the next alignment in the file is in a binary block, without consuming any of the file.
+ */
+bool stPairwiseAlignment_isBinary(FILE *fileHandle);
+
+/*
+ * Orders alignments by descending score, then by the name of the second contig.
+ */
+int stPairwiseAlignment_cmpByDescendingScore(const struct PairwiseAlignment *pA1, const struct PairwiseAlignment *pA2);
+
+/*
+ * Orders alignments by the name of the first contig, then by ascending start and end on it.
+ */
+int stPairwiseAlignment_cmpByFirstSequenceStart(const struct PairwiseAlignment *pA1, const struct PairwiseAlignment *pA2);
+
+/*
+ * Orders alignments by the name of the second contig, then by ascending start and end on it.
+ */
+int stPairwiseAlignment_cmpBySecondSequenceStart(const struct PairwiseAlignment *pA1, const struct PairwiseAlignment *pA2);
+
+/*
+ * Sorts the alignments in inputFile into outputFile with an external merge sort, keeping alignments that compare
+ * equal in the order of the input. If the input starts with a binary block the output is binary records, otherwise
+ * the input must be text cigars, and the output is the lines of the input, unchanged, in sorted order.
+ *
+ * Chunks of the input that fit in memoryBudget bytes, between them, are sorted on threadNumber threads and
+ * written as runs to temporary files in tempDir, or in $TMPDIR, or /tmp, if tempDir is NULL. The runs are then
+ * merged, in parallel passes if there are more than can be merged at once.
+ *
+ * If unique is non-zero, an alignment the same as an earlier one that compares equal to it is dropped, like piping
+ * the output through uniq, but without needing the duplicates to be adjacent.
+ */
+void stPairwiseAlignment_sortFile(const char *inputFile, const char *outputFile,
+        int (*cmpFn)(const struct PairwiseAlignment *, const struct PairwiseAlignment *),
+        int64_t memoryBudget, int64_t threadNumber, const char *tempDir, bool unique);
+
 #ifdef __cplusplus
 }
 #endif
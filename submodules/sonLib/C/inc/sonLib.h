@@ -29,6 +29,7 @@
 #include "sonLibCompression.h"
 #include "sonLibFile.h"
 #include "sonLibCache.h"
+#include "sonLibShardedCache.h"
 #include "stGraph.h"
 #include "stPosetAlignment.h"
 #include "sonLibTreap.h"
@@ -22,19 +22,62 @@ extern "C" {
 //The exception string
 extern const char *ST_COMPRESSION_EXCEPTION_ID;
 
+/*
+ * The codecs a record can be compressed with. The codec is tagged in the header of the compressed record,
+ * so stCompression_decompress can decompress a record compressed with any of them.
+ */
+typedef enum _stCompressionCodec {
+    ST_COMPRESSION_UNTAGGED = 0, //An lz4 record written before records were tagged, can only be decompressed.
+    ST_COMPRESSION_LZ4 = 1, //Very fast.
+    ST_COMPRESSION_LZ4HC = 2, //Slower to compress but smaller, and as fast to decompress.
+    ST_COMPRESSION_ZLIB = 3 //Slow, smallest.
+} stCompressionCodec;
+
 /*
  * Compresses the data and returns it. sizeInBytes in the size of the uncompressed data array, the pointer
- * compressedSizeInBytes is given the size of the compressed string. The level is a value between 0 and 10 giving the
- * degree of required compression. If -1 is given then the default level is used.
+ * compressedSizeInBytes is given the size of the compressed string. The data is compressed with lz4 whatever the level,
+ * which is kept for compatibility; use stCompression_compress2 for lz4hc or zlib.
  */
 void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level);
 
+/*
+ * As stCompression_compress, but with the given codec. The level is only used by zlib, -1 giving its fastest level.
+ */
+void *stCompression_compress2(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, stCompressionCodec codec,
+        int64_t level);
+
 /*
  * Decompresses the compressed data string of size compressedSizeInBytes, initialises the sizeInBytes point to the size
- * of the decompressed string.
+ * of the decompressed string. Records from stCompression_compress and stCompression_compress2 are accepted, whatever
+ * their codec, as are records from the older untagged format.
  */
 void *stCompression_decompress(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes);
 
+/*
+ * Returns the codec the record was compressed with.
+ */
+stCompressionCodec stCompression_getCodec(void *compressedData, int64_t compressedSizeInBytes);
+
+/*
+ * Returns the codec named "lz4", "lz4hc" or "zlib", or ST_COMPRESSION_UNTAGGED if the name is not recognised.
+ */
+stCompressionCodec stCompression_parseCodec(const char *name);
+
+/*
+ * Compresses each of the recordNumber records in data, whose sizes are in sizesInBytes, as stCompression_compress2,
+ * putting the compressed records in compressedData and their sizes in compressedSizesInBytes. Batches big enough to
+ * be worth it are split between threadNumber threads. If compressing any record throws an exception then none of
+ * the compressed records are returned and an ST_COMPRESSION_EXCEPTION_ID exception is thrown.
+ */
+void stCompression_compressBulk(void **data, int64_t *sizesInBytes, int64_t recordNumber, void **compressedData,
+        int64_t *compressedSizesInBytes, stCompressionCodec codec, int64_t level, int64_t threadNumber);
+
+/*
+ * The inverse of stCompression_compressBulk, as stCompression_decompress.
+ */
+void stCompression_decompressBulk(void **compressedData, int64_t *compressedSizesInBytes, int64_t recordNumber, void **data,
+        int64_t *sizesInBytes, int64_t threadNumber);
+
 /*
  * Uses Zlib.
  */
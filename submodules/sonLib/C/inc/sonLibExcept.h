@@ -159,7 +159,7 @@ struct _stExceptContext {
  * Exception content Top Of Stack.
  * (Internal structure, don't use directly)
  */
-extern struct _stExceptContext *_cexceptTOS;
+extern __thread struct _stExceptContext *_cexceptTOS;
 
 /// @defgroup CMacros C try/catch macros
 /// @ingroup stExceptions
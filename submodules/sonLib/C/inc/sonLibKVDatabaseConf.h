@@ -17,6 +17,7 @@ typedef enum {
     stKVDatabaseTypeKyotoTycoon,
     stKVDatabaseTypeMySql,
     stKVDatabaseTypeRedis,
+    stKVDatabaseTypeLogFile,
 } stKVDatabaseType;
 
 /* 
@@ -34,6 +35,13 @@ stKVDatabaseConf *stKVDatabaseConf_constructKyotoTycoon(const char *host, unsign
                                                         int64_t maxBulkSetNumRecords,
                                                         const char *databaseDir, const char* databaseName);
 
+/*
+ * Construct a new database configuration object for an embedded log
+ * structured database, kept in a single file in the given directory.
+ * It needs no server, and may be shared by several processes.
+ */
+stKVDatabaseConf *stKVDatabaseConf_constructLogFile(const char *databaseDir);
+
 /* 
  * Construct a new database configuration object for a Kyoto Tycoon
  * database remote object.
@@ -52,11 +60,12 @@ stKVDatabaseConf *stKVDatabaseConf_constructMySql(const char *host, unsigned por
  * Decodes a simple piece of XML, structured as follows:
  * <st_kv_database_conf type="TYPE">
  *      <tokyo_cabinet database_dir=""/>
+ *      <log_file database_dir=""/>
  *      <mysql host="" port="" user="" password="" database_name="" table_name=""/>
  *      <kyoto_cabinet host="" port=""/>
  * </st_kv_database_conf>
  *
- * Type can be "tokyo_cabinet", "mysql", or "kyoto_cabinet". If it is of that type then
+ * Type can be "tokyo_cabinet", "log_file", "mysql", or "kyoto_cabinet". If it is of that type then
  * you need to include a nested tag with the parameters for that conf constructor.
  * The labels for the nested tag are name value pairs (no order assumed) for the conf constructor
  * (see above).  The port is optional.
@@ -30,6 +30,19 @@ extern const char *RANDOM_EXCEPTION_ID;
  */
 void st_randomSeed(int64_t seed);
 
+/*
+ * Gives the calling thread its own random number stream, started from the given seed, which is used
+ * by the functions below in place of the shared generator. Calling this again restarts the stream.
+ * Results computed by a thread therefore do not depend on how other threads are scheduled.
+ */
+void st_randomSeedThread(int64_t seed);
+
+/*
+ * Returns the calling thread to the shared generator seeded by st_randomSeed, ending the stream given by
+ * st_randomSeedThread.
+ */
+void st_randomUnseedThread(void);
+
 /*
  * Returns a random value in the range min (inclusive) to max (exclusive), where min < max.
  */
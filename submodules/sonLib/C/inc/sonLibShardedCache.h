@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef SONLIB_SHARDED_CACHE_H_
+#define SONLIB_SHARDED_CACHE_H_
+
+#include "sonLibTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Sharded cache functions
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * A size bounded cache of whole records, keyed by integer. Unlike stCache it does not hold record
+ * fragments. The keys are hashed across a number of shards, each an open addressing hash table with its
+ * own lock and its own share of the size bound, so the cache can be used concurrently by multiple threads.
+ * When a shard is full records are evicted using the CLOCK (second chance) approximation of LRU.
+ */
+
+/*
+ * Create an empty cache holding up to maxSize bytes of records (overhead is not counted toward the size),
+ * split evenly between the given number of shards, which is rounded up to a power of two. If shardNumber
+ * is zero or less a default number of shards is used. A record bigger than a shard's share of maxSize is
+ * not admitted to the cache.
+ */
+stShardedCache *stShardedCache_construct(size_t maxSize, int64_t shardNumber);
+
+/*
+ * Create an empty cache of unbounded size, with the default number of shards.
+ */
+stShardedCache *stShardedCache_construct2(void);
+
+/*
+ * Destructs the cache.
+ */
+void stShardedCache_destruct(stShardedCache *cache);
+
+/*
+ * Clears the cache. The counters are not reset.
+ */
+void stShardedCache_clear(stShardedCache *cache);
+
+/*
+ * Puts a copy of the record in the cache, replacing any existing record with the key. Returns non-zero
+ * if the record was admitted, zero if it is too big for the cache (in which case any existing record
+ * with the key is removed).
+ */
+bool stShardedCache_setRecord(stShardedCache *cache, int64_t key, const void *value, int64_t sizeInBytes);
+
+/*
+ * Returns non-zero if the cache contains a record with the given key. Does not count as a use of the record.
+ */
+bool stShardedCache_containsRecord(stShardedCache *cache, int64_t key);
+
+/*
+ * Returns a copy of the record with the given key, or NULL if it is not in the cache, initialising recordSize
+ * with the size of the record.
+ */
+void *stShardedCache_getRecord(stShardedCache *cache, int64_t key, int64_t *recordSize);
+
+/*
+ * Calls fn with the record with the given key, without copying it, returning non-zero if the record was in
+ * the cache. The record's shard is locked while fn runs, so fn must not use the cache itself and should be quick.
+ */
+bool stShardedCache_applyToRecord(stShardedCache *cache, int64_t key,
+        void (*fn)(const void *record, int64_t recordSize, void *extraArg), void *extraArg);
+
+/*
+ * Removes the record with the given key from the cache, if present.
+ */
+void stShardedCache_removeRecord(stShardedCache *cache, int64_t key);
+
+/*
+ * Gets the total size of the records in the cache.
+ */
+size_t stShardedCache_size(stShardedCache *cache);
+
+/*
+ * Gets the number of records in the cache.
+ */
+int64_t stShardedCache_length(stShardedCache *cache);
+
+/*
+ * Gets the counters of the cache: the number of gets (and applies) that found their record, the number that
+ * did not, the number of records evicted to make space and the number of records too big to be admitted.
+ * Any of the arguments may be NULL.
+ */
+void stShardedCache_getCounters(stShardedCache *cache, int64_t *hits, int64_t *misses, int64_t *evictions,
+        int64_t *rejections);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
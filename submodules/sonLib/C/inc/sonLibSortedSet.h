@@ -43,6 +43,14 @@ stSortedSet *stSortedSet_construct2(void (*destructElementFn)(void *));
 stSortedSet *stSortedSet_construct3(int (*compareFn)(const void *, const void *),
                                       void (*destructElementFn)(void *));
 
+/*
+ * Constructs a sorted set from the items of the given list, which must be in strictly ascending order
+ * according to compareFn, in time linear in the length of the list. Throws an exception if the list is
+ * not in order.
+ */
+stSortedSet *stSortedSet_constructFromSortedList(stList *list, int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *));
+
 /*
  * Clones the given sorted set, setting the element destructor to the given function.
  */
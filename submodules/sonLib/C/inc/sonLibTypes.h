@@ -44,6 +44,7 @@ typedef int64_t stIntTuple;
 typedef double stDoubleTuple;
 typedef struct stExcept stExcept;
 typedef struct stCache stCache;
+typedef struct stShardedCache stShardedCache;
 typedef struct stKVDatabase stKVDatabase;
 typedef struct stKVDatabaseConf stKVDatabaseConf;
 typedef struct stKVDatabaseBulkRequest stKVDatabaseBulkRequest;
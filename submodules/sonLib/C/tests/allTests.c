@@ -20,6 +20,7 @@ CuSuite* sonLib_stRandomTestSuite(void);
 CuSuite* sonLib_stCompressionTestSuite(void);
 CuSuite* sonLibFileTestSuite(void);
 CuSuite* stCacheSuite(void);
+CuSuite* stShardedCacheSuite(void);
 CuSuite* stPosetAlignmentTestSuite(void);
 CuSuite* sonLibGraphTestSuite(void);
 CuSuite* sonLib_stConnectivityTestSuite(void);
@@ -30,6 +31,7 @@ CuSuite* sonLib_stMatrixTestSuite(void);
 CuSuite* sonLib_stPhylogenyTestSuite(void);
 CuSuite* sonLib_stThreadPoolTestSuite(void);
 CuSuite* sonLib_stUnionFindTestSuite(void);
+CuSuite* sonLib_pairwiseAlignmentTestSuite(void);
 
 int sonLibRunAllTests(void) {
     CuString *output = CuStringNew();
@@ -57,7 +59,9 @@ int sonLibRunAllTests(void) {
     CuSuiteAddSuite(suite, sonLib_stCompressionTestSuite());
     CuSuiteAddSuite(suite, sonLibFileTestSuite());
     CuSuiteAddSuite(suite, stCacheSuite());
+    CuSuiteAddSuite(suite, stShardedCacheSuite());
     CuSuiteAddSuite(suite, sonLib_stUnionFindTestSuite());
+    CuSuiteAddSuite(suite, sonLib_pairwiseAlignmentTestSuite());
     CuSuiteRun(suite);
     CuSuiteSummary(suite, output);
     CuSuiteDetails(suite, output);
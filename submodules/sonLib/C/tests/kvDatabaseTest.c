@@ -575,6 +575,75 @@ static void test_stKVDatabaseConf_constructFromString_tokyoCabinet(CuTest *testC
     stKVDatabaseConf_destruct(conf);
 }
 
+static void test_stKVDatabaseConf_constructFromString_logFile(CuTest *testCase) {
+    const char *xmlTestString =
+            "<st_kv_database_conf type='log_file'><log_file database_dir='foo'/></st_kv_database_conf>";
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(xmlTestString);
+    CuAssertTrue(testCase, stKVDatabaseConf_getType(conf) == stKVDatabaseTypeLogFile);
+    CuAssertStrEquals(testCase, "foo", stKVDatabaseConf_getDir(conf));
+    stKVDatabaseConf_destruct(conf);
+}
+
+static void checkLogFileRecords(CuTest *testCase, stKVDatabase *database, int64_t numRecords) {
+    CuAssertIntEquals(testCase, numRecords, stKVDatabase_getNumberOfRecords(database));
+    for (int64_t i = 0; i < numRecords; i++) {
+        CuAssertIntEquals(testCase, 3 * i, stKVDatabase_getInt64(database, i));
+    }
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, numRecords));
+}
+
+/*
+ * Tests the recovery and sharing of the embedded log file database, which keeps its
+ * records in a single append only file.
+ */
+static void testLogFileRecoveryAndSharing(CuTest *testCase) {
+    if (stKVDatabaseConf_getType(conf) != stKVDatabaseTypeLogFile) {
+        return;
+    }
+    setup();
+    for (int64_t i = 0; i < 100; i++) {
+        stKVDatabase_insertInt64(database, i, 3 * i);
+    }
+    stKVDatabase_removeRecord(database, 100 - 1);
+    stKVDatabase_insertInt64(database, 100 - 1, 3 * (100 - 1));
+
+    //Reopening uses the index written on closing
+    stKVDatabase_destruct(database);
+    database = stKVDatabase_construct(conf, false);
+    checkLogFileRecords(testCase, database, 100);
+
+    //A torn record at the end of the log, as left by a crash, is dropped
+    stKVDatabase_insertInt64(database, 100, 300);
+    stKVDatabase_destruct(database);
+    char *logPath = stString_print("%s/data.log", stKVDatabaseConf_getDir(conf));
+    FILE *fileHandle = fopen(logPath, "ab");
+    CuAssertTrue(testCase, fileHandle != NULL);
+    fwrite("torn", sizeof(char), 4, fileHandle);
+    fclose(fileHandle);
+    free(logPath);
+    database = stKVDatabase_construct(conf, false);
+    checkLogFileRecords(testCase, database, 101);
+    stKVDatabase_insertInt64(database, 101, 303);
+
+    //A second handle sees the writes of the first, and vice versa
+    stKVDatabase *database2 = stKVDatabase_construct(conf, false);
+    checkLogFileRecords(testCase, database2, 102);
+    stKVDatabase_insertInt64(database, 102, 306);
+    CuAssertIntEquals(testCase, 306, stKVDatabase_getInt64(database2, 102));
+    stList *requests = stList_construct3(0, (void(*)(void *)) stKVDatabaseBulkRequest_destruct);
+    int64_t i = 309, j = 312;
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(103, &i, sizeof(int64_t)));
+    stList_append(requests, stKVDatabaseBulkRequest_constructSetRequest(104, &j, sizeof(int64_t)));
+    stKVDatabase_bulkSetRecords(database2, requests);
+    stList_destruct(requests);
+    CuAssertIntEquals(testCase, 309, stKVDatabase_getInt64(database, 103));
+    stKVDatabase_insertInt64(database, 105, 315);
+    checkLogFileRecords(testCase, database2, 106);
+    stKVDatabase_destruct(database2);
+    checkLogFileRecords(testCase, database, 106);
+    teardown();
+}
+
 static void test_stKVDatabaseConf_constructFromString_mysql(CuTest *testCase) {
 #ifdef HAVE_MYSQL
     const char *xmlTestString =
@@ -605,7 +674,9 @@ static CuSuite* stKVDatabaseTestSuite(void) {
     SUITE_ADD_TEST(suite, testBulkGetRecords);
     SUITE_ADD_TEST(suite, constructDestructAndDelete);
     SUITE_ADD_TEST(suite, test_stKVDatabaseConf_constructFromString_tokyoCabinet);
+    SUITE_ADD_TEST(suite, test_stKVDatabaseConf_constructFromString_logFile);
     SUITE_ADD_TEST(suite, test_stKVDatabaseConf_constructFromString_mysql);
+    SUITE_ADD_TEST(suite, testLogFileRecoveryAndSharing);
     SUITE_ADD_TEST(suite, testIncrementRecord);
     return suite;
 }
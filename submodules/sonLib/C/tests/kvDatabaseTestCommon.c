@@ -17,9 +17,9 @@ static void usage(const char *desc) {
     static const char *help = 
         "Options:\n"
         "\n"
-        "-t --type=dbtype - one of 'KyotoTycoon', 'TokyoCabinet' or 'MySql'.\n"
+        "-t --type=dbtype - one of 'KyotoTycoon', 'TokyoCabinet', 'LogFile' or 'MySql'.\n"
         "    Values area case-insensitive, defaults to TokyoCabinet.\n"
-        "-d --db=database - database directory for TokyoCabinet or database name\n"
+        "-d --db=database - database directory for TokyoCabinet and LogFile or database name\n"
         "    for SQL databases. Defaults to testTCDatabase for TokyoCabinet,\n"
         "    SQL databases must specify.\n"
         "--host=host - Tycoon or SQL database host, defaults to localhost\n"
@@ -34,6 +34,8 @@ static void usage(const char *desc) {
 static stKVDatabaseType parseDbType(const char *dbTypeStr) {
     if (stString_eqcase(dbTypeStr, "TokyoCabinet")) {
         return stKVDatabaseTypeTokyoCabinet;
+    } else if (stString_eqcase(dbTypeStr, "LogFile")) {
+        return stKVDatabaseTypeLogFile;
     } else if (stString_eqcase(dbTypeStr, "KyotoTycoon")) {
         return stKVDatabaseTypeKyotoTycoon;
     } else if (stString_eqcase(dbTypeStr, "MySql")) {
@@ -137,6 +139,9 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
     if (optType == stKVDatabaseTypeTokyoCabinet) {
         conf = stKVDatabaseConf_constructTokyoCabinet(optDb);
         fprintf(stderr, "running Tokyo Cabinet sonLibKVDatabase tests\n");
+    } else if (optType == stKVDatabaseTypeLogFile) {
+        conf = stKVDatabaseConf_constructLogFile(optDb);
+        fprintf(stderr, "running log file sonLibKVDatabase tests\n");
     } else if (optType == stKVDatabaseTypeKyotoTycoon) {
         conf = stKVDatabaseConf_constructKyotoTycoon(optHost, optPort, optTimeout,
         		optMaxKTRecordSize, optMaxKTBulkSetSize, optMaxKTBulkSetNumRecords, optDb, optName);
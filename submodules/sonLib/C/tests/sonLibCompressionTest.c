@@ -78,11 +78,114 @@ static void test_stCompression_compressAndDecompress_Big_Zlib(CuTest *testCase)
     test_stCompression_compressAndDecompressP(testCase, 5, 10000000, 50000000, stCompression_compressZlib, stCompression_decompressZlib);
 }
 
+static stCompressionCodec codec;
+
+static void *compressWithCodec(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
+    void *compressedData = stCompression_compress2(data, sizeInBytes, compressedSizeInBytes, codec, level);
+    assert(stCompression_getCodec(compressedData, *compressedSizeInBytes) == codec);
+    return compressedData;
+}
+
+/*
+ * Round trips with each codec, including empty strings.
+ */
+static void test_stCompression_codecs(CuTest *testCase) {
+    stCompressionCodec codecs[] = { ST_COMPRESSION_LZ4, ST_COMPRESSION_LZ4HC, ST_COMPRESSION_ZLIB };
+    for (int64_t i = 0; i < 3; i++) {
+        codec = codecs[i];
+        test_stCompression_compressAndDecompressP(testCase, 100, 0, 5000, compressWithCodec, stCompression_decompress);
+    }
+    CuAssertIntEquals(testCase, ST_COMPRESSION_LZ4, stCompression_parseCodec("lz4"));
+    CuAssertIntEquals(testCase, ST_COMPRESSION_LZ4HC, stCompression_parseCodec("lz4hc"));
+    CuAssertIntEquals(testCase, ST_COMPRESSION_ZLIB, stCompression_parseCodec("zlib"));
+    CuAssertIntEquals(testCase, ST_COMPRESSION_UNTAGGED, stCompression_parseCodec("gzip"));
+}
+
+/*
+ * Records written before the codec was tagged can still be decompressed.
+ */
+static void test_stCompression_untagged(CuTest *testCase) {
+    char record[] = { 0, 0x50, 'h', 'e', 'l', 'l', 'o' }; //A final chunk, holding an lz4 block of 5 literals
+    CuAssertIntEquals(testCase, ST_COMPRESSION_UNTAGGED, stCompression_getCodec(record, sizeof(record)));
+    int64_t size;
+    char *string = stCompression_decompress(record, sizeof(record), &size);
+    CuAssertIntEquals(testCase, 5, size);
+    CuAssertTrue(testCase, memcmp(string, "hello", 5) == 0);
+    free(string);
+}
+
+static void testCorruptBatch(CuTest *testCase, void **compressedRecords, int64_t *compressedSizes, int64_t recordNumber,
+        void **records2, int64_t *sizes2, int64_t threadNumber, int64_t *sizes) {
+    /*
+     * Truncating a record makes the whole batch fail, unless the record is empty.
+     */
+    int64_t i = st_randomInt(0, recordNumber);
+    compressedSizes[i] = 11;
+    stTry {
+        stCompression_decompressBulk(compressedRecords, compressedSizes, recordNumber, records2, sizes2, threadNumber);
+        CuAssertTrue(testCase, sizes[i] == 0);
+    } stCatch(except) {
+        CuAssertStrEquals(testCase, ST_COMPRESSION_EXCEPTION_ID, stExcept_getId(except));
+        for (int64_t j = 0; j < recordNumber; j++) {
+            CuAssertTrue(testCase, records2[j] == NULL);
+        }
+    } stTryEnd;
+}
+
+static void test_stCompression_bulk(CuTest *testCase) {
+    for (int64_t test = 0; test < 10; test++) {
+        int64_t recordNumber = st_randomInt(0, 200), threadNumber = st_randomInt(1, 5);
+        codec = st_randomInt(ST_COMPRESSION_LZ4, ST_COMPRESSION_ZLIB + 1);
+        void **records = st_malloc(sizeof(void *) * recordNumber);
+        void **compressedRecords = st_malloc(sizeof(void *) * recordNumber);
+        void **records2 = st_malloc(sizeof(void *) * recordNumber);
+        int64_t *sizes = st_malloc(sizeof(int64_t) * recordNumber);
+        int64_t *compressedSizes = st_malloc(sizeof(int64_t) * recordNumber);
+        int64_t *sizes2 = st_malloc(sizeof(int64_t) * recordNumber);
+        for (int64_t i = 0; i < recordNumber; i++) {
+            sizes[i] = st_randomInt(0, 10000);
+            records[i] = st_malloc(sizes[i]);
+            for (int64_t j = 0; j < sizes[i]; j++) {
+                ((char *) records[i])[j] = (char) st_randomInt(0, 4);
+            }
+        }
+        stCompression_compressBulk(records, sizes, recordNumber, compressedRecords, compressedSizes, codec, -1, threadNumber);
+        stCompression_decompressBulk(compressedRecords, compressedSizes, recordNumber, records2, sizes2, threadNumber);
+        for (int64_t i = 0; i < recordNumber; i++) {
+            CuAssertIntEquals(testCase, codec, stCompression_getCodec(compressedRecords[i], compressedSizes[i]));
+            CuAssertIntEquals(testCase, sizes[i], sizes2[i]);
+            CuAssertTrue(testCase, memcmp(records[i], records2[i], sizes[i]) == 0);
+        }
+
+        if (recordNumber > 0 && codec != ST_COMPRESSION_ZLIB) {
+            for (int64_t i = 0; i < recordNumber; i++) {
+                free(records2[i]);
+            }
+            testCorruptBatch(testCase, compressedRecords, compressedSizes, recordNumber, records2, sizes2, threadNumber,
+                    sizes);
+        }
+        for (int64_t i = 0; i < recordNumber; i++) {
+            free(records[i]);
+            free(compressedRecords[i]);
+            free(records2[i]);
+        }
+        free(records);
+        free(compressedRecords);
+        free(records2);
+        free(sizes);
+        free(compressedSizes);
+        free(sizes2);
+    }
+}
+
 CuSuite* sonLib_stCompressionTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Lots);
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Big);
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Lots_Zlib);
         SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Big_Zlib);
+    SUITE_ADD_TEST(suite, test_stCompression_codecs);
+    SUITE_ADD_TEST(suite, test_stCompression_untagged);
+    SUITE_ADD_TEST(suite, test_stCompression_bulk);
     return suite;
 }
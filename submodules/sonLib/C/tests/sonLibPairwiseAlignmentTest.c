@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#define _POSIX_C_SOURCE 200809L //For mkstemp
+
+#include "sonLibGlobalsTest.h"
+#include <unistd.h>
+#include "pairwiseAlignment.h"
+
+static struct PairwiseAlignment *getRandomPairwiseAlignment(bool withProbs) {
+    char *contig1 = stString_print("contig%" PRIi64 "", st_randomInt64(0, 10));
+    char *contig2 = stString_print("otherContig%" PRIi64 "", st_randomInt64(0, 10));
+    int64_t strand1 = st_random() > 0.5, strand2 = st_random() > 0.5;
+    int64_t start1 = st_randomInt64(0, 1000000), start2 = st_randomInt64(0, 1000000);
+    int64_t end1 = start1, end2 = start2;
+    struct List *operationList = constructEmptyList(0, (void (*)(void *))destructAlignmentOperation);
+    int64_t operationNumber = st_randomInt64(0, 20);
+    for (int64_t i = 0; i < operationNumber; i++) {
+        int64_t type = st_randomInt64(0, 3);
+        //Lengths of several bytes as varints
+        int64_t length = st_random() > 0.9 ? st_randomInt64(0, 100000) : st_randomInt64(0, 100);
+        if (type != PAIRWISE_INDEL_Y) {
+            end1 += length;
+        }
+        if (type != PAIRWISE_INDEL_X) {
+            end2 += length;
+        }
+        listAppend(operationList, constructAlignmentOperation(type, length, withProbs ? st_random() : 0.0));
+    }
+    struct PairwiseAlignment *pA = constructPairwiseAlignment(contig1, strand1 ? start1 : end1, strand1 ? end1 : start1,
+            strand1, contig2, strand2 ? start2 : end2, strand2 ? end2 : start2, strand2,
+            st_randomInt64(0, 100000) / 8.0, operationList);
+    free(contig1);
+    free(contig2);
+    return pA;
+}
+
+static void checkEqual(CuTest *testCase, struct PairwiseAlignment *pA, struct PairwiseAlignment *pA2) {
+    CuAssertPtrNotNull(testCase, pA2);
+    CuAssertStrEquals(testCase, pA->contig1, pA2->contig1);
+    CuAssertIntEquals(testCase, pA->start1, pA2->start1);
+    CuAssertIntEquals(testCase, pA->end1, pA2->end1);
+    CuAssertIntEquals(testCase, pA->strand1, pA2->strand1);
+    CuAssertStrEquals(testCase, pA->contig2, pA2->contig2);
+    CuAssertIntEquals(testCase, pA->start2, pA2->start2);
+    CuAssertIntEquals(testCase, pA->end2, pA2->end2);
+    CuAssertIntEquals(testCase, pA->strand2, pA2->strand2);
+    CuAssertDblEquals(testCase, pA->score, pA2->score, 0.0);
+    CuAssertIntEquals(testCase, pA->operationList->length, pA2->operationList->length);
+    for (int64_t i = 0; i < pA->operationList->length; i++) {
+        struct AlignmentOperation *oP = pA->operationList->list[i], *oP2 = pA2->operationList->list[i];
+        CuAssertIntEquals(testCase, oP->opType, oP2->opType);
+        CuAssertIntEquals(testCase, oP->length, oP2->length);
+        CuAssertDblEquals(testCase, oP->score, oP2->score, 0.0);
+    }
+}
+
+static stList *getRandomPairwiseAlignments(int64_t alignmentNumber, bool withProbs) {
+    stList *alignments = stList_construct3(0, (void (*)(void *))destructPairwiseAlignment);
+    for (int64_t i = 0; i < alignmentNumber; i++) {
+        stList_append(alignments, getRandomPairwiseAlignment(withProbs));
+    }
+    return alignments;
+}
+
+static void test_pairwiseAlignment_binaryRoundTrip(CuTest *testCase) {
+    /*
+     * Writes random alignments as a mix of text cigars and binary blocks, and checks they are read back the same by
+     * both cigarRead and a reader.
+     */
+    for (int64_t test = 0; test < 20; test++) {
+        bool withProbs = st_random() > 0.5;
+        //Enough alignments, some of the time, to need more than one block
+        stList *alignments = getRandomPairwiseAlignments(st_random() > 0.8 ? st_randomInt64(4000, 10000) : st_randomInt64(0, 100),
+                withProbs);
+        FILE *fileHandle = tmpfile();
+        stPairwiseAlignmentWriter *writer = stPairwiseAlignmentWriter_construct(fileHandle, withProbs);
+        for (int64_t i = 0; i < stList_length(alignments); i++) {
+            if (st_random() > 0.9) { //Switch to text for a record
+                stPairwiseAlignmentWriter_flush(writer);
+                cigarWrite(fileHandle, stList_get(alignments, i), withProbs);
+            } else {
+                stPairwiseAlignmentWriter_write(writer, stList_get(alignments, i));
+            }
+        }
+        stPairwiseAlignmentWriter_destruct(writer);
+
+        //The text cigars hold the scores to a fixed number of decimal places
+        if (withProbs) {
+            rewind(fileHandle);
+            for (int64_t i = 0; i < stList_length(alignments); i++) {
+                struct PairwiseAlignment *pA = cigarRead(fileHandle);
+                struct PairwiseAlignment *pA2 = stList_get(alignments, i);
+                for (int64_t j = 0; j < pA->operationList->length; j++) {
+                    ((struct AlignmentOperation *) pA2->operationList->list[j])->score =
+                            ((struct AlignmentOperation *) pA->operationList->list[j])->score;
+                }
+                destructPairwiseAlignment(pA);
+            }
+        }
+
+        rewind(fileHandle);
+        for (int64_t i = 0; i < stList_length(alignments); i++) {
+            struct PairwiseAlignment *pA = cigarRead(fileHandle);
+            checkEqual(testCase, stList_get(alignments, i), pA);
+            destructPairwiseAlignment(pA);
+        }
+        CuAssertPtrEquals(testCase, NULL, cigarRead(fileHandle));
+
+        rewind(fileHandle);
+        stPairwiseAlignmentReader *reader = stPairwiseAlignmentReader_construct(fileHandle);
+        for (int64_t i = 0; i < stList_length(alignments); i++) {
+            struct PairwiseAlignment *pA = stPairwiseAlignmentReader_read(reader);
+            checkEqual(testCase, stList_get(alignments, i), pA);
+            destructPairwiseAlignment(pA);
+        }
+        CuAssertPtrEquals(testCase, NULL, stPairwiseAlignmentReader_read(reader));
+        stPairwiseAlignmentReader_destruct(reader);
+
+        fclose(fileHandle);
+        stList_destruct(alignments);
+    }
+}
+
+static void test_pairwiseAlignment_binaryRewind(CuTest *testCase) {
+    /*
+     * Checks that cigarRead starts again from the beginning of a binary file rewound part way through a block.
+     */
+    stList *alignments = getRandomPairwiseAlignments(100, 0);
+    FILE *fileHandle = tmpfile();
+    CuAssertTrue(testCase, !stPairwiseAlignment_isBinary(fileHandle));
+    stPairwiseAlignmentWriter *writer = stPairwiseAlignmentWriter_construct(fileHandle, 0);
+    for (int64_t i = 0; i < stList_length(alignments); i++) {
+        stPairwiseAlignmentWriter_write(writer, stList_get(alignments, i));
+    }
+    stPairwiseAlignmentWriter_destruct(writer);
+    rewind(fileHandle);
+    CuAssertTrue(testCase, stPairwiseAlignment_isBinary(fileHandle));
+    for (int64_t test = 0; test < 3; test++) {
+        int64_t alignmentNumber = test < 2 ? st_randomInt64(1, stList_length(alignments)) : stList_length(alignments);
+        for (int64_t i = 0; i < alignmentNumber; i++) {
+            struct PairwiseAlignment *pA = cigarRead(fileHandle);
+            checkEqual(testCase, stList_get(alignments, i), pA);
+            destructPairwiseAlignment(pA);
+        }
+        fseek(fileHandle, 0, SEEK_SET);
+    }
+    fclose(fileHandle);
+    stList_destruct(alignments);
+}
+
+static FILE *writeBinaryTmpfile(stList *alignments) {
+    FILE *fileHandle = tmpfile();
+    stPairwiseAlignmentWriter *writer = stPairwiseAlignmentWriter_construct(fileHandle, 0);
+    for (int64_t i = 0; i < stList_length(alignments); i++) {
+        stPairwiseAlignmentWriter_write(writer, stList_get(alignments, i));
+    }
+    stPairwiseAlignmentWriter_destruct(writer);
+    rewind(fileHandle);
+    return fileHandle;
+}
+
+static void test_pairwiseAlignment_binaryClosedMidBlock(CuTest *testCase) {
+    /*
+     * Checks that a file closed part way through a block does not leave its records to the next file cigarRead is
+     * given, which may well reuse the same handle.
+     */
+    for (int64_t test = 0; test < 10; test++) {
+        stList *alignments = getRandomPairwiseAlignments(100, 0);
+        stList *alignments2 = getRandomPairwiseAlignments(st_randomInt64(1, 100), 0);
+        FILE *fileHandle = writeBinaryTmpfile(alignments);
+        for (int64_t i = 0, j = st_randomInt64(1, stList_length(alignments)); i < j; i++) {
+            destructPairwiseAlignment(cigarRead(fileHandle));
+        }
+        fclose(fileHandle);
+        fileHandle = writeBinaryTmpfile(alignments2);
+        for (int64_t i = 0; i < stList_length(alignments2); i++) {
+            struct PairwiseAlignment *pA = cigarRead(fileHandle);
+            checkEqual(testCase, stList_get(alignments2, i), pA);
+            destructPairwiseAlignment(pA);
+        }
+        CuAssertPtrEquals(testCase, NULL, cigarRead(fileHandle));
+        fclose(fileHandle);
+        stList_destruct(alignments);
+        stList_destruct(alignments2);
+    }
+}
+
+static int (*sortCmpFn)(const struct PairwiseAlignment *, const struct PairwiseAlignment *);
+
+static stHash *inputOrder; //Alignments to their position in the input, plus one
+
+static int cmpByInputOrder(const void *a, const void *b) {
+    //Ties broken by the position in the input, to give the stable order
+    int i = sortCmpFn(a, b);
+    return i != 0 ? i : (stHash_search(inputOrder, (void *) a) < stHash_search(inputOrder, (void *) b) ? -1 : 1);
+}
+
+static void test_pairwiseAlignment_sortFile(CuTest *testCase) {
+    /*
+     * Sorts random alignments with budgets that give one chunk, a few runs and, with more than can be merged at once,
+     * several passes of merging, and checks the order is that of a stable sort. With unique, copies of earlier
+     * alignments are added to the input, and must be dropped.
+     */
+    int (*cmpFns[])(const struct PairwiseAlignment *, const struct PairwiseAlignment *) = {
+            stPairwiseAlignment_cmpByFirstSequenceStart, stPairwiseAlignment_cmpByDescendingScore,
+            stPairwiseAlignment_cmpBySecondSequenceStart };
+    for (int64_t test = 0; test < 24; test++) {
+        bool binary = test % 2;
+        bool unique = test >= 12;
+        sortCmpFn = cmpFns[(test / 2) % 3];
+        int64_t memoryBudget = test % 12 < 4 ? 1000000000 : (test % 12 < 8 ? 100000 : 1000);
+        int64_t threadNumber = st_randomInt64(1, 4);
+        stList *alignments = getRandomPairwiseAlignments(st_randomInt64(0, 500), binary);
+        for (int64_t i = 0; i < stList_length(alignments); i++) { //Give some ties
+            struct PairwiseAlignment *pA = stList_get(alignments, i);
+            pA->score = st_randomInt64(0, 5);
+        }
+
+        char *inputFile = stString_print("%s/sonLibPairwiseAlignmentTest_XXXXXX", getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp");
+        close(mkstemp(inputFile));
+        char *outputFile = stString_print("%s.sorted", inputFile);
+        FILE *fileHandle = fopen(inputFile, "w");
+        stPairwiseAlignmentWriter *writer = binary ? stPairwiseAlignmentWriter_construct(fileHandle, 1) : NULL;
+        for (int64_t i = 0; i < stList_length(alignments); i++) {
+            int64_t copies = unique ? st_randomInt64(1, 3) : 1;
+            for (int64_t j = 0; j < copies; j++) { //Later copies are of a random alignment written before
+                struct PairwiseAlignment *pA = stList_get(alignments, j == 0 ? i : st_randomInt64(0, i + 1));
+                if (binary) {
+                    stPairwiseAlignmentWriter_write(writer, pA);
+                } else {
+                    cigarWrite(fileHandle, pA, 0);
+                }
+            }
+        }
+        if (binary) {
+            stPairwiseAlignmentWriter_destruct(writer);
+        }
+        fclose(fileHandle);
+
+        stPairwiseAlignment_sortFile(inputFile, outputFile, sortCmpFn, memoryBudget, threadNumber, NULL, unique);
+
+        inputOrder = stHash_construct();
+        for (int64_t i = 0; i < stList_length(alignments); i++) {
+            stHash_insert(inputOrder, stList_get(alignments, i), (void *) (i + 1));
+        }
+        stList *expectedAlignments = stList_copy(alignments, NULL);
+        stList_sort(expectedAlignments, cmpByInputOrder);
+        fileHandle = fopen(outputFile, "r");
+        CuAssertIntEquals(testCase, binary && stList_length(alignments) > 0, stPairwiseAlignment_isBinary(fileHandle));
+        for (int64_t i = 0; i < stList_length(expectedAlignments); i++) {
+            struct PairwiseAlignment *pA = cigarRead(fileHandle);
+            checkEqual(testCase, stList_get(expectedAlignments, i), pA);
+            destructPairwiseAlignment(pA);
+        }
+        CuAssertPtrEquals(testCase, NULL, cigarRead(fileHandle));
+        fclose(fileHandle);
+
+        remove(inputFile);
+        remove(outputFile);
+        free(inputFile);
+        free(outputFile);
+        stHash_destruct(inputOrder);
+        stList_destruct(expectedAlignments);
+        stList_destruct(alignments);
+    }
+}
+
+CuSuite* sonLib_pairwiseAlignmentTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_pairwiseAlignment_binaryRoundTrip);
+    SUITE_ADD_TEST(suite, test_pairwiseAlignment_binaryRewind);
+    SUITE_ADD_TEST(suite, test_pairwiseAlignment_binaryClosedMidBlock);
+    SUITE_ADD_TEST(suite, test_pairwiseAlignment_sortFile);
+    return suite;
+}
@@ -11,6 +11,7 @@
  *      Author: benedictpaten
  */
 
+#include <pthread.h>
 #include "sonLibGlobalsTest.h"
 
 static int cmp32(const void *a, const void *b) {
@@ -206,6 +207,49 @@ static void test_st_random(CuTest *testCase) {
         CuAssertTrue(testCase, st_random() < 1.0);
     }
 }
+static void *getThreadRandomNumbers(void *seed) {
+    st_randomSeedThread(*(int64_t *) seed);
+    double *numbers = st_malloc(sizeof(double) * 1000);
+    for (int64_t i = 0; i < 1000; i++) {
+        numbers[i] = st_random();
+    }
+    return numbers;
+}
+static void test_st_randomSeedThread(CuTest *testCase) {
+    /*
+     * Checks that seeded threads each get their own reproducible stream of random numbers in [0, 1).
+     */
+    int64_t seeds[] = { 1, 2, 1 };
+    pthread_t threads[3];
+    for (int64_t i = 0; i < 3; i++) {
+        CuAssertTrue(testCase, pthread_create(&threads[i], NULL, getThreadRandomNumbers, &seeds[i]) == 0);
+    }
+    double *numbers[3];
+    for (int64_t i = 0; i < 3; i++) {
+        CuAssertTrue(testCase, pthread_join(threads[i], (void **) &numbers[i]) == 0);
+    }
+    bool differ = 0;
+    for (int64_t i = 0; i < 1000; i++) {
+        for (int64_t j = 0; j < 3; j++) {
+            CuAssertTrue(testCase, numbers[j][i] >= 0);
+            CuAssertTrue(testCase, numbers[j][i] < 1.0);
+        }
+        CuAssertTrue(testCase, numbers[0][i] == numbers[2][i]);
+        differ = differ || numbers[0][i] != numbers[1][i];
+    }
+    CuAssertTrue(testCase, differ);
+    for (int64_t i = 0; i < 3; i++) {
+        free(numbers[i]);
+    }
+    //Once unseeded the thread is back on the shared generator.
+    st_randomSeed(5);
+    double d = st_random();
+    st_randomSeedThread(1);
+    st_random();
+    st_randomUnseedThread();
+    st_randomSeed(5);
+    CuAssertTrue(testCase, st_random() == d);
+}
 static void test_st_randomChoice(CuTest *testCase) {
     /*
      * Excercies the random int function.
@@ -233,6 +277,7 @@ CuSuite* sonLib_stRandomTestSuite(void) {
     SUITE_ADD_TEST(suite, test_st_randomInt64_range_0);
     SUITE_ADD_TEST(suite, test_st_randomInt64_distribution_0);
     SUITE_ADD_TEST(suite, test_st_random);
+    SUITE_ADD_TEST(suite, test_st_randomSeedThread);
     SUITE_ADD_TEST(suite, test_st_randomChoice);
     return suite;
 }
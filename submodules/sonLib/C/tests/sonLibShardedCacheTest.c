@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "sonLibGlobalsTest.h"
+#include <pthread.h>
+
+static stShardedCache *cache = NULL;
+static int64_t recordSize;
+
+static void teardown() {
+    if (cache != NULL) {
+        stShardedCache_destruct(cache);
+        cache = NULL;
+    }
+}
+
+static void setup(size_t maxSize, int64_t shardNumber) {
+    teardown();
+    cache = stShardedCache_construct(maxSize, shardNumber);
+}
+
+static void readAndUpdateRecords(CuTest *testCase) {
+    setup(SIZE_MAX, 0);
+
+    CuAssertTrue(testCase, stShardedCache_getRecord(cache, 1, &recordSize) == NULL);
+    CuAssertTrue(testCase, !stShardedCache_containsRecord(cache, 1));
+
+    CuAssertTrue(testCase, stShardedCache_setRecord(cache, 1, "hello", 6));
+    CuAssertTrue(testCase, stShardedCache_setRecord(cache, 1, "world", 6));
+    CuAssertTrue(testCase, stShardedCache_setRecord(cache, INT64_MAX, "goodbye", 8));
+    CuAssertTrue(testCase, stShardedCache_setRecord(cache, INT64_MIN, "earth", 6));
+    CuAssertTrue(testCase, stShardedCache_setRecord(cache, 3, "", 0));
+
+    char *s = stShardedCache_getRecord(cache, 1, &recordSize);
+    CuAssertStrEquals(testCase, "world", s);
+    CuAssertIntEquals(testCase, 6, recordSize);
+    free(s);
+    s = stShardedCache_getRecord(cache, INT64_MAX, &recordSize);
+    CuAssertStrEquals(testCase, "goodbye", s);
+    CuAssertIntEquals(testCase, 8, recordSize);
+    free(s);
+    s = stShardedCache_getRecord(cache, INT64_MIN, &recordSize);
+    CuAssertStrEquals(testCase, "earth", s);
+    free(s);
+    free(stShardedCache_getRecord(cache, 3, &recordSize));
+    CuAssertIntEquals(testCase, 0, recordSize);
+    CuAssertTrue(testCase, stShardedCache_containsRecord(cache, 3));
+    CuAssertIntEquals(testCase, 4, stShardedCache_length(cache));
+    CuAssertIntEquals(testCase, 20, stShardedCache_size(cache));
+
+    stShardedCache_removeRecord(cache, 1);
+    stShardedCache_removeRecord(cache, 2); //Not present
+    CuAssertTrue(testCase, !stShardedCache_containsRecord(cache, 1));
+    CuAssertIntEquals(testCase, 3, stShardedCache_length(cache));
+    CuAssertIntEquals(testCase, 14, stShardedCache_size(cache));
+
+    stShardedCache_clear(cache);
+    CuAssertTrue(testCase, !stShardedCache_containsRecord(cache, INT64_MAX));
+    CuAssertIntEquals(testCase, 0, stShardedCache_length(cache));
+    CuAssertIntEquals(testCase, 0, stShardedCache_size(cache));
+
+    teardown();
+}
+
+static void concatenate(const void *record, int64_t recordSize, void *extraArg) {
+    stList_append(extraArg, stString_copy(record));
+}
+
+static void applyToRecord(CuTest *testCase) {
+    setup(SIZE_MAX, 0);
+    stShardedCache_setRecord(cache, 5, "hello", 6);
+    stList *strings = stList_construct3(0, free);
+    CuAssertTrue(testCase, stShardedCache_applyToRecord(cache, 5, concatenate, strings));
+    CuAssertTrue(testCase, !stShardedCache_applyToRecord(cache, 6, concatenate, strings));
+    CuAssertIntEquals(testCase, 1, stList_length(strings));
+    CuAssertStrEquals(testCase, "hello", stList_get(strings, 0));
+    stList_destruct(strings);
+    teardown();
+}
+
+static void counters(CuTest *testCase) {
+    setup(SIZE_MAX, 0);
+    int64_t hits, misses, evictions, rejections;
+    stShardedCache_setRecord(cache, 1, "a", 2);
+    free(stShardedCache_getRecord(cache, 1, &recordSize));
+    free(stShardedCache_getRecord(cache, 1, &recordSize));
+    free(stShardedCache_getRecord(cache, 2, &recordSize));
+    CuAssertTrue(testCase, stShardedCache_containsRecord(cache, 1)); //Not counted
+    stShardedCache_getCounters(cache, &hits, &misses, &evictions, &rejections);
+    CuAssertIntEquals(testCase, 2, hits);
+    CuAssertIntEquals(testCase, 1, misses);
+    CuAssertIntEquals(testCase, 0, evictions);
+    CuAssertIntEquals(testCase, 0, rejections);
+    stShardedCache_getCounters(cache, NULL, &misses, NULL, NULL);
+    CuAssertIntEquals(testCase, 1, misses);
+    teardown();
+}
+
+static void limitedSizeCache(CuTest *testCase) {
+    setup(12, 1);
+    int64_t evictions, rejections;
+
+    stShardedCache_setRecord(cache, 1, "abc", 4);
+    stShardedCache_setRecord(cache, 2, "def", 4);
+    stShardedCache_setRecord(cache, 3, "ghi", 4);
+    CuAssertIntEquals(testCase, 12, stShardedCache_size(cache));
+
+    // Use 1 and 3, so the hand passes over them and 2 is evicted
+    free(stShardedCache_getRecord(cache, 1, &recordSize));
+    free(stShardedCache_getRecord(cache, 3, &recordSize));
+    stShardedCache_setRecord(cache, 4, "jkl", 4);
+    CuAssertTrue(testCase, stShardedCache_containsRecord(cache, 1));
+    CuAssertTrue(testCase, !stShardedCache_containsRecord(cache, 2));
+    CuAssertTrue(testCase, stShardedCache_containsRecord(cache, 3));
+    CuAssertTrue(testCase, stShardedCache_containsRecord(cache, 4));
+    CuAssertIntEquals(testCase, 12, stShardedCache_size(cache));
+    stShardedCache_getCounters(cache, NULL, NULL, &evictions, NULL);
+    CuAssertIntEquals(testCase, 1, evictions);
+
+    // Replacing a record accounts for the size of the old one
+    stShardedCache_setRecord(cache, 4, "mn", 3);
+    CuAssertIntEquals(testCase, 11, stShardedCache_size(cache));
+    CuAssertIntEquals(testCase, 3, stShardedCache_length(cache));
+
+    // A record bigger than the cache is not admitted, and nothing is evicted for it
+    CuAssertTrue(testCase, !stShardedCache_setRecord(cache, 5, "this is too long", 17));
+    CuAssertTrue(testCase, !stShardedCache_containsRecord(cache, 5));
+    CuAssertIntEquals(testCase, 3, stShardedCache_length(cache));
+    // but it does replace the existing record
+    CuAssertTrue(testCase, !stShardedCache_setRecord(cache, 1, "this is too long", 17));
+    CuAssertTrue(testCase, !stShardedCache_containsRecord(cache, 1));
+    stShardedCache_getCounters(cache, NULL, NULL, &evictions, &rejections);
+    CuAssertIntEquals(testCase, 1, evictions);
+    CuAssertIntEquals(testCase, 2, rejections);
+
+    // A record the size of the cache evicts everything else
+    CuAssertTrue(testCase, stShardedCache_setRecord(cache, 6, "exactly fit", 12));
+    CuAssertIntEquals(testCase, 1, stShardedCache_length(cache));
+    CuAssertIntEquals(testCase, 12, stShardedCache_size(cache));
+
+    teardown();
+}
+
+static void randomOperations(CuTest *testCase) {
+    /*
+     * Compares the cache with a hash of the expected records, through enough insertions and removals
+     * to grow the tables and shift records back over removed ones.
+     */
+    for (int64_t test = 0; test < 10; test++) {
+        setup(SIZE_MAX, st_randomInt(1, 8));
+        stHash *expected = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+        int64_t keyNumber = st_randomInt(1, 1000);
+        for (int64_t i = 0; i < 10000; i++) {
+            int64_t key = st_randomInt(-keyNumber, keyNumber);
+            char *keyString = stString_print("%" PRIi64, key);
+            double r = st_random();
+            if (r < 0.4) {
+                char *value = stString_print("%" PRIi64 " %" PRIi64, key, i);
+                stShardedCache_setRecord(cache, key, value, strlen(value) + 1);
+                free(stHash_removeAndFreeKey(expected, keyString));
+                stHash_insert(expected, stString_copy(keyString), value);
+            } else if (r < 0.6) {
+                stShardedCache_removeRecord(cache, key);
+                free(stHash_removeAndFreeKey(expected, keyString));
+            } else {
+                char *value = stShardedCache_getRecord(cache, key, &recordSize);
+                char *expectedValue = stHash_search(expected, keyString);
+                if (expectedValue == NULL) {
+                    CuAssertTrue(testCase, value == NULL);
+                } else {
+                    CuAssertTrue(testCase, value != NULL);
+                    CuAssertStrEquals(testCase, expectedValue, value);
+                    CuAssertIntEquals(testCase, strlen(expectedValue) + 1, recordSize);
+                }
+                free(value);
+            }
+            free(keyString);
+        }
+        CuAssertIntEquals(testCase, stHash_size(expected), stShardedCache_length(cache));
+        stHash_destruct(expected);
+        teardown();
+    }
+}
+
+typedef struct _threadArgs {
+    int64_t seed;
+    int64_t hits;
+    int64_t misses;
+    bool ok;
+} ThreadArgs;
+
+static void *getAndSetRecords(void *extraArg) {
+    /*
+     * Each record's value is determined by its key, so any record read must match its key.
+     */
+    ThreadArgs *args = extraArg;
+    uint64_t x = args->seed;
+    for (int64_t i = 0; i < 20000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        int64_t key = (x >> 33) % 2000;
+        int64_t size;
+        int64_t *value = stShardedCache_getRecord(cache, key, &size);
+        if (value == NULL) {
+            args->misses++;
+            size = sizeof(int64_t) * (key % 16 + 1);
+            value = st_malloc(size);
+            for (int64_t j = 0; j < key % 16 + 1; j++) {
+                value[j] = key;
+            }
+            stShardedCache_setRecord(cache, key, value, size);
+        } else {
+            args->hits++;
+            if (size != (int64_t) sizeof(int64_t) * (key % 16 + 1)) {
+                args->ok = 0;
+            }
+            for (int64_t j = 0; j < size / (int64_t) sizeof(int64_t); j++) {
+                if (value[j] != key) {
+                    args->ok = 0;
+                }
+            }
+        }
+        free(value);
+    }
+    return NULL;
+}
+
+static void concurrentUse(CuTest *testCase) {
+    size_t maxSize = 20000;
+    setup(maxSize, 4);
+    int64_t threadNumber = 4;
+    pthread_t *threads = st_malloc(sizeof(pthread_t) * threadNumber);
+    ThreadArgs *args = st_calloc(threadNumber, sizeof(ThreadArgs));
+    for (int64_t i = 0; i < threadNumber; i++) {
+        args[i].seed = i + 1;
+        args[i].ok = 1;
+        CuAssertIntEquals(testCase, 0, pthread_create(&threads[i], NULL, getAndSetRecords, &args[i]));
+    }
+    int64_t hits = 0, misses = 0;
+    for (int64_t i = 0; i < threadNumber; i++) {
+        pthread_join(threads[i], NULL);
+        CuAssertTrue(testCase, args[i].ok);
+        hits += args[i].hits;
+        misses += args[i].misses;
+    }
+    int64_t cacheHits, cacheMisses, evictions;
+    stShardedCache_getCounters(cache, &cacheHits, &cacheMisses, &evictions, NULL);
+    CuAssertIntEquals(testCase, hits, cacheHits);
+    CuAssertIntEquals(testCase, misses, cacheMisses);
+    CuAssertTrue(testCase, evictions > 0);
+    CuAssertTrue(testCase, stShardedCache_size(cache) <= maxSize);
+    free(threads);
+    free(args);
+    teardown();
+}
+
+CuSuite* stShardedCacheSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, readAndUpdateRecords);
+    SUITE_ADD_TEST(suite, applyToRecord);
+    SUITE_ADD_TEST(suite, counters);
+    SUITE_ADD_TEST(suite, limitedSizeCache);
+    SUITE_ADD_TEST(suite, randomOperations);
+    SUITE_ADD_TEST(suite, concurrentUse);
+    return suite;
+}
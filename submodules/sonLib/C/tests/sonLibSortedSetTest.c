@@ -497,6 +497,59 @@ static void test_stSortedSet_searchGreaterThan(CuTest* testCase) {
     sonLibSortedSetTestTeardown();
 }
 
+static void test_stSortedSet_constructFromSortedList(CuTest* testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        stList *list = stList_construct();
+        stList *removed = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        stSortedSet *sortedSet3 = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn,
+                (void (*)(void *))stIntTuple_destruct);
+        int64_t n = st_randomInt(0, 1000);
+        for (int64_t i = 0; i < n; i++) {
+            stList_append(list, stIntTuple_construct1(i * 2));
+            stSortedSet_insert(sortedSet3, stIntTuple_construct1(i * 2));
+        }
+        stSortedSet *sortedSet4 = stSortedSet_constructFromSortedList(list,
+                (int (*)(const void *, const void *))stIntTuple_cmpFn, (void (*)(void *))stIntTuple_destruct);
+        CuAssertIntEquals(testCase, n, stSortedSet_size(sortedSet4));
+        CuAssertTrue(testCase, stSortedSet_equals(sortedSet3, sortedSet4));
+        //Check the tree stays usable under further inserts and removes
+        for (int64_t i = 0; i < n; i++) {
+            stIntTuple *j = stList_get(list, st_randomInt(0, n));
+            if (stSortedSet_search(sortedSet4, j) != NULL) {
+                stSortedSet_remove(sortedSet4, j);
+                stList_append(removed, j);
+                stList_append(removed, stSortedSet_remove(sortedSet3, j));
+                stSortedSet_insert(sortedSet3, stIntTuple_construct1(stIntTuple_get(j, 0) + 1));
+                stSortedSet_insert(sortedSet4, stIntTuple_construct1(stIntTuple_get(j, 0) + 1));
+            }
+        }
+        CuAssertIntEquals(testCase, stSortedSet_size(sortedSet3), stSortedSet_size(sortedSet4));
+        stSortedSetIterator *it = stSortedSet_getIterator(sortedSet3);
+        stSortedSetIterator *it2 = stSortedSet_getIterator(sortedSet4);
+        stIntTuple *j;
+        while ((j = stSortedSet_getNext(it)) != NULL) {
+            CuAssertIntEquals(testCase, stIntTuple_get(j, 0), stIntTuple_get(stSortedSet_getNext(it2), 0));
+        }
+        stSortedSet_destructIterator(it);
+        stSortedSet_destructIterator(it2);
+        stSortedSet_destruct(sortedSet3);
+        stSortedSet_destruct(sortedSet4);
+        stList_destruct(list);
+        stList_destruct(removed);
+    }
+    //Out of order lists are rejected
+    stList *list = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    stList_append(list, stIntTuple_construct1(2));
+    stList_append(list, stIntTuple_construct1(1));
+    stTry {
+        stSortedSet_constructFromSortedList(list, (int (*)(const void *, const void *))stIntTuple_cmpFn, NULL);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_getId(except) == SORTED_SET_EXCEPTION_ID);
+    } stTryEnd;
+    stList_destruct(list);
+}
+
 CuSuite* sonLib_stSortedSetTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stSortedSet_construct);
@@ -513,5 +566,6 @@ CuSuite* sonLib_stSortedSetTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stSortedSet_searchLessThan);
     SUITE_ADD_TEST(suite, test_stSortedSet_searchGreaterThanOrEqual);
     SUITE_ADD_TEST(suite, test_stSortedSet_searchGreaterThan);
+    SUITE_ADD_TEST(suite, test_stSortedSet_constructFromSortedList);
     return suite;
 }
@@ -65,6 +65,10 @@ class TestCase(unittest.TestCase):
         """Run the sonLib TokyoCabinet interface tests."""
         system("sonLib_kvDatabaseTest --type=tokyocabinet")
 
+    def testSonLibKVLogFile(self):
+        """Run the sonLib embedded log file database interface tests."""
+        system("sonLib_kvDatabaseTest --type=logfile --db=testLogFileDatabase")
+
 def allSuites():
     bioioSuite = unittest.makeSuite(bioioTest.TestCase, 'test')
     cigarsSuite = unittest.makeSuite(cigarsTest.TestCase, 'test')